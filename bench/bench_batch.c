@@ -0,0 +1,144 @@
+/*
+ * bench_batch.c - Multi-PID inspection benchmark
+ *
+ * Forks 300 idle children (a service's worker processes) and times one
+ * collect_process_reports() call over all of them at several pool sizes.
+ * Wall-clock time should drop with pool size up to the number of cores.
+ * Then times the collectors a --fields selection leaves running, against
+ * the default plain-text report.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "../include/batch.h"
+#include "../include/workpool.h"
+
+#define CHILDREN 300
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+ * Time ROUNDS batches with the given pool size.
+ * Returns best wall-clock milliseconds, or -1 on error.
+ */
+static double run_options(const pid_t *pids, int count,
+                          const batch_options_t *opts)
+{
+    double best = -1;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        process_report_t *reports = NULL;
+        double start = now_ns();
+        if (collect_process_reports(pids, count, opts, &reports) != 0) {
+            return -1;
+        }
+        double ms = (now_ns() - start) / 1e6;
+        process_reports_free(reports, count);
+
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+
+    return best;
+}
+
+/*
+ * Time ROUNDS batches of status + fds + threads with the given pool size.
+ * Returns best wall-clock milliseconds, or -1 on error.
+ */
+static double run_case(const pid_t *pids, int count, int workers)
+{
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = true, .sockets = false,
+                             .workers = workers };
+    return run_options(pids, count, &opts);
+}
+
+int main(void)
+{
+    pid_t pids[CHILDREN];
+    int started = 0;
+
+    for (int i = 0; i < CHILDREN; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            pause();
+            _exit(0);
+        }
+        if (child < 0) {
+            break;
+        }
+        pids[started++] = child;
+    }
+
+    printf("\n=== Multi-PID Inspection Benchmark ===\n");
+    printf("%d processes, status + fds + threads, best of %d, %d CPUs\n\n",
+           started, ROUNDS, workpool_default_size());
+    printf("  Workers  Wall ms  Speedup\n");
+    printf("  -------  -------  -------\n");
+
+    static const int sizes[] = { 1, 2, 4, 8 };
+    double single = -1;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        double ms = run_case(pids, started, sizes[i]);
+        if (ms < 0) {
+            printf("  %-7d  failed\n", sizes[i]);
+            continue;
+        }
+        if (single < 0) {
+            single = ms;
+        }
+        printf("  %-7d  %7.2f  %6.2fx\n", sizes[i], ms, single / ms);
+    }
+
+    /* What the plain text report runs, then --fields selections */
+    static const struct {
+        const char *name;
+        batch_options_t opts;
+    } selections[] = {
+        { "default report", { .status_fields = FIELDS_STATUS, .fds = true,
+                              .sockets = true, .counts_only = true,
+                              .workers = 1 } },
+        { "--fields=rss,fds", { .status_fields = FIELD_VM_RSS, .fds = true,
+                                .counts_only = true, .workers = 1 } },
+        { "--fields=rss", { .status_fields = FIELD_VM_RSS,
+                            .counts_only = true, .workers = 1 } },
+        { "--fields=name", { .status_fields = FIELD_NAME,
+                             .counts_only = true, .workers = 1 } },
+        { "--fields=fds", { .status_fields = 0, .fds = true,
+                            .counts_only = true, .workers = 1 } },
+    };
+
+    printf("\n  Selection (1 worker)  Wall ms  us/process\n");
+    printf("  --------------------  -------  ----------\n");
+    for (size_t i = 0; i < sizeof(selections) / sizeof(selections[0]); i++) {
+        double ms = run_options(pids, started, &selections[i].opts);
+        if (ms < 0) {
+            printf("  %-20s  failed\n", selections[i].name);
+            continue;
+        }
+        printf("  %-20s  %7.2f  %10.2f\n", selections[i].name, ms,
+               ms * 1000.0 / started);
+    }
+
+    for (int i = 0; i < started; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+    }
+
+    return 0;
+}
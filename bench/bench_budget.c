@@ -0,0 +1,196 @@
+/*
+ * bench_budget.c - What inspecting a busy process costs it
+ *
+ * Forks a target holding 15,000 FDs (12,000 /dev/null, 3,000 sockets)
+ * that dup()s and closes an FD in a loop, counting iterations in shared
+ * memory; each dup() takes the file table lock that every fd/ readlink
+ * takes too. Runs enumerate_fds() on it back to back for one second,
+ * with no budget and with syscall and CPU budgets, and reports the
+ * target's dup() rate and the inspector's syscall rate during each. Then
+ * stops the target and compares sample_fds() of several sizes with a
+ * full enumeration: time, and the socket estimate against the true 3,000.
+ */
+
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "../include/budget.h"
+#include "../include/proc_fd.h"
+#include "../include/sample.h"
+
+#define FILES 12000
+#define SOCKETS 3000
+#define WINDOW_NS 1000000000.0
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Target: open the FDs, report ready, then dup/close until killed */
+static void run_target(_Atomic long *iterations, int ready_fd)
+{
+    for (int i = 0; i < FILES; i++) {
+        if (open("/dev/null", O_RDONLY) < 0) {
+            _exit(1);
+        }
+    }
+    for (int i = 0; i < SOCKETS; i++) {
+        if (socket(AF_UNIX, SOCK_STREAM, 0) < 0) {
+            _exit(1);
+        }
+    }
+    char ok = 1;
+    if (write(ready_fd, &ok, 1) != 1) {
+        _exit(1);
+    }
+    for (;;) {
+        int fd = dup(0);
+        if (fd >= 0) {
+            close(fd);
+        }
+        atomic_fetch_add_explicit(iterations, 1, memory_order_relaxed);
+    }
+}
+
+/*
+ * Enumerate pid back to back for WINDOW_NS under budget (NULL for none).
+ * Prints the target's dup() rate and the enumerations and syscalls done.
+ */
+static void run_window(const char *label, pid_t pid, const budget_t *budget,
+                       _Atomic long *iterations)
+{
+    budget_set(budget);
+    long before = atomic_load(iterations);
+    double start = now_ns();
+    int walks = 0;
+    long fds = 0;
+    while (now_ns() - start < WINDOW_NS) {
+        fd_list_t list;
+        if (enumerate_fds(pid, &list) == 0) {
+            fds += list.count;
+            fd_list_free(&list);
+        }
+        walks++;
+    }
+    double elapsed = now_ns() - start;
+    long done = atomic_load(iterations) - before;
+    double slept = (double)budget_slept_ns();
+    budget_set(NULL);
+
+    printf("  %-22s %11.0f %8d %12.0f %9.0f%%\n", label,
+           (double)done * 1e9 / elapsed, walks, (double)fds * 1e9 / elapsed,
+           100.0 * slept / elapsed);
+}
+
+/* Best-of-ROUNDS ns for sample_fds() at size; fills out from the last */
+static double time_sample(pid_t pid, int size, fd_sample_t *out)
+{
+    double best = -1;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = now_ns();
+        if (sample_fds(pid, size, (uint64_t)round + 1, out) != 0) {
+            return -1;
+        }
+        double ns = now_ns() - start;
+        if (best < 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(void)
+{
+    _Atomic long *iterations = mmap(NULL, sizeof(*iterations),
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int ready[2];
+    if (iterations == MAP_FAILED || pipe(ready) != 0) {
+        perror("setup");
+        return 1;
+    }
+    atomic_store(iterations, 0);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(ready[0]);
+        run_target(iterations, ready[1]);
+    }
+    close(ready[1]);
+    char ok = 0;
+    if (pid < 0 || read(ready[0], &ok, 1) != 1 || ok != 1) {
+        printf("target did not start (RLIMIT_NOFILE below %d?)\n",
+               FILES + SOCKETS + 8);
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+        }
+        return 0;
+    }
+    close(ready[0]);
+
+    printf("Target with %d FDs dup()ing in a loop, enumerate_fds() "
+           "back to back for 1 s\n\n", FILES + SOCKETS);
+    printf("  %-22s %11s %8s %12s %10s\n", "", "target dup/s", "walks",
+           "readlinks/s", "asleep");
+
+    /* The inspector idle: the target's undisturbed rate */
+    long before = atomic_load(iterations);
+    double start = now_ns();
+    struct timespec idle = { .tv_sec = 1, .tv_nsec = 0 };
+    nanosleep(&idle, NULL);
+    printf("  %-22s %11.0f %8d %12d %9d%%\n", "not inspected",
+           (double)(atomic_load(iterations) - before) * 1e9 /
+               (now_ns() - start), 0, 0, 100);
+
+    budget_t by_calls = { .syscalls_per_sec = 20000 };
+    budget_t by_cpu = { .cpu_percent = 10 };
+    run_window("no budget", pid, NULL, iterations);
+    run_window("--max-syscalls=20000", pid, &by_calls, iterations);
+    run_window("--max-cpu=10", pid, &by_cpu, iterations);
+
+    /* Stopped, so the timings below are the inspector's alone */
+    kill(pid, SIGSTOP);
+    fd_list_t list;
+    double full_start = now_ns();
+    int ret = enumerate_fds(pid, &list);
+    double full_ns = now_ns() - full_start;
+    if (ret == 0) {
+        fd_list_free(&list);
+    }
+
+    printf("\nSocket count from a sample vs enumerate_fds() (%.2f ms, "
+           "true count %d)\n\n", full_ns / 1e6, SOCKETS);
+    printf("  %7s %9s %9s %21s\n", "sample", "ms", "estimate",
+           "95% interval");
+    static const int sizes[] = { 100, 400, 1600, 6400 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        fd_sample_t sample;
+        double ns = time_sample(pid, sizes[s], &sample);
+        count_estimate_t e;
+        if (ns < 0 ||
+            estimate_count(sample.type_counts[FD_TYPE_SOCKET],
+                           sample.sampled, sample.total, &e) != 0) {
+            continue;
+        }
+        printf("  %7d %9.2f %9.0f       [%5.0f, %5.0f]\n", sizes[s],
+               ns / 1e6, e.estimate, e.low, e.high);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
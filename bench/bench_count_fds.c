@@ -0,0 +1,128 @@
+/*
+ * bench_count_fds.c - FD count versus full enumeration
+ *
+ * Opens as many descriptors as RLIMIT_NOFILE allows (up to 1M) and times
+ * count_fds() against for_each_fd() and enumerate_fds() on the current
+ * process at several table sizes. count_fds() should stay flat while the
+ * readlink() walks grow linearly.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../include/proc_fd.h"
+
+#define MAX_FDS (1024 * 1024)
+#define ROUNDS 3
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int count_visitor(const fd_entry_t *entry, const char *target,
+                         void *ctx)
+{
+    (void)entry;
+    (void)target;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+/*
+ * Best-of-ROUNDS milliseconds for each method; counts must agree.
+ * Returns 0 on success, -1 on error.
+ */
+static int run_case(int open_fds)
+{
+    double best[3] = { -1, -1, -1 };
+    int counts[3] = { 0, 0, 0 };
+
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = now_ns();
+        if (count_fds(getpid(), &counts[0]) != 0) {
+            return -1;
+        }
+        double t0 = now_ns() - start;
+
+        counts[1] = 0;
+        start = now_ns();
+        if (for_each_fd(getpid(), count_visitor, &counts[1]) != 0) {
+            return -1;
+        }
+        double t1 = now_ns() - start;
+
+        fd_list_t list;
+        start = now_ns();
+        if (enumerate_fds(getpid(), &list) != 0) {
+            return -1;
+        }
+        double t2 = now_ns() - start;
+        counts[2] = list.count;
+        fd_list_free(&list);
+
+        double times[3] = { t0, t1, t2 };
+        for (int i = 0; i < 3; i++) {
+            if (best[i] < 0 || times[i] < best[i]) {
+                best[i] = times[i];
+            }
+        }
+    }
+
+    printf("  %8d  %12.3f  %12.3f  %14.3f  %s\n", open_fds,
+           best[0] / 1e6, best[1] / 1e6, best[2] / 1e6,
+           (counts[0] == counts[1] && counts[1] == counts[2]) ? "ok"
+                                                              : "MISMATCH");
+    return 0;
+}
+
+int main(void)
+{
+    /* Raise the soft limit as far as allowed */
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        rlim_t want = (lim.rlim_max == RLIM_INFINITY || lim.rlim_max > MAX_FDS)
+                          ? MAX_FDS : lim.rlim_max;
+        lim.rlim_cur = want;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+    }
+    int limit = (lim.rlim_cur > MAX_FDS) ? MAX_FDS : (int)lim.rlim_cur;
+
+    int base = open("/dev/null", O_RDONLY);
+    if (base < 0) {
+        perror("open");
+        return 1;
+    }
+
+    printf("count_fds vs readlink walks (best of %d, ms)\n\n", ROUNDS);
+    printf("  %8s  %12s  %12s  %14s\n", "FDs", "count_fds", "for_each_fd",
+           "enumerate_fds");
+
+    int open_fds = 4;
+    int targets[] = { 1000, 10000, 100000, MAX_FDS };
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        /* Leave headroom for the directory handles the walks open */
+        int goal = targets[t] < limit - 16 ? targets[t] : limit - 16;
+        while (open_fds < goal && dup(base) >= 0) {
+            open_fds++;
+        }
+        if (run_case(open_fds) != 0) {
+            perror("run_case");
+            return 1;
+        }
+        if (goal < targets[t]) {
+            printf("  (RLIMIT_NOFILE caps the table at %d)\n", limit);
+            break;
+        }
+    }
+
+    return 0;
+}
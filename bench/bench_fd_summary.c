@@ -0,0 +1,221 @@
+/*
+ * bench_fd_summary.c - FD summary versus enumerate-and-count
+ *
+ * Builds FD tables of growing size on the current process, either as a
+ * leak (every FD a dup() of one leaked file) or as many distinct files
+ * (each FD on its own file in a temporary directory). For each, gets
+ * kind counts and the top-10 paths two ways: enumerate_fds() then sort
+ * the targets and count runs, as post-processing -v output would, and
+ * summarize_fds(). Reports best-of-ROUNDS time and the bytes each keeps.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../include/fd_summary.h"
+#include "../include/proc_fd.h"
+
+#define MAX_FDS 100000
+#define ROUNDS 3
+#define TOP_K 10
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static const fd_list_t *sort_list;
+
+static int compare_targets(const void *a, const void *b)
+{
+    return strcmp(fd_target(sort_list, *(const fd_entry_t *const *)a),
+                  fd_target(sort_list, *(const fd_entry_t *const *)b));
+}
+
+/*
+ * The -v route: enumerate, sort pointers to the path entries and count
+ * each run of equal targets. Returns bytes held at the peak (list plus
+ * the pointer array), or 0 on error; *top_count is the largest run.
+ */
+static size_t enumerate_and_count(int *kinds, int *top_count)
+{
+    fd_list_t list;
+    if (enumerate_fds(getpid(), &list) != 0) {
+        return 0;
+    }
+    const fd_entry_t **paths = malloc((size_t)(list.count + 1) *
+                                      sizeof(*paths));
+    if (paths == NULL) {
+        fd_list_free(&list);
+        return 0;
+    }
+
+    int n = 0;
+    for (int i = 0; i < list.count; i++) {
+        const char *target = fd_target(&list, &list.entries[i]);
+        fd_kind_t kind = classify_fd_kind(target);
+        kinds[kind]++;
+        if (kind == FD_KIND_FILE || kind == FD_KIND_DELETED ||
+            kind == FD_KIND_DEVICE) {
+            paths[n++] = &list.entries[i];
+        }
+    }
+    sort_list = &list;
+    qsort(paths, (size_t)n, sizeof(*paths), compare_targets);
+
+    *top_count = 0;
+    for (int i = 0, run = 0; i < n; i++) {
+        run = (i > 0 && compare_targets(&paths[i - 1], &paths[i]) == 0)
+                  ? run + 1 : 1;
+        if (run > *top_count) {
+            *top_count = run;
+        }
+    }
+
+    size_t bytes = (size_t)list.count * sizeof(fd_entry_t) +
+                   list.strings_len + (size_t)n * sizeof(*paths);
+    free(paths);
+    fd_list_free(&list);
+    return bytes;
+}
+
+/* Bytes summarize_fds() keeps: the slot arrays and the path arena */
+static size_t summary_bytes(const fd_summary_t *s)
+{
+    return s->capacity * (sizeof(*s->hashes) + sizeof(*s->offsets) +
+                          sizeof(*s->counts)) + s->strings_capacity;
+}
+
+/*
+ * Time both methods on the current table and print a row.
+ * Returns 0 on success, -1 on error.
+ */
+static int run_case(const char *pattern, int open_fds)
+{
+    double best[2] = { -1, -1 };
+    size_t bytes[2] = { 0, 0 };
+    int top[2] = { 0, 0 };
+    size_t distinct = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        int kinds[FD_KIND_OTHER + 1] = { 0 };
+        double start = now_ns();
+        bytes[0] = enumerate_and_count(kinds, &top[0]);
+        double t0 = now_ns() - start;
+        if (bytes[0] == 0) {
+            return -1;
+        }
+
+        fd_summary_t s;
+        fd_path_count_t rows[TOP_K];
+        start = now_ns();
+        int n = (summarize_fds(getpid(), &s) == 0)
+                    ? fd_summary_top(&s, rows, TOP_K) : -1;
+        double t1 = now_ns() - start;
+        if (n <= 0) {
+            fd_summary_free(&s);
+            return -1;
+        }
+        top[1] = rows[0].count;
+        bytes[1] = summary_bytes(&s);
+        distinct = s.distinct;
+        fd_summary_free(&s);
+
+        double times[2] = { t0, t1 };
+        for (int i = 0; i < 2; i++) {
+            if (best[i] < 0 || times[i] < best[i]) {
+                best[i] = times[i];
+            }
+        }
+    }
+
+    printf("  %-8s %7d %9zu %11.2f %9.2f %10.1f %9.1f  %s\n", pattern,
+           open_fds, distinct, best[0] / 1e6, best[1] / 1e6,
+           (double)bytes[0] / 1024, (double)bytes[1] / 1024,
+           (top[0] == top[1]) ? "ok" : "MISMATCH");
+    return 0;
+}
+
+/* Close every FD above base */
+static void close_above(int base, int open_fds)
+{
+    for (int fd = base + 1; fd < base + open_fds; fd++) {
+        close(fd);
+    }
+}
+
+int main(void)
+{
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        rlim_t want = (lim.rlim_max == RLIM_INFINITY || lim.rlim_max > MAX_FDS)
+                          ? MAX_FDS : lim.rlim_max;
+        lim.rlim_cur = want;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+    }
+    int limit = (lim.rlim_cur > MAX_FDS) ? MAX_FDS : (int)lim.rlim_cur;
+
+    char dir[] = "/tmp/pinspect_benchXXXXXX";
+    int leaked = open("/dev/null", O_RDONLY);
+    if (mkdtemp(dir) == NULL || leaked < 0) {
+        perror("setup");
+        return 1;
+    }
+
+    printf("Kind counts and top %d paths (best of %d)\n\n", TOP_K, ROUNDS);
+    printf("  %-8s %7s %9s %11s %9s %10s %9s\n", "pattern", "FDs",
+           "distinct", "enum+sort", "summary", "enum KB", "sum KB");
+    printf("  %-8s %7s %9s %11s %9s %10s %9s\n", "", "", "", "ms", "ms",
+           "", "");
+
+    int targets[] = { 1000, 10000, MAX_FDS };
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        /* Leave headroom for the directory handles the walks open */
+        int goal = targets[t] < limit - 16 ? targets[t] : limit - 16;
+
+        int open_fds = 1;
+        while (open_fds < goal && dup(leaked) >= 0) {
+            open_fds++;
+        }
+        int ret = run_case("leak", open_fds);
+        close_above(leaked, open_fds);
+
+        char path[64];
+        open_fds = 1;
+        while (ret == 0 && open_fds < goal) {
+            snprintf(path, sizeof(path), "%s/%d", dir, open_fds);
+            if (open(path, O_CREAT | O_RDONLY, 0600) < 0) {
+                break;
+            }
+            open_fds++;
+        }
+        ret = (ret == 0) ? run_case("distinct", open_fds) : ret;
+        close_above(leaked, open_fds);
+        for (int i = 1; i < open_fds; i++) {
+            snprintf(path, sizeof(path), "%s/%d", dir, i);
+            unlink(path);
+        }
+
+        if (ret != 0) {
+            perror("run_case");
+            rmdir(dir);
+            return 1;
+        }
+        if (goal < targets[t]) {
+            printf("  (RLIMIT_NOFILE caps the table at %d)\n", limit);
+            break;
+        }
+    }
+
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * bench_fd_uring.c - readlink versus io_uring FD resolution
+ *
+ * Fills the FD table of the current process with equal shares of socket
+ * pairs, pipes and /dev/null handles, as far as RLIMIT_NOFILE allows, and
+ * times enumerate_fds() on it with FD_BACKEND_READLINK and
+ * FD_BACKEND_URING. The syscall columns are readlinkat(), getdents64()
+ * and io_uring_enter() calls per walk, from the --stats counters; they
+ * show "-" in STATS=0 builds.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "../include/proc_fd.h"
+#include "../include/stats.h"
+#include "../include/uring.h"
+
+#define MAX_FDS (1024 * 1024)
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Best-of-ROUNDS time and syscalls of one backend */
+typedef struct {
+    double best_ns;
+    int count;
+    uint64_t syscalls;
+} backend_result_t;
+
+/*
+ * Time enumerate_fds() on ourselves with backend. Returns 0 on success,
+ * -1 on error.
+ */
+static int run_backend(fd_backend_t backend, backend_result_t *r)
+{
+    fd_set_backend(backend);
+    r->best_ns = -1;
+    for (int round = 0; round < ROUNDS; round++) {
+        stats_enable();
+        fd_list_t list;
+        double start = now_ns();
+        if (enumerate_fds(getpid(), &list) != 0) {
+            return -1;
+        }
+        double ns = now_ns() - start;
+        stats_snapshot_t snap;
+        stats_snapshot(&snap);
+        r->count = list.count;
+        fd_list_free(&list);
+
+        const uint64_t *fd = snap.values[STATS_PHASE_FDS];
+        r->syscalls = fd[STATS_READLINKS] + fd[STATS_GETDENTS] +
+                      fd[STATS_RING_ENTERS];
+        if (r->best_ns < 0 || ns < r->best_ns) {
+            r->best_ns = ns;
+        }
+    }
+    return 0;
+}
+
+/* Print a syscall count, or "-" when the build does not count */
+static void print_syscalls(uint64_t n)
+{
+    if (stats_supported()) {
+        printf("  %9llu", (unsigned long long)n);
+    } else {
+        printf("  %9s", "-");
+    }
+}
+
+/*
+ * Open one socket pair, one pipe and one /dev/null handle. Returns the
+ * number of FDs opened.
+ */
+static int open_fd_set(int devnull)
+{
+    int n = 0;
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0) {
+        n += 2;
+    }
+    if (pipe(pair) == 0) {
+        n += 2;
+    }
+    if (dup(devnull) >= 0) {
+        n++;
+    }
+    return n;
+}
+
+int main(void)
+{
+    /* Raise the soft limit as far as allowed */
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        rlim_t want = (lim.rlim_max == RLIM_INFINITY || lim.rlim_max > MAX_FDS)
+                          ? MAX_FDS : lim.rlim_max;
+        lim.rlim_cur = want;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+    }
+    int limit = (lim.rlim_cur > MAX_FDS) ? MAX_FDS : (int)lim.rlim_cur;
+
+    int devnull = open("/dev/null", O_RDONLY);
+    if (devnull < 0) {
+        perror("open");
+        return 1;
+    }
+
+    printf("enumerate_fds: readlink vs io_uring backend (best of %d)\n",
+           ROUNDS);
+    printf("io_uring %s\n\n", uring_supported() ? "available"
+                                                : "unavailable: uring runs "
+                                                  "the readlink path");
+    printf("                 ms per walk          ns per FD        syscalls\n");
+    printf("  %8s  %9s  %9s  %9s  %9s  %9s  %9s\n", "FDs", "readlink",
+           "uring", "readlink", "uring", "readlink", "uring");
+
+    int open_fds = 4;
+    int targets[] = { 1000, 10000, 100000, MAX_FDS };
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        /* Leave headroom for the directory and ring handles */
+        int goal = targets[t] < limit - 16 ? targets[t] : limit - 16;
+        while (open_fds + 5 <= goal) {
+            int n = open_fd_set(devnull);
+            if (n == 0) {
+                break;
+            }
+            open_fds += n;
+        }
+
+        backend_result_t rl;
+        backend_result_t ur;
+        if (run_backend(FD_BACKEND_READLINK, &rl) != 0 ||
+            run_backend(FD_BACKEND_URING, &ur) != 0) {
+            perror("enumerate_fds");
+            return 1;
+        }
+        printf("  %8d  %9.3f  %9.3f  %9.1f  %9.1f", rl.count,
+               rl.best_ns / 1e6, ur.best_ns / 1e6, rl.best_ns / rl.count,
+               ur.best_ns / ur.count);
+        print_syscalls(rl.syscalls);
+        print_syscalls(ur.syscalls);
+        printf("%s\n", (rl.count == ur.count) ? "" : "  MISMATCH");
+
+        if (goal < targets[t]) {
+            printf("  (RLIMIT_NOFILE caps the table at %d)\n", limit);
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * bench_idmap.c - Socket inode correlation benchmark
+ *
+ * Compares the old linear inode_in_set() scan with id_map lookups for
+ * processes owning 1k, 10k and 100k sockets. Each "row" simulates one line
+ * of /proc/net/tcp being checked against the process's inode set; roughly
+ * one row in five belongs to the process.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../include/idmap.h"
+
+/* Table rows checked per measurement (like a busy /proc/net/tcp) */
+#define TABLE_ROWS 200000
+
+/* Cap on linear-scan comparisons so the 100k case finishes */
+#define LINEAR_WORK_CAP 400000000UL
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Baseline copied from net.c before the hash map was introduced */
+static bool inode_in_set(unsigned long inode, unsigned long *set, int set_size)
+{
+    for (int i = 0; i < set_size; i++) {
+        if (set[i] == inode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Simple xorshift so runs are reproducible */
+static unsigned long next_rand(unsigned long *state)
+{
+    unsigned long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void run_case(int sockets)
+{
+    unsigned long seed = 0x2545F4914F6CDD1DUL;
+    unsigned long *inodes = malloc((size_t)sockets * sizeof(unsigned long));
+    unsigned long *rows = malloc(TABLE_ROWS * sizeof(unsigned long));
+    if (inodes == NULL || rows == NULL) {
+        free(inodes);
+        free(rows);
+        return;
+    }
+
+    for (int i = 0; i < sockets; i++) {
+        inodes[i] = 1000000 + (next_rand(&seed) % 100000000UL);
+    }
+    for (int i = 0; i < TABLE_ROWS; i++) {
+        rows[i] = (i % 5 == 0) ? inodes[next_rand(&seed) % sockets]
+                               : 1000000 + (next_rand(&seed) % 100000000UL);
+    }
+
+    /* Linear scan: limit rows so total comparisons stay bounded */
+    int linear_rows = TABLE_ROWS;
+    if ((unsigned long)linear_rows * (unsigned long)sockets > LINEAR_WORK_CAP) {
+        linear_rows = (int)(LINEAR_WORK_CAP / (unsigned long)sockets);
+    }
+
+    volatile int hits = 0;
+    double start = now_ns();
+    for (int i = 0; i < linear_rows; i++) {
+        if (inode_in_set(rows[i], inodes, sockets)) {
+            hits++;
+        }
+    }
+    double linear_ns = (now_ns() - start) / linear_rows;
+
+    start = now_ns();
+    id_map_t map;
+    if (id_map_init(&map, (size_t)sockets) != 0) {
+        free(inodes);
+        free(rows);
+        return;
+    }
+    for (int i = 0; i < sockets; i++) {
+        id_map_put(&map, inodes[i], i);
+    }
+    double build_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < TABLE_ROWS; i++) {
+        if (id_map_contains(&map, rows[i])) {
+            hits++;
+        }
+    }
+    double hash_ns = (now_ns() - start) / TABLE_ROWS;
+
+    printf("  %7d  %12.1f  %10.1f  %10.1f  %9.0fx\n",
+           sockets, linear_ns, hash_ns, build_ns / 1e3,
+           hash_ns > 0 ? linear_ns / hash_ns : 0.0);
+
+    id_map_free(&map);
+    free(inodes);
+    free(rows);
+}
+
+int main(void)
+{
+    static const int sizes[] = {1000, 10000, 100000};
+
+    printf("\n=== Socket Inode Correlation Benchmark ===\n\n");
+    printf("  %d table rows, ~20%% owned by the process\n\n", TABLE_ROWS);
+    printf("  Sockets  Linear ns/row  Hash ns/row  Build (us)  Speedup\n");
+    printf("  -------  -------------  -----------  ----------  -------\n");
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run_case(sizes[i]);
+    }
+
+    return 0;
+}
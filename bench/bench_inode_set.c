@@ -0,0 +1,182 @@
+/*
+ * bench_inode_set.c - Sorting and looking up socket inodes
+ *
+ * Builds sets of 1,000 to 1,000,000 random socket inodes and times two
+ * things. Sorting (inode, FD) pairs: radix_sort_ids() against qsort().
+ * Looking up table rows: an id_map_t (what the table walk uses),
+ * inode_set_find()'s Eytzinger search and a plain binary search over the
+ * sorted inodes. A quarter of the lookups hit, like a socket table where
+ * most rows belong to other processes.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../include/idmap.h"
+#include "../include/inode_set.h"
+
+#define LOOKUPS 4000000
+#define ROUNDS 3
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dull;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+typedef struct {
+    unsigned long key;
+    int value;
+} pair_t;
+
+static int compare_pairs(const void *a, const void *b)
+{
+    const pair_t *x = a;
+    const pair_t *y = b;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+/* Lower-bound binary search; returns true if key is in sorted[0, n) */
+static bool binary_search(const unsigned long *sorted, int n,
+                          unsigned long key)
+{
+    int lo = 0;
+    int hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < n && sorted[lo] == key;
+}
+
+/* Best-of-ROUNDS ns per key of radix_sort_ids() or qsort() */
+static double time_sort(const unsigned long *inodes, int n, bool radix)
+{
+    unsigned long *keys = malloc((size_t)n * sizeof(*keys));
+    int *values = malloc((size_t)n * sizeof(*values));
+    pair_t *pairs = malloc((size_t)n * sizeof(*pairs));
+    double best = -1;
+    for (int round = 0; keys && values && pairs && round < ROUNDS; round++) {
+        for (int i = 0; i < n; i++) {
+            keys[i] = inodes[i];
+            values[i] = i;
+            pairs[i].key = inodes[i];
+            pairs[i].value = i;
+        }
+        double start = now_ns();
+        if (radix) {
+            radix_sort_ids(keys, values, (size_t)n);
+        } else {
+            qsort(pairs, (size_t)n, sizeof(*pairs), compare_pairs);
+        }
+        double ns = (now_ns() - start) / n;
+        if (best < 0 || ns < best) {
+            best = ns;
+        }
+    }
+    free(keys);
+    free(values);
+    free(pairs);
+    return best;
+}
+
+int main(void)
+{
+    static const int sizes[] = { 1000, 100000, 1000000 };
+    unsigned long *queries = malloc(LOOKUPS * sizeof(*queries));
+    if (queries == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("Socket inode sets: sort ns per key, lookup ns per row "
+           "(25%% hits)\n\n");
+    printf("  %9s  %7s  %7s  %8s  %9s  %8s\n", "inodes", "radix", "qsort",
+           "id_map", "eytzinger", "bsearch");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        unsigned long span = 50ul * (unsigned long)n;
+
+        /* A process's socket FDs: random inodes, a few shared */
+        fd_list_t list = { .entries = calloc((size_t)n, sizeof(fd_entry_t)),
+                           .count = n };
+        unsigned long *inodes = malloc((size_t)n * sizeof(*inodes));
+        if (list.entries == NULL || inodes == NULL) {
+            perror("malloc");
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            inodes[i] = 1000000 + (unsigned long)(next_random() % span);
+            list.entries[i].fd = i;
+            list.entries[i].type = FD_TYPE_SOCKET;
+            list.entries[i].socket_inode = inodes[i];
+        }
+
+        inode_set_t set;
+        id_map_t map;
+        if (inode_set_build(&set, &list) != 0 ||
+            id_map_init(&map, (size_t)set.count) != 0) {
+            perror("build");
+            return 1;
+        }
+        for (int i = 0; i < set.count; i++) {
+            id_map_put(&map, set.inodes[i], i);
+        }
+        for (int i = 0; i < LOOKUPS; i++) {
+            queries[i] = (i % 4 == 0)
+                             ? set.inodes[next_random() % set.count]
+                             : 1000000 + (unsigned long)(next_random() %
+                                                         span);
+        }
+
+        double lookup_ns[3];
+        size_t hits[3] = { 0, 0, 0 };
+        for (int mode = 0; mode < 3; mode++) {
+            double start = now_ns();
+            for (int i = 0; i < LOOKUPS; i++) {
+                if (mode == 0) {
+                    hits[mode] += id_map_contains(&map, queries[i]);
+                } else if (mode == 1) {
+                    hits[mode] += inode_set_find(&set, queries[i]) >= 0;
+                } else {
+                    hits[mode] += binary_search(set.inodes, set.count,
+                                                queries[i]);
+                }
+            }
+            lookup_ns[mode] = (now_ns() - start) / LOOKUPS;
+        }
+
+        printf("  %9d  %7.1f  %7.1f  %8.1f  %9.1f  %8.1f%s\n", set.count,
+               time_sort(inodes, n, true), time_sort(inodes, n, false),
+               lookup_ns[0], lookup_ns[1], lookup_ns[2],
+               (hits[0] == hits[1] && hits[1] == hits[2]) ? ""
+                                                          : "  MISMATCH");
+
+        id_map_free(&map);
+        inode_set_free(&set);
+        free(inodes);
+        free(list.entries);
+    }
+
+    free(queries);
+    return 0;
+}
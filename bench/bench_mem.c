@@ -0,0 +1,126 @@
+/*
+ * bench_mem.c - smaps_rollup vs full smaps benchmark
+ *
+ * Splits one anonymous mapping into REGIONS read-write/read-only page
+ * pairs (2 * REGIONS mappings, under the default vm.max_map_count of
+ * 65530), touches each one, then times
+ * read_mem_usage() (smaps_rollup), for_each_vma() and
+ * enumerate_mem_files() (streaming smaps) on this process.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "../include/proc_mem.h"
+
+#define REGIONS 30000
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* for_each_vma() visitor counting mappings */
+static int count_vma(const vma_info_t *vma, void *ctx)
+{
+    (void)vma;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+/*
+ * Map count two-page regions whose second page is read-only.
+ * Returns the number actually split.
+ */
+static int map_regions(int count)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    size_t len = (size_t)page * 2 * (size_t)count;
+
+    /* Reserve one range, then split it into alternating protections */
+    char *base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+
+    int mapped = 0;
+    for (int i = 0; i < count; i++) {
+        char *region = base + (size_t)i * 2 * (size_t)page;
+        region[0] = 1;
+        if (mprotect(region + page, (size_t)page, PROT_READ) != 0) {
+            break;
+        }
+        mapped++;
+    }
+    return mapped;
+}
+
+int main(void)
+{
+    int regions = map_regions(REGIONS);
+    pid_t self = getpid();
+    double rollup = -1, walk = -1, files = -1;
+    int vmas = 0;
+    int file_count = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        mem_usage_t usage;
+        double start = now_ns();
+        if (read_mem_usage(self, &usage) != 0) {
+            perror("read_mem_usage");
+            return 1;
+        }
+        double ns = now_ns() - start;
+        if (rollup < 0 || ns < rollup) {
+            rollup = ns;
+        }
+
+        vmas = 0;
+        start = now_ns();
+        if (for_each_vma(self, count_vma, &vmas) != 0) {
+            perror("for_each_vma");
+            return 1;
+        }
+        ns = now_ns() - start;
+        if (walk < 0 || ns < walk) {
+            walk = ns;
+        }
+
+        mem_file_list_t list;
+        start = now_ns();
+        if (enumerate_mem_files(self, &list) != 0) {
+            perror("enumerate_mem_files");
+            return 1;
+        }
+        ns = now_ns() - start;
+        file_count = list.count;
+        mem_file_list_free(&list);
+        if (files < 0 || ns < files) {
+            files = ns;
+        }
+    }
+
+    printf("\n=== Memory Map Benchmark ===\n");
+    printf("%d mappings (%d split regions), %d files, best of %d\n\n",
+           vmas, regions, file_count, ROUNDS);
+    printf("  %-22s  %10s  %12s\n", "Call", "Total ms", "ns/mapping");
+    printf("  %-22s  %10s  %12s\n", "----------------------",
+           "----------", "------------");
+    printf("  %-22s  %10.3f  %12s\n", "read_mem_usage (rollup)",
+           rollup / 1e6, "-");
+    printf("  %-22s  %10.3f  %12.0f\n", "for_each_vma", walk / 1e6,
+           walk / vmas);
+    printf("  %-22s  %10.3f  %12.0f\n", "enumerate_mem_files", files / 1e6,
+           files / vmas);
+
+    return 0;
+}
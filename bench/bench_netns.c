@@ -0,0 +1,198 @@
+/*
+ * bench_netns.c - Socket matching for processes spread over namespaces
+ *
+ * Forks 500 processes across 20 network namespaces (25 per namespace,
+ * each listening on 4 TCP sockets) and compares finding their sockets
+ * one PID at a time, where every process parses its own namespace's
+ * tables, with one collect_process_reports() batch, which parses each
+ * namespace's tables once. Needs CAP_SYS_ADMIN for unshare(CLONE_NEWNET);
+ * without it the benchmark says so and exits.
+ */
+
+#define _GNU_SOURCE     /* unshare() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "../include/batch.h"
+#include "../include/net.h"
+
+#define NAMESPACES 20
+#define PER_NAMESPACE 25
+#define SOCKETS_EACH 4
+#define PROCESSES (NAMESPACES * PER_NAMESPACE)
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Member: listen on SOCKETS_EACH ports, report its PID, wait */
+static void run_member(int ready_fd)
+{
+    for (int i = 0; i < SOCKETS_EACH; i++) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0 ||
+            bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(sock, 1) != 0) {
+            _exit(1);
+        }
+    }
+    pid_t self = getpid();
+    if (write(ready_fd, &self, sizeof(self)) != sizeof(self)) {
+        _exit(1);
+    }
+    pause();
+    _exit(0);
+}
+
+/* Leader: enter a new namespace and fork its members there */
+static void run_leader(int ready_fd)
+{
+    if (unshare(CLONE_NEWNET) != 0) {
+        pid_t failed = -errno;
+        if (write(ready_fd, &failed, sizeof(failed)) != sizeof(failed)) {
+            _exit(1);
+        }
+        _exit(1);
+    }
+    for (int m = 0; m < PER_NAMESPACE; m++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_member(ready_fd);
+        }
+    }
+    pause();
+    _exit(0);
+}
+
+/* Best-of-ROUNDS ms for find_process_sockets() on each PID in turn */
+static double time_per_pid(const pid_t *pids, int count, long *found)
+{
+    double best = -1;
+    for (int round = 0; round < ROUNDS; round++) {
+        long total = 0;
+        double start = now_ns();
+        for (int i = 0; i < count; i++) {
+            socket_info_t *sockets = NULL;
+            int n = 0;
+            if (find_process_sockets(pids[i], &sockets, &n) == 0) {
+                total += n;
+            }
+            socket_list_free(sockets);
+        }
+        double ms = (now_ns() - start) / 1e6;
+        *found = total;
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+/* Best-of-ROUNDS ms for one batch over every PID */
+static double time_batch(const pid_t *pids, int count, long *found)
+{
+    batch_options_t opts = { .sockets = true, .counts_only = true };
+    double best = -1;
+    for (int round = 0; round < ROUNDS; round++) {
+        process_report_t *reports = NULL;
+        double start = now_ns();
+        if (collect_process_reports(pids, count, &opts, &reports) != 0) {
+            return -1;
+        }
+        double ms = (now_ns() - start) / 1e6;
+        long total = 0;
+        for (int i = 0; i < count; i++) {
+            total += reports[i].socket_count;
+        }
+        process_reports_free(reports, count);
+        *found = total;
+        if (best < 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+int main(void)
+{
+    int ready[2];
+    if (pipe(ready) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    pid_t leaders[NAMESPACES];
+    int leader_count = 0;
+    for (; leader_count < NAMESPACES; leader_count++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            break;
+        }
+        if (pid == 0) {
+            close(ready[0]);
+            run_leader(ready[1]);
+        }
+        leaders[leader_count] = pid;
+    }
+    close(ready[1]);
+
+    pid_t pids[PROCESSES];
+    int count = 0;
+    int status = 0;
+    while (count < leader_count * PER_NAMESPACE) {
+        pid_t pid;
+        if (read(ready[0], &pid, sizeof(pid)) != sizeof(pid)) {
+            break;
+        }
+        if (pid < 0) {
+            status = (int)-pid;
+            break;
+        }
+        pids[count++] = pid;
+    }
+    close(ready[0]);
+
+    if (count < PROCESSES) {
+        printf("network namespaces: only %d of %d processes started (%s)\n",
+               count, PROCESSES,
+               status ? strerror(status) : "fork failed");
+    } else {
+        long per_pid_found = 0;
+        long batch_found = 0;
+        double per_pid_ms = time_per_pid(pids, count, &per_pid_found);
+        double batch_ms = time_batch(pids, count, &batch_found);
+
+        printf("Sockets of %d processes in %d network namespaces "
+               "(%d listening each)\n\n", count, NAMESPACES, SOCKETS_EACH);
+        printf("  %-34s %10s %8s\n", "", "ms", "found");
+        printf("  %-34s %10.2f %8ld\n", "find_process_sockets per PID",
+               per_pid_ms, per_pid_found);
+        printf("  %-34s %10.2f %8ld\n", "collect_process_reports batch",
+               batch_ms, batch_found);
+    }
+
+    for (int i = 0; i < count; i++) {
+        kill(pids[i], SIGKILL);
+    }
+    for (int i = 0; i < leader_count; i++) {
+        kill(leaders[i], SIGKILL);
+        waitpid(leaders[i], NULL, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * bench_shmring.c - What a pinspectd reader pays against collecting itself
+ *
+ * Forks 64 idle children and compares three ways a monitoring agent can
+ * get status, FD and socket counts for them every tick: running the
+ * pinspect CLI (when ./pinspect is built), calling
+ * collect_process_reports() itself, and reading the newest tick from a
+ * pinspectd-style ring. Also reports the producer's publish cost and a
+ * lone reader following a ring that is never lapped.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../include/batch.h"
+#include "../include/shmring.h"
+
+#define CHILDREN 64
+#define ROUNDS 5
+#define CLI_RUNS 20
+#define READ_TICKS 100000
+#define STREAM_RECORDS 1000000
+
+extern char **environ;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* The collectors pinspectd runs each tick */
+static const batch_options_t daemon_opts = {
+    .status_fields = FIELDS_STATUS,
+    .fds = true,
+    .sockets = true,
+    .counts_only = true,
+};
+
+/* Best-of-ROUNDS microseconds for one collect_process_reports() tick */
+static double time_collect(const pid_t *pids, int count)
+{
+    double best = -1;
+    for (int round = 0; round < ROUNDS; round++) {
+        process_report_t *reports = NULL;
+        double start = now_ns();
+        if (collect_process_reports(pids, count, &daemon_opts,
+                                    &reports) != 0) {
+            return -1;
+        }
+        double us = (now_ns() - start) / 1e3;
+        process_reports_free(reports, count);
+        if (best < 0 || us < best) {
+            best = us;
+        }
+    }
+    return best;
+}
+
+/*
+ * Mean microseconds for one "./pinspect --fields=all PID..." run with
+ * stdout on /dev/null, or -1 if the CLI is not built.
+ */
+static double time_cli(const pid_t *pids, int count)
+{
+    if (access("./pinspect", X_OK) != 0) {
+        return -1;
+    }
+    char *argv[CHILDREN + 3];
+    char pid_text[CHILDREN][16];
+    argv[0] = "./pinspect";
+    argv[1] = "--fields=all";
+    for (int i = 0; i < count; i++) {
+        snprintf(pid_text[i], sizeof(pid_text[i]), "%d", (int)pids[i]);
+        argv[i + 2] = pid_text[i];
+    }
+    argv[count + 2] = NULL;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+    double start = now_ns();
+    int runs = 0;
+    for (; runs < CLI_RUNS; runs++) {
+        pid_t child;
+        int status;
+        if (posix_spawn(&child, argv[0], &actions, NULL, argv,
+                        environ) != 0 ||
+            waitpid(child, &status, 0) != child) {
+            break;
+        }
+    }
+    double us = (now_ns() - start) / 1e3;
+    posix_spawn_file_actions_destroy(&actions);
+    return runs == CLI_RUNS ? us / runs : -1;
+}
+
+int main(void)
+{
+    pid_t pids[CHILDREN];
+    int count = 0;
+    for (; count < CHILDREN; count++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            break;
+        }
+        if (pid == 0) {
+            pause();
+            _exit(0);
+        }
+        pids[count] = pid;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/pinspect-bench-%d", (int)getpid());
+    shmring_t ring;
+    shmring_reader_t reader;
+    if (count == 0 ||
+        shmring_create(&ring, name, sizeof(shm_sample_t), 4096, 0600) != 0 ||
+        shmring_open(&reader, name, sizeof(shm_sample_t)) != 0) {
+        perror("setup");
+        return 1;
+    }
+
+    double cli_us = time_cli(pids, count);
+    double collect_us = time_collect(pids, count);
+
+    /* Publish one tick the way pinspectd does, then time it alone */
+    process_report_t *reports = NULL;
+    if (collect_process_reports(pids, count, &daemon_opts, &reports) != 0) {
+        perror("collect_process_reports");
+        return 1;
+    }
+    shm_sample_t samples[CHILDREN];
+    memset(samples, 0, sizeof(samples));
+    for (int i = 0; i < count; i++) {
+        samples[i].tick = 1;
+        samples[i].pid = reports[i].pid;
+        samples[i].info = reports[i].info;
+        samples[i].fd_count = reports[i].fds.count;
+        samples[i].socket_count = reports[i].socket_count;
+    }
+    process_reports_free(reports, count);
+
+    double start = now_ns();
+    for (int t = 0; t < READ_TICKS; t++) {
+        for (int i = 0; i < count; i++) {
+            shmring_publish(&ring, &samples[i]);
+        }
+    }
+    double publish_ns = (now_ns() - start) / ((double)READ_TICKS * count);
+
+    /* A consumer polling for the newest tick */
+    uint64_t checksum = 0;
+    start = now_ns();
+    for (int t = 0; t < READ_TICKS; t++) {
+        shmring_seek(&reader, shmring_head(&reader) - (uint64_t)count);
+        shm_sample_t s;
+        while (shmring_read(&reader, &s) == 1) {
+            checksum += (uint64_t)s.fd_count;
+        }
+    }
+    double tick_us = (now_ns() - start) / 1e3 / READ_TICKS;
+
+    /* Producer and one reader interleaved: every record read once */
+    start = now_ns();
+    uint64_t read = 0;
+    for (int i = 0; i < STREAM_RECORDS; i++) {
+        shmring_publish(&ring, &samples[i % count]);
+        shm_sample_t s;
+        read += (uint64_t)shmring_read(&reader, &s);
+    }
+    double stream_ns = (now_ns() - start) / STREAM_RECORDS;
+
+    printf("pinspectd ring: %d processes, %zu-byte records\n\n", count,
+           sizeof(shm_sample_t));
+    printf("  %-36s %12s\n", "", "us per tick");
+    if (cli_us >= 0) {
+        printf("  %-36s %12.1f\n", "pinspect --fields=all (spawned)", cli_us);
+    } else {
+        printf("  %-36s %12s\n", "pinspect --fields=all (spawned)",
+               "not built");
+    }
+    printf("  %-36s %12.1f\n", "collect_process_reports", collect_us);
+    printf("  %-36s %12.3f\n", "ring: read newest tick", tick_us);
+    printf("\n  publish   %8.1f ns per record\n", publish_ns);
+    printf("  publish + read %3.1f ns per record (%llu of %d read)\n",
+           stream_ns, (unsigned long long)read, STREAM_RECORDS);
+    if (checksum == 0) {
+        printf("  (no FDs counted: children unreadable?)\n");
+    }
+
+    shmring_close(&reader);
+    shmring_destroy(&ring, true);
+    for (int i = 0; i < count; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * bench_status.c - Status file parser benchmark
+ *
+ * Times the previous fgets() + strncmp()/sscanf() status parser against
+ * read_status_fields_at() over every /proc/<pid>/status and
+ * /proc/<pid>/task/<tid>/status on the host. Extra idle threads are
+ * started first so there are a few thousand files even on a quiet
+ * machine. Two workloads: all fields (read_proc_status()) and State only
+ * (the per-thread read in enumerate_threads()). A third row parses cached
+ * copies of the same files, leaving out the kernel's cost of generating
+ * them.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/proc_status.h"
+#include "../include/util.h"
+
+/* Idle threads started so the host has at least this many task files */
+#define EXTRA_THREADS 3000
+#define ROUNDS 5
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Baseline copied from proc_status.c before the single-read parser */
+static int baseline_parse_line(const char *line, proc_info_t *info)
+{
+    if (strncmp(line, "Name:", 5) == 0) {
+        sscanf(line, "Name:\t%15s", info->name);
+        return 0;
+    }
+    if (strncmp(line, "State:", 6) == 0) {
+        char state_char;
+        if (sscanf(line, "State:\t%c", &state_char) == 1) {
+            info->state = char_to_state(state_char);
+        }
+        return 0;
+    }
+    if (strncmp(line, "Uid:", 4) == 0) {
+        if (sscanf(line, "Uid:\t%u\t%u", &info->uid_real,
+                   &info->uid_effective) == 2) {
+            return 0;
+        }
+    }
+    if (strncmp(line, "Gid:", 4) == 0) {
+        if (sscanf(line, "Gid:\t%u\t%u", &info->gid_real,
+                   &info->gid_effective) == 2) {
+            return 0;
+        }
+    }
+    if (strncmp(line, "VmSize:", 7) == 0) {
+        if (sscanf(line, "VmSize:\t%lu", &info->vm_size_kb) == 1) {
+            return 0;
+        }
+    }
+    if (strncmp(line, "VmRSS:", 6) == 0) {
+        if (sscanf(line, "VmRSS:\t%lu", &info->vm_rss_kb) == 1) {
+            return 0;
+        }
+    }
+    if (strncmp(line, "VmPeak:", 7) == 0) {
+        if (sscanf(line, "VmPeak:\t%lu", &info->vm_peak_kb) == 1) {
+            return 0;
+        }
+    }
+    if (strncmp(line, "Threads:", 8) == 0) {
+        if (sscanf(line, "Threads:\t%d", &info->thread_count) == 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int baseline_read_status(const char *path, proc_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        baseline_parse_line(line, info);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* Baseline copied from proc_task.c read_thread_state() */
+static proc_state_t baseline_read_state(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return PROC_STATE_UNKNOWN;
+    }
+    char line[256];
+    proc_state_t state = PROC_STATE_UNKNOWN;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char state_char;
+        if (sscanf(line, "State: %c", &state_char) == 1) {
+            state = char_to_state(state_char);
+            break;
+        }
+    }
+    fclose(fp);
+    return state;
+}
+
+/* Baseline parse of in-memory text, one fgets()-sized line at a time */
+static void baseline_parse_text(const char *text, proc_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    char line[256];
+    while (*text != '\0') {
+        size_t len = strcspn(text, "\n");
+        size_t copy = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+        memcpy(line, text, copy);
+        line[copy] = '\0';
+        baseline_parse_line(line, info);
+        text += len + (text[len] == '\n');
+    }
+}
+
+static int fast_read_status(const char *path, proc_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    return read_status_fields_at(AT_FDCWD, path, STATUS_FIELDS_DEFAULT,
+                                 info);
+}
+
+static proc_state_t fast_read_state(const char *path)
+{
+    proc_info_t info;
+    info.state = PROC_STATE_UNKNOWN;
+    read_status_fields_at(AT_FDCWD, path, STATUS_FIELD_STATE, &info);
+    return info.state;
+}
+
+typedef struct {
+    char **paths;
+    char **texts;       /* Cached contents for the parse-only row */
+    int count;
+    int capacity;
+} path_list_t;
+
+static void add_path(path_list_t *list, const char *path)
+{
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char *));
+        list->texts = realloc(list->texts, list->capacity * sizeof(char *));
+        if (list->paths == NULL || list->texts == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    /* Cache the text now; a file that vanishes later is cached empty */
+    char text[8192];
+    size_t len = 0;
+    FILE *fp = fopen(path, "r");
+    if (fp != NULL) {
+        len = fread(text, 1, sizeof(text) - 1, fp);
+        fclose(fp);
+    }
+    text[len] = '\0';
+
+    list->paths[list->count] = strdup(path);
+    list->texts[list->count] = strdup(text);
+    list->count++;
+}
+
+/* Every process and thread status file under /proc */
+static void collect_paths(path_list_t *list)
+{
+    DIR *proc = opendir("/proc");
+    if (proc == NULL) {
+        perror("opendir");
+        exit(1);
+    }
+
+    struct dirent *pe;
+    while ((pe = readdir(proc)) != NULL) {
+        if (pe->d_name[0] < '0' || pe->d_name[0] > '9') {
+            continue;
+        }
+
+        char path[600];
+        snprintf(path, sizeof(path), "/proc/%s/status", pe->d_name);
+        add_path(list, path);
+
+        snprintf(path, sizeof(path), "/proc/%s/task", pe->d_name);
+        DIR *task = opendir(path);
+        if (task == NULL) {
+            continue;
+        }
+        struct dirent *te;
+        while ((te = readdir(task)) != NULL) {
+            if (te->d_name[0] >= '0' && te->d_name[0] <= '9') {
+                snprintf(path, sizeof(path), "/proc/%s/task/%s/status",
+                         pe->d_name, te->d_name);
+                add_path(list, path);
+            }
+        }
+        closedir(task);
+    }
+    closedir(proc);
+}
+
+static int release_pipe[2];
+
+static void *idle_thread(void *arg)
+{
+    (void)arg;
+    char byte;
+    /* Blocks until main closes the write end */
+    while (read(release_pipe[0], &byte, 1) > 0) {
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    if (pipe(release_pipe) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+    pthread_t *threads = calloc(EXTRA_THREADS, sizeof(pthread_t));
+    int started = 0;
+    while (threads != NULL && started < EXTRA_THREADS &&
+           pthread_create(&threads[started], &attr, idle_thread, NULL) == 0) {
+        started++;
+    }
+
+    path_list_t list = { NULL, NULL, 0, 0 };
+    collect_paths(&list);
+
+    /* Results must agree on the fields that don't change between reads */
+    int mismatches = 0;
+    for (int i = 0; i < list.count; i++) {
+        proc_info_t a, b;
+        if (baseline_read_status(list.paths[i], &a) != 0 ||
+            fast_read_status(list.paths[i], &b) != 0) {
+            continue;
+        }
+        if (a.uid_real != b.uid_real || a.uid_effective != b.uid_effective ||
+            a.gid_real != b.gid_real || a.vm_peak_kb != b.vm_peak_kb) {
+            mismatches++;
+        }
+    }
+
+    double best[6] = { -1, -1, -1, -1, -1, -1 };
+    volatile int sink = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        double times[6];
+        proc_info_t info;
+
+        double start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            sink += baseline_read_status(list.paths[i], &info);
+        }
+        times[0] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            sink += fast_read_status(list.paths[i], &info);
+        }
+        times[1] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            sink += (int)baseline_read_state(list.paths[i]);
+        }
+        times[2] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            sink += (int)fast_read_state(list.paths[i]);
+        }
+        times[3] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            baseline_parse_text(list.texts[i], &info);
+            sink += info.thread_count;
+        }
+        times[4] = now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < list.count; i++) {
+            memset(&info, 0, sizeof(info));
+            parse_proc_status(list.texts[i], strlen(list.texts[i]),
+                              STATUS_FIELDS_DEFAULT, &info);
+            sink += info.thread_count;
+        }
+        times[5] = now_ns() - start;
+
+        for (int i = 0; i < 6; i++) {
+            if (best[i] < 0 || times[i] < best[i]) {
+                best[i] = times[i];
+            }
+        }
+    }
+
+    printf("status parsing over %d files (best of %d, ns/file)\n\n",
+           list.count, ROUNDS);
+    printf("  %-12s  %12s  %12s  %8s\n", "workload", "fgets+sscanf",
+           "single-read", "speedup");
+    printf("  %-12s  %12.0f  %12.0f  %7.2fx\n", "all fields",
+           best[0] / list.count, best[1] / list.count, best[0] / best[1]);
+    printf("  %-12s  %12.0f  %12.0f  %7.2fx\n", "state only",
+           best[2] / list.count, best[3] / list.count, best[2] / best[3]);
+    printf("  %-12s  %12.0f  %12.0f  %7.2fx\n", "parse only",
+           best[4] / list.count, best[5] / list.count, best[4] / best[5]);
+    printf("\n  field mismatches: %d\n", mismatches);
+
+    close(release_pipe[1]);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    close(release_pipe[0]);
+    free(threads);
+    pthread_attr_destroy(&attr);
+    for (int i = 0; i < list.count; i++) {
+        free(list.paths[i]);
+        free(list.texts[i]);
+    }
+    free(list.paths);
+    free(list.texts);
+    return mismatches == 0 ? 0 : 1;
+}
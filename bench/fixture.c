@@ -0,0 +1,330 @@
+/*
+ * fixture.c - Synthetic /proc tree generator for the benchmarks
+ *
+ * File contents follow proc(5) and the kernel's own formatting closely
+ * enough for every pinspect parser; values are fixed apart from the
+ * PID/TID, inodes and port numbers.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fixture.h"
+
+/* Open descriptors nftw() may hold while removing a tree */
+#define REMOVE_FDS 16
+
+static const char status_format[] =
+    "Name:\tfixture\n"
+    "Umask:\t0022\n"
+    "State:\tS (sleeping)\n"
+    "Tgid:\t%d\n"
+    "Ngid:\t0\n"
+    "Pid:\t%d\n"
+    "PPid:\t1\n"
+    "TracerPid:\t0\n"
+    "Uid:\t1000\t1000\t1000\t1000\n"
+    "Gid:\t1000\t1000\t1000\t1000\n"
+    "FDSize:\t%d\n"
+    "Groups:\t1000\n"
+    "VmPeak:\t  524288 kB\n"
+    "VmSize:\t  524288 kB\n"
+    "VmLck:\t       0 kB\n"
+    "VmPin:\t       0 kB\n"
+    "VmHWM:\t  131072 kB\n"
+    "VmRSS:\t  131072 kB\n"
+    "RssAnon:\t  122880 kB\n"
+    "RssFile:\t    8192 kB\n"
+    "RssShmem:\t       0 kB\n"
+    "VmData:\t  262144 kB\n"
+    "VmStk:\t     132 kB\n"
+    "VmExe:\t    2048 kB\n"
+    "VmLib:\t    4096 kB\n"
+    "VmPTE:\t     512 kB\n"
+    "VmSwap:\t       0 kB\n"
+    "Threads:\t%d\n"
+    "SigQ:\t0/63413\n"
+    "SigPnd:\t0000000000000000\n"
+    "ShdPnd:\t0000000000000000\n"
+    "SigBlk:\t0000000000000000\n"
+    "SigIgn:\t0000000000001000\n"
+    "SigCgt:\t0000000180004002\n"
+    "CapInh:\t0000000000000000\n"
+    "CapPrm:\t0000000000000000\n"
+    "CapEff:\t0000000000000000\n"
+    "CapBnd:\t000001ffffffffff\n"
+    "CapAmb:\t0000000000000000\n"
+    "NoNewPrivs:\t0\n"
+    "Seccomp:\t0\n"
+    "Cpus_allowed:\tff\n"
+    "Cpus_allowed_list:\t0-7\n"
+    "voluntary_ctxt_switches:\t%d\n"
+    "nonvoluntary_ctxt_switches:\t%d\n";
+
+static const char stat_format[] =
+    "%d (fixture) S 1 %d %d 0 -1 4194560 1024 0 0 0 %d %d 0 0 20 0 %d 0 "
+    "438217 536870912 32768 18446744073709551615 1 1 0 0 0 0 0 4096 "
+    "16386 0 0 0 17 %d 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+
+static const char inet_header[] =
+    "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when "
+    "retrnsmt   uid  timeout inode\n";
+
+static const char unix_header[] =
+    "Num       RefCount Protocol Flags    Type St Inode Path\n";
+
+/*
+ * Write len bytes of text to path under dirfd. Returns 0 or -1.
+ */
+static int write_text_at(int dirfd, const char *path, const char *text,
+                         size_t len)
+{
+    int fd = openat(dirfd, path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    ssize_t n = write(fd, text, len);
+    int saved_errno = errno;
+    close(fd);
+    if (n != (ssize_t)len) {
+        errno = (n < 0) ? saved_errno : EIO;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Create directory path under dirfd and open it. Returns the fd or -1.
+ */
+static int make_dir_at(int dirfd, const char *path)
+{
+    if (mkdirat(dirfd, path, 0755) != 0) {
+        return -1;
+    }
+    return openat(dirfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/*
+ * Write a stat and a status file for tid under dirfd. Returns 0 or -1.
+ */
+static int write_task_files(int dirfd, const fixture_spec_t *spec, pid_t tid)
+{
+    char text[2048];
+    int len = snprintf(text, sizeof(text), stat_format, tid, spec->pid,
+                       spec->pid, tid % 997, tid % 389, spec->threads,
+                       tid % 8);
+    if (write_text_at(dirfd, "stat", text, (size_t)len) != 0) {
+        return -1;
+    }
+
+    len = snprintf(text, sizeof(text), status_format, spec->pid, tid,
+                   spec->fds, spec->threads, tid % 1009, tid % 101);
+    return write_text_at(dirfd, "status", text, (size_t)len);
+}
+
+/*
+ * Fill fd/ with spec->fds links: sockets on odd FDs, a rotation of
+ * files, pipes and anon inodes on even ones. Returns 0 or -1.
+ */
+static int write_fd_links(int piddir, const fixture_spec_t *spec)
+{
+    int fddir = make_dir_at(piddir, "fd");
+    if (fddir < 0) {
+        return -1;
+    }
+
+    int ret = 0;
+    for (int fd = 0; fd < spec->fds && ret == 0; fd++) {
+        char name[16];
+        char target[64];
+        snprintf(name, sizeof(name), "%d", fd);
+
+        if (fd % 2 == 1) {
+            snprintf(target, sizeof(target), "socket:[%d]",
+                     FIXTURE_INODE_BASE + fd / 2);
+        } else {
+            switch ((fd / 2) % 4) {
+                case 0:
+                    snprintf(target, sizeof(target), "/dev/null");
+                    break;
+                case 1:
+                    snprintf(target, sizeof(target), "pipe:[%d]", 2000 + fd);
+                    break;
+                case 2:
+                    snprintf(target, sizeof(target), "anon_inode:[eventfd]");
+                    break;
+                default:
+                    snprintf(target, sizeof(target),
+                             "/var/log/fixture/%d.log", fd);
+                    break;
+            }
+        }
+        ret = symlinkat(target, fddir, name);
+    }
+
+    int saved_errno = errno;
+    close(fddir);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Fill task/ with spec->threads thread directories. Returns 0 or -1.
+ */
+static int write_task_dirs(int piddir, const fixture_spec_t *spec)
+{
+    int taskdir = make_dir_at(piddir, "task");
+    if (taskdir < 0) {
+        return -1;
+    }
+
+    int ret = 0;
+    for (int i = 0; i < spec->threads && ret == 0; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%d", spec->pid + i);
+        int tdir = make_dir_at(taskdir, name);
+        if (tdir < 0) {
+            ret = -1;
+            break;
+        }
+        ret = write_task_files(tdir, spec, spec->pid + i);
+        close(tdir);
+    }
+
+    int saved_errno = errno;
+    close(taskdir);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Write net/ with spec->net_rows listening tcp rows, row k owning inode
+ * FIXTURE_INODE_BASE + k, and header-only tcp6, udp, udp6 and unix.
+ * Returns 0 or -1.
+ */
+static int write_net_tables(int rootdir, const fixture_spec_t *spec)
+{
+    int netdir = make_dir_at(rootdir, "net");
+    if (netdir < 0) {
+        return -1;
+    }
+
+    int ret = -1;
+    int fd = openat(netdir, "tcp", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    FILE *fp = (fd >= 0) ? fdopen(fd, "w") : NULL;
+    if (fp != NULL) {
+        fputs(inet_header, fp);
+        for (int i = 0; i < spec->net_rows; i++) {
+            fprintf(fp, "%4d: 0100007F:%04X 00000000:0000 0A "
+                        "00000000:00000000 00:00000000 00000000  1000 "
+                        "       0 %d 1 0000000000000000 100 0 0 10 0\n",
+                    i, 1024 + i % 60000, FIXTURE_INODE_BASE + i);
+        }
+        ret = (fclose(fp) == 0) ? 0 : -1;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    static const char *const inet_tables[] = { "tcp6", "udp", "udp6" };
+    for (size_t i = 0; i < 3 && ret == 0; i++) {
+        ret = write_text_at(netdir, inet_tables[i], inet_header,
+                            sizeof(inet_header) - 1);
+    }
+    if (ret == 0) {
+        ret = write_text_at(netdir, "unix", unix_header,
+                            sizeof(unix_header) - 1);
+    }
+
+    int saved_errno = errno;
+    close(netdir);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Implementation of fixture_create() - see fixture.h for API docs.
+ */
+int fixture_create(const fixture_spec_t *spec, char *root, size_t size)
+{
+    if (spec == NULL || root == NULL || spec->pid <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    static const char template[] = "/tmp/pinspect_fixture_XXXXXX";
+    if (size < sizeof(template)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(root, template, sizeof(template));
+    if (mkdtemp(root) == NULL) {
+        return -1;
+    }
+
+    int ret = -1;
+    int rootdir = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    char name[16];
+    snprintf(name, sizeof(name), "%d", spec->pid);
+    int piddir = (rootdir >= 0) ? make_dir_at(rootdir, name) : -1;
+
+    if (piddir >= 0) {
+        ret = write_task_files(piddir, spec, spec->pid);
+        if (ret == 0) {
+            ret = write_text_at(piddir, "comm", "fixture\n", 8);
+        }
+        if (ret == 0) {
+            ret = write_fd_links(piddir, spec);
+        }
+        if (ret == 0) {
+            ret = write_task_dirs(piddir, spec);
+        }
+        if (ret == 0) {
+            ret = write_net_tables(rootdir, spec);
+        }
+    }
+
+    int saved_errno = errno;
+    if (piddir >= 0) {
+        close(piddir);
+    }
+    if (rootdir >= 0) {
+        close(rootdir);
+    }
+    if (ret != 0) {
+        fixture_remove(root);
+        errno = saved_errno;
+    }
+    return ret;
+}
+
+/* nftw() callback: remove each entry after its children */
+static int remove_entry(const char *path, const struct stat *st, int type,
+                        struct FTW *ftw)
+{
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+/*
+ * Implementation of fixture_remove() - see fixture.h for API docs.
+ */
+int fixture_remove(const char *root)
+{
+    if (root == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    return nftw(root, remove_entry, REMOVE_FDS, FTW_DEPTH | FTW_PHYS);
+}
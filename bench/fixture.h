@@ -0,0 +1,44 @@
+/*
+ * fixture.h - Synthetic /proc tree generator for the benchmarks
+ *
+ * Writes one process directory with N FD links, N task/<tid> directories
+ * and an N-row net/tcp table under a fresh directory in /tmp, in the
+ * layout the collectors read, so they can be timed through
+ * proc_set_root() on sizes no real process reaches and without the
+ * kernel generating the files on each read.
+ */
+
+#ifndef FIXTURE_H
+#define FIXTURE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Inode of fixture socket k, which is also the inode of net/tcp row k */
+#define FIXTURE_INODE_BASE 100000
+
+/* Shape of a synthetic process tree */
+typedef struct {
+    pid_t pid;          /* Name of the process directory */
+    int fds;            /* fd/ links; every second one is a socket */
+    int threads;        /* task/<tid> directories, tids pid upwards */
+    int net_rows;       /* net/tcp rows; the rest of net/ is headers only */
+} fixture_spec_t;
+
+/*
+ * Create a tree shaped by spec under a new /tmp directory and write its
+ * path to root (size bytes). On failure the partial tree is removed.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, or errno
+ * from creating the files).
+ */
+int fixture_create(const fixture_spec_t *spec, char *root, size_t size);
+
+/*
+ * Remove a tree made by fixture_create(), links included.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int fixture_remove(const char *root);
+
+#endif /* FIXTURE_H */
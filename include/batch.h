@@ -0,0 +1,100 @@
+/*
+ * batch.h - Multi-process inspection on a worker pool
+ *
+ * Collects status, FDs, threads, sockets and memory for many PIDs in one
+ * call. Each PID is an independent job on a workpool; results land in a
+ * caller-ordered array so output can be printed in PID order.
+ *
+ * The reports are the snapshot every printer works from: each /proc file
+ * is read at most once per call. Sockets come from the FD list already
+ * read for the PID, and each socket table is read once for the batch.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "pinspect.h"
+#include "inode_set.h"
+#include "fd_summary.h"
+
+#pragma GCC visibility push(default)
+
+/* Which collectors to run for each PID */
+typedef struct {
+    unsigned status_fields; /* FIELD_* status bits to parse (FIELDS_STATUS
+                               for all), 0 to not read status at all */
+    bool fds;           /* enumerate_fds() */
+    bool threads;       /* enumerate_threads(); split across workers when
+                           there is only one PID */
+    bool sockets;       /* Match socket FDs against the socket tables */
+    bool memory;        /* read_mem_usage() (smaps_rollup) */
+    bool memory_files;  /* enumerate_mem_files() (full smaps) */
+    bool counts_only;   /* Count FDs and sockets without keeping entries */
+    int sample_size;    /* > 0: sample this many FDs and threads per PID
+                           into fd_sample and thread_sample instead of
+                           reading them all; cannot be used with sockets */
+    uint64_t seed;      /* Sampling seed, the same for every PID */
+    bool fd_summary;    /* With fds: summarize_fds() into fd_summary
+                           instead of keeping entries; cannot be used
+                           with sockets or sample_size */
+    int workers;        /* Pool size, <= 0 for one per online CPU */
+} batch_options_t;
+
+/*
+ * Everything collected for one PID. Each *_errno is 0 when the matching
+ * data is valid, otherwise the errno the collector failed with. When
+ * status_errno is set the other collectors are not run. info fields not
+ * in status_fields are zero, apart from pid and a PROC_STATE_UNKNOWN
+ * state. With counts_only, fds.count and socket_count are set but
+ * fds.entries, sockets and socket_fds are NULL, and socket_inodes is
+ * empty.
+ */
+typedef struct {
+    pid_t pid;
+    int status_errno;
+    proc_info_t info;
+    fd_list_t fds;
+    fd_sample_t fd_sample;  /* With sample_size; fd_errno covers it */
+    fd_summary_t fd_summary;    /* With fd_summary; fd_errno covers it */
+    int fd_errno;
+    thread_info_t *threads;
+    int thread_count;
+    thread_sample_t thread_sample;  /* With sample_size; thread_errno */
+    int thread_errno;
+    socket_info_t *sockets;
+    int *socket_fds;        /* First FD each socket is held on */
+    int socket_count;
+    inode_set_t socket_inodes;  /* Every socket FD, grouped by inode */
+    unsigned long netns;    /* Network namespace inode, 0 if not read */
+    int socket_errno;
+    mem_usage_t memory;
+    int memory_errno;
+    mem_file_list_t memory_files;
+    int memory_files_errno;
+} process_report_t;
+
+/*
+ * Inspect count PIDs in parallel. (*reports)[i] describes pids[i], so
+ * sorting pids first gives PID-ordered output.
+ *
+ * Per-PID failures (exited, permission denied) are recorded in the report
+ * and do not fail the batch.
+ * Returns 0 on success, -1 on error (EINVAL for bad arguments, including
+ * sockets with a sample_size or fd_summary, ENOMEM, or EAGAIN if worker
+ * threads could not be started).
+ */
+int collect_process_reports(const pid_t *pids, int count,
+                            const batch_options_t *opts,
+                            process_report_t **reports);
+
+/*
+ * Free an array returned by collect_process_reports(). Safe with NULL.
+ */
+void process_reports_free(process_report_t *reports, int count);
+
+#pragma GCC visibility pop
+
+#endif /* BATCH_H */
@@ -0,0 +1,92 @@
+/*
+ * budget.h - Rate limits bounding collection's load on the host
+ *
+ * Reading /proc takes locks the inspected process needs too: its file
+ * table for every fd/ readlink, its mm for smaps, socket hash buckets
+ * for the net tables. A full pass over a million FDs or a huge socket
+ * table can stall the service being diagnosed. A budget caps the
+ * syscalls per second, the CPU time per wall second, or both.
+ *
+ * Collectors charge each syscall with BUDGET_CHARGE() and call
+ * BUDGET_YIELD() between batches: getdents64() batches of fd/ and task/,
+ * read chunks of socket tables and netlink receives. A thread over
+ * budget sleeps there, holding no kernel lock, until the work done since
+ * the previous yield has been paid for. With a budget set, directory
+ * batches shrink to BUDGET_DIR_BUFFER so the sleeps come in small steps.
+ *
+ * The budget is process-wide and shared by every worker thread. Idle
+ * time banks at most BUDGET_BURST_NS of credit. Like the stats macros,
+ * the macros cost one predictable branch while no budget is set.
+ */
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma GCC visibility push(default)
+
+/* getdents64() buffer while a budget is set: about 170 FD entries */
+#define BUDGET_DIR_BUFFER (4 * 1024)
+
+/* Most idle time a caller may bank towards its next burst */
+#define BUDGET_BURST_NS 100000000ull
+
+typedef struct {
+    unsigned long syscalls_per_sec; /* 0 for no syscall limit */
+    unsigned cpu_percent;   /* CPU time per wall second, in percent of
+                               one CPU (200 = two CPUs); 0 for no limit */
+} budget_t;
+
+/*
+ * Apply budget, or remove any budget with NULL or all-zero limits.
+ * Starts a fresh accounting period from now. Call before worker threads
+ * start.
+ */
+void budget_set(const budget_t *budget);
+
+/*
+ * Copy the limits last set with budget_set() into out (all zero if
+ * none).
+ */
+void budget_get(budget_t *out);
+
+/*
+ * Return the total time threads have slept in budget_yield() since the
+ * last budget_set().
+ */
+uint64_t budget_slept_ns(void);
+
+/* Set by budget_set(); read by the macros below */
+extern bool budget_active;
+
+/*
+ * Count n syscalls against the budget. Never sleeps.
+ */
+void budget_charge(unsigned long n);
+
+/*
+ * Settle the syscalls charged and CPU used since the last yield, and
+ * sleep until they fit the budget. A signal ends the sleep early. errno
+ * is preserved.
+ */
+void budget_yield(void);
+
+#define BUDGET_CHARGE(n) \
+    do { \
+        if (budget_active) { \
+            budget_charge((unsigned long)(n)); \
+        } \
+    } while (0)
+
+#define BUDGET_YIELD() \
+    do { \
+        if (budget_active) { \
+            budget_yield(); \
+        } \
+    } while (0)
+
+#pragma GCC visibility pop
+
+#endif /* BUDGET_H */
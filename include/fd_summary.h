@@ -0,0 +1,105 @@
+/*
+ * fd_summary.h - FD kind histogram and open-path counts
+ *
+ * Answers "how many FDs of each kind, and which files are open most
+ * often" in one for_each_fd() walk, without an fd_entry_t per FD. Each
+ * target is classified as it is read; targets that name a path are
+ * counted in an open-addressing table keyed by the path text. Memory
+ * grows with the number of distinct paths, not FDs: a process that
+ * leaked 100,000 descriptors of one log file costs one table slot.
+ */
+
+#ifndef FD_SUMMARY_H
+#define FD_SUMMARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/* Finer-grained than fd_type_t: anon inodes and unlinked files split out */
+typedef enum {
+    FD_KIND_FILE,           /* Path outside /dev */
+    FD_KIND_DELETED,        /* Path of an unlinked file, "... (deleted)" */
+    FD_KIND_DEVICE,         /* /dev/... */
+    FD_KIND_SOCKET,         /* socket:[inode] */
+    FD_KIND_PIPE,           /* pipe:[inode] */
+    FD_KIND_EVENTFD,        /* anon_inode:[eventfd] */
+    FD_KIND_EVENTPOLL,      /* anon_inode:[eventpoll] */
+    FD_KIND_TIMERFD,        /* anon_inode:[timerfd] */
+    FD_KIND_ANON_OTHER,     /* Other anon_inode: (signalfd, inotify, ...) */
+    FD_KIND_OTHER           /* Anything else (e.g. net:[...], mnt:[...]) */
+} fd_kind_t;
+
+/*
+ * Zero-initialize or fill with summarize_fds(); release with
+ * fd_summary_free(). Path slot i is empty when hashes[i] is 0, and
+ * otherwise names strings + offsets[i], held open counts[i] times.
+ */
+typedef struct {
+    int total;                              /* FDs resolved */
+    int kind_counts[FD_KIND_OTHER + 1];
+    uint64_t *hashes;       /* FNV-1a of each path; 0 marks an empty slot */
+    uint32_t *offsets;      /* Parallel to hashes, into strings */
+    int *counts;            /* Parallel to hashes */
+    size_t capacity;        /* Always a power of two, at most half full */
+    size_t distinct;        /* Occupied slots */
+    char *strings;          /* NUL-terminated paths, one per slot */
+    size_t strings_len;
+    size_t strings_capacity;
+} fd_summary_t;
+
+/* One row of fd_summary_top() */
+typedef struct {
+    const char *path;       /* Points into the summary's strings */
+    int count;
+} fd_path_count_t;
+
+/*
+ * Classify a symlink target, with anon inodes and deleted files told
+ * apart. A path is FD_KIND_DELETED when it ends in " (deleted)", which
+ * includes memfds ("/memfd:name (deleted)").
+ */
+fd_kind_t classify_fd_kind(const char *target);
+
+/*
+ * Short label for an FD kind: "file", "deleted", "device", "socket",
+ * "pipe", "eventfd", "eventpoll", "timerfd", "anon_inode" or "other".
+ * Never returns NULL.
+ */
+const char *fd_kind_to_string(fd_kind_t kind);
+
+/*
+ * Count the FDs of a process by kind, and by path for the FD_KIND_FILE,
+ * FD_KIND_DELETED and FD_KIND_DEVICE ones. Uses the for_each_fd() walk
+ * and its backend, so syscalls are the same as enumerate_fds(); only
+ * the distinct paths are stored. summary is overwritten, not freed.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL summary, ENOENT if
+ * process not found, EACCES if permission denied, ENOMEM). On error
+ * summary is left empty.
+ */
+int summarize_fds(pid_t pid, fd_summary_t *summary);
+int summarize_fds_at(const proc_handle_t *h, fd_summary_t *summary);
+
+/*
+ * Fill top with the k paths held open most often, most first; paths
+ * with equal counts are in strcmp() order. top stays valid until the
+ * summary is freed.
+ *
+ * Returns the number of rows filled, min(k, summary->distinct), or -1
+ * on error (EINVAL for NULL arguments or k < 0).
+ */
+int fd_summary_top(const fd_summary_t *summary, fd_path_count_t *top, int k);
+
+/*
+ * Free storage owned by the summary and reset it to empty. Safe to call
+ * with NULL or a zeroed summary.
+ */
+void fd_summary_free(fd_summary_t *summary);
+
+#pragma GCC visibility pop
+
+#endif /* FD_SUMMARY_H */
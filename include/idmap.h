@@ -0,0 +1,63 @@
+/*
+ * idmap.h - Open-addressing hash map keyed by kernel IDs
+ *
+ * Maps unsigned long identifiers (socket inodes, TIDs) to int values with
+ * O(1) expected lookup. Key 0 is reserved as the empty-slot marker; the
+ * kernel never hands out inode 0 or TID 0.
+ */
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#pragma GCC visibility push(default)
+
+typedef struct {
+    unsigned long *keys;    /* 0 marks an empty slot */
+    int *values;            /* Parallel to keys */
+    size_t capacity;        /* Always a power of two */
+    size_t count;           /* Occupied slots */
+    unsigned int shift;     /* 64 - log2(capacity), for Fibonacci hashing */
+} id_map_t;
+
+/*
+ * Initialize an empty map sized for about expected keys.
+ *
+ * Returns 0 on success, -1 on error (ENOMEM if allocation fails).
+ */
+int id_map_init(id_map_t *map, size_t expected);
+
+/*
+ * Free storage owned by the map. Safe to call on a zeroed map.
+ */
+void id_map_free(id_map_t *map);
+
+/*
+ * Remove all keys but keep the allocated table for reuse.
+ */
+void id_map_clear(id_map_t *map);
+
+/*
+ * Insert key or overwrite its value. Grows the table as needed.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for key 0, ENOMEM if growth
+ * fails).
+ */
+int id_map_put(id_map_t *map, unsigned long key, int value);
+
+/*
+ * Look up key. Stores its value in *value (if non-NULL) and returns true
+ * when present, false otherwise.
+ */
+bool id_map_get(const id_map_t *map, unsigned long key, int *value);
+
+/*
+ * Return true if key is present.
+ */
+bool id_map_contains(const id_map_t *map, unsigned long key);
+
+#pragma GCC visibility pop
+
+#endif /* IDMAP_H */
@@ -2,6 +2,13 @@
  * net.h - Network connection parsing interface
  *
  * Public API for finding network connections belonging to a process.
+ * Per-process lookups have a pid form and an _at form that reads the
+ * process's FDs through an open proc_handle_t.
+ *
+ * Socket tables are per network namespace. The caller's are always read;
+ * for a process in another namespace (a container) its own tables are
+ * read too, through /proc/<pid>/net. Socket inodes are unique across
+ * namespaces, so one inode set is matched against every table read.
  */
 
 #ifndef NET_H
@@ -12,24 +19,202 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "pinspect.h"
+#include "proc_handle.h"
+#include "idmap.h"
+
+#pragma GCC visibility push(default)
+
+/* Buffer size that fits any format_socket_addr() result */
+#define SOCKET_ADDR_MAX (SOCKET_PATH_MAX + 8)
+
+/*
+ * Select how socket tables are read. Default is NET_BACKEND_AUTO: binary
+ * NETLINK_SOCK_DIAG dumps, falling back per table to /proc/net text when
+ * netlink is unavailable. Both backends produce identical socket_info_t.
+ * sock_diag only answers for the caller's network namespace, so other
+ * namespaces' tables are always read as text.
+ */
+void net_set_backend(net_backend_t backend);
+
+/*
+ * Return the backend last set with net_set_backend().
+ */
+net_backend_t net_get_backend(void);
+
+/*
+ * Visitor called once per socket by for_each_socket(), with the FD the
+ * process holds it on. sock is not valid after the call returns. Return 0
+ * to continue or non-zero to stop.
+ */
+typedef int (*socket_visit_fn)(const socket_info_t *sock, int fd, void *ctx);
+
+/*
+ * Call visit for each network socket belonging to a process, in the order
+ * find_process_sockets() would return them.
+ *
+ * Only the process's socket inode set is kept in memory; FDs and table
+ * rows are streamed. Stopping early skips the remaining tables. Sockets
+ * in the caller's network namespace come first, then those from the
+ * process's own namespace when it differs.
+ *
+ * Returns 0 when the walk completed or visit stopped it, -1 on error
+ * (EINVAL if visit is NULL, ENOENT if process not found, EACCES if
+ * permission denied, ENOMEM if allocation fails).
+ */
+int for_each_socket(pid_t pid, socket_visit_fn visit, void *ctx);
+int for_each_socket_at(const proc_handle_t *h, socket_visit_fn visit,
+                       void *ctx);
 
 /*
  * Find all network sockets belonging to a process.
  *
- * Correlates socket inodes from /proc/<pid>/fd/ with /proc/net/tcp and
- * /proc/net/udp to identify connections. Returns heap-allocated array via
+ * Correlates socket inodes from /proc/<pid>/fd/ with /proc/net/tcp, tcp6,
+ * udp, udp6 and unix to identify connections. Returns heap-allocated array via
  * sockets parameter. Caller must free with socket_list_free().
  *
  * Returns 0 on success, -1 on error (ENOENT if process not found, EACCES
  * if permission denied, ENOMEM if allocation fails).
  */
 int find_process_sockets(pid_t pid, socket_info_t **sockets, int *count);
+int find_process_sockets_at(const proc_handle_t *h, socket_info_t **sockets,
+                            int *count);
+
+/*
+ * Same as find_process_sockets(), for FDs that were already enumerated:
+ * only the socket entries of fds are matched, so fd/ is not read again.
+ * With no process to read through, only the caller's network namespace
+ * is searched.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, ENOMEM
+ * if allocation fails).
+ */
+int find_fd_list_sockets(const fd_list_t *fds, socket_info_t **sockets,
+                         int *count);
 
 /*
  * Free memory allocated by find_process_sockets(). Safe to call with NULL.
  */
 void socket_list_free(socket_info_t *sockets);
 
+/* One owner's FD on a socket inode in a socket_snapshot_t */
+typedef struct {
+    int owner;          /* Caller's index, e.g. a report slot */
+    int fd;
+    int next;           /* Next reference to the same inode, or -1 */
+} socket_ref_t;
+
+/* One process recorded under its network namespace in a netns_list_t */
+typedef struct {
+    unsigned long netns;    /* ns/net inode, see proc_handle_netns() */
+    pid_t pid;
+    int next;               /* Earlier process in the same namespace, or -1 */
+} netns_member_t;
+
+/*
+ * Network namespaces other than the caller's that a walk reads tables
+ * from, each with every recorded process its tables can be read through.
+ * Processes in the caller's namespace are not recorded.
+ */
+typedef struct {
+    unsigned long caller_netns; /* 0 if unknown: other namespaces are
+                                   then not told apart and not read */
+    id_map_t heads;             /* netns inode -> newest member */
+    netns_member_t *members;
+    int count;
+    int capacity;
+} netns_list_t;
+
+/*
+ * Socket FDs of many owners (processes), matched against every socket
+ * table in one pass instead of one pass per owner. Each owner is listed
+ * once per inode even if it holds the socket on several FDs. Set up with
+ * socket_snapshot_init(); release with socket_snapshot_free().
+ */
+typedef struct {
+    id_map_t heads;     /* inode -> newest socket_ref_t index */
+    socket_ref_t *refs;
+    int ref_count;
+    int ref_capacity;
+    netns_list_t namespaces;
+} socket_snapshot_t;
+
+/*
+ * Visitor called once per (socket, owner) by socket_snapshot_walk(). sock
+ * is not valid after the call returns. Return 0 to continue or non-zero
+ * to stop.
+ */
+typedef int (*socket_owner_visit_fn)(const socket_info_t *sock, int owner,
+                                     int fd, void *ctx);
+
+/*
+ * Prepare an empty snapshot.
+ *
+ * Returns 0 on success, -1 on error (ENOMEM if allocation fails).
+ */
+int socket_snapshot_init(socket_snapshot_t *snap);
+
+/*
+ * Record the socket entries of fds as held by owner. The refs of one
+ * owner must be added together, before the next owner's.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, ENOMEM
+ * if allocation fails).
+ */
+int socket_snapshot_add_fds(socket_snapshot_t *snap, const fd_list_t *fds,
+                            int owner);
+
+/*
+ * Record that pid is in network namespace netns (from proc_handle_netns()
+ * of an owner), so socket_snapshot_walk() reads that namespace's tables
+ * too. Each namespace is read once however many processes are recorded
+ * in it: through the latest one, falling back to earlier ones if it has
+ * exited or moved. netns 0 and the caller's namespace are ignored.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL snap, ENOMEM if
+ * allocation fails).
+ */
+int socket_snapshot_add_netns(socket_snapshot_t *snap, unsigned long netns,
+                              pid_t pid);
+
+/*
+ * Read each socket table once per recorded network namespace (the
+ * caller's first) and call visit for every recorded owner of each
+ * matching row. For each owner, sockets arrive in the order
+ * find_process_sockets() would return them. Nothing is read when no
+ * socket was added. A namespace whose recorded processes have all exited
+ * contributes no rows.
+ *
+ * Returns 0 when the walk completed or visit stopped it, -1 on error
+ * (EINVAL for NULL arguments, or errno from reading the tables).
+ */
+int socket_snapshot_walk(const socket_snapshot_t *snap,
+                         socket_owner_visit_fn visit, void *ctx);
+
+/*
+ * Free storage owned by the snapshot. Safe to call on a zeroed snapshot.
+ */
+void socket_snapshot_free(socket_snapshot_t *snap);
+
+/*
+ * Find the owning process and FD of every socket on the host.
+ *
+ * Walks every /proc/<pid>/fd/ once to build a single inode -> (pid, fd)
+ * index, then parses each socket table of every network namespace that
+ * an owner is in once against it, so cost is O(total sockets) rather
+ * than O(processes x table size).
+ * Processes that exit or deny access during the walk are skipped. Returns
+ * heap-allocated array via owners parameter. Caller must free with
+ * socket_owner_list_free().
+ *
+ * Returns 0 on success, -1 on error (ENOMEM if allocation fails).
+ */
+int find_all_socket_owners(socket_owner_t **owners, int *count);
+
+/*
+ * Free memory allocated by find_all_socket_owners(). Safe to call with NULL.
+ */
+void socket_owner_list_free(socket_owner_t *owners);
+
 /*
  * Convert TCP state enum to human-readable string.
  *
@@ -46,4 +231,23 @@ const char *tcp_state_to_string(tcp_state_t state);
  */
 void format_ip_port(uint32_t addr, uint16_t port, char *buf, size_t buflen);
 
+/*
+ * Format one end of a socket as a string.
+ *
+ * IPv4 as "192.168.1.1:8080", IPv6 as "[::1]:8080", UNIX as the bound
+ * path or "*" if unnamed. Selects the local end when local is true,
+ * otherwise the remote end. Buffer should be at least SOCKET_ADDR_MAX
+ * bytes.
+ */
+void format_socket_addr(const socket_info_t *sock, bool local,
+                        char *buf, size_t buflen);
+
+/*
+ * Return protocol label for a socket: "TCP", "TCP6", "UDP", "UDP6" or
+ * "UNIX". Never returns NULL.
+ */
+const char *socket_proto_to_string(const socket_info_t *sock);
+
+#pragma GCC visibility pop
+
 #endif /* NET_H */
\ No newline at end of file
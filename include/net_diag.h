@@ -0,0 +1,40 @@
+/*
+ * net_diag.h - NETLINK_SOCK_DIAG socket enumeration
+ *
+ * Binary alternative to parsing /proc/net text tables. The kernel sends
+ * inet_diag / unix_diag records directly, skipping text formatting.
+ */
+
+#ifndef NET_DIAG_H
+#define NET_DIAG_H
+
+#include <stdint.h>
+#include "pinspect.h"
+#include "idmap.h"
+
+/*
+ * Called for each socket whose inode is in the target set, with the value
+ * the set maps that inode to. sock is only valid during the call. Return 0
+ * to continue or non-zero to stop.
+ */
+typedef int (*diag_visit_fn)(const socket_info_t *sock, int value, void *ctx);
+
+/*
+ * Dump one socket family/protocol over netlink, calling visit for each
+ * record whose inode is in target_inodes.
+ *
+ * family is AF_INET, AF_INET6 or AF_UNIX; ipproto is IPPROTO_TCP or
+ * IPPROTO_UDP (ignored for AF_UNIX). states is a bitmask of (1 << state)
+ * values the kernel should report; sockets in other states are filtered
+ * kernel-side.
+ *
+ * Returns 0 when the dump completed or visit stopped it, -1 on error
+ * (EPROTONOSUPPORT/EAFNOSUPPORT/EPERM if sock_diag is unavailable, ENOENT
+ * if the diag module for this family is not loaded, ENOMEM if allocation
+ * fails).
+ */
+int diag_dump_sockets(int family, int ipproto, uint32_t states,
+                      const id_map_t *target_inodes,
+                      diag_visit_fn visit, void *ctx);
+
+#endif /* NET_DIAG_H */
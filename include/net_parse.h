@@ -0,0 +1,85 @@
+/*
+ * net_parse.h - In-place row parsers for /proc/net tables
+ *
+ * Hand-written tokenizer shared by tcp, tcp6, udp, udp6 and unix. Rows are
+ * scanned once without copying fields or calling sscanf(), straight from
+ * the large read buffer parse_net_table() streams each table through.
+ */
+
+#ifndef NET_PARSE_H
+#define NET_PARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pinspect.h"
+
+/*
+ * Decode exactly len hex digits (upper or lower case) into *value.
+ *
+ * Returns true on success, false if any character is not a hex digit or
+ * len is 0 or greater than 8.
+ */
+bool parse_hex_u32(const char *s, size_t len, uint32_t *value);
+
+/*
+ * Decode words runs of exactly 8 hex digits each, back to back, into
+ * values[0..words-1], the same as calling parse_hex_u32(s + 8 * i, 8).
+ * Decodes 16 digits per step with SSE2 when the build targets it.
+ *
+ * Returns true on success, false if any character is not a hex digit or
+ * words is 0; values is then undefined.
+ */
+bool parse_hex_words(const char *s, size_t words, uint32_t *values);
+
+/*
+ * Parse one data row of /proc/net/{tcp,udp,tcp6,udp6}.
+ *
+ * Address width selects the family: 8 hex digits is AF_INET, 32 is
+ * AF_INET6. Fills family, addresses, ports, state and inode; the caller
+ * sets proto. line need not be NUL-terminated.
+ *
+ * Returns 0 on success, -1 if the row is malformed (e.g. the header line).
+ */
+int parse_inet_row(const char *line, size_t len, socket_info_t *sock);
+
+/*
+ * Parse one data row of /proc/net/unix.
+ *
+ * Fills family, state (LISTEN, ESTABLISHED, ...), inode and path. The
+ * caller sets proto. line need not be NUL-terminated.
+ *
+ * Returns 0 on success, -1 if the row is malformed (e.g. the header line).
+ */
+int parse_unix_row(const char *line, size_t len, socket_info_t *sock);
+
+/* Buffer size for parse_net_table(): about 7,000 tcp rows per read() */
+#define NET_READ_SIZE (1024 * 1024)
+
+/* Row parser for one table format: parse_inet_row or parse_unix_row */
+typedef int (*net_row_parser_t)(const char *line, size_t len,
+                                socket_info_t *sock);
+
+/*
+ * Visitor called by parse_net_table() with each parsed row. sock may be
+ * modified and is not valid after the call returns. Return 0 to continue
+ * or non-zero to stop.
+ */
+typedef int (*net_row_visit_fn)(socket_info_t *sock, void *ctx);
+
+/*
+ * Parse the table at path relative to dirfd with parse_row, reading it
+ * through buf in size-byte read() calls. Rows are parsed in place, and a
+ * row cut by the end of one read is carried into the next. Rows that fail
+ * to parse, like the header line, are skipped. size should be at least
+ * NET_READ_SIZE to keep the number of seq_file reads low.
+ *
+ * Returns 0 when the table was read to the end or visit stopped it, -1 on
+ * error (EINVAL for NULL arguments or size 0, errno from openat()/read()
+ * otherwise).
+ */
+int parse_net_table(int dirfd, const char *path, net_row_parser_t parse_row,
+                    char *buf, size_t size, net_row_visit_fn visit,
+                    void *ctx);
+
+#endif /* NET_PARSE_H */
@@ -0,0 +1,118 @@
+/*
+ * output.h - Machine-readable record output (JSON Lines and binary)
+ *
+ * Serializes process, memory, FD, thread, socket and count records straight into
+ * one large write buffer that is flushed with write(2) only when full, so
+ * a host-wide dump costs a handful of syscalls instead of one per line.
+ *
+ * Binary stream layout (all integers little-endian, see
+ * docs/output-formats.md):
+ *
+ *   header:  "PNSP" u16 version u16 reserved
+ *   record:  u32 length, u8 type, payload[length - 1]
+ *   string:  u16 length, bytes (no terminator)
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "pinspect.h"
+
+#pragma GCC visibility push(default)
+
+/* Size of the buffer between records and write(2) */
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+/* Binary stream header */
+#define OUTPUT_BINARY_MAGIC "PNSP"
+#define OUTPUT_BINARY_VERSION 2
+
+typedef enum {
+    OUTPUT_TEXT,        /* Human-readable tables (printf, not this module) */
+    OUTPUT_JSONL,       /* One JSON object per line */
+    OUTPUT_BINARY       /* Length-prefixed binary records */
+} output_format_t;
+
+/* Binary record type byte */
+typedef enum {
+    OUTPUT_RECORD_PROCESS = 1,
+    OUTPUT_RECORD_FD = 2,
+    OUTPUT_RECORD_THREAD = 3,
+    OUTPUT_RECORD_SOCKET = 4,
+    OUTPUT_RECORD_ERROR = 5,
+    OUTPUT_RECORD_MEMORY = 6,
+    OUTPUT_RECORD_MEM_FILE = 7,
+    OUTPUT_RECORD_COUNTS = 8
+} output_record_t;
+
+/*
+ * Buffered record writer. Initialize with output_open(), finish with
+ * output_close(). After the first failed write(2) further records are
+ * dropped and output_close() reports the error.
+ */
+typedef struct {
+    int fd;
+    output_format_t format;
+    char *buf;
+    size_t len;
+    int error;          /* errno of first failed write, 0 if none */
+} output_t;
+
+/*
+ * Parse "text", "jsonl" or "binary".
+ *
+ * Returns 0 on success, -1 if name is unknown (EINVAL).
+ */
+int output_parse_format(const char *name, output_format_t *format);
+
+/*
+ * Start writing records in format to fd. Writes the stream header for
+ * OUTPUT_BINARY.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for OUTPUT_TEXT or NULL,
+ * ENOMEM if the buffer cannot be allocated).
+ */
+int output_open(output_t *out, int fd, output_format_t format);
+
+/* Append one record. No-ops once a write has failed. */
+void output_process(output_t *out, const proc_info_t *info);
+void output_fd(output_t *out, pid_t pid, const fd_entry_t *entry,
+               const char *target);
+void output_thread(output_t *out, pid_t pid, const thread_info_t *thread);
+
+/* fd is the owning descriptor, or -1 if not known */
+void output_socket(output_t *out, pid_t pid, int fd,
+                   const socket_info_t *sock);
+
+/* Whole-process memory usage (smaps_rollup) */
+void output_memory(output_t *out, pid_t pid, const mem_usage_t *usage);
+
+/* One entry of a per-file memory breakdown; name from mem_file_name() */
+void output_mem_file(output_t *out, pid_t pid, const mem_file_t *entry,
+                     const char *name);
+
+/* FD and socket totals from a host scan; -1 for a count not known */
+void output_counts(output_t *out, pid_t pid, int fd_count, int socket_count);
+
+/* A PID that could not be read; err is an errno value */
+void output_error(output_t *out, pid_t pid, int err);
+
+/*
+ * Write any buffered records to fd.
+ *
+ * Returns 0 on success, -1 on error (errno from write(2), e.g. EPIPE).
+ */
+int output_flush(output_t *out);
+
+/*
+ * Flush and release the buffer. Does not close fd. Safe with NULL.
+ *
+ * Returns 0 if every record was written, -1 otherwise (errno set).
+ */
+int output_close(output_t *out);
+
+#pragma GCC visibility pop
+
+#endif /* OUTPUT_H */
@@ -12,10 +12,30 @@
 #include <linux/limits.h>
 #include <stdint.h>
 
+#pragma GCC visibility push(default)
 
 /* Constants */
 #define PROC_ROOT "/proc"
 #define PROC_NAME_MAX 16  /* Kernel truncates to 15 chars + null */
+#define SOCKET_PATH_MAX 108  /* Matches sizeof(sockaddr_un.sun_path) */
+
+/*
+ * Report fields selectable with --fields, as a bitmask. The status bits
+ * are the STATUS_FIELD_* bits of proc_status.h, so (fields & FIELDS_STATUS)
+ * can be passed straight to the status parser.
+ */
+#define FIELD_NAME      (1u << 0)   /* name */
+#define FIELD_STATE     (1u << 1)   /* state */
+#define FIELD_UID       (1u << 2)   /* uid_real, uid_effective */
+#define FIELD_GID       (1u << 3)   /* gid_real, gid_effective */
+#define FIELD_VM_PEAK   (1u << 4)   /* vm_peak_kb */
+#define FIELD_VM_SIZE   (1u << 5)   /* vm_size_kb */
+#define FIELD_VM_RSS    (1u << 6)   /* vm_rss_kb */
+#define FIELD_THREADS   (1u << 7)   /* thread_count */
+#define FIELD_FDS       (1u << 10)  /* Open FD count */
+#define FIELD_SOCKETS   (1u << 11)  /* Socket count */
+#define FIELDS_STATUS   0xffu       /* Every field read from status */
+#define FIELDS_ALL      (FIELDS_STATUS | FIELD_FDS | FIELD_SOCKETS)
 
 /* Process states from /proc/<PID>/status */
 typedef enum {
@@ -41,30 +61,131 @@ typedef struct {
     unsigned long vm_rss_kb;
     unsigned long vm_peak_kb;
     int thread_count;
+    /* Only filled when asked for through read_status_fields_at() */
+    unsigned long voluntary_ctxt_switches;
+    unsigned long nonvoluntary_ctxt_switches;
 } proc_info_t;
 
+/* What an FD refers to, classified from its /proc/<pid>/fd symlink text */
+typedef enum {
+    FD_TYPE_FILE,           /* Absolute path outside /dev */
+    FD_TYPE_DEVICE,         /* /dev/... */
+    FD_TYPE_SOCKET,         /* socket:[inode] */
+    FD_TYPE_PIPE,           /* pipe:[inode] */
+    FD_TYPE_ANON_INODE,     /* anon_inode:[eventfd], anon_inode:[eventpoll], ... */
+    FD_TYPE_OTHER           /* Anything else (e.g. net:[...], mnt:[...]) */
+} fd_type_t;
+
 /*
  * File descriptor entry - describes one open file descriptor.
  *
- * Each entry in /proc/<pid>/fd/ is a symlink. We capture the FD number
- * and what it points to.
+ * Each entry in /proc/<pid>/fd/ is a symlink. We capture the FD number,
+ * its classified type and where its target text lives in the owning
+ * fd_list_t arena (use fd_target() to get it as a C string).
  */
 typedef struct {
     int fd;                         /* File descriptor number */
-    char target[PATH_MAX];          /* Symlink target (what FD points to) */
-    bool is_socket;                 /* True if target is a socket */
-    unsigned long socket_inode;     /* If is_socket, the inode number */
+    fd_type_t type;                 /* Classified target type */
+    uint32_t target_offset;         /* Start of target in list arena */
+    uint32_t target_len;            /* Target length, excluding the NUL */
+    unsigned long socket_inode;     /* If FD_TYPE_SOCKET, the inode number */
 } fd_entry_t;
 
+/*
+ * All FDs of one process. Targets are stored back to back, NUL-terminated,
+ * in a single bump-allocated string arena, so the list is two allocations
+ * regardless of FD count. Zero-initialize or fill with enumerate_fds();
+ * release with fd_list_free().
+ */
+typedef struct {
+    fd_entry_t *entries;
+    int count;
+    char *strings;                  /* Target arena */
+    size_t strings_len;             /* Bytes used, including NULs */
+} fd_list_t;
+
+/*
+ * FD types of a uniform sample of one process's FDs. total is how many
+ * FDs were listed; sampled of them were resolved, with type_counts[t]
+ * of type t. Scale a count up with estimate_count().
+ */
+typedef struct {
+    int total;
+    int sampled;
+    int type_counts[FD_TYPE_OTHER + 1];
+} fd_sample_t;
+
 /*
  * Thread information - describes one thread in a process.
  */
 typedef struct {
     pid_t tid;              /* Thread ID */
-    char name[16];          /* Thread name from comm file */
+    char name[16];          /* Thread name (comm) */
     proc_state_t state;     /* Thread state */
+    unsigned long long utime;   /* User CPU time, clock ticks */
+    unsigned long long stime;   /* System CPU time, clock ticks */
+    int processor;          /* CPU the thread last ran on */
+    /* 0 unless THREAD_READ_CTXT_SWITCHES was given */
+    unsigned long nr_voluntary_ctxt_switches;
+    unsigned long nr_involuntary_ctxt_switches;
 } thread_info_t;
 
+/* Thread states of a uniform sample of one process's threads */
+typedef struct {
+    int total;              /* Threads listed in task/ */
+    int sampled;            /* Of which read */
+    int state_counts[PROC_STATE_UNKNOWN + 1];
+} thread_sample_t;
+
+/*
+ * Memory usage from smaps_rollup, or summed over smaps mappings. All
+ * values are in KB. Fields an older kernel doesn't report stay 0.
+ */
+typedef struct {
+    unsigned long size_kb;          /* Mapped size (smaps only) */
+    unsigned long rss_kb;
+    unsigned long pss_kb;           /* RSS with shared pages split evenly */
+    unsigned long pss_anon_kb;      /* PSS split by backing: rollup only */
+    unsigned long pss_file_kb;
+    unsigned long pss_shmem_kb;
+    unsigned long shared_clean_kb;
+    unsigned long shared_dirty_kb;
+    unsigned long private_clean_kb;
+    unsigned long private_dirty_kb;
+    unsigned long anonymous_kb;     /* Anonymous RSS */
+    unsigned long anon_huge_kb;     /* AnonHugePages (THP) */
+    unsigned long shmem_huge_kb;    /* ShmemPmdMapped */
+    unsigned long file_huge_kb;     /* FilePmdMapped */
+    unsigned long hugetlb_kb;       /* Shared_Hugetlb + Private_Hugetlb */
+    unsigned long swap_kb;
+    unsigned long swap_pss_kb;
+    unsigned long locked_kb;
+} mem_usage_t;
+
+/*
+ * Memory of all mappings backed by one file, or one named region such as
+ * [heap] or [stack]. Its name lives in the owning mem_file_list_t arena
+ * (use mem_file_name() to get it as a C string).
+ */
+typedef struct {
+    uint32_t name_offset;           /* Start of name in list arena */
+    uint32_t name_len;              /* Name length, excluding the NUL */
+    int vma_count;                  /* Mappings aggregated into this entry */
+    mem_usage_t usage;              /* Sum over those mappings */
+} mem_file_t;
+
+/*
+ * Per-file memory breakdown of one process, sorted by descending PSS.
+ * Zero-initialize or fill with enumerate_mem_files(); release with
+ * mem_file_list_free().
+ */
+typedef struct {
+    mem_file_t *entries;
+    int count;
+    char *strings;                  /* Name arena */
+    size_t strings_len;             /* Bytes used, including NULs */
+} mem_file_list_t;
+
 /* TCP connection state */
 typedef enum {
     TCP_ESTABLISHED = 1,
@@ -80,15 +201,57 @@ typedef enum {
     TCP_CLOSING
 } tcp_state_t;
 
+/* Socket protocol, from which /proc/net table the entry came */
+typedef enum {
+    SOCK_PROTO_TCP,
+    SOCK_PROTO_UDP,
+    SOCK_PROTO_UNIX
+} sock_proto_t;
+
+/* Source of socket records for find_process_sockets() and friends */
+typedef enum {
+    NET_BACKEND_AUTO,        /* Netlink when available, else /proc/net */
+    NET_BACKEND_PROC,        /* Always parse /proc/net text tables */
+    NET_BACKEND_NETLINK      /* Always use NETLINK_SOCK_DIAG */
+} net_backend_t;
+
+/* How for_each_fd_at() resolves FD targets */
+typedef enum {
+    FD_BACKEND_READLINK,     /* One readlinkat() per FD */
+    FD_BACKEND_URING         /* Batched io_uring statx, readlinkat for rest */
+} fd_backend_t;
+
+/* IPv4 or IPv6 address in network byte order */
+typedef union {
+    uint32_t v4;             /* AF_INET: same layout as in_addr.s_addr */
+    uint8_t v6[16];          /* AF_INET6: same layout as in6_addr */
+} net_addr_t;
+
 /* Network socket info */
 typedef struct {
-    bool is_tcp;             /* true = TCP, false = UDP */
-    uint32_t local_addr;     /* Local IP in network byte order */
+    sock_proto_t proto;      /* TCP, UDP or UNIX */
+    int family;              /* AF_INET, AF_INET6 or AF_UNIX */
+    net_addr_t local_addr;   /* Local IP (unused for UNIX) */
     uint16_t local_port;     /* Local port in host byte order */
-    uint32_t remote_addr;    /* Remote IP in network byte order */
+    net_addr_t remote_addr;  /* Remote IP (unused for UNIX) */
     uint16_t remote_port;    /* Remote port in host byte order */
-    tcp_state_t state;       /* Connection state (meaningful for TCP) */
+    tcp_state_t state;       /* Connection state (TCP and UNIX) */
     unsigned long inode;     /* Socket inode for correlation */
+    char path[SOCKET_PATH_MAX]; /* UNIX socket path, "" if unnamed */
 } socket_info_t;
 
+/*
+ * Socket ownership - one connection and one process FD referring to it.
+ *
+ * A socket shared across fork() or dup() appears once per owning FD.
+ */
+typedef struct {
+    socket_info_t socket;           /* Connection details */
+    pid_t pid;                      /* Owning process */
+    int fd;                         /* FD number within that process */
+    char name[PROC_NAME_MAX];       /* Owning process name from comm */
+} socket_owner_t;
+
+#pragma GCC visibility pop
+
 #endif /* PINSPECT_H */
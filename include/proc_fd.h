@@ -1,7 +1,9 @@
 /*
  * proc_fd.h - File descriptor enumeration API
  *
- * Functions for enumerating and analyzing /proc/<PID>/fd/.
+ * Functions for enumerating and analyzing /proc/<PID>/fd/. Each collector
+ * has a pid form, which opens a proc_handle_t for the one call, and an _at
+ * form that works through a handle the caller already holds.
  */
 
 #ifndef PROC_FD_H
@@ -9,26 +11,142 @@
 
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "pinspect.h"
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/*
+ * Select how for_each_fd() and enumerate_fds() resolve targets. Default
+ * is FD_BACKEND_READLINK, one readlinkat() per FD. FD_BACKEND_URING
+ * overlaps each getdents64() batch with an io_uring batch of statx()
+ * calls on the previous one: sockets and pipes are named from the inode
+ * statx() returns and only other FDs need a readlinkat(), so a walk
+ * makes two io_uring_enter() calls per batch instead of one syscall per
+ * FD. Walks of fewer than FD_URING_MIN_FDS entries, fixture roots and
+ * kernels without io_uring use readlinkat() as before. Both backends
+ * produce identical entries.
+ */
+void fd_set_backend(fd_backend_t backend);
+
+/*
+ * Return the backend last set with fd_set_backend().
+ */
+fd_backend_t fd_get_backend(void);
+
+/* Fewest FDs in a first batch for which FD_BACKEND_URING sets up a ring */
+#define FD_URING_MIN_FDS 256
+
+/*
+ * Visitor called once per FD by for_each_fd(). entry lives on the walker's
+ * stack with target_offset 0; target is its NUL-terminated symlink text.
+ * Neither pointer is valid after the call returns. Return 0 to continue
+ * or non-zero to stop the walk.
+ */
+typedef int (*fd_visit_fn)(const fd_entry_t *entry, const char *target,
+                           void *ctx);
+
+/*
+ * Call visit for each file descriptor of a process without allocating.
+ *
+ * Same directory walk and skipping rules as enumerate_fds(), so memory use
+ * is constant however many FDs the process has: one getdents64() buffer,
+ * plus a fixed ~220 KB work area on the FD_BACKEND_URING path.
+ *
+ * FDs closed during the walk are skipped; any other readlinkat() failure
+ * ends it with that errno.
+ *
+ * Returns 0 when the walk completed or visit stopped it, -1 on error
+ * (EINVAL if visit is NULL, ENOENT if process not found, EACCES if
+ * permission denied, which includes an fd/ that can be listed but whose
+ * links cannot be read).
+ */
+int for_each_fd(pid_t pid, fd_visit_fn visit, void *ctx);
+int for_each_fd_at(const proc_handle_t *h, fd_visit_fn visit, void *ctx);
+
+/*
+ * Count the open file descriptors of a process without resolving them.
+ *
+ * Uses the descriptor count procfs reports as the st_size of
+ * /proc/<pid>/fd (Linux 6.2+), falling back to a getdents64() scan of the
+ * directory on older kernels. No readlink() is done either way, so cost
+ * does not grow with target lengths. On the calling process the count
+ * includes the directory handle this call opens, as enumerate_fds() does.
+ *
+ * Returns 0 on success, -1 on error (EINVAL if count is NULL, ENOENT if
+ * process not found, EACCES if permission denied).
+ */
+int count_fds(pid_t pid, int *count);
+int count_fds_at(const proc_handle_t *h, int *count);
+
+/*
+ * Count the open file descriptors of a process and how many of them are
+ * sockets. Each symlink is read into a buffer just long enough for the
+ * "socket:[" prefix, so no target is copied in full, but this still costs
+ * one readlinkat() per FD against count_fds()'s single fstat(). FDs closed
+ * during the walk are not counted.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL counts, ENOENT if
+ * process not found, EACCES if permission denied, which includes an fd/
+ * that can be listed but whose links cannot be read).
+ */
+int count_socket_fds(pid_t pid, int *fd_count, int *socket_count);
+int count_socket_fds_at(const proc_handle_t *h, int *fd_count,
+                        int *socket_count);
+
+/*
+ * Classify a uniform sample of size FDs of a process. fd/ is listed once
+ * and only the sampled links are read, so a process with a million FDs
+ * costs one listing plus size readlinkat() calls. The same seed samples
+ * the same FDs of an unchanged process. out->total is every FD listed;
+ * FDs closed before their link was read are left out of out->sampled.
+ * A process with at most size FDs is read in full.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL out or size <= 0,
+ * ENOENT if process not found, EACCES if permission denied, ENOMEM). On
+ * error out is zeroed.
+ */
+int sample_fds(pid_t pid, int size, uint64_t seed, fd_sample_t *out);
+int sample_fds_at(const proc_handle_t *h, int size, uint64_t seed,
+                  fd_sample_t *out);
 
 /*
  * Enumerate all file descriptors for a process.
  *
  * Reads /proc/<pid>/fd/ and resolves each symlink to determine what the
- * descriptor points to. Returns heap-allocated array via entries parameter.
- * Caller must free with fd_entries_free().
+ * descriptor points to. Fills list with heap-allocated entries and target
+ * arena. Caller must free with fd_list_free().
  *
  * Returns 0 on success, -1 on error (ENOENT if process not found, EACCES
- * if permission denied, ENOMEM if allocation fails).
+ * if permission denied, including links that cannot be read, ENOMEM if
+ * allocation fails). On error list is left empty.
  */
-int enumerate_fds(pid_t pid, fd_entry_t **entries, int *count);
+int enumerate_fds(pid_t pid, fd_list_t *list);
+int enumerate_fds_at(const proc_handle_t *h, fd_list_t *list);
 
 /*
- * Free array of fd_entry_t returned by enumerate_fds().
+ * Free the entries and target arena of list and reset it to empty.
  *
- * Safe to call with NULL pointer.
+ * Safe to call with NULL or an already-empty list.
  */
-void fd_entries_free(fd_entry_t *entries);
+void fd_list_free(fd_list_t *list);
+
+/*
+ * Target text of entry, which must belong to list. Never returns NULL.
+ */
+const char *fd_target(const fd_list_t *list, const fd_entry_t *entry);
+
+/*
+ * Classify a symlink target ("socket:[1]", "pipe:[2]", "/dev/null", ...).
+ */
+fd_type_t classify_fd_target(const char *target);
+
+/*
+ * Short label for an FD type: "file", "device", "socket", "pipe",
+ * "anon_inode" or "other". Never returns NULL.
+ */
+const char *fd_type_to_string(fd_type_t type);
 
 /*
  * Parse socket inode from symlink target string.
@@ -38,4 +156,6 @@ void fd_entries_free(fd_entry_t *entries);
  */
 bool parse_socket_inode(const char *target, unsigned long *inode);
 
+#pragma GCC visibility pop
+
 #endif /* PROC_FD_H */
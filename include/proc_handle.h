@@ -0,0 +1,95 @@
+/*
+ * proc_handle.h - Open handle on one process's /proc directory
+ *
+ * Holds /proc/<pid> open as a directory descriptor, plus a pidfd where the
+ * kernel supports one, so collectors open files relative to it with
+ * openat()/readlinkat() instead of rebuilding and re-resolving absolute
+ * paths for every file.
+ *
+ * The directory descriptor is pinned to the process it was opened for:
+ * once that process is reaped, lookups through the handle fail (ESRCH or
+ * ENOENT) even if the PID has been reused, so every read made through one
+ * handle describes the same process.
+ */
+
+#ifndef PROC_HANDLE_H
+#define PROC_HANDLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#pragma GCC visibility push(default)
+
+typedef struct {
+    pid_t pid;
+    int dirfd;          /* /proc/<pid>, or -1 when closed */
+    int pidfd;          /* pidfd_open() descriptor, or -1 if unsupported */
+} proc_handle_t;
+
+/*
+ * Open a handle on pid.
+ *
+ * The pidfd is optional (Linux 5.3+, may be blocked by seccomp); the
+ * handle works without it. Both descriptors are verified to refer to the
+ * same process before returning.
+ *
+ * Returns 0 on success, -1 on error (EINVAL if h is NULL or pid is not
+ * positive, ENOENT if process not found, EACCES if permission denied).
+ * On error h is closed.
+ */
+int proc_handle_open(proc_handle_t *h, pid_t pid);
+
+/*
+ * Close both descriptors. Safe with NULL or an already-closed handle.
+ */
+void proc_handle_close(proc_handle_t *h);
+
+/*
+ * openat() relative to the handle's /proc/<pid> directory, e.g. "status"
+ * or "task/1234/comm". O_CLOEXEC is always added.
+ *
+ * Returns a descriptor, or -1 on error (EBADF if h is NULL or closed).
+ */
+int proc_handle_openat(const proc_handle_t *h, const char *rel, int flags);
+
+/*
+ * Read up to size - 1 bytes of a file relative to the handle into buf and
+ * NUL-terminate it. Meant for small files (comm, stat, status).
+ *
+ * Returns bytes read, or -1 on error (errno from openat()/read()).
+ */
+ssize_t proc_handle_read(const proc_handle_t *h, const char *rel,
+                         char *buf, size_t size);
+
+/*
+ * Store the inode of the process's network namespace (the ns/net link) in
+ * *netns. Two processes see the same socket tables exactly when their
+ * inodes are equal. Needs the same ptrace access as reading fd/.
+ *
+ * Returns 0 on success, -1 on error (EBADF if h is NULL or closed,
+ * EINVAL if netns is NULL, errno from fstatat() otherwise).
+ */
+int proc_handle_netns(const proc_handle_t *h, unsigned long *netns);
+
+/*
+ * Return true once the process has exited, including while it is a
+ * zombie. Uses the pidfd when available; otherwise reports exit only
+ * after the process has been reaped.
+ */
+bool proc_handle_exited(const proc_handle_t *h);
+
+/*
+ * Sleep until the absolute CLOCK_MONOTONIC deadline. With a pidfd the wait
+ * is a poll() on it, so it also ends as soon as the process exits; check
+ * proc_handle_exited() afterwards.
+ *
+ * Returns 0 at the deadline or on exit, -1 on error (EINVAL for a closed
+ * handle or NULL deadline, EINTR if a signal interrupted the wait).
+ */
+int proc_handle_wait(const proc_handle_t *h, const struct timespec *deadline);
+
+#pragma GCC visibility pop
+
+#endif /* PROC_HANDLE_H */
@@ -0,0 +1,116 @@
+/*
+ * proc_mem.h - Memory usage from /proc/<PID>/smaps_rollup and smaps
+ *
+ * read_mem_usage() reads smaps_rollup, which the kernel sums over every
+ * mapping in one pass, so it costs about as much as reading status.
+ * for_each_vma() and enumerate_mem_files() stream the full smaps file,
+ * which is about 1 KB of text per mapping, when a per-mapping breakdown is
+ * actually wanted. Each collector has a pid form and an _at form that
+ * works through an open proc_handle_t.
+ */
+
+#ifndef PROC_MEM_H
+#define PROC_MEM_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "pinspect.h"
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/* Name used in mem_file_list_t for mappings with no backing path */
+#define MEM_ANON_NAME "[anon]"
+
+/*
+ * One mapping from smaps. path points into the walker's buffer: it is ""
+ * for anonymous memory, and may end in " (deleted)". Neither path nor the
+ * struct is valid after the visitor returns.
+ */
+typedef struct {
+    unsigned long start;        /* First address */
+    unsigned long end;          /* One past the last address */
+    char perms[5];              /* "r-xp", "rw-s", ... */
+    unsigned long inode;        /* Backing file inode, 0 if anonymous */
+    const char *path;
+    mem_usage_t usage;
+} vma_info_t;
+
+/*
+ * Visitor called once per mapping by for_each_vma(). Return 0 to
+ * continue or non-zero to stop the walk.
+ */
+typedef int (*vma_visit_fn)(const vma_info_t *vma, void *ctx);
+
+/*
+ * Read total memory usage of a process from smaps_rollup. On kernels
+ * without smaps_rollup (before 4.14) the smaps mappings are summed
+ * instead.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL usage, ENOENT if
+ * process not found, EACCES if permission denied).
+ */
+int read_mem_usage(pid_t pid, mem_usage_t *usage);
+int read_mem_usage_at(const proc_handle_t *h, mem_usage_t *usage);
+
+/*
+ * Call visit for each mapping in smaps, in address order. The file is
+ * streamed through a fixed buffer, so memory use does not grow with the
+ * number of mappings.
+ *
+ * Returns 0 when the walk completed or visit stopped it, -1 on error
+ * (EINVAL if visit is NULL, ENOENT if process not found, EACCES if
+ * permission denied).
+ */
+int for_each_vma(pid_t pid, vma_visit_fn visit, void *ctx);
+int for_each_vma_at(const proc_handle_t *h, vma_visit_fn visit, void *ctx);
+
+/*
+ * Aggregate smaps by backing file: one entry per distinct path or named
+ * region ([heap], [stack], ...), with anonymous mappings grouped under
+ * MEM_ANON_NAME. Entries are sorted by descending PSS. Memory use is
+ * proportional to the number of distinct files, not mappings. Caller must
+ * free with mem_file_list_free().
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL list, ENOENT if
+ * process not found, EACCES if permission denied, ENOMEM).
+ */
+int enumerate_mem_files(pid_t pid, mem_file_list_t *list);
+int enumerate_mem_files_at(const proc_handle_t *h, mem_file_list_t *list);
+
+/*
+ * Name of a file entry as a NUL-terminated string. Returns "" for NULL
+ * arguments.
+ */
+const char *mem_file_name(const mem_file_list_t *list,
+                          const mem_file_t *entry);
+
+/*
+ * Free memory owned by list and zero it. Safe to call with NULL.
+ */
+void mem_file_list_free(mem_file_list_t *list);
+
+/*
+ * Add every "Key: <n> kB" line of text (len bytes, need not be
+ * NUL-terminated) that maps to a mem_usage_t field into usage. Other
+ * lines, including smaps mapping headers, are ignored, so a whole smaps
+ * file sums to the process totals.
+ *
+ * Returns the number of lines added.
+ */
+unsigned parse_mem_usage(const char *text, size_t len, mem_usage_t *usage);
+
+/*
+ * Parse an smaps mapping header ("start-end perms offset dev inode path")
+ * of len bytes into vma. vma->path points into line and is not
+ * NUL-terminated; its length is stored in *path_len. usage is zeroed.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments or a line
+ * that is not a header).
+ */
+int parse_vma_header(const char *line, size_t len, vma_info_t *vma,
+                     size_t *path_len);
+
+#pragma GCC visibility pop
+
+#endif /* PROC_MEM_H */
@@ -7,8 +7,28 @@
 #ifndef PROC_STATUS_H
 #define PROC_STATUS_H
 
+#include <stddef.h>
 #include <sys/types.h>
 #include "pinspect.h"
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/* proc_info_t fields parsed from a status file, as a bitmask */
+#define STATUS_FIELD_NAME     (1u << 0)   /* name */
+#define STATUS_FIELD_STATE    (1u << 1)   /* state */
+#define STATUS_FIELD_UID      (1u << 2)   /* uid_real, uid_effective */
+#define STATUS_FIELD_GID      (1u << 3)   /* gid_real, gid_effective */
+#define STATUS_FIELD_VM_PEAK  (1u << 4)   /* vm_peak_kb */
+#define STATUS_FIELD_VM_SIZE  (1u << 5)   /* vm_size_kb */
+#define STATUS_FIELD_VM_RSS   (1u << 6)   /* vm_rss_kb */
+#define STATUS_FIELD_THREADS  (1u << 7)   /* thread_count */
+#define STATUS_FIELD_VOLUNTARY_CTXT     (1u << 8)
+#define STATUS_FIELD_NONVOLUNTARY_CTXT  (1u << 9)
+
+/* What read_proc_status() fills; the context switch lines end the file */
+#define STATUS_FIELDS_DEFAULT 0xffu
+#define STATUS_FIELDS_ALL     0x3ffu
 
 /*
  * Read process info from /proc/<pid>/status.
@@ -21,4 +41,50 @@
  */
 int read_proc_status(pid_t pid, proc_info_t *info);
 
+/*
+ * Same as read_proc_status(), reading status through an open handle.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, ENOENT or
+ * ESRCH if the process has exited).
+ */
+int read_proc_status_at(const proc_handle_t *h, proc_info_t *info);
+
+/*
+ * Same as read_proc_status_at(), parsing only the STATUS_FIELD_* bits in
+ * wanted; the rest of info is zeroed, with state PROC_STATE_UNKNOWN.
+ * Parsing stops at the first line after which every wanted field is
+ * settled.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, ENOENT or
+ * ESRCH if the process has exited).
+ */
+int read_proc_status_fields_at(const proc_handle_t *h, unsigned wanted,
+                               proc_info_t *info);
+
+/*
+ * Read the wanted fields of a status file at path relative to dirfd
+ * (e.g. "status" under /proc/<pid>, or "<tid>/status" under its task
+ * directory) into info. Fields not wanted or not present are left
+ * unchanged. Stops reading once every wanted field is filled.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, errno from
+ * openat()/read() otherwise).
+ */
+int read_status_fields_at(int dirfd, const char *path, unsigned wanted,
+                          proc_info_t *info);
+
+/*
+ * Parse the wanted fields of status text (len bytes, need not be
+ * NUL-terminated) into info, leaving other fields unchanged. Stops at the
+ * first line after which every wanted field is settled.
+ *
+ * Returns the wanted fields that are settled: parsed, or known to be
+ * absent because the Threads: line that follows them was reached (the
+ * memory fields of kernel threads and zombies).
+ */
+unsigned parse_proc_status(const char *text, size_t len, unsigned wanted,
+                           proc_info_t *info);
+
+#pragma GCC visibility pop
+
 #endif /* PROC_STATUS_H */
@@ -2,19 +2,52 @@
  * proc_task.h - Thread enumeration interface
  *
  * Provides API for enumerating threads of a Linux process
- * by reading /proc/<PID>/task/ directory.
+ * by reading /proc/<PID>/task/ directory. Each collector has a pid form
+ * and an _at form that works through an open proc_handle_t.
  */
 
 #ifndef PROC_TASK_H
 #define PROC_TASK_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include "pinspect.h"
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/*
+ * Optional per-thread reads for the _at collectors. Without flags each
+ * thread costs one read of task/<tid>/stat.
+ */
+#define THREAD_READ_CTXT_SWITCHES (1u << 0)   /* Also read task/<tid>/status */
+
+/*
+ * Visitor called once per thread by for_each_thread(). thread lives on
+ * the walker's stack and is not valid after the call returns. Return 0 to
+ * continue or non-zero to stop the walk.
+ */
+typedef int (*thread_visit_fn)(const thread_info_t *thread, void *ctx);
+
+/*
+ * Call visit for each thread of a process without allocating. Threads
+ * that exit while the walk is running are skipped. flags is a mask of
+ * THREAD_READ_*; the pid form uses none.
+ *
+ * Returns 0 when the walk completed or visit stopped it, -1 on error
+ * (EINVAL if visit is NULL, ENOENT if process not found, EACCES if
+ * permission denied).
+ */
+int for_each_thread(pid_t pid, thread_visit_fn visit, void *ctx);
+int for_each_thread_at(const proc_handle_t *h, unsigned flags,
+                       thread_visit_fn visit, void *ctx);
 
 /*
  * Enumerate all threads for a process.
  *
- * Reads /proc/<pid>/task/ and collects TID, name, and state for each thread.
+ * Reads /proc/<pid>/task/ and collects TID, name, state, CPU times and last
+ * CPU for each thread.
  * Returns heap-allocated array via threads parameter. Caller must free with
  * thread_info_free().
  *
@@ -22,10 +55,65 @@
  * if permission denied, ENOMEM if allocation fails).
  */
 int enumerate_threads(pid_t pid, thread_info_t **threads, int *count);
+int enumerate_threads_at(const proc_handle_t *h, unsigned flags,
+                         thread_info_t **threads, int *count);
+
+/*
+ * Count the states of a uniform sample of size threads of a process.
+ * task/ is listed once and only the sampled threads' stat is read. The
+ * same seed samples the same threads of an unchanged process.
+ * out->total is every thread listed; threads that exit before being read
+ * are left out of out->sampled. A process with at most size threads is
+ * read in full.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL out or size <= 0,
+ * ENOENT if process not found, EACCES if permission denied, ENOMEM). On
+ * error out is zeroed.
+ */
+int sample_threads(pid_t pid, int size, uint64_t seed, thread_sample_t *out);
+int sample_threads_at(const proc_handle_t *h, int size, uint64_t seed,
+                      thread_sample_t *out);
+
+/*
+ * enumerate_threads_at() with the per-thread reads split across a worker
+ * pool. task/ is listed once, the TIDs are sorted, and each worker reads
+ * a contiguous slice of them into its own slice of the result, so no
+ * locking is needed. The result is in ascending TID order. workers <= 0
+ * picks thread_workers_for() the thread count; with one worker nothing
+ * is spawned. Call it from a thread that is not itself a pool worker
+ * busy with other processes, or the pools oversubscribe the CPUs.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL outputs, ENOENT if
+ * process not found, EACCES if permission denied, ENOMEM if allocation
+ * fails).
+ */
+int enumerate_threads_parallel_at(const proc_handle_t *h, unsigned flags,
+                                  int workers, thread_info_t **threads,
+                                  int *count);
+
+/*
+ * Return the automatic worker count for reading thread_count threads:
+ * one per 512 threads, at most one per online CPU and at most 8. Below
+ * 1,024 threads it is 1, so small processes never pay for a thread spawn.
+ */
+int thread_workers_for(int thread_count);
+
+/*
+ * Parse one /proc/<pid>/task/<tid>/stat line (len bytes, need not be
+ * NUL-terminated) into thread: tid, name, state, utime, stime and
+ * processor. Context switch counts are set to 0. A name containing ')' or
+ * spaces is handled by ending it at the last ')'.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments or a
+ * malformed line).
+ */
+int parse_thread_stat(const char *text, size_t len, thread_info_t *thread);
 
 /*
  * Free memory allocated by enumerate_threads(). Safe to call with NULL.
  */
 void thread_info_free(thread_info_t *threads);
 
+#pragma GCC visibility pop
+
 #endif /* PROC_TASK_H */
\ No newline at end of file
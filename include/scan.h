@@ -0,0 +1,98 @@
+/*
+ * scan.h - Host-wide process table scan
+ *
+ * Lists /proc once with getdents64(), then collects a short summary
+ * (status plus FD and socket counts) for every process on a worker pool.
+ * Filters are applied as soon as the data they need is known, so a
+ * process dropped by its UID or RSS never has its fd/ directory read.
+ * The top N are picked with a bounded heap in O(n log N) rather than by
+ * sorting every process.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "pinspect.h"
+
+#pragma GCC visibility push(default)
+
+/* Result order; ties are broken by ascending PID */
+typedef enum {
+    SCAN_SORT_PID,      /* Ascending PID */
+    SCAN_SORT_RSS,      /* Descending VmRSS */
+    SCAN_SORT_FDS,      /* Descending FD count */
+    SCAN_SORT_SOCKETS,  /* Descending socket count */
+    SCAN_SORT_THREADS,  /* Descending thread count */
+    SCAN_SORT_UID       /* Ascending effective UID */
+} scan_sort_t;
+
+/* What to collect, which processes to keep and how to order them */
+typedef struct {
+    scan_sort_t sort;
+    int limit;                  /* Keep the first limit in order, 0 = all */
+    unsigned fields;            /* FIELD_* to collect, 0 for FIELDS_ALL */
+    bool match_uid;             /* Keep only uid_effective == uid */
+    uid_t uid;
+    unsigned long min_rss_kb;   /* Keep only VmRSS >= min_rss_kb */
+    int min_fds;                /* Keep only fd_count >= min_fds */
+    int min_threads;            /* Keep only thread_count >= min_threads */
+    int workers;                /* Pool size, <= 0 for one per online CPU */
+} scan_options_t;
+
+/*
+ * One process of a scan. info fields outside the collected fields are
+ * zero, apart from pid and a PROC_STATE_UNKNOWN state. fd_count is -1
+ * when neither FIELD_FDS nor FIELD_SOCKETS was collected, or fd/ could
+ * not be read (other users' processes without privileges). socket_count
+ * is -1 without FIELD_SOCKETS, which costs one readlink per FD, or when
+ * the links could not be read.
+ */
+typedef struct {
+    proc_info_t info;
+    int fd_count;
+    int socket_count;
+} proc_summary_t;
+
+/*
+ * Summarize every process on the host that passes the filters in opts,
+ * in opts->sort order. The fields the filters and sort key need are
+ * collected whether or not they are in opts->fields; files no wanted
+ * field comes from are never opened. Processes that exit during the scan,
+ * or whose status cannot be read, are left out. Caller must free
+ * *summaries with proc_summary_list_free().
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL arguments, ENOMEM,
+ * EAGAIN if worker threads could not be started, or errno from reading
+ * /proc).
+ */
+int scan_processes(const scan_options_t *opts, proc_summary_t **summaries,
+                   int *count);
+
+/*
+ * Reorder items so that the first min(limit, count) of them are the
+ * leading entries in sort order, sorted; limit <= 0 sorts everything.
+ * Uses a heap of the kept entries, so cost is O(count log limit) with no
+ * allocation.
+ *
+ * Returns the number of entries kept.
+ */
+int select_top_summaries(proc_summary_t *items, int count, scan_sort_t sort,
+                         int limit);
+
+/*
+ * Parse "pid", "rss", "fds", "sockets", "threads" or "uid".
+ *
+ * Returns 0 on success, -1 if name is unknown (EINVAL).
+ */
+int scan_parse_sort(const char *name, scan_sort_t *sort);
+
+/*
+ * Free an array returned by scan_processes(). Safe with NULL.
+ */
+void proc_summary_list_free(proc_summary_t *summaries);
+
+#pragma GCC visibility pop
+
+#endif /* SCAN_H */
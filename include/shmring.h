@@ -0,0 +1,147 @@
+/*
+ * shmring.h - Single-producer, multi-consumer ring in POSIX shared memory
+ *
+ * pinspectd publishes one fixed-size record per sampled PID per tick into
+ * a ring it creates with shm_open(); any number of readers map the same
+ * object read-only and follow it. Once mapped, reading is plain loads:
+ * no syscalls and no locks, and a reader can never slow the producer.
+ *
+ * Each slot carries a sequence word used as a seqlock: odd while the
+ * producer is writing it, 2 * (n + 1) once it holds record n. A reader
+ * copies the slot and accepts it only if the word was the expected even
+ * value both before and after the copy, so a torn record is never
+ * returned. A reader that falls more than a ring behind skips ahead to
+ * the oldest record still held and counts what it missed.
+ */
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "pinspect.h"
+
+#pragma GCC visibility push(default)
+
+#define SHMRING_MAGIC   0x474e5250u    /* "PRNG" little-endian */
+#define SHMRING_VERSION 1
+
+/* Ring pinspectd publishes to unless given another name */
+#define SHMRING_DEFAULT_NAME "/pinspectd"
+
+/*
+ * The record pinspectd publishes: one sampled PID at one tick. Fixed
+ * size and pointer-free, so it can be copied byte for byte between
+ * processes built from the same headers (the ring header records
+ * sizeof, and shmring_open() refuses a mismatch). Counts are -1 and the
+ * matching *_errno is set when a collector failed; when status_errno is
+ * set only pid, tick and time_ns are valid.
+ */
+typedef struct {
+    uint64_t tick;          /* Sampling round, counting from 1 */
+    uint64_t time_ns;       /* CLOCK_REALTIME when the tick started */
+    int32_t pid;
+    int32_t status_errno;
+    proc_info_t info;       /* Every status field */
+    int32_t fd_count;
+    int32_t fd_errno;
+    int32_t socket_count;
+    int32_t socket_errno;
+} shm_sample_t;
+
+struct shmring_header;
+
+/*
+ * The producer side. Initialize with shmring_create(), release with
+ * shmring_destroy(). Only one thread may publish.
+ */
+typedef struct {
+    struct shmring_header *header;
+    size_t map_size;
+    char name[NAME_MAX + 1];
+} shmring_t;
+
+/*
+ * One consumer. Initialize with shmring_open(), release with
+ * shmring_close(). cursor is the index of the next record to read;
+ * dropped counts records the producer overwrote before they were read.
+ */
+typedef struct {
+    const struct shmring_header *header;
+    size_t map_size;
+    uint64_t cursor;
+    uint64_t dropped;
+} shmring_reader_t;
+
+/*
+ * Create the shared-memory object name ("/something", as shm_open()
+ * wants) holding capacity slots of record_size bytes, with permission
+ * bits mode. capacity is rounded up to a power of two. An existing object
+ * of that name, such as one left by a crashed producer, is replaced;
+ * readers still mapping it keep the old, now frozen, ring.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for a bad name, size or
+ * capacity, or errno from shm_open(), ftruncate() or mmap()).
+ */
+int shmring_create(shmring_t *ring, const char *name, size_t record_size,
+                   uint32_t capacity, mode_t mode);
+
+/*
+ * Copy one record_size record into the next slot and make it visible to
+ * readers. Wait-free: it never blocks on readers.
+ */
+void shmring_publish(shmring_t *ring, const void *record);
+
+/*
+ * Unmap ring and, with unlink, remove its name so no new reader can
+ * open it. NULL-safe.
+ */
+void shmring_destroy(shmring_t *ring, bool unlink);
+
+/*
+ * Map the ring called name read-only. The cursor starts at the oldest
+ * record the ring still holds; shmring_seek() moves it.
+ *
+ * Returns 0 on success, -1 on error (errno from shm_open() or mmap(),
+ * EPROTO if the object is not a ring of this version, EINVAL if its
+ * records are not record_size bytes).
+ */
+int shmring_open(shmring_reader_t *reader, const char *name,
+                 size_t record_size);
+
+/*
+ * Copy the record at the cursor into out (record_size bytes) and advance
+ * the cursor. Makes no syscalls.
+ *
+ * Returns 1 if a record was copied, 0 if the reader is caught up.
+ */
+int shmring_read(shmring_reader_t *reader, void *out);
+
+/*
+ * Number of records published so far; the newest is head - 1.
+ */
+uint64_t shmring_head(const shmring_reader_t *reader);
+
+/*
+ * Move the cursor to record index, clamped to what the ring still holds
+ * and to the head. Seeking to shmring_head() - n reads the n newest.
+ */
+void shmring_seek(shmring_reader_t *reader, uint64_t index);
+
+/*
+ * PID of the producer that created the ring, so readers can tell a live
+ * ring from one whose producer has gone.
+ */
+pid_t shmring_producer(const shmring_reader_t *reader);
+
+/*
+ * Unmap reader. NULL-safe.
+ */
+void shmring_close(shmring_reader_t *reader);
+
+#pragma GCC visibility pop
+
+#endif /* SHMRING_H */
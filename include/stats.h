@@ -0,0 +1,132 @@
+/*
+ * stats.h - Self-profiling counters for --stats
+ *
+ * Collectors mark the phase they are in with STATS_PHASE_BEGIN() and
+ * STATS_PHASE_END(), and count their syscalls and entries with
+ * STATS_COUNT(). Counts go to the innermost phase of the calling thread
+ * and phase times are exclusive, so the time enumerate_fds() spends
+ * inside find_process_sockets() shows under fds, not net. Counters are
+ * summed across worker threads with relaxed atomics.
+ *
+ * The macros cost one predictable branch until stats_enable() is called,
+ * and nothing at all in builds without PINSPECT_STATS (make STATS=0).
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#pragma GCC visibility push(default)
+
+/* Where time and syscalls are charged */
+typedef enum {
+    STATS_PHASE_OTHER,      /* Outside any collector; not timed */
+    STATS_PHASE_LIST,       /* Listing /proc for --all, --pgrep, owners */
+    STATS_PHASE_STATUS,     /* <pid>/status */
+    STATS_PHASE_FDS,        /* <pid>/fd readdir and readlink */
+    STATS_PHASE_THREADS,    /* <pid>/task/<tid> */
+    STATS_PHASE_NET,        /* Socket tables, text or sock_diag */
+    STATS_PHASE_MEMORY,     /* smaps_rollup and smaps */
+    STATS_PHASE_OUTPUT,     /* Formatting and writing the report */
+    STATS_PHASE_COUNT
+} stats_phase_t;
+
+/* What is counted per phase */
+typedef enum {
+    STATS_CALLS,            /* Times the phase was entered */
+    STATS_WALL_NS,          /* Monotonic time in the phase, all threads */
+    STATS_ENTRIES,          /* PIDs, FDs, threads, rows or records */
+    STATS_OPENS,            /* open, openat, opendir, socket */
+    STATS_READS,            /* read and recv calls */
+    STATS_READLINKS,
+    STATS_GETDENTS,
+    STATS_RING_ENTERS,      /* io_uring_enter, one per batch */
+    STATS_BYTES_READ,
+    STATS_COUNTER_COUNT
+} stats_counter_t;
+
+/* Copy of every counter, from stats_snapshot() */
+typedef struct {
+    uint64_t values[STATS_PHASE_COUNT][STATS_COUNTER_COUNT];
+    uint64_t elapsed_ns;    /* Since stats_enable() */
+} stats_snapshot_t;
+
+/*
+ * Return true if this build counts anything (built with PINSPECT_STATS).
+ */
+bool stats_supported(void);
+
+/*
+ * Zero every counter and start counting from now. Call before any worker
+ * threads start; without PINSPECT_STATS it does nothing.
+ */
+void stats_enable(void);
+
+/*
+ * Copy the counters into out. All zero when counting is off.
+ */
+void stats_snapshot(stats_snapshot_t *out);
+
+/*
+ * Return the short name of phase ("status", "fds", ...).
+ */
+const char *stats_phase_name(stats_phase_t phase);
+
+/*
+ * Print one row per phase that did anything, then totals, to fp.
+ */
+void stats_print(FILE *fp);
+
+#ifdef PINSPECT_STATS
+
+/* Set by stats_enable(); read by the macros below */
+extern bool stats_active;
+
+/*
+ * Add n to counter of the calling thread's current phase.
+ */
+void stats_add(stats_counter_t counter, uint64_t n);
+
+/*
+ * Make phase the calling thread's current phase. Returns the phase to
+ * hand back to stats_phase_end(), or -1 if phase was already current.
+ */
+int stats_phase_begin(stats_phase_t phase);
+
+/*
+ * Charge the time since the last phase change to the current phase and
+ * return to prev. errno is preserved.
+ */
+void stats_phase_end(int prev);
+
+#define STATS_COUNT(counter, n) \
+    do { \
+        if (stats_active) { \
+            stats_add((counter), (uint64_t)(n)); \
+        } \
+    } while (0)
+
+#define STATS_PHASE_BEGIN(phase) \
+    (stats_active ? stats_phase_begin(phase) : -1)
+
+#define STATS_PHASE_END(prev) \
+    do { \
+        if ((prev) >= 0) { \
+            stats_phase_end(prev); \
+        } \
+    } while (0)
+
+#else
+
+#define STATS_COUNT(counter, n) ((void)0)
+#define STATS_PHASE_BEGIN(phase) (-1)
+#define STATS_PHASE_END(prev) ((void)(prev))
+
+#endif /* PINSPECT_STATS */
+
+#pragma GCC visibility pop
+
+#endif /* STATS_H */
@@ -0,0 +1,107 @@
+/*
+ * top.h - Per-thread CPU sampling ("pinspect top -H")
+ *
+ * Reads every thread's CPU ticks and context switch counts on an interval
+ * and turns the difference between two samples into per-thread %CPU and
+ * switch rates, printed as a top-N table sorted by CPU use.
+ *
+ * The previous sample is indexed by TID in an id_map_t that is cleared,
+ * not freed, between refreshes, and the sample arrays are reused, so a
+ * refresh allocates nothing once the thread count is stable and its cost
+ * is dominated by the per-thread /proc reads.
+ */
+
+#ifndef TOP_H
+#define TOP_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include "pinspect.h"
+#include "proc_handle.h"
+#include "idmap.h"
+
+#pragma GCC visibility push(default)
+
+/* Default number of rows printed per refresh */
+#define TOP_DEFAULT_LIMIT 20
+
+typedef struct {
+    double interval_sec;    /* Time between refreshes */
+    int limit;              /* Rows per refresh, <= 0 for all threads */
+    int max_samples;        /* Stop after this many refreshes, 0 = forever */
+} top_options_t;
+
+/* One thread's usage over the last interval */
+typedef struct {
+    pid_t tid;
+    char name[PROC_NAME_MAX];
+    proc_state_t state;
+    int processor;              /* CPU the thread last ran on */
+    double cpu_percent;         /* Of one CPU; 100 = one core busy */
+    double voluntary_per_sec;   /* Voluntary context switches per second */
+    double involuntary_per_sec; /* Preemptions per second */
+} thread_rate_t;
+
+/*
+ * Sampler state. Initialize with top_init(), release with top_free().
+ */
+typedef struct {
+    pid_t pid;
+    proc_handle_t handle;
+    bool primed;                /* True once a baseline sample exists */
+    thread_info_t *prev;        /* Previous sample */
+    int prev_count;
+    thread_info_t *cur;         /* Sample being taken */
+    int cur_count;
+    int capacity;               /* Slots in prev, cur and rates */
+    thread_rate_t *rates;
+    id_map_t index;             /* TID -> slot in prev */
+    struct timespec prev_time;
+    long ticks_per_sec;         /* sysconf(_SC_CLK_TCK) */
+} top_state_t;
+
+/*
+ * Prepare state for sampling pid's threads and open its process handle.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL state, ENOENT if
+ * process not found, ENOMEM). On error state is still safe to pass to
+ * top_free().
+ */
+int top_init(top_state_t *state, pid_t pid);
+
+/*
+ * Take one sample. From the second call on, *rates points to one entry
+ * per current thread, sorted by descending %CPU (ties by TID), covering
+ * the time since the previous call; the array is owned by state and valid
+ * until the next call. The first call only records a baseline and sets
+ * *count to 0. Threads that appeared since the previous sample are
+ * charged everything they used since they started.
+ *
+ * Returns 0 on success, -1 on error (ENOENT or ESRCH if the process
+ * exited, ENOMEM).
+ */
+int top_sample(top_state_t *state, const thread_rate_t **rates, int *count);
+
+/*
+ * Release everything held by state and close the handle. Safe to call
+ * more than once and with NULL.
+ */
+void top_free(top_state_t *state);
+
+/*
+ * Sample pid every opts->interval_sec seconds and print the busiest
+ * opts->limit threads to out after each refresh, until the process exits,
+ * SIGINT or SIGTERM arrives, or opts->max_samples refreshes have been
+ * printed.
+ *
+ * Returns 0 when stopped by signal, sample limit or process exit, -1 on
+ * error (EINVAL for a bad interval, ENOENT if process not found, EACCES
+ * if permission denied).
+ */
+int top_run(pid_t pid, const top_options_t *opts, FILE *out);
+
+#pragma GCC visibility pop
+
+#endif /* TOP_H */
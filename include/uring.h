@@ -0,0 +1,86 @@
+/*
+ * uring.h - Minimal io_uring for batched statx()
+ *
+ * Just enough io_uring to queue a batch of IORING_OP_STATX requests with
+ * one io_uring_enter() and reap every completion with another. The ring
+ * is set up with the raw syscalls, so there is no liburing dependency;
+ * builds without <linux/io_uring.h> get stubs that fail with ENOSYS.
+ * Used by the FD_BACKEND_URING path of for_each_fd_at().
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct statx;
+
+/*
+ * One ring. Initialize with uring_init(), release with uring_free(). Not
+ * shared between threads: each walk sets up its own.
+ */
+typedef struct {
+    int fd;
+    _Atomic unsigned *sq_head;
+    _Atomic unsigned *sq_tail;
+    const unsigned *sq_mask;
+    unsigned *sq_array;
+    _Atomic unsigned *cq_head;
+    _Atomic unsigned *cq_tail;
+    const unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned entries;          /* Largest batch uring_submit_statx() takes */
+    unsigned pending;          /* Submitted and not yet reaped */
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+/*
+ * Return true if io_uring_setup() works here. It can be compiled out,
+ * missing (ENOSYS), or refused by seccomp or kernel.io_uring_disabled
+ * (EPERM). The probe runs once per process.
+ */
+bool uring_supported(void);
+
+/*
+ * Set up ring with room for batches of at least entries requests.
+ *
+ * Returns 0 on success, -1 on error (errno from io_uring_setup() or
+ * mmap(), ENOSYS if built without io_uring).
+ */
+int uring_init(uring_t *ring, unsigned entries);
+
+/*
+ * Unmap and close ring. Nothing may still be pending. NULL-safe.
+ */
+void uring_free(uring_t *ring);
+
+/*
+ * Queue statx(dirfd, names[i], flags, mask, &out[i]) for i in [0, count)
+ * and submit them with one io_uring_enter(). The kernel writes into
+ * names and out until uring_wait() returns, so both must stay valid.
+ *
+ * Returns 0 on success, -1 on error (EINVAL if count exceeds the ring,
+ * EBUSY if a batch is still pending, or errno from io_uring_enter()).
+ */
+int uring_submit_statx(uring_t *ring, int dirfd, const char *const *names,
+                       unsigned count, int flags, unsigned mask,
+                       struct statx *out);
+
+/*
+ * Wait for every pending request; res[i] gets the result of request i of
+ * the batch (0 or -errno, as io_uring reports it).
+ *
+ * Returns 0 on success, -1 on error (errno from io_uring_enter() other
+ * than EINTR, which is retried). On error requests may still be running.
+ */
+int uring_wait(uring_t *ring, int *res);
+
+#endif /* URING_H */
@@ -10,17 +10,42 @@
 #include <sys/types.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 #include "pinspect.h"
+#include "proc_handle.h"
 
 /*
- * Build path to /proc/<pid>/ or /proc/<pid>/<file>.
+ * Point every collector at root instead of PROC_ROOT, for instance a
+ * synthetic tree from the benchmark fixture generator; NULL restores
+ * PROC_ROOT. root is not copied and must stay valid while in use. Not
+ * thread-safe: set it before collecting. Under any other root, handles
+ * take no pidfd (it would name a live process, not the tree's) and
+ * NET_BACKEND_AUTO reads the tree's net/ text tables instead of
+ * sock_diag.
+ */
+void proc_set_root(const char *root);
+
+/*
+ * Return the root last set with proc_set_root(), PROC_ROOT by default.
+ */
+const char *proc_get_root(void);
+
+/*
+ * Return true while the root is the kernel's PROC_ROOT.
+ */
+bool proc_root_is_live(void);
+
+/*
+ * Build path to <root>/<pid>/ or <root>/<pid>/<file>, where root is
+ * proc_get_root().
  *
  * Returns 0 on success, -1 if buffer too small. Does not check if path exists.
  */
 int build_proc_path(pid_t pid, const char *file, char *out_path, size_t out_path_len);
 
 /*
- * Build path to /proc/<pid>/task/<tid>/<file>.
+ * Build path to <root>/<pid>/task/<tid>/<file>.
  *
  * Returns 0 on success, -1 if path would overflow buffer.
  */
@@ -42,6 +67,136 @@ bool pid_exists(pid_t pid);
  */
 pid_t parse_pid(const char *str);
 
+/*
+ * Read /proc/<pid>/comm into name (at most size - 1 chars, no newline).
+ *
+ * Falls back to "?" if the process exited or comm is unreadable.
+ */
+void read_process_name(pid_t pid, char *name, size_t size);
+
+/*
+ * Same as read_process_name(), reading comm through an open handle.
+ */
+void read_process_name_at(const proc_handle_t *h, char *name, size_t size);
+
+/*
+ * Find every process whose name (comm) contains pattern, like pgrep
+ * without regex. The calling process is excluded.
+ *
+ * On success, *pids is a malloc'd array sorted by PID (caller frees) and
+ * *count is its length; both are NULL/0 when nothing matches.
+ * Returns 0 on success, -1 on error (ENOMEM, or errno from opening /proc).
+ */
+int find_pids_by_name(const char *pattern, pid_t **pids, int *count);
+
+/*
+ * Sort pids ascending and drop duplicates in place.
+ *
+ * Returns the new number of entries.
+ */
+int sort_unique_pids(pid_t *pids, int count);
+
+/* Bytes per getdents64() batch in scan_numeric_dir() */
+#define DIR_SCAN_BUFFER (64 * 1024)
+
+/*
+ * Visitor for scan_numeric_dir(). name is the entry name and id its
+ * numeric value. Return 0 to continue or non-zero to stop.
+ */
+typedef int (*numeric_entry_fn)(const char *name, long id, void *ctx);
+
+/*
+ * Call visit for every all-digit entry ("123") of the open directory
+ * dirfd; ".", ".." and other names are skipped. Entries are read with
+ * getdents64() in DIR_SCAN_BUFFER batches (BUDGET_DIR_BUFFER under a
+ * budget, yielding after each) straight from the kernel, with no
+ * per-entry allocation. dirfd is read from its current offset and left
+ * open.
+ *
+ * Returns 0 when the scan completed or visit stopped it, -1 on error
+ * (EINVAL if visit is NULL, ENOMEM, or errno from getdents64()).
+ */
+int scan_numeric_dir(int dirfd, numeric_entry_fn visit, void *ctx);
+
+/*
+ * The two halves of scan_numeric_dir(), for callers that overlap work
+ * with directory reads. read_dir_batch() is one getdents64() of dirfd
+ * into buf; it returns the bytes read, 0 at the end of the directory or
+ * -1 on error. visit_numeric_entries() calls visit for each all-digit
+ * entry of such a batch and returns 1 if visit stopped it, else 0.
+ */
+long read_dir_batch(int dirfd, char *buf, size_t size);
+int visit_numeric_entries(const char *buf, size_t len, numeric_entry_fn visit,
+                          void *ctx);
+
+/*
+ * Parse an unsigned decimal in [p, end) after optional spaces and tabs,
+ * for in-place parsing of /proc text that is not NUL-terminated.
+ *
+ * Returns a pointer past the last digit, or NULL if no digit follows.
+ */
+const char *scan_decimal(const char *p, const char *end,
+                         unsigned long long *value);
+
+/*
+ * Advance ts by sec seconds (may be fractional), keeping tv_nsec
+ * normalized.
+ */
+void timespec_add_sec(struct timespec *ts, double sec);
+
+/*
+ * Seconds from start to end.
+ */
+double timespec_diff_sec(const struct timespec *start,
+                         const struct timespec *end);
+
+/*
+ * Read up to size - 1 bytes of the file at path relative to dirfd into buf
+ * and NUL-terminate it. Meant for small /proc files (comm, stat, status)
+ * that the kernel returns in one read().
+ *
+ * Returns bytes read, or -1 on error (EINVAL for NULL buf or size 0,
+ * errno from openat()/read() otherwise).
+ */
+ssize_t read_file_at(int dirfd, const char *path, char *buf, size_t size);
+
+/*
+ * Make room for at least need more bytes in a growing string arena of
+ * *capacity bytes with used in use, doubling it as needed. Arenas are
+ * addressed by 32-bit offsets, so growth past UINT32_MAX is refused.
+ *
+ * Returns 0 on success, -1 on error (ENOMEM).
+ */
+int reserve_arena(char **strings, size_t *capacity, size_t used,
+                  size_t need);
+
+/*
+ * 64-bit FNV-1a hash of len bytes of data. Callers that reserve 0 as an
+ * empty-slot marker map it to another value themselves.
+ */
+uint64_t fnv1a64(const void *data, size_t len);
+
+/*
+ * Visitor called by read_lines_at() with a run of whole lines: text holds
+ * len bytes, every line but possibly the file's last ends in '\n', and
+ * text is not NUL-terminated. Return 0 to keep reading or non-zero to stop.
+ */
+typedef int (*lines_visit_fn)(const char *text, size_t len, void *ctx);
+
+/*
+ * Stream the file at path relative to dirfd through buf (size bytes),
+ * handing visit each buffer's worth of complete lines. A partial last line
+ * is carried into the next read; a single line longer than size is
+ * skipped. Memory use is bounded by size however long the file is. Under
+ * a budget, it yields between reads.
+ *
+ * Returns 0 when the file was read to the end or visit stopped it, -1 on
+ * error (EINVAL for NULL arguments or size 0, errno from openat()/read()
+ * otherwise).
+ */
+int read_lines_at(int dirfd, const char *path, char *buf, size_t size,
+                  lines_visit_fn visit, void *ctx);
+
 /*
  * Convert process state enum to human-readable string.
  *
@@ -50,6 +205,15 @@ pid_t parse_pid(const char *str);
  */
 const char *state_to_string(proc_state_t state);
 
+/*
+ * Parse a comma-separated field list ("rss,fds") into a FIELD_* mask.
+ * Names are name, state, uid, gid, vmpeak, vmsize, rss, threads, fds,
+ * sockets and all.
+ *
+ * Returns 0 on success, -1 on an unknown or empty name (EINVAL).
+ */
+int parse_field_list(const char *list, unsigned *fields);
+
 /*
  * Convert single-character state code to proc_state_t enum.
  *
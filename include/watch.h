@@ -0,0 +1,81 @@
+/*
+ * watch.h - Continuous sampling with delta output
+ *
+ * Re-samples a process on an interval and reports only what changed
+ * between samples: FDs opened/closed, threads spawned/exited, and
+ * connections appearing, closing or changing state.
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "pinspect.h"
+#include "proc_handle.h"
+
+#pragma GCC visibility push(default)
+
+/* What to sample on each tick */
+typedef struct {
+    double interval_sec;    /* Time between samples */
+    bool network_only;      /* Only track connections (-n) */
+    int max_samples;        /* Stop after this many samples, 0 = forever */
+} watch_options_t;
+
+/*
+ * Previous sample, kept between ticks so each tick prints only deltas.
+ * Initialize with watch_init() before the first watch_sample(). Every
+ * sample is read through one process handle, so a PID reused after the
+ * watched process exits is never mistaken for it.
+ */
+typedef struct {
+    pid_t pid;
+    proc_handle_t handle;
+    bool network_only;
+    bool primed;                /* True once a baseline sample exists */
+    fd_list_t fds;
+    thread_info_t *threads;
+    int thread_count;
+    socket_info_t *sockets;
+    int socket_count;
+} watch_state_t;
+
+/*
+ * Prepare state for watching pid and open its process handle.
+ *
+ * Returns 0 on success, -1 on error (EINVAL for NULL state, ENOENT if
+ * process not found). On error state is still safe to pass to
+ * watch_free(); watch_sample() on it fails with EBADF.
+ */
+int watch_init(watch_state_t *state, pid_t pid, bool network_only);
+
+/*
+ * Take one sample and print every change since the previous one to out.
+ * The first sample prints a one-line baseline summary instead.
+ *
+ * Returns number of changes printed (0 for the baseline), or -1 on error
+ * (ENOENT if the process exited, EACCES if permission denied).
+ */
+int watch_sample(watch_state_t *state, FILE *out);
+
+/*
+ * Free the previous sample held in state and close the process handle.
+ * Safe to call more than once and with NULL.
+ */
+void watch_free(watch_state_t *state);
+
+/*
+ * Sample pid every opts->interval_sec seconds until it exits, SIGINT or
+ * SIGTERM arrives, or opts->max_samples is reached. Where pidfds are
+ * supported the wait between samples ends as soon as the process exits.
+ *
+ * Returns 0 when stopped by signal, sample limit or process exit, -1 on
+ * error (EACCES if permission denied, EINVAL for a bad interval).
+ */
+int watch_run(pid_t pid, const watch_options_t *opts, FILE *out);
+
+#pragma GCC visibility pop
+
+#endif /* WATCH_H */
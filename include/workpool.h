@@ -0,0 +1,66 @@
+/*
+ * workpool.h - Fixed-size pthread worker pool
+ *
+ * Runs an indexed job function over [0, count) on a set of long-lived
+ * worker threads. The calling thread joins in, so a pool of size 1 runs
+ * everything inline with no threads at all.
+ */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* Job callback: process item index using shared context ctx */
+typedef void (*workpool_fn)(void *ctx, size_t index);
+
+/*
+ * Pool state. Initialize with workpool_init(), release with
+ * workpool_destroy(). Not safe to call workpool_run() concurrently.
+ */
+typedef struct {
+    pthread_t *threads;         /* Worker threads (size - 1 of them) */
+    int size;                   /* Total parallelism including caller */
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;  /* Signalled when a new batch starts */
+    pthread_cond_t work_done;   /* Signalled when the last worker finishes */
+    workpool_fn fn;
+    void *ctx;
+    size_t count;               /* Items in the current batch */
+    size_t next;                /* Next unclaimed item */
+    int busy;                   /* Workers still draining current batch */
+    unsigned long generation;   /* Incremented for every batch */
+    bool shutdown;
+} workpool_t;
+
+/*
+ * Return a sensible pool size: online CPU count, at least 1.
+ */
+int workpool_default_size(void);
+
+/*
+ * Start a pool that runs up to size items at once. size <= 0 means
+ * workpool_default_size().
+ *
+ * Returns 0 on success, -1 on error (ENOMEM/EAGAIN if threads could not
+ * be created).
+ */
+int workpool_init(workpool_t *pool, int size);
+
+/*
+ * Call fn(ctx, i) for every i in [0, count) and wait for all of them.
+ * Items are claimed in index order; fn must be thread-safe with respect
+ * to ctx but each index is processed exactly once.
+ *
+ * Returns 0 on success, -1 on error (EINVAL if pool or fn is NULL).
+ */
+int workpool_run(workpool_t *pool, size_t count, workpool_fn fn, void *ctx);
+
+/*
+ * Stop and join all workers. Safe to call with NULL.
+ */
+void workpool_destroy(workpool_t *pool);
+
+#endif /* WORKPOOL_H */
@@ -0,0 +1,454 @@
+/*
+ * batch.c - Multi-process inspection on a worker pool
+ *
+ * Each worker fills a distinct process_report_t slot, so no locking is
+ * needed beyond the pool's own index counter. Sockets are matched after
+ * the pool finishes, from the FD lists the workers already read.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "batch.h"
+#include "workpool.h"
+#include "proc_handle.h"
+#include "proc_status.h"
+#include "proc_fd.h"
+#include "fd_summary.h"
+#include "proc_task.h"
+#include "proc_mem.h"
+#include "net.h"
+#include "budget.h"
+
+/* Initial capacity of each report's socket array */
+#define INITIAL_SOCKET_CAPACITY 16
+
+/* Initial capacity of each counts-only socket FD list */
+#define INITIAL_SOCKET_FD_CAPACITY 16
+
+/* Shared, read-only job context */
+typedef struct {
+    const pid_t *pids;
+    const batch_options_t *opts;
+    process_report_t *reports;
+    fd_list_t *socket_fds;  /* counts_only with sockets: each report's
+                               socket FDs, without targets */
+    bool split_threads;     /* One PID: its threads get the idle workers */
+} batch_job_t;
+
+/* Per-walk state for keep_socket_fd() */
+typedef struct {
+    fd_list_t *list;
+    int capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} socket_keeper_t;
+
+/*
+ * for_each_fd() visitor: append socket FDs to the list, leaving the
+ * target out (entries only need fd, type and inode for matching). Stops
+ * the walk on allocation failure.
+ */
+static int keep_socket_fd(const fd_entry_t *entry, const char *target,
+                          void *ctx)
+{
+    (void)target;
+    socket_keeper_t *k = ctx;
+    if (entry->type != FD_TYPE_SOCKET || entry->socket_inode == 0) {
+        return 0;
+    }
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (k->list->count == k->capacity) {
+        int capacity = (k->capacity > 0) ? k->capacity * 2
+                                         : INITIAL_SOCKET_FD_CAPACITY;
+        fd_entry_t *entries = realloc(k->list->entries,
+                                      capacity * sizeof(fd_entry_t));
+        if (entries == NULL) {
+            k->failed = true;
+            return 1;
+        }
+        k->list->entries = entries;
+        k->capacity = capacity;
+    }
+
+    fd_entry_t *kept = &k->list->entries[k->list->count++];
+    *kept = *entry;
+    kept->target_len = 0;
+    return 0;
+}
+
+/*
+ * Read the report's FDs. A full list is enumerated unless counts_only is
+ * set; then the count comes from count_fds_at(), which resolves nothing,
+ * and when sockets are wanted one for_each_fd_at() walk keeps only the
+ * socket FDs, in socket_fds, for match_sockets(). Each failure is
+ * recorded in fd_errno or socket_errno, whichever it affects.
+ */
+static void collect_fds(const proc_handle_t *h, process_report_t *report,
+                        const batch_options_t *opts, fd_list_t *socket_fds)
+{
+    if (!opts->counts_only) {
+        if (enumerate_fds_at(h, &report->fds) != 0) {
+            int saved_errno = errno;
+            report->fds.count = 0;
+            if (opts->sockets) {
+                report->socket_errno = saved_errno;
+            }
+            if (opts->fds) {
+                report->fd_errno = saved_errno;
+            }
+        }
+        return;
+    }
+
+    if (opts->fds && count_fds_at(h, &report->fds.count) != 0) {
+        report->fd_errno = errno;
+        report->fds.count = 0;
+    }
+
+    if (opts->sockets) {
+        socket_keeper_t k = { .list = socket_fds, .capacity = 0,
+                              .failed = false };
+        if (for_each_fd_at(h, keep_socket_fd, &k) != 0 || k.failed) {
+            report->socket_errno = errno;
+            fd_list_free(socket_fds);
+        }
+    }
+}
+
+/*
+ * Run the selected collectors for one PID into its report slot. All of
+ * them read through one handle, so a PID reused mid-collection can't mix
+ * two processes into one report.
+ */
+static void collect_one(void *ctx, size_t index)
+{
+    batch_job_t *job = ctx;
+    process_report_t *report = &job->reports[index];
+
+    /* Settle the previous process's syscalls before starting this one */
+    BUDGET_YIELD();
+    report->pid = job->pids[index];
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, report->pid) != 0) {
+        report->status_errno = errno;
+        report->info.pid = report->pid;
+        return;
+    }
+
+    /* With no status fields wanted the handle open is the liveness check */
+    report->info.pid = report->pid;
+    report->info.state = PROC_STATE_UNKNOWN;
+    if (job->opts->status_fields != 0 &&
+        read_proc_status_fields_at(&h, job->opts->status_fields,
+                                   &report->info) != 0) {
+        report->status_errno = errno;
+        proc_handle_close(&h);
+        return;
+    }
+
+    const batch_options_t *opts = job->opts;
+
+    /* A sample stands in for the full FD list; sockets are excluded */
+    if (opts->fds && opts->sample_size > 0 &&
+        sample_fds_at(&h, opts->sample_size, opts->seed,
+                      &report->fd_sample) != 0) {
+        report->fd_errno = errno;
+    }
+
+    /* So does a summary, which keeps only the distinct paths */
+    if (opts->fds && opts->fd_summary &&
+        summarize_fds_at(&h, &report->fd_summary) != 0) {
+        report->fd_errno = errno;
+    }
+
+    /* Sockets are matched against these FDs once the pool finishes */
+    if (opts->sample_size == 0 && !opts->fd_summary &&
+        (opts->fds || opts->sockets)) {
+        collect_fds(&h, report, opts,
+                    (job->socket_fds != NULL) ? &job->socket_fds[index]
+                                              : NULL);
+    }
+
+    /* Sockets of a container are in its namespace's tables, not ours */
+    if (opts->sockets && report->socket_errno == 0) {
+        proc_handle_netns(&h, &report->netns);
+    }
+
+    int thread_ret = 0;
+    if (opts->threads && opts->sample_size > 0) {
+        thread_ret = sample_threads_at(&h, opts->sample_size, opts->seed,
+                                       &report->thread_sample);
+    } else if (opts->threads && job->split_threads) {
+        thread_ret = enumerate_threads_parallel_at(&h, 0, 0,
+                                                   &report->threads,
+                                                   &report->thread_count);
+    } else if (opts->threads) {
+        thread_ret = enumerate_threads_at(&h, 0, &report->threads,
+                                          &report->thread_count);
+    }
+    if (thread_ret != 0) {
+        report->thread_errno = errno;
+    }
+
+    if (opts->memory && read_mem_usage_at(&h, &report->memory) != 0) {
+        report->memory_errno = errno;
+    }
+
+    if (opts->memory_files &&
+        enumerate_mem_files_at(&h, &report->memory_files) != 0) {
+        report->memory_files_errno = errno;
+    }
+
+    proc_handle_close(&h);
+}
+
+/* Per-report socket arrays filled by route_socket() */
+typedef struct {
+    process_report_t *reports;
+    int *capacities;    /* Allocated length of each reports[i].sockets */
+    bool counts_only;
+    bool failed;        /* Allocation failed; errno is set */
+} socket_router_t;
+
+/*
+ * socket_snapshot_walk() visitor: append or count the socket in its
+ * owner's report. Stops the walk on allocation failure.
+ */
+static int route_socket(const socket_info_t *sock, int owner, int fd,
+                        void *ctx)
+{
+    socket_router_t *r = ctx;
+    process_report_t *report = &r->reports[owner];
+
+    if (r->counts_only) {
+        report->socket_count++;
+        return 0;
+    }
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (report->socket_count == r->capacities[owner]) {
+        int capacity = (r->capacities[owner] > 0) ? r->capacities[owner] * 2
+                                                  : INITIAL_SOCKET_CAPACITY;
+        socket_info_t *sockets = realloc(report->sockets,
+                                         capacity * sizeof(socket_info_t));
+        if (sockets != NULL) {
+            report->sockets = sockets;
+        }
+        int *fds = realloc(report->socket_fds, capacity * sizeof(int));
+        if (fds != NULL) {
+            report->socket_fds = fds;
+        }
+        if (sockets == NULL || fds == NULL) {
+            r->failed = true;
+            return 1;
+        }
+        r->capacities[owner] = capacity;
+    }
+
+    report->sockets[report->socket_count] = *sock;
+    report->socket_fds[report->socket_count++] = fd;
+    return 0;
+}
+
+/* True if report's FD list is to be matched against the socket tables */
+static bool wants_sockets(const process_report_t *report)
+{
+    return report->status_errno == 0 && report->socket_errno == 0;
+}
+
+/*
+ * Match the socket FDs of every report against the socket tables in a
+ * single pass, so each table is read once per network namespace per batch
+ * rather than once per PID. The FDs are each report's fds, or with
+ * counts_only socket_fds[i]. A failed table read is recorded in each
+ * socket_errno.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int match_sockets(process_report_t *reports, int count,
+                         bool counts_only, const fd_list_t *socket_fds)
+{
+    socket_snapshot_t snap;
+    if (socket_snapshot_init(&snap) != 0) {
+        return -1;
+    }
+
+    int *capacities = counts_only ? NULL : calloc(count, sizeof(int));
+    if (!counts_only && capacities == NULL) {
+        socket_snapshot_free(&snap);
+        return -1;
+    }
+
+    /*
+     * Each namespace's tables are read once, whatever number of reports
+     * is in it. The inode sets keep which FDs share a socket after fds is
+     * trimmed.
+     */
+    for (int i = 0; i < count; i++) {
+        const fd_list_t *fds = counts_only ? &socket_fds[i]
+                                           : &reports[i].fds;
+        if (wants_sockets(&reports[i]) &&
+            (socket_snapshot_add_fds(&snap, fds, i) != 0 ||
+             socket_snapshot_add_netns(&snap, reports[i].netns,
+                                       reports[i].pid) != 0 ||
+             (!counts_only &&
+              inode_set_build(&reports[i].socket_inodes,
+                              &reports[i].fds) != 0))) {
+            free(capacities);
+            socket_snapshot_free(&snap);
+            return -1;
+        }
+    }
+
+    socket_router_t r = { .reports = reports, .capacities = capacities,
+                          .counts_only = counts_only };
+    int ret = socket_snapshot_walk(&snap, route_socket, &r);
+    int saved_errno = errno;
+
+    for (int i = 0; i < count; i++) {
+        process_report_t *report = &reports[i];
+        if (!wants_sockets(report)) {
+            continue;
+        }
+
+        if (ret != 0 || r.failed) {
+            socket_list_free(report->sockets);
+            free(report->socket_fds);
+            report->sockets = NULL;
+            report->socket_fds = NULL;
+            report->socket_count = 0;
+            inode_set_free(&report->socket_inodes);
+            report->socket_errno = saved_errno;
+            continue;
+        }
+
+        /* Shrink to exact size to minimize memory footprint */
+        if (report->sockets != NULL) {
+            socket_info_t *final = realloc(report->sockets,
+                                           report->socket_count *
+                                           sizeof(socket_info_t));
+            if (final != NULL) {
+                report->sockets = final;
+            }
+            int *fds = realloc(report->socket_fds,
+                               report->socket_count * sizeof(int));
+            if (fds != NULL) {
+                report->socket_fds = fds;
+            }
+        }
+    }
+
+    free(capacities);
+    socket_snapshot_free(&snap);
+    return 0;
+}
+
+/*
+ * Free the FD lists that were only read for socket matching: every
+ * counts_only socket_fds list (NULL-safe), and the reports' own lists
+ * when fds was not asked for.
+ */
+static void free_matched_fds(process_report_t *reports, fd_list_t *socket_fds,
+                             int count, const batch_options_t *opts)
+{
+    for (int i = 0; i < count; i++) {
+        if (socket_fds != NULL) {
+            fd_list_free(&socket_fds[i]);
+        }
+        if (!opts->fds) {
+            fd_list_free(&reports[i].fds);
+        }
+    }
+    free(socket_fds);
+}
+
+/*
+ * Implementation of collect_process_reports() - see batch.h for API docs.
+ */
+int collect_process_reports(const pid_t *pids, int count,
+                            const batch_options_t *opts,
+                            process_report_t **reports)
+{
+    if (reports == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *reports = NULL;
+
+    if (pids == NULL || opts == NULL || count <= 0 ||
+        opts->sample_size < 0 ||
+        ((opts->sample_size > 0 || opts->fd_summary) && opts->sockets) ||
+        (opts->sample_size > 0 && opts->fd_summary)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    process_report_t *array = calloc(count, sizeof(process_report_t));
+    if (array == NULL) {
+        return -1;
+    }
+
+    /* No point starting more threads than there are PIDs */
+    int workers = (opts->workers > 0) ? opts->workers
+                                      : workpool_default_size();
+    if (workers > count) {
+        workers = count;
+    }
+
+    /* Counts-only sockets: only the socket FDs are kept until matching */
+    fd_list_t *socket_fds = NULL;
+    if (opts->sockets && opts->counts_only) {
+        socket_fds = calloc(count, sizeof(fd_list_t));
+        if (socket_fds == NULL) {
+            free(array);
+            return -1;
+        }
+    }
+
+    workpool_t pool;
+    if (workpool_init(&pool, workers) != 0) {
+        free(socket_fds);
+        free(array);
+        return -1;
+    }
+
+    batch_job_t job = { .pids = pids, .opts = opts, .reports = array,
+                        .socket_fds = socket_fds,
+                        .split_threads = (count == 1) };
+    workpool_run(&pool, (size_t)count, collect_one, &job);
+    workpool_destroy(&pool);
+
+    if (opts->sockets) {
+        int ret = match_sockets(array, count, opts->counts_only, socket_fds);
+        free_matched_fds(array, socket_fds, count, opts);
+        if (ret != 0) {
+            int saved_errno = errno;
+            process_reports_free(array, count);
+            errno = saved_errno;
+            return -1;
+        }
+    }
+
+    *reports = array;
+    return 0;
+}
+
+void process_reports_free(process_report_t *reports, int count)
+{
+    if (reports == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        fd_list_free(&reports[i].fds);
+        fd_summary_free(&reports[i].fd_summary);
+        thread_info_free(reports[i].threads);
+        socket_list_free(reports[i].sockets);
+        free(reports[i].socket_fds);
+        inode_set_free(&reports[i].socket_inodes);
+        mem_file_list_free(&reports[i].memory_files);
+    }
+    free(reports);
+}
@@ -0,0 +1,136 @@
+/*
+ * budget.c - Rate limits bounding collection's load on the host
+ *
+ * A virtual clock, ready_ns, marks when the work done so far is paid
+ * for. Each yield converts the syscalls and CPU time since the previous
+ * yield into wall time at the allowed rate (the larger of the two when
+ * both limits are set), and adds it to the clock. The addition starts
+ * from the previous yield, not from now, so time already spent doing the
+ * work counts towards its cost. The clock never lags now by more than
+ * BUDGET_BURST_NS, which bounds the credit an idle period can bank.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include "budget.h"
+
+bool budget_active = false;
+
+static budget_t limits;
+static _Atomic unsigned long pending_calls;
+static _Atomic uint64_t slept_ns;
+
+/* Accounting state, under lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t ready_ns;       /* Work so far is paid for at this time */
+static uint64_t last_ns;        /* Time of the previous yield */
+static uint64_t last_cpu_ns;    /* Process CPU time at the previous yield */
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Implementation of budget_set() - see budget.h for API docs.
+ */
+void budget_set(const budget_t *budget)
+{
+    pthread_mutex_lock(&lock);
+    if (budget != NULL) {
+        limits = *budget;
+    } else {
+        memset(&limits, 0, sizeof(limits));
+    }
+    atomic_store_explicit(&pending_calls, 0, memory_order_relaxed);
+    atomic_store_explicit(&slept_ns, 0, memory_order_relaxed);
+    last_ns = clock_ns(CLOCK_MONOTONIC);
+    last_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    ready_ns = last_ns;
+    budget_active = limits.syscalls_per_sec > 0 || limits.cpu_percent > 0;
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Implementation of budget_get() - see budget.h for API docs.
+ */
+void budget_get(budget_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    *out = limits;
+    pthread_mutex_unlock(&lock);
+}
+
+uint64_t budget_slept_ns(void)
+{
+    return atomic_load_explicit(&slept_ns, memory_order_relaxed);
+}
+
+void budget_charge(unsigned long n)
+{
+    atomic_fetch_add_explicit(&pending_calls, n, memory_order_relaxed);
+}
+
+/*
+ * Implementation of budget_yield() - see budget.h for API docs.
+ */
+void budget_yield(void)
+{
+    int saved_errno = errno;
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    uint64_t cpu = (limits.cpu_percent > 0)
+                       ? clock_ns(CLOCK_PROCESS_CPUTIME_ID) : 0;
+
+    pthread_mutex_lock(&lock);
+    unsigned long calls = atomic_exchange_explicit(&pending_calls, 0,
+                                                   memory_order_relaxed);
+
+    /* Wall time the work since the last yield is allowed to take */
+    double cost = 0;
+    if (limits.syscalls_per_sec > 0) {
+        cost = (double)calls * 1e9 / (double)limits.syscalls_per_sec;
+    }
+    if (limits.cpu_percent > 0 && cpu > last_cpu_ns) {
+        double cpu_cost = (double)(cpu - last_cpu_ns) * 100.0 /
+                          (double)limits.cpu_percent;
+        if (cpu_cost > cost) {
+            cost = cpu_cost;
+        }
+        last_cpu_ns = cpu;
+    }
+
+    uint64_t start = (ready_ns > last_ns) ? ready_ns : last_ns;
+    if (now > BUDGET_BURST_NS && start < now - BUDGET_BURST_NS) {
+        start = now - BUDGET_BURST_NS;
+    }
+    ready_ns = start + (uint64_t)cost;
+    if (now > last_ns) {
+        last_ns = now;
+    }
+    uint64_t wake = ready_ns;
+    pthread_mutex_unlock(&lock);
+
+    if (wake > now) {
+        struct timespec ts = {
+            .tv_sec = (time_t)(wake / 1000000000u),
+            .tv_nsec = (long)(wake % 1000000000u),
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        uint64_t woke = clock_ns(CLOCK_MONOTONIC);
+        atomic_fetch_add_explicit(&slept_ns, (woke > now) ? woke - now : 0,
+                                  memory_order_relaxed);
+    }
+    errno = saved_errno;
+}
@@ -0,0 +1,354 @@
+/*
+ * fd_summary.c - FD kind histogram and open-path counts
+ *
+ * A for_each_fd() visitor classifies each target and bumps its kind
+ * count; path targets are then looked up in a linear-probing table of
+ * FNV-1a hashes, kept at most half full, whose slots point into a string
+ * arena holding each distinct path once. Top-K selection keeps the best
+ * k rows seen so far in a min-heap, so it is O(distinct * log k) and
+ * needs no storage beyond the caller's array.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fd_summary.h"
+#include "proc_fd.h"
+#include "util.h"
+
+/* Smallest path table we allocate (slots) */
+#define SUMMARY_MIN_CAPACITY 16
+
+/* Initial path arena size; grows by doubling */
+#define SUMMARY_MIN_ARENA 1024
+
+static const char deleted_suffix[] = " (deleted)";
+
+/*
+ * Split an fd_type_t into its fd_kind_t, given the target of len bytes
+ * it was classified from.
+ */
+static fd_kind_t refine_kind(fd_type_t type, const char *target, size_t len)
+{
+    switch (type) {
+    case FD_TYPE_SOCKET:
+        return FD_KIND_SOCKET;
+    case FD_TYPE_PIPE:
+        return FD_KIND_PIPE;
+    case FD_TYPE_ANON_INODE:
+        if (strcmp(target, "anon_inode:[eventfd]") == 0) {
+            return FD_KIND_EVENTFD;
+        }
+        if (strcmp(target, "anon_inode:[eventpoll]") == 0) {
+            return FD_KIND_EVENTPOLL;
+        }
+        if (strcmp(target, "anon_inode:[timerfd]") == 0) {
+            return FD_KIND_TIMERFD;
+        }
+        return FD_KIND_ANON_OTHER;
+    case FD_TYPE_FILE:
+    case FD_TYPE_DEVICE: {
+        size_t suffix = sizeof(deleted_suffix) - 1;
+        if (len > suffix &&
+            memcmp(target + len - suffix, deleted_suffix, suffix) == 0) {
+            return FD_KIND_DELETED;
+        }
+        return (type == FD_TYPE_DEVICE) ? FD_KIND_DEVICE : FD_KIND_FILE;
+    }
+    case FD_TYPE_OTHER:
+    default:
+        return FD_KIND_OTHER;
+    }
+}
+
+fd_kind_t classify_fd_kind(const char *target)
+{
+    if (target == NULL) {
+        return FD_KIND_OTHER;
+    }
+    return refine_kind(classify_fd_target(target), target, strlen(target));
+}
+
+const char *fd_kind_to_string(fd_kind_t kind)
+{
+    switch (kind) {
+    case FD_KIND_FILE:       return "file";
+    case FD_KIND_DELETED:    return "deleted";
+    case FD_KIND_DEVICE:     return "device";
+    case FD_KIND_SOCKET:     return "socket";
+    case FD_KIND_PIPE:       return "pipe";
+    case FD_KIND_EVENTFD:    return "eventfd";
+    case FD_KIND_EVENTPOLL:  return "eventpoll";
+    case FD_KIND_TIMERFD:    return "timerfd";
+    case FD_KIND_ANON_OTHER: return "anon_inode";
+    case FD_KIND_OTHER:
+    default:                 return "other";
+    }
+}
+
+/* FNV-1a of len bytes of path, never 0 (the empty-slot marker) */
+static uint64_t hash_path(const char *path, size_t len)
+{
+    uint64_t h = fnv1a64(path, len);
+    return (h != 0) ? h : 1;
+}
+
+/*
+ * Double the path table (or allocate the first one) and rehash every
+ * slot. Paths stay where they are in the arena.
+ * Returns 0 on success, -1 on allocation failure (table unchanged).
+ */
+static int grow_table(fd_summary_t *s)
+{
+    size_t capacity = (s->capacity == 0) ? SUMMARY_MIN_CAPACITY
+                                         : s->capacity * 2;
+    uint64_t *hashes = calloc(capacity, sizeof(uint64_t));
+    uint32_t *offsets = malloc(capacity * sizeof(uint32_t));
+    int *counts = malloc(capacity * sizeof(int));
+    if (hashes == NULL || offsets == NULL || counts == NULL) {
+        free(hashes);
+        free(offsets);
+        free(counts);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < s->capacity; i++) {
+        if (s->hashes[i] == 0) {
+            continue;
+        }
+        size_t j = (size_t)s->hashes[i] & mask;
+        while (hashes[j] != 0) {
+            j = (j + 1) & mask;
+        }
+        hashes[j] = s->hashes[i];
+        offsets[j] = s->offsets[i];
+        counts[j] = s->counts[i];
+    }
+
+    free(s->hashes);
+    free(s->offsets);
+    free(s->counts);
+    s->hashes = hashes;
+    s->offsets = offsets;
+    s->counts = counts;
+    s->capacity = capacity;
+    return 0;
+}
+
+/*
+ * Count one more FD open on path (len bytes, NUL-terminated), copying it
+ * into the arena the first time it is seen.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int count_path(fd_summary_t *s, const char *path, size_t len)
+{
+    if ((s->distinct + 1) * 2 > s->capacity && grow_table(s) != 0) {
+        return -1;
+    }
+
+    uint64_t h = hash_path(path, len);
+    size_t mask = s->capacity - 1;
+    size_t i = (size_t)h & mask;
+    while (s->hashes[i] != 0) {
+        if (s->hashes[i] == h && strcmp(s->strings + s->offsets[i],
+                                        path) == 0) {
+            s->counts[i]++;
+            return 0;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (s->strings_capacity == 0) {
+        s->strings = malloc(SUMMARY_MIN_ARENA);
+        if (s->strings == NULL) {
+            return -1;
+        }
+        s->strings_capacity = SUMMARY_MIN_ARENA;
+    }
+    if (reserve_arena(&s->strings, &s->strings_capacity, s->strings_len,
+                      len + 1) != 0) {
+        return -1;
+    }
+
+    memcpy(s->strings + s->strings_len, path, len + 1);
+    s->hashes[i] = h;
+    s->offsets[i] = (uint32_t)s->strings_len;
+    s->counts[i] = 1;
+    s->strings_len += len + 1;
+    s->distinct++;
+    return 0;
+}
+
+/* Per-walk state for summarize_fd() */
+typedef struct {
+    fd_summary_t *summary;
+    bool failed;        /* Allocation failed; errno is set */
+} summary_walk_t;
+
+/*
+ * for_each_fd() visitor: count the FD by kind and, for paths, by path.
+ * Stops the walk on allocation failure.
+ */
+static int summarize_fd(const fd_entry_t *entry, const char *target,
+                        void *ctx)
+{
+    summary_walk_t *walk = ctx;
+    fd_summary_t *s = walk->summary;
+
+    /* for_each_fd() already classified it; only anon and paths split */
+    fd_kind_t kind = refine_kind(entry->type, target, entry->target_len);
+    s->kind_counts[kind]++;
+    s->total++;
+
+    if ((kind == FD_KIND_FILE || kind == FD_KIND_DELETED ||
+         kind == FD_KIND_DEVICE) &&
+        count_path(s, target, entry->target_len) != 0) {
+        walk->failed = true;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Implementation of summarize_fds_at() - see fd_summary.h for API docs.
+ */
+int summarize_fds_at(const proc_handle_t *h, fd_summary_t *summary)
+{
+    if (summary == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(summary, 0, sizeof(*summary));
+
+    summary_walk_t walk = { .summary = summary, .failed = false };
+    if (for_each_fd_at(h, summarize_fd, &walk) != 0 || walk.failed) {
+        int saved_errno = errno;
+        fd_summary_free(summary);
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+int summarize_fds(pid_t pid, fd_summary_t *summary)
+{
+    if (summary == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(summary, 0, sizeof(*summary));
+        return -1;
+    }
+
+    int ret = summarize_fds_at(&h, summary);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+/* True when row a belongs above row b: more FDs, then path order */
+static bool ranks_above(const fd_path_count_t *a, const fd_path_count_t *b)
+{
+    if (a->count != b->count) {
+        return a->count > b->count;
+    }
+    return strcmp(a->path, b->path) < 0;
+}
+
+/* Restore the min-heap (lowest-ranked row at 0) below index i */
+static void sift_down(fd_path_count_t *heap, int n, int i)
+{
+    for (;;) {
+        int lowest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < n && ranks_above(&heap[lowest], &heap[left])) {
+            lowest = left;
+        }
+        if (right < n && ranks_above(&heap[lowest], &heap[right])) {
+            lowest = right;
+        }
+        if (lowest == i) {
+            return;
+        }
+        fd_path_count_t tmp = heap[i];
+        heap[i] = heap[lowest];
+        heap[lowest] = tmp;
+        i = lowest;
+    }
+}
+
+/* Move the row just appended at index i up to its heap position */
+static void sift_up(fd_path_count_t *heap, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ranks_above(&heap[parent], &heap[i])) {
+            return;
+        }
+        fd_path_count_t tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+/*
+ * Implementation of fd_summary_top() - see fd_summary.h for API docs.
+ */
+int fd_summary_top(const fd_summary_t *summary, fd_path_count_t *top, int k)
+{
+    if (summary == NULL || top == NULL || k < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int n = 0;
+    for (size_t i = 0; k > 0 && i < summary->capacity; i++) {
+        if (summary->hashes[i] == 0) {
+            continue;
+        }
+        fd_path_count_t row = {
+            .path = summary->strings + summary->offsets[i],
+            .count = summary->counts[i],
+        };
+        if (n < k) {
+            top[n] = row;
+            sift_up(top, n++);
+        } else if (ranks_above(&row, &top[0])) {
+            top[0] = row;
+            sift_down(top, n, 0);
+        }
+    }
+
+    /* Pop the lowest-ranked row to the end until the heap is sorted */
+    for (int end = n - 1; end > 0; end--) {
+        fd_path_count_t tmp = top[0];
+        top[0] = top[end];
+        top[end] = tmp;
+        sift_down(top, end, 0);
+    }
+    return n;
+}
+
+void fd_summary_free(fd_summary_t *summary)
+{
+    if (summary == NULL) {
+        return;
+    }
+
+    free(summary->hashes);
+    free(summary->offsets);
+    free(summary->counts);
+    free(summary->strings);
+    memset(summary, 0, sizeof(*summary));
+}
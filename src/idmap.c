@@ -0,0 +1,174 @@
+/*
+ * idmap.c - Open-addressing hash map keyed by kernel IDs
+ *
+ * Linear probing over a power-of-two table kept at most half full.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "idmap.h"
+
+/* Smallest table we allocate (slots) */
+#define IDMAP_MIN_CAPACITY 16
+
+/* 2^64 / golden ratio, spreads sequential inodes across the table */
+#define FIB_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+static size_t slot_for(const id_map_t *map, unsigned long key)
+{
+    return (size_t)(((uint64_t)key * FIB_MULTIPLIER) >> map->shift);
+}
+
+/*
+ * Allocate an empty table with the given power-of-two capacity.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int alloc_table(id_map_t *map, size_t capacity)
+{
+    unsigned long *keys = calloc(capacity, sizeof(unsigned long));
+    int *values = malloc(capacity * sizeof(int));
+
+    if (keys == NULL || values == NULL) {
+        free(keys);
+        free(values);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    unsigned int bits = 0;
+    while (((size_t)1 << bits) < capacity) {
+        bits++;
+    }
+
+    map->keys = keys;
+    map->values = values;
+    map->capacity = capacity;
+    map->count = 0;
+    map->shift = 64 - bits;
+    return 0;
+}
+
+/*
+ * Insert into a table known to have a free slot. No growth check.
+ */
+static void insert_slot(id_map_t *map, unsigned long key, int value)
+{
+    size_t mask = map->capacity - 1;
+    size_t i = slot_for(map, key);
+
+    while (map->keys[i] != 0 && map->keys[i] != key) {
+        i = (i + 1) & mask;
+    }
+
+    if (map->keys[i] == 0) {
+        map->keys[i] = key;
+        map->count++;
+    }
+    map->values[i] = value;
+}
+
+/*
+ * Double the table and rehash every key.
+ * Returns 0 on success, -1 on allocation failure (map is unchanged).
+ */
+static int grow(id_map_t *map)
+{
+    id_map_t bigger;
+
+    if (alloc_table(&bigger, map->capacity * 2) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->keys[i] != 0) {
+            insert_slot(&bigger, map->keys[i], map->values[i]);
+        }
+    }
+
+    id_map_free(map);
+    *map = bigger;
+    return 0;
+}
+
+int id_map_init(id_map_t *map, size_t expected)
+{
+    if (map == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(map, 0, sizeof(*map));
+
+    /* Keep load factor at or below 1/2 so probe chains stay short */
+    size_t capacity = IDMAP_MIN_CAPACITY;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+
+    return alloc_table(map, capacity);
+}
+
+void id_map_free(id_map_t *map)
+{
+    if (map == NULL) {
+        return;
+    }
+
+    free(map->keys);
+    free(map->values);
+    memset(map, 0, sizeof(*map));
+}
+
+void id_map_clear(id_map_t *map)
+{
+    if (map == NULL || map->keys == NULL) {
+        return;
+    }
+
+    memset(map->keys, 0, map->capacity * sizeof(unsigned long));
+    map->count = 0;
+}
+
+int id_map_put(id_map_t *map, unsigned long key, int value)
+{
+    if (map == NULL || map->keys == NULL || key == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((map->count + 1) * 2 > map->capacity && grow(map) != 0) {
+        return -1;
+    }
+
+    insert_slot(map, key, value);
+    return 0;
+}
+
+bool id_map_get(const id_map_t *map, unsigned long key, int *value)
+{
+    if (map == NULL || map->keys == NULL || key == 0) {
+        return false;
+    }
+
+    size_t mask = map->capacity - 1;
+    size_t i = slot_for(map, key);
+
+    while (map->keys[i] != 0) {
+        if (map->keys[i] == key) {
+            if (value != NULL) {
+                *value = map->values[i];
+            }
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return false;
+}
+
+bool id_map_contains(const id_map_t *map, unsigned long key)
+{
+    return id_map_get(map, key, NULL);
+}
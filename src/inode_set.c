@@ -0,0 +1,280 @@
+/*
+ * inode_set.c - Sorted socket inode set with FD multiplicity
+ *
+ * (inode, FD) pairs are radix-sorted by inode, which keeps the FDs of one
+ * inode in list order, then collapsed into unique inodes with offsets
+ * into the FD array. The Eytzinger copy is filled by an in-order walk of
+ * the implicit tree, so it costs one pass over the sorted inodes.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include "inode_set.h"
+
+/* Below this many keys an insertion sort beats the histogram passes */
+#define RADIX_MIN_KEYS 64
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_DIGITS ((int)(sizeof(unsigned long) * 8 / RADIX_BITS))
+
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void)(addr))
+#endif
+
+static void insertion_sort_ids(unsigned long *keys, int *values,
+                               size_t count)
+{
+    for (size_t i = 1; i < count; i++) {
+        unsigned long key = keys[i];
+        int value = values[i];
+        size_t j = i;
+        while (j > 0 && keys[j - 1] > key) {
+            keys[j] = keys[j - 1];
+            values[j] = values[j - 1];
+            j--;
+        }
+        keys[j] = key;
+        values[j] = value;
+    }
+}
+
+/*
+ * Implementation of radix_sort_ids() - see inode_set.h for API docs.
+ */
+int radix_sort_ids(unsigned long *keys, int *values, size_t count)
+{
+    if (count < RADIX_MIN_KEYS) {
+        insertion_sort_ids(keys, values, count);
+        return 0;
+    }
+
+    /* One pass builds every digit's histogram */
+    size_t (*hist)[RADIX_BUCKETS] = calloc(RADIX_DIGITS, sizeof(*hist));
+    unsigned long *key_tmp = malloc(count * sizeof(*key_tmp));
+    int *value_tmp = malloc(count * sizeof(*value_tmp));
+    if (hist == NULL || key_tmp == NULL || value_tmp == NULL) {
+        free(hist);
+        free(key_tmp);
+        free(value_tmp);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        unsigned long key = keys[i];
+        for (int d = 0; d < RADIX_DIGITS; d++) {
+            hist[d][(key >> (d * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    unsigned long *src_keys = keys;
+    int *src_values = values;
+    unsigned long *dst_keys = key_tmp;
+    int *dst_values = value_tmp;
+    for (int d = 0; d < RADIX_DIGITS; d++) {
+        /* A digit every key shares would move nothing */
+        unsigned shift = (unsigned)(d * RADIX_BITS);
+        if (hist[d][(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            size_t n = hist[d][b];
+            hist[d][b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = hist[d][(src_keys[i] >> shift) &
+                                  (RADIX_BUCKETS - 1)]++;
+            dst_keys[slot] = src_keys[i];
+            dst_values[slot] = src_values[i];
+        }
+
+        unsigned long *tk = src_keys;
+        int *tv = src_values;
+        src_keys = dst_keys;
+        src_values = dst_values;
+        dst_keys = tk;
+        dst_values = tv;
+    }
+
+    /* An odd number of passes leaves the result in the scratch arrays */
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, count * sizeof(*keys));
+        memcpy(values, src_values, count * sizeof(*values));
+    }
+
+    free(hist);
+    free(key_tmp);
+    free(value_tmp);
+    return 0;
+}
+
+/*
+ * Fill the Eytzinger subtree rooted at node k from set->inodes, in
+ * order, starting at sorted index next. Returns the next unused index.
+ * Recursion depth is log2(count).
+ */
+static int fill_eytzinger(inode_set_t *set, int next, size_t k)
+{
+    if (k > (size_t)set->count) {
+        return next;
+    }
+    next = fill_eytzinger(set, next, 2 * k);
+    set->eytzinger[k] = set->inodes[next];
+    set->eytzinger_index[k] = next;
+    return fill_eytzinger(set, next + 1, 2 * k + 1);
+}
+
+/*
+ * Implementation of inode_set_build() - see inode_set.h for API docs.
+ */
+int inode_set_build(inode_set_t *set, const fd_list_t *fds)
+{
+    if (set == NULL || fds == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(set, 0, sizeof(*set));
+
+    int sockets = 0;
+    for (int i = 0; i < fds->count; i++) {
+        if (fds->entries[i].type == FD_TYPE_SOCKET &&
+            fds->entries[i].socket_inode != 0) {
+            sockets++;
+        }
+    }
+
+    /* Node 0 of the Eytzinger copy is the "not found" answer */
+    set->inodes = malloc(((size_t)sockets + 1) * sizeof(unsigned long));
+    set->fds = malloc(((size_t)sockets + 1) * sizeof(int));
+    set->fd_start = malloc(((size_t)sockets + 1) * sizeof(int));
+    set->eytzinger = malloc(((size_t)sockets + 1) * sizeof(unsigned long));
+    set->eytzinger_index = malloc(((size_t)sockets + 1) * sizeof(int));
+    if (set->inodes == NULL || set->fds == NULL || set->fd_start == NULL ||
+        set->eytzinger == NULL || set->eytzinger_index == NULL) {
+        inode_set_free(set);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int n = 0;
+    for (int i = 0; i < fds->count; i++) {
+        const fd_entry_t *e = &fds->entries[i];
+        if (e->type == FD_TYPE_SOCKET && e->socket_inode != 0) {
+            set->inodes[n] = e->socket_inode;
+            set->fds[n++] = e->fd;
+        }
+    }
+    if (radix_sort_ids(set->inodes, set->fds, (size_t)n) != 0) {
+        inode_set_free(set);
+        return -1;
+    }
+
+    /* Collapse runs of one inode; the FDs stay where they are */
+    int unique = 0;
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || set->inodes[i] != set->inodes[unique - 1]) {
+            set->inodes[unique] = set->inodes[i];
+            set->fd_start[unique++] = i;
+        }
+    }
+    set->fd_start[unique] = n;
+    set->count = unique;
+    set->fd_count = n;
+
+    /* Sorting keeps each inode's FDs in list order; make it ascending */
+    for (int u = 0; u < unique; u++) {
+        int start = set->fd_start[u];
+        int len = set->fd_start[u + 1] - start;
+        for (int i = 1; i < len; i++) {
+            int fd = set->fds[start + i];
+            int j = i;
+            while (j > 0 && set->fds[start + j - 1] > fd) {
+                set->fds[start + j] = set->fds[start + j - 1];
+                j--;
+            }
+            set->fds[start + j] = fd;
+        }
+    }
+
+    set->eytzinger[0] = 0;
+    set->eytzinger_index[0] = -1;
+    fill_eytzinger(set, 0, 1);
+    return 0;
+}
+
+/*
+ * Implementation of inode_set_find() - see inode_set.h for API docs.
+ */
+int inode_set_find(const inode_set_t *set, unsigned long inode)
+{
+    if (set == NULL || set->count == 0) {
+        return -1;
+    }
+
+    /*
+     * Descend without a data-dependent branch: go right while the node is
+     * less than inode. The path ends below a leaf; its last left turn was
+     * at the lower bound, recovered by dropping the trailing right turns
+     * (one bits) and that left turn. A path with no left turn ends at
+     * node 0, which holds 0 and index -1.
+     */
+    const unsigned long *tree = set->eytzinger;
+    size_t n = (size_t)set->count;
+    size_t k = 1;
+    while (k <= n) {
+        PREFETCH(tree + 16 * k);
+        k = 2 * k + (tree[k] < inode);
+    }
+#if defined(__GNUC__)
+    k >>= __builtin_ctzl(~k) + 1;
+#else
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+#endif
+    return (tree[k] == inode) ? set->eytzinger_index[k] : -1;
+}
+
+/*
+ * Implementation of inode_set_fds() - see inode_set.h for API docs.
+ */
+const int *inode_set_fds(const inode_set_t *set, int index, int *count)
+{
+    if (set == NULL || index < 0 || index >= set->count) {
+        if (count != NULL) {
+            *count = 0;
+        }
+        return NULL;
+    }
+    if (count != NULL) {
+        *count = set->fd_start[index + 1] - set->fd_start[index];
+    }
+    return &set->fds[set->fd_start[index]];
+}
+
+/*
+ * Implementation of inode_set_free() - see inode_set.h for API docs.
+ */
+void inode_set_free(inode_set_t *set)
+{
+    if (set == NULL) {
+        return;
+    }
+    free(set->inodes);
+    free(set->fds);
+    free(set->fd_start);
+    free(set->eytzinger);
+    free(set->eytzinger_index);
+    memset(set, 0, sizeof(*set));
+}
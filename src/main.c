@@ -8,35 +8,132 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <getopt.h>
+#include <unistd.h>
 #include "pinspect.h"
 #include "proc_status.h"
 #include "proc_fd.h"
+#include "fd_summary.h"
 #include "proc_task.h"
+#include "proc_mem.h"
 #include "net.h"
+#include "watch.h"
+#include "top.h"
+#include "batch.h"
+#include "scan.h"
+#include "output.h"
+#include "stats.h"
+#include "budget.h"
+#include "sample.h"
 #include "util.h"
 
 #define PROGRAM_NAME "pinspect"
 #define VERSION "1.0.0"
 
+/* Long-only option codes (outside the range of short option characters) */
+enum {
+    OPT_ALL_NET = 256,
+    OPT_NET_BACKEND,
+    OPT_FD_BACKEND,
+    OPT_PGREP,
+    OPT_FORMAT,
+    OPT_MAPS,
+    OPT_ALL,
+    OPT_SORT,
+    OPT_LIMIT,
+    OPT_UID,
+    OPT_MIN_RSS,
+    OPT_MIN_FDS,
+    OPT_MIN_THREADS,
+    OPT_FIELDS,
+    OPT_STATS,
+    OPT_MAX_SYSCALLS,
+    OPT_MAX_CPU,
+    OPT_SAMPLE,
+    OPT_FD_SUMMARY
+};
+
+/* Paths listed by --fd-summary when no count is given */
+#define DEFAULT_FD_TOP 10
+
 /* Command-line options */
 static struct {
     bool verbose;
     bool network_only;
+    bool all_net;
+    bool all;               /* --all: one summary row per host process */
+    bool scan_option;       /* A --sort/--limit/filter option was given */
+    scan_options_t scan;    /* Sort, limit and filters for --all */
+    unsigned fields;        /* --fields FIELD_* mask, 0 if not given */
+    bool memory;            /* -m: smaps_rollup summary */
+    bool maps;              /* --maps: per-file smaps breakdown */
+    bool stats;             /* --stats: phase profile on stderr at exit */
+    budget_t budget;        /* --max-syscalls/--max-cpu, zero if unset */
+    int sample_size;        /* --sample: FDs/threads per process, 0 = all */
+    int fd_top;             /* --fd-summary: paths to list, 0 = no summary */
     bool help;
+    double watch_interval;  /* Seconds between samples, 0 = no watch */
     bool version;
-    pid_t pid;
+    const char *pgrep;      /* --pgrep name pattern, or NULL */
+    output_format_t format; /* --format, OUTPUT_TEXT by default */
+    pid_t *pids;            /* PIDs from the command line */
+    int pid_count;
 } options = {0};
 
 static void print_usage(void)
 {
-    printf("Usage: %s [OPTIONS] <PID>\n", PROGRAM_NAME);
+    printf("Usage: %s [OPTIONS] <PID>...\n", PROGRAM_NAME);
+    printf("       %s [OPTIONS] --pgrep=NAME\n", PROGRAM_NAME);
+    printf("       %s --all [--sort=KEY] [--limit=N] [FILTERS]\n", PROGRAM_NAME);
+    printf("       %s --all-net\n", PROGRAM_NAME);
+    printf("       %s top -H [-d SEC] [-n COUNT] [-l ROWS] <PID>\n",
+           PROGRAM_NAME);
     printf("\n");
     printf("Inspect Linux process information via /proc filesystem.\n");
     printf("\n");
     printf("Options:\n");
     printf("  -v, --verbose    Show detailed file descriptor information\n");
     printf("  -n, --network    Show network connections only\n");
+    printf("  -m, --memory     Show PSS, swap, anonymous/file and huge page usage\n");
+    printf("      --maps       Also break memory down by mapped file (reads\n");
+    printf("                   all of smaps; slow with many mappings)\n");
+    printf("  -w, --watch=SEC  Re-sample every SEC seconds and print only changes\n");
+    printf("      --pgrep=NAME Inspect every process whose name contains NAME\n");
+    printf("      --fields=LIST\n");
+    printf("                   Collect and show only these fields, one row per\n");
+    printf("                   process: name,state,uid,gid,vmpeak,vmsize,rss,\n");
+    printf("                   threads,fds,sockets or all\n");
+    printf("      --all        Summarize every process on the host\n");
+    printf("      --sort=pid|rss|fds|sockets|threads|uid\n");
+    printf("                   Order for --all (default pid; counts descending)\n");
+    printf("      --limit=N    With --all, show only the first N processes\n");
+    printf("      --uid=UID    With --all, only processes with this effective UID\n");
+    printf("      --min-rss=KB, --min-fds=N, --min-threads=N\n");
+    printf("                   With --all, only processes at or above the value\n");
+    printf("      --all-net    Show every connection on the host with its owner\n");
+    printf("      --net-backend=auto|netlink|proc\n");
+    printf("                   Read sockets via sock_diag or /proc/net (default auto)\n");
+    printf("      --fd-backend=readlink|uring\n");
+    printf("                   Resolve FDs one readlink each or in io_uring\n");
+    printf("                   statx batches (default readlink)\n");
+    printf("      --format=text|jsonl|binary\n");
+    printf("                   Output format (default text); jsonl and binary\n");
+    printf("                   emit one record per process/fd/thread/socket\n");
+    printf("      --stats      Print time, syscalls and bytes read per phase to\n");
+    printf("                   stderr on exit\n");
+    printf("      --max-syscalls=N\n");
+    printf("                   Read /proc at most N syscalls per second, sleeping\n");
+    printf("                   between batches so the target is not stalled\n");
+    printf("      --max-cpu=PCT\n");
+    printf("                   Use at most PCT%% of one CPU while collecting\n");
+    printf("      --sample=N   Read only N random FDs and threads per process\n");
+    printf("                   and estimate type and state counts, with 95%%\n");
+    printf("                   intervals (text output; no -v, -n or --fields)\n");
+    printf("      --fd-summary[=K]\n");
+    printf("                   Count FDs by kind and list the K paths open most\n");
+    printf("                   often (default %d), storing only distinct paths\n",
+           DEFAULT_FD_TOP);
     printf("  -h, --help       Display this help message\n");
     printf("  -V, --version    Display version information\n");
     printf("\n");
@@ -45,6 +142,151 @@ static void print_usage(void)
     printf("  %s -v $$         Inspect current shell (verbose)\n", PROGRAM_NAME);
     printf("  %s -n $(pgrep firefox)  Show Firefox network connections\n",
            PROGRAM_NAME);
+    printf("  %s 1 2 3         Inspect several processes, in PID order\n",
+           PROGRAM_NAME);
+    printf("  %s --pgrep=nginx Inspect all nginx processes\n", PROGRAM_NAME);
+    printf("  %s -m --maps 1234  Memory usage per mapped file\n",
+           PROGRAM_NAME);
+    printf("  %s -w 0.5 1234   Stream FD/thread/connection changes\n",
+           PROGRAM_NAME);
+    printf("  %s --all --sort=rss --limit=10  Ten largest processes\n",
+           PROGRAM_NAME);
+    printf("  %s --fields=rss,fds --pgrep=nginx  RSS and FDs per worker\n",
+           PROGRAM_NAME);
+    printf("  %s --all-net     List owners of all sockets\n",
+           PROGRAM_NAME);
+    printf("  %s top -H 1234   Per-thread CPU%% and context switch rates\n",
+           PROGRAM_NAME);
+    printf("  %s --sample=500 --max-syscalls=2000 1234\n", PROGRAM_NAME);
+    printf("                   Gently estimate a huge process's FD mix\n");
+    printf("  %s --fd-summary=20 1234  Which files leak FDs\n",
+           PROGRAM_NAME);
+}
+
+static void print_top_usage(void)
+{
+    printf("Usage: %s top -H [OPTIONS] <PID>\n", PROGRAM_NAME);
+    printf("\n");
+    printf("Refresh a table of the busiest threads of a process.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -H, --threads    Per-thread view (required)\n");
+    printf("  -d, --delay=SEC  Seconds between refreshes (default 1)\n");
+    printf("  -n, --iterations=COUNT\n");
+    printf("                   Stop after COUNT refreshes (default 0 = forever)\n");
+    printf("  -l, --limit=ROWS Show the ROWS busiest threads (default %d,\n",
+           TOP_DEFAULT_LIMIT);
+    printf("                   0 = all)\n");
+    printf("  -h, --help       Display this help message\n");
+}
+
+/*
+ * Parse a non-negative integer option value. Returns 0 on success, -1 on
+ * a malformed or out-of-range value.
+ */
+static int parse_count(const char *text, int *value)
+{
+    char *end;
+    errno = 0;
+    long n = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || n < 0 || n > INT_MAX) {
+        return -1;
+    }
+    *value = (int)n;
+    return 0;
+}
+
+/*
+ * "pinspect top" subcommand: argv[0] is "top". Parses its own options and
+ * runs top_run(). Returns the process exit code.
+ */
+static int run_top(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"threads",    no_argument,       NULL, 'H'},
+        {"delay",      required_argument, NULL, 'd'},
+        {"iterations", required_argument, NULL, 'n'},
+        {"limit",      required_argument, NULL, 'l'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL,         0,                 NULL,  0}
+    };
+
+    top_options_t top = {
+        .interval_sec = 1.0,
+        .limit = TOP_DEFAULT_LIMIT,
+        .max_samples = 0,
+    };
+    bool threads = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "Hd:n:l:h", long_options,
+                              NULL)) != -1) {
+        switch (opt) {
+        case 'H':
+            threads = true;
+            break;
+        case 'd': {
+            char *end;
+            errno = 0;
+            top.interval_sec = strtod(optarg, &end);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                !(top.interval_sec > 0)) {
+                fprintf(stderr, "Invalid delay: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'n':
+            if (parse_count(optarg, &top.max_samples) != 0) {
+                fprintf(stderr, "Invalid iteration count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'l':
+            if (parse_count(optarg, &top.limit) != 0) {
+                fprintf(stderr, "Invalid limit: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            print_top_usage();
+            return 0;
+        case '?':
+            fprintf(stderr, "Try '%s top --help' for more information.\n",
+                    PROGRAM_NAME);
+            return 1;
+        }
+    }
+
+    if (!threads) {
+        fprintf(stderr, "%s top: only the per-thread view (-H) is "
+                "implemented\n", PROGRAM_NAME);
+        return 1;
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "%s top: expected exactly one PID\n", PROGRAM_NAME);
+        return 1;
+    }
+
+    pid_t pid = parse_pid(argv[optind]);
+    if (pid == -1) {
+        fprintf(stderr, "Invalid PID: %s\n", argv[optind]);
+        return 1;
+    }
+
+    if (top_run(pid, &top, stdout) != 0) {
+        fprintf(stderr, "%s: cannot sample process %d: %s\n",
+                PROGRAM_NAME, pid, strerror(errno));
+        return (errno == ENOENT) ? 2 : 3;
+    }
+    return 0;
+}
+
+/* atexit() handler for --stats, so every exit path reports */
+static void print_stats(void)
+{
+    stats_print(stderr);
 }
 
 static void print_version(void)
@@ -52,18 +294,45 @@ static void print_version(void)
     printf("%s version %s\n", PROGRAM_NAME, VERSION);
 }
 
+/* Longest FD list format_fd_list() writes, with its NUL */
+#define FD_LIST_TEXT_MAX 64
+
+/*
+ * Format fds as "3,7,12". A list that does not fit in size bytes ends at
+ * the last FD that does, followed by ",+N" for the N left out.
+ */
+static void format_fd_list(const int *fds, int count, char *buf, size_t size)
+{
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        /* Room for this FD and, if more follow, a ",+N" tail */
+        char item[16];
+        int len = snprintf(item, sizeof(item), "%s%d", i > 0 ? "," : "",
+                           fds[i]);
+        size_t reserve = (i + 1 < count) ? 16 : 0;
+        if (used + (size_t)len + reserve >= size) {
+            snprintf(buf + used, size - used, ",+%d", count - i);
+            return;
+        }
+        memcpy(buf + used, item, (size_t)len + 1);
+        used += (size_t)len;
+    }
+}
+
 /*
  * Display network connections for a process.
  *
  * In normal mode: Just show count
  * In verbose mode: Show detailed list of all connections
  */
-static void print_network_connections(pid_t pid, bool verbose)
+static void print_network_connections(const process_report_t *report,
+                                      bool verbose)
 {
-    socket_info_t *sockets = NULL;
-    int count = 0;
+    const socket_info_t *sockets = report->sockets;
+    int count = report->socket_count;
 
-    if (find_process_sockets(pid, &sockets, &count) != 0) {
+    if (report->socket_errno != 0) {
         printf("\nNetwork Connections: Unable to read (permission denied)\n");
         return;
     }
@@ -71,25 +340,80 @@ static void print_network_connections(pid_t pid, bool verbose)
     printf("\nNetwork Connections: %d open\n", count);
 
     if (verbose && count > 0) {
-        printf("\n  Proto  Local Address          Remote Address         State\n");
-        printf("  -----  ---------------------  ---------------------  -----------\n");
+        printf("\n  Proto  Local Address          Remote Address         State        FDs\n");
+        printf("  -----  ---------------------  ---------------------  -----------  ---\n");
+
+        for (int i = 0; i < count; i++) {
+            char local[SOCKET_ADDR_MAX], remote[SOCKET_ADDR_MAX];
+            format_socket_addr(&sockets[i], true, local, sizeof(local));
+            format_socket_addr(&sockets[i], false, remote, sizeof(remote));
+
+            /* Every FD sharing the socket, e.g. a prefork listener's dups */
+            char fd_text[FD_LIST_TEXT_MAX];
+            int fd_count = 0;
+            int index = inode_set_find(&report->socket_inodes,
+                                       sockets[i].inode);
+            const int *fds = inode_set_fds(&report->socket_inodes, index,
+                                           &fd_count);
+            if (fds != NULL) {
+                format_fd_list(fds, fd_count, fd_text, sizeof(fd_text));
+            } else {
+                snprintf(fd_text, sizeof(fd_text), "%d",
+                         report->socket_fds[i]);
+            }
+
+            printf("  %-5s  %-21s  %-21s  %-11s  %s\n",
+                   socket_proto_to_string(&sockets[i]),
+                   local,
+                   remote,
+                   tcp_state_to_string(sockets[i].state),
+                   fd_text);
+        }
+    }
+}
+
+/*
+ * Display every connection on the host along with its owning process.
+ *
+ * Uses the system-wide inode index so the /proc/net tables are parsed once
+ * no matter how many processes own sockets.
+ * Returns 0 on success, -1 if the socket owners could not be read (errno
+ * set, nothing printed).
+ */
+static int print_all_network_connections(void)
+{
+    socket_owner_t *owners = NULL;
+    int count = 0;
+
+    if (find_all_socket_owners(&owners, &count) != 0) {
+        return -1;
+    }
+
+    printf("Network Connections: %d owned sockets\n", count);
+
+    if (count > 0) {
+        printf("\n  PID     Name              FD    Proto  Local Address          Remote Address         State\n");
+        printf("  ------  ----------------  ----  -----  ---------------------  ---------------------  -----------\n");
 
         for (int i = 0; i < count; i++) {
-            char local[32], remote[32];
-            format_ip_port(sockets[i].local_addr, sockets[i].local_port,
-                          local, sizeof(local));
-            format_ip_port(sockets[i].remote_addr, sockets[i].remote_port,
-                          remote, sizeof(remote));
-
-            printf("  %-5s  %-21s  %-21s  %s\n",
-                   sockets[i].is_tcp ? "TCP" : "UDP",
+            const socket_info_t *sock = &owners[i].socket;
+            char local[SOCKET_ADDR_MAX], remote[SOCKET_ADDR_MAX];
+            format_socket_addr(sock, true, local, sizeof(local));
+            format_socket_addr(sock, false, remote, sizeof(remote));
+
+            printf("  %-6d  %-16s  %-4d  %-5s  %-21s  %-21s  %s\n",
+                   owners[i].pid,
+                   owners[i].name,
+                   owners[i].fd,
+                   socket_proto_to_string(sock),
                    local,
                    remote,
-                   tcp_state_to_string(sockets[i].state));
+                   tcp_state_to_string(sock->state));
         }
     }
 
-    socket_list_free(sockets);
+    socket_owner_list_free(owners);
+    return 0;
 }
 
 /*
@@ -101,13 +425,36 @@ static int parse_args(int argc, char *argv[])
     static struct option long_options[] = {
         {"verbose", no_argument, NULL, 'v'},
         {"network", no_argument, NULL, 'n'},
+        {"memory",  no_argument, NULL, 'm'},
+        {"maps",    no_argument, NULL, OPT_MAPS},
+        {"watch",   required_argument, NULL, 'w'},
+        {"pgrep",   required_argument, NULL, OPT_PGREP},
+        {"format",  required_argument, NULL, OPT_FORMAT},
+        {"all",     no_argument, NULL, OPT_ALL},
+        {"fields",  required_argument, NULL, OPT_FIELDS},
+        {"sort",    required_argument, NULL, OPT_SORT},
+        {"limit",   required_argument, NULL, OPT_LIMIT},
+        {"uid",     required_argument, NULL, OPT_UID},
+        {"min-rss", required_argument, NULL, OPT_MIN_RSS},
+        {"min-fds", required_argument, NULL, OPT_MIN_FDS},
+        {"min-threads", required_argument, NULL, OPT_MIN_THREADS},
+        {"all-net", no_argument, NULL, OPT_ALL_NET},
+        {"net-backend", required_argument, NULL, OPT_NET_BACKEND},
+        {"fd-backend", required_argument, NULL, OPT_FD_BACKEND},
+        {"stats",   no_argument, NULL, OPT_STATS},
+        {"max-syscalls", required_argument, NULL, OPT_MAX_SYSCALLS},
+        {"max-cpu", required_argument, NULL, OPT_MAX_CPU},
+        {"sample",  required_argument, NULL, OPT_SAMPLE},
+        {"fd-summary", optional_argument, NULL, OPT_FD_SUMMARY},
         {"help",    no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'V'},
         {NULL,      0,           NULL,  0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "vnhV", long_options, NULL)) != -1) {
+    int option_index = 0;
+    while ((opt = getopt_long(argc, argv, "vnmw:hV", long_options,
+                              &option_index)) != -1) {
         switch (opt) {
         case 'v':
             options.verbose = true;
@@ -115,6 +462,131 @@ static int parse_args(int argc, char *argv[])
         case 'n':
             options.network_only = true;
             break;
+        case 'm':
+            options.memory = true;
+            break;
+        case OPT_MAPS:
+            options.memory = true;
+            options.maps = true;
+            break;
+        case 'w': {
+            char *end;
+            errno = 0;
+            options.watch_interval = strtod(optarg, &end);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                !(options.watch_interval > 0)) {
+                fprintf(stderr, "Invalid watch interval: %s\n", optarg);
+                return -1;
+            }
+            break;
+        }
+        case OPT_PGREP:
+            options.pgrep = optarg;
+            break;
+        case OPT_FORMAT:
+            if (output_parse_format(optarg, &options.format) != 0) {
+                fprintf(stderr, "Invalid output format: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case OPT_ALL_NET:
+            options.all_net = true;
+            break;
+        case OPT_ALL:
+            options.all = true;
+            break;
+        case OPT_FIELDS:
+            if (parse_field_list(optarg, &options.fields) != 0) {
+                fprintf(stderr, "Invalid field list: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case OPT_SORT:
+            options.scan_option = true;
+            if (scan_parse_sort(optarg, &options.scan.sort) != 0) {
+                fprintf(stderr, "Invalid sort key: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case OPT_LIMIT:
+        case OPT_UID:
+        case OPT_MIN_RSS:
+        case OPT_MIN_FDS:
+        case OPT_MIN_THREADS: {
+            int value;
+            options.scan_option = true;
+            if (parse_count(optarg, &value) != 0) {
+                fprintf(stderr, "Invalid value for --%s: %s\n",
+                        long_options[option_index].name, optarg);
+                return -1;
+            }
+            if (opt == OPT_LIMIT) {
+                options.scan.limit = value;
+            } else if (opt == OPT_UID) {
+                options.scan.match_uid = true;
+                options.scan.uid = (uid_t)value;
+            } else if (opt == OPT_MIN_RSS) {
+                options.scan.min_rss_kb = (unsigned long)value;
+            } else if (opt == OPT_MIN_FDS) {
+                options.scan.min_fds = value;
+            } else {
+                options.scan.min_threads = value;
+            }
+            break;
+        }
+        case OPT_NET_BACKEND:
+            if (strcmp(optarg, "auto") == 0) {
+                net_set_backend(NET_BACKEND_AUTO);
+            } else if (strcmp(optarg, "netlink") == 0) {
+                net_set_backend(NET_BACKEND_NETLINK);
+            } else if (strcmp(optarg, "proc") == 0) {
+                net_set_backend(NET_BACKEND_PROC);
+            } else {
+                fprintf(stderr, "Invalid network backend: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case OPT_FD_BACKEND:
+            if (strcmp(optarg, "readlink") == 0) {
+                fd_set_backend(FD_BACKEND_READLINK);
+            } else if (strcmp(optarg, "uring") == 0) {
+                fd_set_backend(FD_BACKEND_URING);
+            } else {
+                fprintf(stderr, "Invalid FD backend: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case OPT_STATS:
+            options.stats = true;
+            break;
+        case OPT_MAX_SYSCALLS:
+        case OPT_MAX_CPU:
+        case OPT_SAMPLE: {
+            int value;
+            if (parse_count(optarg, &value) != 0 || value == 0) {
+                fprintf(stderr, "Invalid value for --%s: %s\n",
+                        long_options[option_index].name, optarg);
+                return -1;
+            }
+            if (opt == OPT_MAX_SYSCALLS) {
+                options.budget.syscalls_per_sec = (unsigned long)value;
+            } else if (opt == OPT_MAX_CPU) {
+                options.budget.cpu_percent = (unsigned)value;
+            } else {
+                options.sample_size = value;
+            }
+            break;
+        }
+        case OPT_FD_SUMMARY:
+            options.fd_top = DEFAULT_FD_TOP;
+            if (optarg != NULL &&
+                (parse_count(optarg, &options.fd_top) != 0 ||
+                 options.fd_top == 0)) {
+                fprintf(stderr, "Invalid value for --fd-summary: %s\n",
+                        optarg);
+                return -1;
+            }
+            break;
         case 'h':
             options.help = true;
             break;
@@ -127,19 +599,77 @@ static int parse_args(int argc, char *argv[])
         }
     }
 
-    /* Help and version don't require a PID */
-    if (options.help || options.version) {
+    if (options.watch_interval > 0 && options.format != OUTPUT_TEXT) {
+        fprintf(stderr, "--watch only supports text output\n");
+        return -1;
+    }
+
+    if (options.scan_option && !options.all) {
+        fprintf(stderr, "--sort, --limit, --uid and --min-* require --all\n");
+        return -1;
+    }
+
+    if (options.fields != 0 &&
+        (options.verbose || options.network_only || options.memory ||
+         options.watch_interval > 0)) {
+        fprintf(stderr, "--fields cannot be combined with -v, -n, -m, "
+                "--maps or --watch\n");
+        return -1;
+    }
+
+    if (options.sample_size > 0 &&
+        (options.verbose || options.network_only || options.fields != 0 ||
+         options.watch_interval > 0 || options.all || options.all_net ||
+         options.format != OUTPUT_TEXT)) {
+        fprintf(stderr, "--sample only works with the text report of "
+                "PIDs or --pgrep, without -v, -n or --fields\n");
+        return -1;
+    }
+
+    if (options.fd_top > 0 &&
+        (options.verbose || options.network_only || options.fields != 0 ||
+         options.sample_size > 0 || options.watch_interval > 0 ||
+         options.all || options.all_net || options.format != OUTPUT_TEXT)) {
+        fprintf(stderr, "--fd-summary only works with the text report of "
+                "PIDs or --pgrep, without -v, -n, --fields or --sample\n");
+        return -1;
+    }
+
+    if (options.all && options.watch_interval > 0) {
+        fprintf(stderr, "--watch cannot be combined with --all\n");
+        return -1;
+    }
+
+    /* Help, version and host-wide modes don't require a PID */
+    if (options.help || options.version || options.all_net || options.all) {
         return 0;
     }
 
-    if (optind >= argc) {
+    if (optind >= argc && options.pgrep == NULL) {
         fprintf(stderr, "Expected a PID argument\n");
         return -1;
     }
 
-    options.pid = parse_pid(argv[optind]);
-    if (options.pid == -1) {
-        fprintf(stderr, "Invalid PID: %s\n", argv[optind]);
+    if (optind < argc) {
+        options.pids = malloc((argc - optind) * sizeof(pid_t));
+        if (options.pids == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        pid_t pid = parse_pid(argv[i]);
+        if (pid == -1) {
+            fprintf(stderr, "Invalid PID: %s\n", argv[i]);
+            return -1;
+        }
+        options.pids[options.pid_count++] = pid;
+    }
+
+    if (options.watch_interval > 0 &&
+        (options.pgrep != NULL || options.pid_count != 1)) {
+        fprintf(stderr, "--watch takes exactly one PID\n");
         return -1;
     }
 
@@ -162,18 +692,78 @@ static void print_process_info(const proc_info_t *info)
 }
 
 
+/*
+ * Display smaps_rollup totals and, with --maps, the per-file breakdown.
+ * All values are in KB.
+ */
+static void print_memory(const process_report_t *report)
+{
+    if (!options.memory) {
+        return;
+    }
+
+    if (report->memory_errno != 0) {
+        printf("\nMemory Map: Unable to read (%s)\n",
+               strerror(report->memory_errno));
+        return;
+    }
+
+    const mem_usage_t *m = &report->memory;
+    printf("\nMemory Map:\n");
+    printf("  RSS: %lu KB, PSS: %lu KB (anon %lu, file %lu, shmem %lu)\n",
+           m->rss_kb, m->pss_kb, m->pss_anon_kb, m->pss_file_kb,
+           m->pss_shmem_kb);
+    printf("  Private: %lu KB clean, %lu KB dirty; "
+           "Shared: %lu KB clean, %lu KB dirty\n",
+           m->private_clean_kb, m->private_dirty_kb,
+           m->shared_clean_kb, m->shared_dirty_kb);
+    printf("  Anonymous: %lu KB, Swap: %lu KB (PSS %lu), Locked: %lu KB\n",
+           m->anonymous_kb, m->swap_kb, m->swap_pss_kb, m->locked_kb);
+    printf("  Huge pages: %lu KB anon THP, %lu KB shmem, %lu KB file, "
+           "%lu KB hugetlb\n",
+           m->anon_huge_kb, m->shmem_huge_kb, m->file_huge_kb,
+           m->hugetlb_kb);
+
+    if (!options.maps) {
+        return;
+    }
+
+    if (report->memory_files_errno != 0) {
+        printf("\nMapped Files: Unable to read (%s)\n",
+               strerror(report->memory_files_errno));
+        return;
+    }
+
+    const mem_file_list_t *list = &report->memory_files;
+    printf("\nMapped Files: %d\n", list->count);
+    printf("\n   PSS KB    RSS KB   Swap KB  Maps  File\n");
+    printf("  -------  --------  --------  ----  ----------------------------------------\n");
+
+    for (int i = 0; i < list->count; i++) {
+        const mem_file_t *entry = &list->entries[i];
+        printf("  %7lu  %8lu  %8lu  %4d  %s\n",
+               entry->usage.pss_kb,
+               entry->usage.rss_kb,
+               entry->usage.swap_kb,
+               entry->vma_count,
+               mem_file_name(list, entry));
+    }
+}
+
 /*
  * Display file descriptor information for a process.
  *
  * In normal mode: Just show count
  * In verbose mode: Show detailed list of all FDs
  */
-static void print_file_descriptors(pid_t pid, bool verbose)
+static void print_file_descriptors(const process_report_t *report,
+                                   bool verbose)
 {
-    fd_entry_t *fds = NULL;
-    int count = 0;
+    const fd_list_t *list = &report->fds;
+    const fd_entry_t *fds = list->entries;
+    int count = list->count;
 
-    if (enumerate_fds(pid, &fds, &count) != 0) {
+    if (report->fd_errno != 0) {
         /* Graceful degradation for permission errors or race conditions */
         printf("\nFile Descriptors: Unable to read (permission denied)\n");
         return;
@@ -182,19 +772,16 @@ static void print_file_descriptors(pid_t pid, bool verbose)
     printf("\nFile Descriptors: %d open\n", count);
 
     if (verbose && count > 0) {
-        printf("\n  FD    Type      Target\n");
-        printf("  ----  --------  ----------------------------------------\n");
+        printf("\n  FD    Type        Target\n");
+        printf("  ----  ----------  ----------------------------------------\n");
 
         for (int i = 0; i < count; i++) {
-            const char *type = fds[i].is_socket ? "socket" : "file";
-            printf("  %-4d  %-8s  %s\n",
+            printf("  %-4d  %-10s  %s\n",
                    fds[i].fd,
-                   type,
-                   fds[i].target);
+                   fd_type_to_string(fds[i].type),
+                   fd_target(list, &fds[i]));
         }
     }
-
-    fd_entries_free(fds);
 }
 
 /*
@@ -203,32 +790,451 @@ static void print_file_descriptors(pid_t pid, bool verbose)
  * In normal mode: Just show count (already from proc_status)
  * In verbose mode: Show detailed list of all threads
  */
-static void print_threads(pid_t pid, bool verbose)
+static void print_threads(const process_report_t *report, bool verbose)
 {
     if (!verbose) {
         return;  // Thread count already shown by print_process_info()
     }
 
-    thread_info_t *threads = NULL;
-    int count = 0;
+    const thread_info_t *threads = report->threads;
+    int count = report->thread_count;
 
-    if (enumerate_threads(pid, &threads, &count) != 0) {
+    if (report->thread_errno != 0) {
         printf("\nThreads: Unable to enumerate (permission denied)\n");
         return;
     }
 
+    /* utime/stime are in clock ticks */
+    long ticks = sysconf(_SC_CLK_TCK);
+    double tick_sec = (ticks > 0) ? 1.0 / (double)ticks : 0.01;
+
     printf("\nThread Details:\n");
-    printf("  TID     State       Name\n");
-    printf("  ------  ----------  ----------------\n");
+    printf("  TID     State       CPU   User(s)   Sys(s)  Name\n");
+    printf("  ------  ----------  ---  --------  -------  ----------------\n");
 
     for (int i = 0; i < count; i++) {
-        printf("  %-6d  %-10s  %s\n",
+        printf("  %-6d  %-10s  %3d  %8.2f  %7.2f  %s\n",
                threads[i].tid,
                state_to_string(threads[i].state),
+               threads[i].processor,
+               (double)threads[i].utime * tick_sec,
+               (double)threads[i].stime * tick_sec,
                threads[i].name);
     }
+}
+
+/*
+ * Print a table row: hits of sampled items had label; estimate how many
+ * of total do, with the 95% interval.
+ */
+static void print_estimate_row(const char *label, int hits, int sampled,
+                               int total)
+{
+    count_estimate_t e;
+    if (estimate_count(hits, sampled, total, &e) != 0) {
+        return;
+    }
+    printf("  %-10s  %7d  %9.0f  [%.0f, %.0f]\n", label, hits, e.estimate,
+           e.low, e.high);
+}
 
-    thread_info_free(threads);
+/* Header of an estimate table whose first column is title */
+static void print_estimate_header(const char *title)
+{
+    printf("\n  %-10s  Sampled   Estimate  95%% interval\n", title);
+    printf("  ----------  -------  ---------  --------------------\n");
+}
+
+/*
+ * Display --sample results: FD types and thread states seen in the
+ * sample, scaled up to every FD and thread of the process. Sockets are
+ * not matched to connections in this mode; the socket row estimates how
+ * many there are.
+ */
+static void print_samples(const process_report_t *report)
+{
+    const fd_sample_t *fds = &report->fd_sample;
+    if (report->fd_errno != 0) {
+        printf("\nFile Descriptors: Unable to read (%s)\n",
+               strerror(report->fd_errno));
+    } else {
+        printf("\nFile Descriptors: %d open, %d sampled\n", fds->total,
+               fds->sampled);
+        if (fds->sampled > 0) {
+            print_estimate_header("Type");
+            for (int t = 0; t <= FD_TYPE_OTHER; t++) {
+                print_estimate_row(fd_type_to_string((fd_type_t)t),
+                                   fds->type_counts[t], fds->sampled,
+                                   fds->total);
+            }
+        }
+    }
+
+    const thread_sample_t *threads = &report->thread_sample;
+    if (report->thread_errno != 0) {
+        printf("\nThread States: Unable to read (%s)\n",
+               strerror(report->thread_errno));
+        return;
+    }
+    printf("\nThread States: %d threads, %d sampled\n", threads->total,
+           threads->sampled);
+    if (threads->sampled == 0) {
+        return;
+    }
+    print_estimate_header("State");
+    for (int s = 0; s <= PROC_STATE_UNKNOWN; s++) {
+        /* Unknown only shows up for a stat line that failed to parse */
+        if (s == PROC_STATE_UNKNOWN && threads->state_counts[s] == 0) {
+            continue;
+        }
+        print_estimate_row(state_to_string((proc_state_t)s),
+                           threads->state_counts[s], threads->sampled,
+                           threads->total);
+    }
+}
+
+/*
+ * Display --fd-summary results: FDs by kind, then the options.fd_top
+ * paths held open most often. Sockets are counted, not matched to
+ * connections, in this mode.
+ */
+static void print_fd_summary(const process_report_t *report)
+{
+    const fd_summary_t *s = &report->fd_summary;
+    if (report->fd_errno != 0) {
+        printf("\nFile Descriptors: Unable to read (%s)\n",
+               strerror(report->fd_errno));
+        return;
+    }
+
+    printf("\nFile Descriptors: %d open, %zu distinct paths\n", s->total,
+           s->distinct);
+    printf("\n  Kind        Count\n");
+    printf("  ----------  -------\n");
+    for (int k = 0; k <= FD_KIND_OTHER; k++) {
+        printf("  %-10s  %7d\n", fd_kind_to_string((fd_kind_t)k),
+               s->kind_counts[k]);
+    }
+
+    fd_path_count_t *top = malloc((size_t)options.fd_top * sizeof(*top));
+    int n = (top != NULL) ? fd_summary_top(s, top, options.fd_top) : -1;
+    if (n > 0) {
+        printf("\n    Count  Path\n");
+        printf("  -------  ----------------------------------------\n");
+        for (int i = 0; i < n; i++) {
+            printf("  %7d  %s\n", top[i].count, top[i].path);
+        }
+    }
+    free(top);
+}
+
+/*
+ * Emit every host socket with its owner as machine-readable records.
+ * Returns 0 on success, -1 on error.
+ */
+static int emit_all_network_connections(output_t *out)
+{
+    socket_owner_t *owners = NULL;
+    int count = 0;
+
+    if (find_all_socket_owners(&owners, &count) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        output_socket(out, owners[i].pid, owners[i].fd, &owners[i].socket);
+    }
+
+    socket_owner_list_free(owners);
+    return 0;
+}
+
+/* Columns shown by --all when --fields is not given */
+#define SCAN_TABLE_FIELDS (FIELD_UID | FIELD_STATE | FIELD_THREADS | \
+                           FIELD_VM_RSS | FIELD_FDS | FIELD_SOCKETS | \
+                           FIELD_NAME)
+
+/* Summary table columns in print order; the name always goes last */
+static const struct {
+    unsigned field;
+    const char *title;
+    int width;              /* Negative to left-align */
+} table_columns[] = {
+    { FIELD_UID,     "UID",        5 },
+    { FIELD_GID,     "GID",        5 },
+    { FIELD_STATE,   "State",      -10 },
+    { FIELD_THREADS, "Threads",    7 },
+    { FIELD_VM_SIZE, "VmSize(KB)", 10 },
+    { FIELD_VM_RSS,  "RSS(KB)",    9 },
+    { FIELD_VM_PEAK, "VmPeak(KB)", 10 },
+    { FIELD_FDS,     "FDs",        5 },
+    { FIELD_SOCKETS, "Socks",      5 },
+};
+
+/*
+ * Format one table cell of s into buf. Unknown counts print as "-".
+ */
+static const char *format_cell(const proc_summary_t *s, unsigned field,
+                               char *buf, size_t size)
+{
+    const proc_info_t *info = &s->info;
+
+    switch (field) {
+    case FIELD_UID:
+        snprintf(buf, size, "%u", info->uid_effective);
+        break;
+    case FIELD_GID:
+        snprintf(buf, size, "%u", info->gid_effective);
+        break;
+    case FIELD_STATE:
+        return state_to_string(info->state);
+    case FIELD_THREADS:
+        snprintf(buf, size, "%d", info->thread_count);
+        break;
+    case FIELD_VM_SIZE:
+        snprintf(buf, size, "%lu", info->vm_size_kb);
+        break;
+    case FIELD_VM_RSS:
+        snprintf(buf, size, "%lu", info->vm_rss_kb);
+        break;
+    case FIELD_VM_PEAK:
+        snprintf(buf, size, "%lu", info->vm_peak_kb);
+        break;
+    case FIELD_FDS:
+    case FIELD_SOCKETS: {
+        int count = (field == FIELD_FDS) ? s->fd_count : s->socket_count;
+        if (count < 0) {
+            return "-";
+        }
+        snprintf(buf, size, "%d", count);
+        break;
+    }
+    default:
+        return "";
+    }
+    return buf;
+}
+
+/*
+ * Print summaries as a table with a PID column and one column per field
+ * in fields.
+ */
+static void print_summary_table(const proc_summary_t *rows, int count,
+                                unsigned fields)
+{
+    size_t ncolumns = sizeof(table_columns) / sizeof(table_columns[0]);
+
+    printf("  %-7s", "PID");
+    for (size_t c = 0; c < ncolumns; c++) {
+        if (fields & table_columns[c].field) {
+            printf("  %*s", table_columns[c].width, table_columns[c].title);
+        }
+    }
+    printf("%s\n", (fields & FIELD_NAME) ? "  Name" : "");
+
+    printf("  -------");
+    for (size_t c = 0; c < ncolumns; c++) {
+        if (fields & table_columns[c].field) {
+            int width = abs(table_columns[c].width);
+            printf("  %.*s", width, "----------");
+        }
+    }
+    printf("%s\n", (fields & FIELD_NAME) ? "  ----------------" : "");
+
+    for (int i = 0; i < count; i++) {
+        printf("  %-7d", rows[i].info.pid);
+        for (size_t c = 0; c < ncolumns; c++) {
+            if (fields & table_columns[c].field) {
+                char buf[32];
+                printf("  %*s", table_columns[c].width,
+                       format_cell(&rows[i], table_columns[c].field, buf,
+                                   sizeof(buf)));
+            }
+        }
+        if (fields & FIELD_NAME) {
+            printf("  %s", rows[i].info.name);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * Emit summaries as a process and a counts record each.
+ */
+static void emit_summaries(output_t *out, const proc_summary_t *rows,
+                           int count)
+{
+    for (int i = 0; i < count; i++) {
+        output_process(out, &rows[i].info);
+        output_counts(out, rows[i].info.pid, rows[i].fd_count,
+                      rows[i].socket_count);
+    }
+}
+
+/*
+ * Reduce a --fields report to a summary row. Counts outside --fields, or
+ * whose collector failed, become -1.
+ */
+static void summarize_report(const process_report_t *report,
+                             proc_summary_t *row)
+{
+    row->info = report->info;
+    row->fd_count = ((options.fields & FIELD_FDS) && report->fd_errno == 0)
+                        ? report->fds.count : -1;
+    row->socket_count = ((options.fields & FIELD_SOCKETS) &&
+                         report->socket_errno == 0)
+                            ? report->socket_count : -1;
+}
+
+/*
+ * Scan every process on the host and print or emit one summary per
+ * process, in --sort order and cut to --limit.
+ * Returns the process exit code.
+ */
+static int run_scan(output_t *out)
+{
+    proc_summary_t *summaries = NULL;
+    int count = 0;
+
+    unsigned fields = (options.fields != 0) ? options.fields
+                                            : SCAN_TABLE_FIELDS;
+    options.scan.fields = fields;
+    if (scan_processes(&options.scan, &summaries, &count) != 0) {
+        fprintf(stderr, "%s: cannot scan processes: %s\n", PROGRAM_NAME,
+                strerror(errno));
+        if (out != NULL) {
+            output_close(out);
+        }
+        return 3;
+    }
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_OUTPUT);
+    STATS_COUNT(STATS_ENTRIES, count);
+    int ret = 0;
+    if (out != NULL) {
+        emit_summaries(out, summaries, count);
+        if (output_close(out) != 0) {
+            fprintf(stderr, "%s: write error: %s\n", PROGRAM_NAME,
+                    strerror(errno));
+            ret = 3;
+        }
+    } else {
+        printf("Processes: %d\n", count);
+        if (count > 0) {
+            printf("\n");
+            print_summary_table(summaries, count, fields);
+        }
+    }
+    STATS_PHASE_END(prev);
+
+    proc_summary_list_free(summaries);
+    return ret;
+}
+
+/*
+ * Emit one report as records: process, then its FDs, threads and sockets.
+ * Unreadable processes become a single error record. Socket records get
+ * their owning FD from the report's FD list when it was collected.
+ */
+static void emit_report(output_t *out, const process_report_t *report)
+{
+    if (report->status_errno != 0) {
+        output_error(out, report->pid, report->status_errno);
+        return;
+    }
+
+    output_process(out, &report->info);
+
+    if (options.memory && report->memory_errno == 0) {
+        output_memory(out, report->pid, &report->memory);
+    }
+    const mem_file_list_t *files = &report->memory_files;
+    for (int i = 0; i < files->count; i++) {
+        output_mem_file(out, report->pid, &files->entries[i],
+                        mem_file_name(files, &files->entries[i]));
+    }
+
+    const fd_list_t *fds = &report->fds;
+    for (int i = 0; i < fds->count; i++) {
+        output_fd(out, report->pid, &fds->entries[i],
+                  fd_target(fds, &fds->entries[i]));
+    }
+    for (int i = 0; i < report->thread_count; i++) {
+        output_thread(out, report->pid, &report->threads[i]);
+    }
+    for (int i = 0; report->sockets != NULL && i < report->socket_count;
+         i++) {
+        output_socket(out, report->pid, report->socket_fds[i],
+                      &report->sockets[i]);
+    }
+}
+
+/*
+ * Gather command-line PIDs and --pgrep matches into one sorted,
+ * duplicate-free list.
+ * Returns 0 on success, -1 on error.
+ */
+static int resolve_pids(pid_t **pids, int *count)
+{
+    *pids = options.pids;
+    *count = options.pid_count;
+    options.pids = NULL;
+    options.pid_count = 0;
+
+    if (options.pgrep != NULL) {
+        pid_t *matches = NULL;
+        int match_count = 0;
+
+        if (find_pids_by_name(options.pgrep, &matches, &match_count) != 0) {
+            return -1;
+        }
+
+        if (match_count > 0) {
+            pid_t *merged = realloc(*pids,
+                                    (*count + match_count) * sizeof(pid_t));
+            if (merged == NULL) {
+                free(matches);
+                return -1;
+            }
+            memcpy(merged + *count, matches, match_count * sizeof(pid_t));
+            *pids = merged;
+            *count += match_count;
+        }
+        free(matches);
+    }
+
+    *count = sort_unique_pids(*pids, *count);
+    return 0;
+}
+
+/*
+ * Print one collected report. In multi-process network-only mode a short
+ * header identifies which process the connections belong to.
+ */
+static void print_report(const process_report_t *report, bool multiple)
+{
+    if (options.network_only) {
+        if (multiple) {
+            printf("%-10s %s (PID %d)\n", "Process:", report->info.name,
+                   report->pid);
+        }
+        print_network_connections(report, options.verbose);
+        return;
+    }
+
+    print_process_info(&report->info);
+    print_memory(report);
+    if (options.sample_size > 0) {
+        print_samples(report);
+        return;
+    }
+    if (options.fd_top > 0) {
+        print_fd_summary(report);
+        return;
+    }
+    print_file_descriptors(report, options.verbose);
+    print_threads(report, options.verbose);
+    print_network_connections(report, options.verbose);
 }
 
 /*
@@ -239,9 +1245,16 @@ static void print_threads(pid_t pid, bool verbose)
  * - 1: Invalid arguments
  * - 2: Process not found
  * - 3: Permission denied
+ *
+ * With several PIDs, processes that cannot be read are reported on stderr
+ * and skipped; the exit code is 2 or 3 only if none could be read.
  */
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "top") == 0) {
+        return run_top(argc - 1, argv + 1);
+    }
+
     if (parse_args(argc, argv) != 0) {
         fprintf(stderr, "Try '%s --help' for more information.\n",
                 PROGRAM_NAME);
@@ -258,21 +1271,225 @@ int main(int argc, char *argv[])
         return 0;
     }
 
-    /* Read and display process info */
-    proc_info_t info;
-    if (read_proc_status(options.pid, &info) != 0) {
-        fprintf(stderr, "%s: cannot read process %d: %s\n",
-                PROGRAM_NAME, options.pid, strerror(errno));
-        return (errno == ENOENT) ? 2 : 3;
+    if (options.budget.syscalls_per_sec > 0 ||
+        options.budget.cpu_percent > 0) {
+        budget_set(&options.budget);
     }
 
-    if (options.network_only) {
-        print_network_connections(options.pid, options.verbose);
-    } else {
-        print_process_info(&info);
-        print_file_descriptors(options.pid, options.verbose);
-        print_threads(options.pid, options.verbose);
-        print_network_connections(options.pid, options.verbose);
+    if (options.stats) {
+        if (!stats_supported()) {
+            fprintf(stderr, "%s: --stats is not available in this build "
+                    "(built with STATS=0)\n", PROGRAM_NAME);
+            return 1;
+        }
+        stats_enable();
+        atexit(print_stats);
+    }
+
+    output_t out;
+    bool machine = (options.format != OUTPUT_TEXT);
+    if (machine && output_open(&out, STDOUT_FILENO, options.format) != 0) {
+        fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(errno));
+        return 3;
+    }
+
+    if (options.all_net) {
+        if (!machine) {
+            if (print_all_network_connections() != 0) {
+                fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(errno));
+                return 3;
+            }
+            return 0;
+        }
+
+        int ret = emit_all_network_connections(&out);
+        int saved_errno = errno;
+        if (output_close(&out) != 0 || ret != 0) {
+            fprintf(stderr, "%s: %s\n", PROGRAM_NAME,
+                    strerror(ret != 0 ? saved_errno : errno));
+            return 3;
+        }
+        return 0;
+    }
+
+    if (options.all) {
+        return run_scan(machine ? &out : NULL);
+    }
+
+    if (options.watch_interval > 0) {
+        pid_t pid = options.pids[0];
+        free(options.pids);
+
+        /* Fail early with the usual exit codes if the PID is unreadable */
+        proc_info_t info;
+        if (read_proc_status(pid, &info) != 0) {
+            fprintf(stderr, "%s: cannot read process %d: %s\n",
+                    PROGRAM_NAME, pid, strerror(errno));
+            return (errno == ENOENT) ? 2 : 3;
+        }
+
+        watch_options_t watch = {
+            .interval_sec = options.watch_interval,
+            .network_only = options.network_only,
+            .max_samples = 0,
+        };
+        if (watch_run(pid, &watch, stdout) != 0) {
+            fprintf(stderr, "%s: cannot watch process %d: %s\n",
+                    PROGRAM_NAME, pid, strerror(errno));
+            return (errno == ENOENT) ? 2 : 3;
+        }
+        return 0;
+    }
+
+    pid_t *pids = NULL;
+    int pid_count = 0;
+    if (resolve_pids(&pids, &pid_count) != 0) {
+        fprintf(stderr, "%s: cannot list processes: %s\n",
+                PROGRAM_NAME, strerror(errno));
+        free(pids);
+        if (machine) {
+            output_close(&out);
+        }
+        return 3;
+    }
+
+    if (pid_count == 0) {
+        fprintf(stderr, "%s: no process matches '%s'\n",
+                PROGRAM_NAME, options.pgrep);
+        free(pids);
+        if (machine) {
+            output_close(&out);
+        }
+        return 2;
+    }
+
+    /*
+     * Collect every PID on the worker pool, then print in PID order. Plain
+     * text output only prints FD and connection counts, so FDs are
+     * counted without reading their links, and only socket FDs are kept,
+     * until they are matched.
+     */
+    batch_options_t batch = {
+        .status_fields = FIELDS_STATUS,
+        .fds = !options.network_only,
+        .threads = (options.verbose || machine) && !options.network_only,
+        .sockets = true,
+        .memory = options.memory && !options.network_only,
+        .memory_files = options.maps && !options.network_only,
+        .counts_only = !options.verbose && !machine,
+        .workers = 0,
+    };
+
+    /* --sample: estimate FD types and thread states; no socket tables */
+    if (options.sample_size > 0) {
+        batch.threads = true;
+        batch.sockets = false;
+        batch.sample_size = options.sample_size;
+    }
+
+    /* --fd-summary: kinds and path counts instead of an FD list */
+    if (options.fd_top > 0) {
+        batch.sockets = false;
+        batch.counts_only = false;
+        batch.fd_summary = true;
+    }
+
+    /*
+     * --fields: only the collectors behind the requested fields run. This
+     * replaces every option set above; parse_args() rejects --fields with
+     * -v, -n, -m, --maps, --sample and --fd-summary, so none is lost.
+     */
+    proc_summary_t *rows = NULL;
+    if (options.fields != 0) {
+        batch = (batch_options_t){
+            .status_fields = options.fields & FIELDS_STATUS,
+            .fds = (options.fields & FIELD_FDS) != 0,
+            .sockets = (options.fields & FIELD_SOCKETS) != 0,
+            .counts_only = true,
+            .workers = 0,
+        };
+        rows = machine ? NULL : malloc(pid_count * sizeof(proc_summary_t));
+        if (!machine && rows == NULL) {
+            fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(errno));
+            free(pids);
+            return 3;
+        }
+    }
+
+    process_report_t *reports = NULL;
+    if (collect_process_reports(pids, pid_count, &batch, &reports) != 0) {
+        fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(errno));
+        free(rows);
+        free(pids);
+        if (machine) {
+            output_close(&out);
+        }
+        return 3;
+    }
+
+    int printed = 0;
+    int first_errno = 0;
+    int output_phase = STATS_PHASE_BEGIN(STATS_PHASE_OUTPUT);
+
+    for (int i = 0; i < pid_count; i++) {
+        const process_report_t *report = &reports[i];
+        STATS_COUNT(STATS_ENTRIES, 1);
+
+        if (options.fields != 0 && report->status_errno == 0) {
+            proc_summary_t row;
+            summarize_report(report, &row);
+            if (machine) {
+                emit_summaries(&out, &row, 1);
+            } else {
+                rows[printed] = row;
+            }
+            printed++;
+            continue;
+        }
+
+        if (machine) {
+            emit_report(&out, report);
+            if (report->status_errno == 0) {
+                printed++;
+            } else if (first_errno == 0) {
+                first_errno = report->status_errno;
+            }
+            continue;
+        }
+
+        if (report->status_errno != 0) {
+            fprintf(stderr, "%s: cannot read process %d: %s\n",
+                    PROGRAM_NAME, report->pid, strerror(report->status_errno));
+            if (first_errno == 0) {
+                first_errno = report->status_errno;
+            }
+            continue;
+        }
+
+        if (printed > 0) {
+            printf("\n");
+        }
+        print_report(report, pid_count > 1);
+        printed++;
+    }
+
+    if (rows != NULL && printed > 0) {
+        print_summary_table(rows, printed, options.fields);
+    }
+    STATS_PHASE_END(output_phase);
+
+    free(rows);
+    process_reports_free(reports, pid_count);
+    free(pids);
+
+    if (machine && output_close(&out) != 0) {
+        fprintf(stderr, "%s: write error: %s\n", PROGRAM_NAME,
+                strerror(errno));
+        return 3;
+    }
+
+    if (printed == 0) {
+        return (first_errno == ENOENT) ? 2 : 3;
     }
 
     return 0;
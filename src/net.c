@@ -1,8 +1,12 @@
 /*
- * net.c - Parse /proc/net/tcp and /proc/net/udp for process sockets
+ * net.c - Parse /proc/net socket tables for process sockets
  *
  * Correlates socket inodes from process FDs with network connection
  * entries to identify which connections belong to a specific process.
+ *
+ * Tables of another network namespace are read through a process in it:
+ * /proc/<pid>/net/tcp shows the tables of pid's namespace, whatever the
+ * reader's own.
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -11,17 +15,63 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include "net.h"
+#include "net_parse.h"
+#include "net_diag.h"
+#include "idmap.h"
 #include "proc_fd.h"
 #include "util.h"
+#include "stats.h"
+#include "budget.h"
 
 /* Initial capacity for socket array */
 #define INITIAL_SOCKET_CAPACITY 16
 
-/* Paths to network statistics files */
-#define PROC_NET_TCP "/proc/net/tcp"
-#define PROC_NET_UDP "/proc/net/udp"
+/* Paths to network statistics files, relative to the proc root or to a
+ * /proc/<pid> directory */
+#define PROC_NET_TCP "net/tcp"
+#define PROC_NET_UDP "net/udp"
+#define PROC_NET_TCP6 "net/tcp6"
+#define PROC_NET_UDP6 "net/udp6"
+#define PROC_NET_UNIX "net/unix"
+
+/*
+ * Every socket table we correlate against, in output order. Each has a
+ * text form under /proc/net and a sock_diag family/protocol pair.
+ */
+static const struct {
+    const char *path;
+    sock_proto_t proto;
+    net_row_parser_t parse_row;
+    int family;
+    int ipproto;
+} net_tables[] = {
+    {PROC_NET_TCP,  SOCK_PROTO_TCP,  parse_inet_row, AF_INET,  IPPROTO_TCP},
+    {PROC_NET_TCP6, SOCK_PROTO_TCP,  parse_inet_row, AF_INET6, IPPROTO_TCP},
+    {PROC_NET_UDP,  SOCK_PROTO_UDP,  parse_inet_row, AF_INET,  IPPROTO_UDP},
+    {PROC_NET_UDP6, SOCK_PROTO_UDP,  parse_inet_row, AF_INET6, IPPROTO_UDP},
+    {PROC_NET_UNIX, SOCK_PROTO_UNIX, parse_unix_row, AF_UNIX,  0},
+};
+
+#define NET_TABLE_COUNT (sizeof(net_tables) / sizeof(net_tables[0]))
+
+/*
+ * States requested from sock_diag. TIME_WAIT, SYN_RECV and NEW_SYN_RECV
+ * (12) entries are kernel mini-sockets with inode 0, so no FD can ever
+ * match them; filtering them kernel-side skips the bulk of a busy table.
+ */
+#define TCP_NEW_SYN_RECV 12
+#define DIAG_OWNABLE_STATES (~((1U << TCP_TIME_WAIT) | (1U << TCP_SYN_RECV) | \
+                               (1U << TCP_NEW_SYN_RECV)))
+
+/* Backend chosen with net_set_backend() */
+static net_backend_t selected_backend = NET_BACKEND_AUTO;
 
 const char *tcp_state_to_string(tcp_state_t state)
 {
@@ -41,38 +91,6 @@ const char *tcp_state_to_string(tcp_state_t state)
     }
 }
 
-/*
- * Parse hex address like "0100007F:1F90" into IP and port.
- * Returns 0 on success, -1 on error.
- */
-static int parse_hex_addr(const char *hex, uint32_t *ip, uint16_t *port)
-{
-    if (hex == NULL || ip == NULL || port == NULL) {
-        return -1;
-    }
-
-    unsigned int ip_hex, port_hex;
-
-    if (sscanf(hex, "%x:%x", &ip_hex, &port_hex) != 2) {
-        return -1;
-    }
-
-    /*
-     * IP address handling:
-     * /proc/net/tcp stores IPs in host byte order (little-endian on x86).
-     * We need network byte order for inet_ntoa().
-     *
-     * Example on x86:
-     *   hex = "0100007F" (127.0.0.1 in little-endian)
-     *   ip_hex = 0x0100007F
-     *   After htonl: 0x7F000001 (127.0.0.1 in network order)
-     */
-    *ip = htonl(ip_hex);
-    *port = (uint16_t)port_hex;
-
-    return 0;
-}
-
 /*
  * Format IP address and port as "192.168.1.1:8080" string.
  */
@@ -95,232 +113,998 @@ void format_ip_port(uint32_t addr, uint16_t port, char *buf, size_t buflen)
 }
 
 /*
- * Check if inode exists in the set (linear search).
- * Used for correlating socket FDs with /proc/net entries.
+ * Format one end of a socket: "1.2.3.4:80", "[::1]:80" or a UNIX path.
+ */
+void format_socket_addr(const socket_info_t *sock, bool local,
+                        char *buf, size_t buflen)
+{
+    if (sock == NULL || buf == NULL || buflen == 0) {
+        return;
+    }
+
+    const net_addr_t *addr = local ? &sock->local_addr : &sock->remote_addr;
+    uint16_t port = local ? sock->local_port : sock->remote_port;
+
+    if (sock->family == AF_UNIX) {
+        /* Only the bound end has a path; "*" like ss(8) otherwise */
+        const char *path = (local && sock->path[0] != '\0') ? sock->path : "*";
+        snprintf(buf, buflen, "%s", path);
+        return;
+    }
+
+    if (sock->family == AF_INET6) {
+        char ip_str[INET6_ADDRSTRLEN];
+        if (inet_ntop(AF_INET6, addr->v6, ip_str, sizeof(ip_str)) == NULL) {
+            snprintf(buf, buflen, "?");
+            return;
+        }
+        snprintf(buf, buflen, "[%s]:%u", ip_str, port);
+        return;
+    }
+
+    format_ip_port(addr->v4, port, buf, buflen);
+}
+
+/*
+ * Short protocol label: TCP, TCP6, UDP, UDP6 or UNIX.
+ */
+const char *socket_proto_to_string(const socket_info_t *sock)
+{
+    if (sock == NULL) {
+        return "UNKNOWN";
+    }
+
+    bool v6 = (sock->family == AF_INET6);
+
+    switch (sock->proto) {
+    case SOCK_PROTO_TCP:  return v6 ? "TCP6" : "TCP";
+    case SOCK_PROTO_UDP:  return v6 ? "UDP6" : "UDP";
+    case SOCK_PROTO_UNIX: return "UNIX";
+    default:              return "UNKNOWN";
+    }
+}
+
+/* Forwards matching rows of each table to a visitor */
+typedef struct {
+    diag_visit_fn visit;
+    void *ctx;
+    int delivered;      /* Rows passed on from the current table */
+    bool stopped;       /* visit asked to stop */
+    char *text_buf;     /* NET_READ_SIZE, allocated on first text read */
+    int netns_dirfd;    /* /proc/<pid> of another namespace, or -1 */
+} table_walk_t;
+
+static int forward_row(const socket_info_t *sock, int value, void *ctx)
+{
+    table_walk_t *walk = ctx;
+
+    walk->delivered++;
+    if (walk->visit(sock, value, walk->ctx) != 0) {
+        walk->stopped = true;
+        return 1;
+    }
+    return 0;
+}
+
+/* Inode filter between parse_net_table() and the table walk */
+typedef struct {
+    const id_map_t *target_inodes;
+    sock_proto_t proto;
+    table_walk_t *walk;
+} text_filter_t;
+
+static int filter_text_row(socket_info_t *sock, void *ctx)
+{
+    text_filter_t *f = ctx;
+
+    int value;
+    if (!id_map_get(f->target_inodes, sock->inode, &value)) {
+        return 0;
+    }
+
+    sock->proto = f->proto;
+    return forward_row(sock, value, f->walk);
+}
+
+/*
+ * Parse one /proc/net table, passing rows whose inode is in target_inodes
+ * on to the walk along with the inode's map value. The table is read in
+ * NET_READ_SIZE chunks through one buffer shared by every table of the
+ * walk. A missing table (e.g. IPv6 disabled) counts as empty. The table
+ * is the caller's, or the namespace's under walk->netns_dirfd.
+ * Returns 0 on success, -1 on error.
  */
-static bool inode_in_set(unsigned long inode, unsigned long *set, int set_size)
+static int parse_net_file(size_t t, const id_map_t *target_inodes,
+                          table_walk_t *walk)
 {
-    if (set == NULL || set_size == 0) {
-        return false;
+    if (walk->text_buf == NULL) {
+        walk->text_buf = malloc(NET_READ_SIZE);
+        if (walk->text_buf == NULL) {
+            return -1;
+        }
     }
 
-    for (int i = 0; i < set_size; i++) {
-        if (set[i] == inode) {
-            return true;
+    char path[PATH_MAX];
+    int dirfd = walk->netns_dirfd;
+    if (dirfd >= 0) {
+        snprintf(path, sizeof(path), "%s", net_tables[t].path);
+    } else {
+        int len = snprintf(path, sizeof(path), "%s/%s", proc_get_root(),
+                           net_tables[t].path);
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            errno = ENAMETOOLONG;
+            return -1;
         }
+        dirfd = AT_FDCWD;
     }
 
-    return false;
+    text_filter_t f = { .target_inodes = target_inodes,
+                        .proto = net_tables[t].proto, .walk = walk };
+    if (parse_net_table(dirfd, path,
+                        net_tables[t].parse_row, walk->text_buf,
+                        NET_READ_SIZE, filter_text_row, &f) != 0) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    return 0;
 }
 
 /*
- * Parse /proc/net/tcp or /proc/net/udp for matching socket inodes.
+ * Stream matching sockets of one table with the selected backend.
+ *
+ * In auto mode a failed netlink dump (no sock_diag, diag module for this
+ * family not loaded, or EPERM under seccomp) falls back to the text table.
+ * Rows already handed to the visitor cannot be taken back, so a dump that
+ * fails after delivering any is an error rather than a fallback. Another
+ * namespace's tables are always text: sock_diag answers for ours.
  * Returns 0 on success, -1 on error.
  */
-static int parse_net_file(const char *path, bool is_tcp,
-                          unsigned long *target_inodes, int inode_count,
-                          socket_info_t **results, int *result_count)
+static int collect_table(size_t t, const id_map_t *socket_inodes,
+                         table_walk_t *walk)
 {
-    *results = NULL;
-    *result_count = 0;
+    /* sock_diag answers for the live kernel, not a tree under another root */
+    if (walk->netns_dirfd < 0 &&
+        (selected_backend == NET_BACKEND_NETLINK ||
+         (selected_backend == NET_BACKEND_AUTO && proc_root_is_live()))) {
+        uint32_t states = (net_tables[t].family == AF_UNIX)
+                              ? ~0U : DIAG_OWNABLE_STATES;
+
+        walk->delivered = 0;
+        if (diag_dump_sockets(net_tables[t].family, net_tables[t].ipproto,
+                              states, socket_inodes,
+                              forward_row, walk) == 0) {
+            return 0;
+        }
+
+        if (selected_backend == NET_BACKEND_NETLINK || errno == ENOMEM ||
+            walk->delivered > 0) {
+            return -1;
+        }
+    }
+
+    return parse_net_file(t, socket_inodes, walk);
+}
 
-    if (target_inodes == NULL || inode_count == 0) {
+/*
+ * Look up every socket table of one network namespace once against a
+ * prepared inode set, passing each match to visit until it asks to stop.
+ * netns_dirfd is /proc/<pid> of a process in another namespace, or -1
+ * for the caller's.
+ * Returns 0 when done, 1 if visit stopped the walk, -1 on error.
+ */
+static int walk_tables(const id_map_t *socket_inodes, int netns_dirfd,
+                       diag_visit_fn visit, void *ctx)
+{
+    if (socket_inodes == NULL || socket_inodes->count == 0) {
         return 0;
     }
 
-    FILE *fp = fopen(path, "r");
-    if (fp == NULL) {
-        return -1;
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_NET);
+    table_walk_t walk = { .visit = visit, .ctx = ctx,
+                          .netns_dirfd = netns_dirfd };
+    int ret = 0;
+
+    for (size_t t = 0; t < NET_TABLE_COUNT && !walk.stopped; t++) {
+        if (collect_table(t, socket_inodes, &walk) != 0) {
+            ret = -1;
+            break;
+        }
     }
 
-    int capacity = INITIAL_SOCKET_CAPACITY;
-    socket_info_t *array = malloc(capacity * sizeof(socket_info_t));
-    if (array == NULL) {
-        fclose(fp);
-        return -1;
+    int saved_errno = errno;
+    free(walk.text_buf);
+    STATS_PHASE_END(prev);
+    errno = saved_errno;
+    return (ret == 0 && walk.stopped) ? 1 : ret;
+}
+
+/*
+ * Inode of the caller's network namespace, or 0 if it can't be read
+ * (e.g. a proc root without self/).
+ */
+static unsigned long read_caller_netns(void)
+{
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/self/ns/net",
+                       proc_get_root());
+    struct stat st;
+    if (len < 0 || (size_t)len >= sizeof(path) || stat(path, &st) != 0) {
+        return 0;
     }
+    return (unsigned long)st.st_ino;
+}
+
+/* Start an empty namespace list for a walk made from this namespace */
+static int netns_list_init(netns_list_t *list)
+{
+    memset(list, 0, sizeof(*list));
+    list->caller_netns = read_caller_netns();
+    return id_map_init(&list->heads, 4);
+}
 
-    int count = 0;
-    char line[512];
+static void netns_list_free(netns_list_t *list)
+{
+    id_map_free(&list->heads);
+    free(list->members);
+    memset(list, 0, sizeof(*list));
+}
 
-    if (fgets(line, sizeof(line), fp) == NULL) {
-        free(array);
-        fclose(fp);
+/*
+ * Record pid as a way into namespace netns unless it is the caller's or
+ * unknown. Returns 0 on success, -1 on allocation failure.
+ */
+static int netns_list_add(netns_list_t *list, unsigned long netns, pid_t pid)
+{
+    if (netns == 0 || list->caller_netns == 0 ||
+        netns == list->caller_netns) {
         return 0;
     }
 
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        unsigned int slot;
-        char local_addr[64], remote_addr[64];
-        unsigned int state;
-        unsigned int uid;
-        unsigned long inode;
+    if (list->count == list->capacity) {
+        int capacity = (list->capacity > 0) ? list->capacity * 2 : 4;
+        netns_member_t *members = realloc(list->members,
+                                          capacity * sizeof(netns_member_t));
+        if (members == NULL) {
+            return -1;
+        }
+        list->members = members;
+        list->capacity = capacity;
+    }
 
-        /*
-         * /proc/net/tcp format:
-         * sl local_address rem_address st tx:rx tr:tm retrnsmt uid timeout inode
-         * We extract: local_address, rem_address, st (state), inode
-         */
-        int matched = sscanf(line,
-                            " %u: %63s %63s %X %*s %*s %*s %u %*d %lu",
-                            &slot, local_addr, remote_addr, &state,
-                            &uid, &inode);
+    int head = -1;
+    id_map_get(&list->heads, netns, &head);
+
+    int slot = list->count++;
+    list->members[slot].netns = netns;
+    list->members[slot].pid = pid;
+    list->members[slot].next = head;
+    return id_map_put(&list->heads, netns, slot);
+}
+
+/*
+ * Walk the tables of namespace netns through the first of the members
+ * chained from head that is still alive and still in it.
+ * Returns walk_tables()'s result; 0 if no member could be used.
+ */
+static int walk_member_tables(const netns_list_t *list, int head,
+                              const id_map_t *socket_inodes,
+                              diag_visit_fn visit, void *ctx)
+{
+    for (int m = head; m >= 0; m = list->members[m].next) {
+        const netns_member_t *member = &list->members[m];
 
-        if (matched < 6) {
+        /* The PID may have been reused, or the process moved by setns() */
+        proc_handle_t h;
+        unsigned long netns = 0;
+        if (proc_handle_open(&h, member->pid) != 0) {
+            continue;
+        }
+        if (proc_handle_netns(&h, &netns) != 0 || netns != member->netns) {
+            proc_handle_close(&h);
             continue;
         }
 
-        if (!inode_in_set(inode, target_inodes, inode_count)) {
+        int ret = walk_tables(socket_inodes, h.dirfd, visit, ctx);
+        int saved_errno = errno;
+        proc_handle_close(&h);
+        errno = saved_errno;
+        return ret;
+    }
+    return 0;
+}
+
+/*
+ * Walk the caller's tables, then those of each recorded namespace in the
+ * order it was first recorded, each once.
+ * Returns 0 when done or visit stopped the walk, -1 on error.
+ */
+static int walk_namespaces(const netns_list_t *list,
+                           const id_map_t *socket_inodes,
+                           diag_visit_fn visit, void *ctx)
+{
+    int ret = walk_tables(socket_inodes, -1, visit, ctx);
+
+    /* A namespace's first member is the one its chain ends at */
+    for (int i = 0; ret == 0 && i < list->count; i++) {
+        int head = -1;
+        if (list->members[i].next >= 0 ||
+            !id_map_get(&list->heads, list->members[i].netns, &head)) {
             continue;
         }
+        ret = walk_member_tables(list, head, socket_inodes, visit, ctx);
+    }
+    return (ret < 0) ? -1 : 0;
+}
+
+void net_set_backend(net_backend_t backend)
+{
+    selected_backend = backend;
+}
+
+net_backend_t net_get_backend(void)
+{
+    return selected_backend;
+}
+
+/* for_each_fd() visitor state for collecting socket inodes */
+typedef struct {
+    id_map_t *inodes;
+    bool failed;        /* Allocation failed; errno is set */
+} inode_collector_t;
+
+/*
+ * Record each socket FD as inode -> fd. Stops the walk on allocation
+ * failure.
+ */
+static int collect_socket_inode(const fd_entry_t *entry, const char *target,
+                                void *ctx)
+{
+    inode_collector_t *c = ctx;
+    (void)target;
+
+    if (entry->type == FD_TYPE_SOCKET && entry->socket_inode != 0 &&
+        id_map_put(c->inodes, entry->socket_inode, entry->fd) != 0) {
+        c->failed = true;
+        return 1;
+    }
+    return 0;
+}
+
+/* Adapts a socket_visit_fn to the table walker's inode -> fd values */
+typedef struct {
+    socket_visit_fn visit;
+    void *ctx;
+} socket_walk_t;
+
+static int forward_socket(const socket_info_t *sock, int fd, void *ctx)
+{
+    socket_walk_t *walk = ctx;
+    return walk->visit(sock, fd, walk->ctx);
+}
+
+/*
+ * Implementation of for_each_socket_at() - see net.h for API docs.
+ */
+int for_each_socket_at(const proc_handle_t *h, socket_visit_fn visit,
+                       void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*
+     * Build the socket inode set once and share it between all table
+     * passes, so each table row costs one O(1) lookup instead of a scan
+     * over every socket the process owns. Only socket FDs are kept.
+     */
+    id_map_t socket_inodes;
+    if (id_map_init(&socket_inodes, INITIAL_SOCKET_CAPACITY) != 0) {
+        return -1;
+    }
+
+    inode_collector_t c = { .inodes = &socket_inodes };
+    if (for_each_fd_at(h, collect_socket_inode, &c) != 0 || c.failed) {
+        int saved_errno = errno;
+        id_map_free(&socket_inodes);
+        errno = saved_errno;
+        return -1;
+    }
+
+    /* The caller's tables always, the target's too when it's elsewhere */
+    socket_walk_t walk = { .visit = visit, .ctx = ctx };
+    int ret = walk_tables(&socket_inodes, -1, forward_socket, &walk);
+
+    unsigned long caller_netns = 0;
+    unsigned long netns = 0;
+    if (ret == 0 && (caller_netns = read_caller_netns()) != 0 &&
+        proc_handle_netns(h, &netns) == 0 && netns != caller_netns) {
+        ret = walk_tables(&socket_inodes, h->dirfd, forward_socket, &walk);
+    }
+
+    int saved_errno = errno;
+    id_map_free(&socket_inodes);
+    errno = saved_errno;
+    return (ret < 0) ? -1 : 0;
+}
+
+/* Growing array filled by collect_socket() */
+typedef struct {
+    socket_info_t *array;
+    int count;
+    int capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} socket_collector_t;
+
+/*
+ * for_each_socket() visitor that appends a copy of the socket. Stops the
+ * walk on allocation failure.
+ */
+static int collect_socket(const socket_info_t *sock, int fd, void *ctx)
+{
+    socket_collector_t *c = ctx;
+    (void)fd;
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = (c->capacity > 0) ? c->capacity * 2
+                                             : INITIAL_SOCKET_CAPACITY;
+        socket_info_t *new_array = realloc(c->array,
+                                           new_capacity * sizeof(socket_info_t));
+        if (new_array == NULL) {
+            c->failed = true;
+            return 1;
+        }
+        c->array = new_array;
+        c->capacity = new_capacity;
+    }
 
-        uint32_t local_ip, remote_ip;
-        uint16_t local_port, remote_port;
+    c->array[c->count++] = *sock;
+    return 0;
+}
 
-        if (parse_hex_addr(local_addr, &local_ip, &local_port) != 0 ||
-            parse_hex_addr(remote_addr, &remote_ip, &remote_port) != 0) {
+/*
+ * Implementation of find_process_sockets_at() - see net.h for API docs.
+ */
+int find_process_sockets_at(const proc_handle_t *h, socket_info_t **sockets,
+                            int *count)
+{
+    *sockets = NULL;
+    *count = 0;
+
+    socket_collector_t c = {0};
+    if (for_each_socket_at(h, collect_socket, &c) != 0 || c.failed) {
+        int saved_errno = errno;
+        free(c.array);
+        errno = saved_errno;
+        return -1;
+    }
+
+    if (c.count == 0) {
+        free(c.array);
+        return 0;
+    }
+
+    /* Shrink to exact size to minimize memory footprint */
+    socket_info_t *final = realloc(c.array, c.count * sizeof(socket_info_t));
+    if (final != NULL) {
+        c.array = final;
+    }
+
+    *sockets = c.array;
+    *count = c.count;
+    return 0;
+}
+
+/*
+ * Implementation of socket_snapshot_init() - see net.h for API docs.
+ */
+int socket_snapshot_init(socket_snapshot_t *snap)
+{
+    if (snap == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(snap, 0, sizeof(*snap));
+    if (netns_list_init(&snap->namespaces) != 0) {
+        return -1;
+    }
+    return id_map_init(&snap->heads, INITIAL_SOCKET_CAPACITY);
+}
+
+/*
+ * Implementation of socket_snapshot_add_fds() - see net.h for API docs.
+ */
+int socket_snapshot_add_fds(socket_snapshot_t *snap, const fd_list_t *fds,
+                            int owner)
+{
+    if (snap == NULL || fds == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < fds->count; i++) {
+        const fd_entry_t *entry = &fds->entries[i];
+        if (entry->type != FD_TYPE_SOCKET || entry->socket_inode == 0) {
+            continue;
+        }
+
+        /*
+         * An owner's refs are added together, so if it already holds this
+         * inode the newest ref to it is that owner's.
+         */
+        int head = -1;
+        if (id_map_get(&snap->heads, entry->socket_inode, &head) &&
+            snap->refs[head].owner == owner) {
             continue;
         }
 
-        array[count].is_tcp = is_tcp;
-        array[count].local_addr = local_ip;
-        array[count].local_port = local_port;
-        array[count].remote_addr = remote_ip;
-        array[count].remote_port = remote_port;
-        array[count].state = (tcp_state_t)state;
-        array[count].inode = inode;
-        count++;
-
-        /* Double capacity when full (amortized O(1) insertion) */
-        if (count == capacity) {
-            capacity *= 2;
-            socket_info_t *new_array = realloc(array,
-                                               capacity * sizeof(socket_info_t));
-            if (new_array == NULL) {
-                free(array);
-                fclose(fp);
+        if (snap->ref_count == snap->ref_capacity) {
+            int capacity = (snap->ref_capacity > 0) ? snap->ref_capacity * 2
+                                                    : INITIAL_SOCKET_CAPACITY;
+            socket_ref_t *refs = realloc(snap->refs,
+                                         capacity * sizeof(socket_ref_t));
+            if (refs == NULL) {
                 return -1;
             }
-            array = new_array;
+            snap->refs = refs;
+            snap->ref_capacity = capacity;
+        }
+
+        int slot = snap->ref_count++;
+        snap->refs[slot].owner = owner;
+        snap->refs[slot].fd = entry->fd;
+        snap->refs[slot].next = head;
+        if (id_map_put(&snap->heads, entry->socket_inode, slot) != 0) {
+            return -1;
         }
     }
 
-    fclose(fp);
+    return 0;
+}
 
-    if (count == 0) {
-        free(array);
-        *results = NULL;
-        *result_count = 0;
+/*
+ * Implementation of socket_snapshot_add_netns() - see net.h for API docs.
+ */
+int socket_snapshot_add_netns(socket_snapshot_t *snap, unsigned long netns,
+                              pid_t pid)
+{
+    if (snap == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    return netns_list_add(&snap->namespaces, netns, pid);
+}
+
+/* Fans each matching table row out to its owners */
+typedef struct {
+    const socket_snapshot_t *snap;
+    socket_owner_visit_fn visit;
+    void *ctx;
+} snapshot_walk_t;
+
+/*
+ * Table walker visitor: pass the row to every owner chained from head,
+ * the row inode's newest ref.
+ */
+static int forward_owners(const socket_info_t *sock, int head, void *ctx)
+{
+    snapshot_walk_t *walk = ctx;
+
+    for (int ref = head; ref >= 0; ref = walk->snap->refs[ref].next) {
+        const socket_ref_t *r = &walk->snap->refs[ref];
+        if (walk->visit(sock, r->owner, r->fd, walk->ctx) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Implementation of socket_snapshot_walk() - see net.h for API docs.
+ */
+int socket_snapshot_walk(const socket_snapshot_t *snap,
+                         socket_owner_visit_fn visit, void *ctx)
+{
+    if (snap == NULL || visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    snapshot_walk_t walk = { .snap = snap, .visit = visit, .ctx = ctx };
+    return walk_namespaces(&snap->namespaces, &snap->heads, forward_owners,
+                           &walk);
+}
+
+/*
+ * Implementation of socket_snapshot_free() - see net.h for API docs.
+ */
+void socket_snapshot_free(socket_snapshot_t *snap)
+{
+    if (snap == NULL) {
+        return;
+    }
+
+    id_map_free(&snap->heads);
+    free(snap->refs);
+    netns_list_free(&snap->namespaces);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/* socket_snapshot_walk() visitor that appends the socket for owner 0 */
+static int collect_owned_socket(const socket_info_t *sock, int owner, int fd,
+                                void *ctx)
+{
+    (void)owner;
+    return collect_socket(sock, fd, ctx);
+}
+
+/*
+ * Implementation of find_fd_list_sockets() - see net.h for API docs.
+ */
+int find_fd_list_sockets(const fd_list_t *fds, socket_info_t **sockets,
+                         int *count)
+{
+    if (fds == NULL || sockets == NULL || count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *sockets = NULL;
+    *count = 0;
+
+    socket_snapshot_t snap;
+    if (socket_snapshot_init(&snap) != 0) {
+        return -1;
+    }
+
+    socket_collector_t c = {0};
+    if (socket_snapshot_add_fds(&snap, fds, 0) != 0 ||
+        socket_snapshot_walk(&snap, collect_owned_socket, &c) != 0 ||
+        c.failed) {
+        int saved_errno = errno;
+        free(c.array);
+        socket_snapshot_free(&snap);
+        errno = saved_errno;
+        return -1;
+    }
+
+    socket_snapshot_free(&snap);
+
+    if (c.count == 0) {
+        free(c.array);
         return 0;
     }
 
-    /* Shrink to exact size to minimize memory footprint */
-    socket_info_t *final = realloc(array, count * sizeof(socket_info_t));
+    socket_info_t *final = realloc(c.array, c.count * sizeof(socket_info_t));
     if (final != NULL) {
-        array = final;
+        c.array = final;
     }
 
-    *results = array;
-    *result_count = count;
+    *sockets = c.array;
+    *count = c.count;
     return 0;
 }
 
 /*
- * Implementation of find_process_sockets() - see net.h for API docs.
+ * Pid-based entry points: open a handle for the duration of one call.
  */
+int for_each_socket(pid_t pid, socket_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        return -1;
+    }
+
+    int ret = for_each_socket_at(&h, visit, ctx);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
 int find_process_sockets(pid_t pid, socket_info_t **sockets, int *count)
 {
     *sockets = NULL;
     *count = 0;
 
-    fd_entry_t *fds = NULL;
-    int fd_count = 0;
-
-    if (enumerate_fds(pid, &fds, &fd_count) != 0) {
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
         return -1;
     }
 
-    /* Extract socket inodes for correlation with /proc/net files */
-    unsigned long *socket_inodes = NULL;
-    int inode_count = 0;
+    int ret = find_process_sockets_at(&h, sockets, count);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
 
-    if (fd_count > 0) {
-        socket_inodes = malloc(fd_count * sizeof(unsigned long));
-        if (socket_inodes == NULL) {
-            fd_entries_free(fds);
+/*
+ * Free socket array returned by find_process_sockets().
+ */
+void socket_list_free(socket_info_t *sockets)
+{
+    free(sockets);
+}
+
+/*
+ * One (pid, fd) reference to a socket inode. References to the same inode
+ * are chained through next so shared sockets keep every owner.
+ */
+typedef struct {
+    pid_t pid;
+    int fd;
+    int name_index;     /* Index into the process name table */
+    int next;           /* Next reference to the same inode, or -1 */
+} owner_ref_t;
+
+/* Growable state for the system-wide walk */
+typedef struct {
+    id_map_t heads;             /* inode -> first owner_ref_t index */
+    owner_ref_t *refs;
+    int ref_count;
+    int ref_capacity;
+    char (*names)[PROC_NAME_MAX];
+    int name_count;
+    int name_capacity;
+    netns_list_t namespaces;    /* Of processes that own sockets */
+} owner_index_t;
+
+/*
+ * Record that pid holds socket inode via fd.
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int owner_index_add(owner_index_t *index, unsigned long inode,
+                           pid_t pid, int fd, int name_index)
+{
+    if (index->ref_count == index->ref_capacity) {
+        int capacity = index->ref_capacity * 2;
+        owner_ref_t *refs = realloc(index->refs,
+                                    capacity * sizeof(owner_ref_t));
+        if (refs == NULL) {
             return -1;
         }
+        index->refs = refs;
+        index->ref_capacity = capacity;
+    }
+
+    int head = -1;
+    id_map_get(&index->heads, inode, &head);
+
+    int slot = index->ref_count++;
+    index->refs[slot].pid = pid;
+    index->refs[slot].fd = fd;
+    index->refs[slot].name_index = name_index;
+    index->refs[slot].next = head;
+
+    return id_map_put(&index->heads, inode, slot);
+}
+
+/* for_each_fd() visitor state for one process of the host-wide walk */
+typedef struct {
+    owner_index_t *index;
+    const proc_handle_t *handle;
+    int name_index;     /* -1 until the process's first socket */
+    bool failed;        /* Allocation failed; errno is set */
+} owner_walk_t;
+
+/*
+ * Add one socket FD to the index. Stops the walk on allocation failure.
+ */
+static int index_socket_fd(const fd_entry_t *entry, const char *target,
+                           void *ctx)
+{
+    owner_walk_t *walk = ctx;
+    owner_index_t *index = walk->index;
+    (void)target;
 
-        for (int i = 0; i < fd_count; i++) {
-            if (fds[i].is_socket) {
-                socket_inodes[inode_count++] = fds[i].socket_inode;
+    if (entry->type != FD_TYPE_SOCKET || entry->socket_inode == 0) {
+        return 0;
+    }
+
+    /* Name is only read for processes that actually own sockets */
+    if (walk->name_index < 0) {
+        if (index->name_count == index->name_capacity) {
+            int capacity = index->name_capacity * 2;
+            char (*names)[PROC_NAME_MAX] =
+                realloc(index->names, capacity * sizeof(*names));
+            if (names == NULL) {
+                walk->failed = true;
+                return 1;
             }
+            index->names = names;
+            index->name_capacity = capacity;
         }
+        walk->name_index = index->name_count++;
+        read_process_name_at(walk->handle, index->names[walk->name_index],
+                             PROC_NAME_MAX);
     }
 
-    fd_entries_free(fds);
+    if (owner_index_add(index, entry->socket_inode, walk->handle->pid,
+                        entry->fd,
+                        walk->name_index) != 0) {
+        walk->failed = true;
+        return 1;
+    }
+    return 0;
+}
 
-    if (inode_count == 0) {
-        free(socket_inodes);
+/*
+ * Add every socket FD of one process to the index. Processes that vanish
+ * or deny access are skipped, like individual FDs in enumerate_fds().
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int index_process_sockets(owner_index_t *index, pid_t pid)
+{
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
         return 0;
     }
 
-    socket_info_t *tcp_sockets = NULL;
-    int tcp_count = 0;
+    /* The name is read through the same handle, so it matches the FDs */
+    owner_walk_t walk = { .index = index, .handle = &h, .name_index = -1 };
+    for_each_fd_at(&h, index_socket_fd, &walk);
+
+    /* Only a process that owns sockets can need its namespace read */
+    unsigned long netns = 0;
+    if (!walk.failed && walk.name_index >= 0 &&
+        proc_handle_netns(&h, &netns) == 0 &&
+        netns_list_add(&index->namespaces, netns, pid) != 0) {
+        walk.failed = true;
+    }
+    proc_handle_close(&h);
 
-    if (parse_net_file(PROC_NET_TCP, true, socket_inodes, inode_count,
-                      &tcp_sockets, &tcp_count) != 0) {
-        free(socket_inodes);
+    return walk.failed ? -1 : 0;
+}
+
+/*
+ * Walk every /proc/<pid>/fd once and build the inode -> owners index.
+ * Returns 0 on success, -1 on error.
+ */
+static int build_owner_index(owner_index_t *index)
+{
+    memset(index, 0, sizeof(*index));
+
+    if (netns_list_init(&index->namespaces) != 0 ||
+        id_map_init(&index->heads, INITIAL_SOCKET_CAPACITY) != 0) {
         return -1;
     }
 
-    socket_info_t *udp_sockets = NULL;
-    int udp_count = 0;
+    index->ref_capacity = INITIAL_SOCKET_CAPACITY;
+    index->refs = malloc(index->ref_capacity * sizeof(owner_ref_t));
+    index->name_capacity = INITIAL_SOCKET_CAPACITY;
+    index->names = malloc(index->name_capacity * sizeof(*index->names));
+    if (index->refs == NULL || index->names == NULL) {
+        return -1;
+    }
 
-    if (parse_net_file(PROC_NET_UDP, false, socket_inodes, inode_count,
-                      &udp_sockets, &udp_count) != 0) {
-        free(socket_inodes);
-        socket_list_free(tcp_sockets);
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_LIST);
+    DIR *dir = opendir(proc_get_root());
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (dir == NULL) {
+        STATS_PHASE_END(prev);
         return -1;
     }
 
-    free(socket_inodes);
+    int ret = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        pid_t pid = parse_pid(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+        STATS_COUNT(STATS_ENTRIES, 1);
 
-    int total_count = tcp_count + udp_count;
+        if (index_process_sockets(index, pid) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    int saved_errno = errno;
+    closedir(dir);
+    STATS_PHASE_END(prev);
+    errno = saved_errno;
+    return ret;
+}
+
+static void owner_index_free(owner_index_t *index)
+{
+    id_map_free(&index->heads);
+    free(index->refs);
+    free(index->names);
+    netns_list_free(&index->namespaces);
+}
+
+/* Output array filled by collect_owners(), sized to index->ref_count */
+typedef struct {
+    const owner_index_t *index;
+    socket_owner_t *array;
+    int count;
+} owner_collector_t;
+
+/*
+ * Table walker visitor: emit one owner record per (pid, fd) reference to
+ * the row's inode. head is the inode's first reference.
+ */
+static int collect_owners(const socket_info_t *sock, int head, void *ctx)
+{
+    owner_collector_t *c = ctx;
+    const owner_index_t *index = c->index;
 
-    if (total_count == 0) {
-        socket_list_free(tcp_sockets);
-        socket_list_free(udp_sockets);
+    /* Guard against an inode listed in both tables */
+    for (int ref = head; ref >= 0 && c->count < index->ref_count;
+         ref = index->refs[ref].next) {
+        const owner_ref_t *r = &index->refs[ref];
+        socket_owner_t *owner = &c->array[c->count++];
+        owner->socket = *sock;
+        owner->pid = r->pid;
+        owner->fd = r->fd;
+        memcpy(owner->name, index->names[r->name_index], PROC_NAME_MAX);
+    }
+    return 0;
+}
+
+/*
+ * Implementation of find_all_socket_owners() - see net.h for API docs.
+ */
+int find_all_socket_owners(socket_owner_t **owners, int *count)
+{
+    *owners = NULL;
+    *count = 0;
+
+    owner_index_t index;
+    if (build_owner_index(&index) != 0) {
+        owner_index_free(&index);
+        return -1;
+    }
+
+    if (index.ref_count == 0) {
+        owner_index_free(&index);
         return 0;
     }
 
-    socket_info_t *merged = malloc(total_count * sizeof(socket_info_t));
-    if (merged == NULL) {
-        socket_list_free(tcp_sockets);
-        socket_list_free(udp_sockets);
+    /* A socket has at most ref_count owners in total across all rows */
+    socket_owner_t *array = malloc(index.ref_count * sizeof(socket_owner_t));
+    if (array == NULL) {
+        owner_index_free(&index);
         return -1;
     }
 
-    if (tcp_count > 0) {
-        memcpy(merged, tcp_sockets, tcp_count * sizeof(socket_info_t));
-        socket_list_free(tcp_sockets);
+    /* Each namespace's tables are parsed exactly once for the whole host */
+    owner_collector_t c = { .index = &index, .array = array };
+    if (walk_namespaces(&index.namespaces, &index.heads, collect_owners,
+                        &c) != 0) {
+        int saved_errno = errno;
+        free(array);
+        owner_index_free(&index);
+        errno = saved_errno;
+        return -1;
     }
 
-    if (udp_count > 0) {
-        memcpy(merged + tcp_count, udp_sockets,
-               udp_count * sizeof(socket_info_t));
-        socket_list_free(udp_sockets);
+    owner_index_free(&index);
+
+    if (c.count == 0) {
+        free(array);
+        return 0;
     }
 
-    *sockets = merged;
-    *count = total_count;
+    *owners = array;
+    *count = c.count;
     return 0;
 }
 
 /*
- * Free socket array returned by find_process_sockets().
+ * Free owner array returned by find_all_socket_owners().
  */
-void socket_list_free(socket_info_t *sockets)
+void socket_owner_list_free(socket_owner_t *owners)
 {
-    free(sockets);
-}
\ No newline at end of file
+    free(owners);
+}
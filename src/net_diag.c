@@ -0,0 +1,231 @@
+/*
+ * net_diag.c - NETLINK_SOCK_DIAG socket enumeration
+ *
+ * Sends one SOCK_DIAG_BY_FAMILY dump request per family/protocol and
+ * converts the binary inet_diag_msg / unix_diag_msg replies into the same
+ * socket_info_t the /proc/net text parser produces.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/unix_diag.h>
+#include "net_diag.h"
+#include "stats.h"
+#include "budget.h"
+
+/* Receive buffer; the kernel packs many records into each datagram */
+#define DIAG_RECV_BUFFER 65536
+
+/* Request message: netlink header followed by the family-specific body */
+typedef struct {
+    struct nlmsghdr nlh;
+    union {
+        struct inet_diag_req_v2 inet;
+        struct unix_diag_req unix_req;
+    } body;
+} diag_request_t;
+
+static void convert_inet(const struct inet_diag_msg *msg, int ipproto,
+                         socket_info_t *sock)
+{
+    memset(sock, 0, sizeof(*sock));
+    sock->proto = (ipproto == IPPROTO_TCP) ? SOCK_PROTO_TCP : SOCK_PROTO_UDP;
+    sock->family = msg->idiag_family;
+
+    /* idiag_src/dst are __be32[4]: already network order like s_addr */
+    memcpy(sock->local_addr.v6, msg->id.idiag_src,
+           sizeof(sock->local_addr.v6));
+    memcpy(sock->remote_addr.v6, msg->id.idiag_dst,
+           sizeof(sock->remote_addr.v6));
+    if (sock->family == AF_INET) {
+        memset(sock->local_addr.v6 + 4, 0, sizeof(sock->local_addr.v6) - 4);
+        memset(sock->remote_addr.v6 + 4, 0, sizeof(sock->remote_addr.v6) - 4);
+    }
+
+    sock->local_port = ntohs(msg->id.idiag_sport);
+    sock->remote_port = ntohs(msg->id.idiag_dport);
+    sock->state = (tcp_state_t)msg->idiag_state;
+    sock->inode = msg->idiag_inode;
+}
+
+static void convert_unix(const struct unix_diag_msg *msg, size_t len,
+                         socket_info_t *sock)
+{
+    memset(sock, 0, sizeof(*sock));
+    sock->proto = SOCK_PROTO_UNIX;
+    sock->family = AF_UNIX;
+    sock->state = (tcp_state_t)msg->udiag_state;
+    sock->inode = msg->udiag_ino;
+
+    /* Walk attributes for UNIX_DIAG_NAME (present only for bound sockets) */
+    const char *attrs = (const char *)(msg + 1);
+    size_t remaining = len - NLMSG_ALIGN(sizeof(*msg));
+
+    while (remaining >= sizeof(struct nlattr)) {
+        const struct nlattr *attr = (const struct nlattr *)attrs;
+        if (attr->nla_len < NLA_HDRLEN || attr->nla_len > remaining) {
+            break;
+        }
+
+        if (attr->nla_type == UNIX_DIAG_NAME) {
+            size_t name_len = attr->nla_len - NLA_HDRLEN;
+            const char *name = attrs + NLA_HDRLEN;
+
+            if (name_len >= sizeof(sock->path)) {
+                name_len = sizeof(sock->path) - 1;
+            }
+            memcpy(sock->path, name, name_len);
+            sock->path[name_len] = '\0';
+
+            /* Abstract names start with NUL; /proc/net/unix shows '@' */
+            if (name_len > 0 && sock->path[0] == '\0') {
+                sock->path[0] = '@';
+            }
+            break;
+        }
+
+        size_t step = NLA_ALIGN(attr->nla_len);
+        if (step > remaining) {
+            break;
+        }
+        attrs += step;
+        remaining -= step;
+    }
+}
+
+/*
+ * Send the dump request for one family/protocol.
+ * Returns 0 on success, -1 on error.
+ */
+static int send_request(int nl, int family, int ipproto, uint32_t states)
+{
+    diag_request_t req;
+    memset(&req, 0, sizeof(req));
+
+    req.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+    if (family == AF_UNIX) {
+        req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.body.unix_req));
+        req.body.unix_req.sdiag_family = AF_UNIX;
+        req.body.unix_req.udiag_states = states;
+        req.body.unix_req.udiag_show = UDIAG_SHOW_NAME;
+    } else {
+        req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.body.inet));
+        req.body.inet.sdiag_family = (uint8_t)family;
+        req.body.inet.sdiag_protocol = (uint8_t)ipproto;
+        req.body.inet.idiag_states = states;
+    }
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t sent = sendto(nl, &req, req.nlh.nlmsg_len, 0,
+                          (struct sockaddr *)&kernel, sizeof(kernel));
+    return (sent < 0) ? -1 : 0;
+}
+
+/*
+ * Implementation of diag_dump_sockets() - see net_diag.h for API docs.
+ */
+int diag_dump_sockets(int family, int ipproto, uint32_t states,
+                      const id_map_t *target_inodes,
+                      diag_visit_fn visit, void *ctx)
+{
+    int nl = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (nl < 0) {
+        return -1;
+    }
+
+    if (send_request(nl, family, ipproto, states) != 0) {
+        close(nl);
+        return -1;
+    }
+
+    char *buf = malloc(DIAG_RECV_BUFFER);
+    if (buf == NULL) {
+        close(nl);
+        return -1;
+    }
+
+    int ret = 0;
+    bool done = false;
+
+    while (!done) {
+        ssize_t len = recv(nl, buf, DIAG_RECV_BUFFER, 0);
+        STATS_COUNT(STATS_READS, 1);
+        BUDGET_CHARGE(1);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        STATS_COUNT(STATS_BYTES_READ, len);
+        if (len == 0) {
+            break;
+        }
+
+        int remaining = (int)len;
+        for (struct nlmsghdr *h = (struct nlmsghdr *)buf;
+             NLMSG_OK(h, remaining); h = NLMSG_NEXT(h, remaining)) {
+            if (h->nlmsg_type == NLMSG_DONE) {
+                done = true;
+                break;
+            }
+
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = NLMSG_DATA(h);
+                errno = (err->error < 0) ? -err->error : EPROTO;
+                ret = -1;
+                done = true;
+                break;
+            }
+
+            socket_info_t sock;
+            size_t payload = NLMSG_PAYLOAD(h, 0);
+
+            if (family == AF_UNIX) {
+                if (payload < sizeof(struct unix_diag_msg)) {
+                    continue;
+                }
+                convert_unix(NLMSG_DATA(h), payload, &sock);
+            } else {
+                if (payload < sizeof(struct inet_diag_msg)) {
+                    continue;
+                }
+                convert_inet(NLMSG_DATA(h), ipproto, &sock);
+            }
+            STATS_COUNT(STATS_ENTRIES, 1);
+
+            int value;
+            if (id_map_get(target_inodes, sock.inode, &value) &&
+                visit(&sock, value, ctx) != 0) {
+                done = true;
+                break;
+            }
+        }
+        /* The dump resumes where it left off; no lock is held meanwhile */
+        if (!done) {
+            BUDGET_YIELD();
+        }
+    }
+
+    free(buf);
+    close(nl);
+    return ret;
+}
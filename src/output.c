@@ -0,0 +1,638 @@
+/*
+ * output.c - Machine-readable record output (JSON Lines and binary)
+ *
+ * Records are encoded directly into the output buffer: integers with a
+ * hand-rolled decimal/little-endian encoder, strings escaped in runs. The
+ * buffer only reaches write(2) when it fills or on output_flush().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "output.h"
+#include "net.h"
+#include "proc_fd.h"
+#include "util.h"
+
+/* Type + fixed payload bytes per binary record (strings excluded) */
+#define BIN_PROCESS_FIXED (1 + 4 + 1 + 4 * 4 + 8 * 3 + 4 + 2)
+#define BIN_FD_FIXED (1 + 4 + 4 + 1 + 8 + 2)
+#define BIN_THREAD_FIXED (1 + 4 + 4 + 1 + 8 + 8 + 4 + 2)
+#define BIN_SOCKET_FIXED (1 + 4 + 4 + 1 + 1 + 1 + 2 + 2 + 16 + 16 + 8 + 2)
+#define BIN_ERROR_FIXED (1 + 4 + 4)
+#define BIN_USAGE_FIXED (18 * 8)
+#define BIN_MEMORY_FIXED (1 + 4 + BIN_USAGE_FIXED)
+#define BIN_MEM_FILE_FIXED (1 + 4 + 4 + BIN_USAGE_FIXED + 2)
+#define BIN_COUNTS_FIXED (1 + 4 + 4 + 4)
+
+/* Longest string a binary record can carry (u16 length prefix) */
+#define BIN_STRING_MAX 0xFFFF
+
+/*
+ * Write len bytes from data with write(2), retrying short writes.
+ * Returns 0 on success, -1 on error.
+ */
+static int write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int output_flush(output_t *out)
+{
+    if (out == NULL || out->buf == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (out->error != 0) {
+        out->len = 0;
+        errno = out->error;
+        return -1;
+    }
+
+    if (out->len > 0 && write_all(out->fd, out->buf, out->len) != 0) {
+        out->error = errno;
+        out->len = 0;
+        return -1;
+    }
+
+    out->len = 0;
+    return 0;
+}
+
+static void put_bytes(output_t *out, const void *data, size_t len)
+{
+    const char *src = data;
+
+    while (len > 0 && out->error == 0) {
+        if (out->len == OUTPUT_BUFFER_SIZE) {
+            output_flush(out);
+            continue;
+        }
+
+        size_t room = OUTPUT_BUFFER_SIZE - out->len;
+        size_t n = (len < room) ? len : room;
+        memcpy(out->buf + out->len, src, n);
+        out->len += n;
+        src += n;
+        len -= n;
+    }
+}
+
+static void put_char(output_t *out, char c)
+{
+    if (out->len == OUTPUT_BUFFER_SIZE) {
+        output_flush(out);
+    }
+    if (out->error == 0) {
+        out->buf[out->len++] = c;
+    }
+}
+
+static void put_literal(output_t *out, const char *s)
+{
+    put_bytes(out, s, strlen(s));
+}
+
+/* ---- JSON encoding ---- */
+
+static void put_u64_dec(output_t *out, unsigned long long value)
+{
+    char digits[20];
+    int n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    put_bytes(out, digits + sizeof(digits) - n, (size_t)n);
+}
+
+static void put_i64_dec(output_t *out, long long value)
+{
+    if (value < 0) {
+        put_char(out, '-');
+        put_u64_dec(out, 0ULL - (unsigned long long)value);
+        return;
+    }
+    put_u64_dec(out, (unsigned long long)value);
+}
+
+/*
+ * Append s as a quoted JSON string. Unescaped runs are copied in one go;
+ * quote, backslash and control characters are escaped. Bytes >= 0x80 are
+ * passed through unchanged (paths are normally UTF-8).
+ */
+static void put_json_string(output_t *out, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
+
+    put_char(out, '"');
+
+    for (const char *p = s; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        put_bytes(out, run, (size_t)(p - run));
+        run = p + 1;
+
+        switch (c) {
+        case '"':  put_literal(out, "\\\""); break;
+        case '\\': put_literal(out, "\\\\"); break;
+        case '\n': put_literal(out, "\\n"); break;
+        case '\r': put_literal(out, "\\r"); break;
+        case '\t': put_literal(out, "\\t"); break;
+        default: {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            put_bytes(out, esc, sizeof(esc));
+            break;
+        }
+        }
+    }
+
+    put_bytes(out, run, strlen(run));
+    put_char(out, '"');
+}
+
+/* ,"key": */
+static void put_json_key(output_t *out, const char *key)
+{
+    put_char(out, ',');
+    put_char(out, '"');
+    put_literal(out, key);
+    put_char(out, '"');
+    put_char(out, ':');
+}
+
+static void json_int(output_t *out, const char *key, long long value)
+{
+    put_json_key(out, key);
+    put_i64_dec(out, value);
+}
+
+static void json_uint(output_t *out, const char *key, unsigned long long value)
+{
+    put_json_key(out, key);
+    put_u64_dec(out, value);
+}
+
+static void json_str(output_t *out, const char *key, const char *value)
+{
+    put_json_key(out, key);
+    put_json_string(out, value);
+}
+
+static void json_bool(output_t *out, const char *key, bool value)
+{
+    put_json_key(out, key);
+    put_literal(out, value ? "true" : "false");
+}
+
+/* {"type":"<type>","pid":<pid> */
+static void json_begin(output_t *out, const char *type, pid_t pid)
+{
+    put_literal(out, "{\"type\":\"");
+    put_literal(out, type);
+    put_char(out, '"');
+    json_int(out, "pid", pid);
+}
+
+static void json_end(output_t *out)
+{
+    put_char(out, '}');
+    put_char(out, '\n');
+}
+
+static const char *family_to_string(int family)
+{
+    switch (family) {
+    case AF_INET:  return "inet";
+    case AF_INET6: return "inet6";
+    case AF_UNIX:  return "unix";
+    default:       return "unknown";
+    }
+}
+
+/* Bare IP text (no port or brackets) for JSON address fields */
+static void format_bare_ip(const socket_info_t *sock, const net_addr_t *addr,
+                           char *buf, size_t buflen)
+{
+    const void *src = (sock->family == AF_INET6) ? (const void *)addr->v6
+                                                 : (const void *)&addr->v4;
+    int af = (sock->family == AF_INET6) ? AF_INET6 : AF_INET;
+    if (inet_ntop(af, src, buf, buflen) == NULL) {
+        snprintf(buf, buflen, "?");
+    }
+}
+
+/* ---- Binary encoding ---- */
+
+static void put_u8(output_t *out, uint8_t v)
+{
+    put_char(out, (char)v);
+}
+
+static void put_u16(output_t *out, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    put_bytes(out, b, sizeof(b));
+}
+
+static void put_u32(output_t *out, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8),
+                     (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    put_bytes(out, b, sizeof(b));
+}
+
+static void put_u64(output_t *out, uint64_t v)
+{
+    put_u32(out, (uint32_t)v);
+    put_u32(out, (uint32_t)(v >> 32));
+}
+
+static size_t bin_string_len(const char *s)
+{
+    size_t len = strlen(s);
+    return (len > BIN_STRING_MAX) ? BIN_STRING_MAX : len;
+}
+
+static void put_bin_string(output_t *out, const char *s, size_t len)
+{
+    put_u16(out, (uint16_t)len);
+    put_bytes(out, s, len);
+}
+
+/*
+ * 16 address bytes; IPv4 uses the first 4 and zero-fills the rest, since
+ * the text parser leaves the tail of the union unset.
+ */
+static void put_bin_addr(output_t *out, const socket_info_t *sock,
+                         const net_addr_t *addr)
+{
+    uint8_t bytes[16] = {0};
+
+    if (sock->family == AF_INET6) {
+        memcpy(bytes, addr->v6, sizeof(bytes));
+    } else if (sock->family == AF_INET) {
+        memcpy(bytes, &addr->v4, sizeof(addr->v4));
+    }
+    put_bytes(out, bytes, sizeof(bytes));
+}
+
+/* Every mem_usage_t field, in declaration order, as JSON keys */
+static void json_usage(output_t *out, const mem_usage_t *u)
+{
+    json_uint(out, "size_kb", u->size_kb);
+    json_uint(out, "rss_kb", u->rss_kb);
+    json_uint(out, "pss_kb", u->pss_kb);
+    json_uint(out, "pss_anon_kb", u->pss_anon_kb);
+    json_uint(out, "pss_file_kb", u->pss_file_kb);
+    json_uint(out, "pss_shmem_kb", u->pss_shmem_kb);
+    json_uint(out, "shared_clean_kb", u->shared_clean_kb);
+    json_uint(out, "shared_dirty_kb", u->shared_dirty_kb);
+    json_uint(out, "private_clean_kb", u->private_clean_kb);
+    json_uint(out, "private_dirty_kb", u->private_dirty_kb);
+    json_uint(out, "anonymous_kb", u->anonymous_kb);
+    json_uint(out, "anon_huge_kb", u->anon_huge_kb);
+    json_uint(out, "shmem_huge_kb", u->shmem_huge_kb);
+    json_uint(out, "file_huge_kb", u->file_huge_kb);
+    json_uint(out, "hugetlb_kb", u->hugetlb_kb);
+    json_uint(out, "swap_kb", u->swap_kb);
+    json_uint(out, "swap_pss_kb", u->swap_pss_kb);
+    json_uint(out, "locked_kb", u->locked_kb);
+}
+
+/* Every mem_usage_t field, in declaration order, as u64s */
+static void put_bin_usage(output_t *out, const mem_usage_t *u)
+{
+    put_u64(out, u->size_kb);
+    put_u64(out, u->rss_kb);
+    put_u64(out, u->pss_kb);
+    put_u64(out, u->pss_anon_kb);
+    put_u64(out, u->pss_file_kb);
+    put_u64(out, u->pss_shmem_kb);
+    put_u64(out, u->shared_clean_kb);
+    put_u64(out, u->shared_dirty_kb);
+    put_u64(out, u->private_clean_kb);
+    put_u64(out, u->private_dirty_kb);
+    put_u64(out, u->anonymous_kb);
+    put_u64(out, u->anon_huge_kb);
+    put_u64(out, u->shmem_huge_kb);
+    put_u64(out, u->file_huge_kb);
+    put_u64(out, u->hugetlb_kb);
+    put_u64(out, u->swap_kb);
+    put_u64(out, u->swap_pss_kb);
+    put_u64(out, u->locked_kb);
+}
+
+/* u32 length (type byte + payload), then the type byte */
+static void bin_begin(output_t *out, output_record_t type, size_t length)
+{
+    put_u32(out, (uint32_t)length);
+    put_u8(out, (uint8_t)type);
+}
+
+/* ---- Public API ---- */
+
+int output_parse_format(const char *name, output_format_t *format)
+{
+    if (name == NULL || format == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (strcmp(name, "text") == 0) {
+        *format = OUTPUT_TEXT;
+    } else if (strcmp(name, "jsonl") == 0) {
+        *format = OUTPUT_JSONL;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = OUTPUT_BINARY;
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Implementation of output_open() - see output.h for API docs.
+ */
+int output_open(output_t *out, int fd, output_format_t format)
+{
+    if (out == NULL || format == OUTPUT_TEXT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->fd = fd;
+    out->format = format;
+    out->buf = malloc(OUTPUT_BUFFER_SIZE);
+    if (out->buf == NULL) {
+        return -1;
+    }
+
+    if (format == OUTPUT_BINARY) {
+        put_bytes(out, OUTPUT_BINARY_MAGIC, 4);
+        put_u16(out, OUTPUT_BINARY_VERSION);
+        put_u16(out, 0);
+    }
+
+    return 0;
+}
+
+void output_process(output_t *out, const proc_info_t *info)
+{
+    if (out == NULL || info == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "process", info->pid);
+        json_str(out, "name", info->name);
+        json_str(out, "state", state_to_string(info->state));
+        json_uint(out, "uid_real", info->uid_real);
+        json_uint(out, "uid_effective", info->uid_effective);
+        json_uint(out, "gid_real", info->gid_real);
+        json_uint(out, "gid_effective", info->gid_effective);
+        json_uint(out, "vm_size_kb", info->vm_size_kb);
+        json_uint(out, "vm_rss_kb", info->vm_rss_kb);
+        json_uint(out, "vm_peak_kb", info->vm_peak_kb);
+        json_int(out, "thread_count", info->thread_count);
+        json_end(out);
+        return;
+    }
+
+    size_t name_len = bin_string_len(info->name);
+    bin_begin(out, OUTPUT_RECORD_PROCESS, BIN_PROCESS_FIXED + name_len);
+    put_u32(out, (uint32_t)info->pid);
+    put_u8(out, (uint8_t)info->state);
+    put_u32(out, info->uid_real);
+    put_u32(out, info->uid_effective);
+    put_u32(out, info->gid_real);
+    put_u32(out, info->gid_effective);
+    put_u64(out, info->vm_size_kb);
+    put_u64(out, info->vm_rss_kb);
+    put_u64(out, info->vm_peak_kb);
+    put_u32(out, (uint32_t)info->thread_count);
+    put_bin_string(out, info->name, name_len);
+}
+
+void output_fd(output_t *out, pid_t pid, const fd_entry_t *entry,
+               const char *target)
+{
+    if (out == NULL || entry == NULL || target == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "fd", pid);
+        json_int(out, "fd", entry->fd);
+        json_str(out, "fd_type", fd_type_to_string(entry->type));
+        json_str(out, "target", target);
+        json_bool(out, "is_socket", entry->type == FD_TYPE_SOCKET);
+        json_uint(out, "socket_inode", entry->socket_inode);
+        json_end(out);
+        return;
+    }
+
+    size_t target_len = bin_string_len(target);
+    bin_begin(out, OUTPUT_RECORD_FD, BIN_FD_FIXED + target_len);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)entry->fd);
+    put_u8(out, (uint8_t)entry->type);
+    put_u64(out, entry->socket_inode);
+    put_bin_string(out, target, target_len);
+}
+
+void output_thread(output_t *out, pid_t pid, const thread_info_t *thread)
+{
+    if (out == NULL || thread == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "thread", pid);
+        json_int(out, "tid", thread->tid);
+        json_str(out, "name", thread->name);
+        json_str(out, "state", state_to_string(thread->state));
+        json_uint(out, "utime", thread->utime);
+        json_uint(out, "stime", thread->stime);
+        json_int(out, "processor", thread->processor);
+        json_end(out);
+        return;
+    }
+
+    size_t name_len = bin_string_len(thread->name);
+    bin_begin(out, OUTPUT_RECORD_THREAD, BIN_THREAD_FIXED + name_len);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)thread->tid);
+    put_u8(out, (uint8_t)thread->state);
+    put_u64(out, thread->utime);
+    put_u64(out, thread->stime);
+    put_u32(out, (uint32_t)thread->processor);
+    put_bin_string(out, thread->name, name_len);
+}
+
+void output_socket(output_t *out, pid_t pid, int fd,
+                   const socket_info_t *sock)
+{
+    if (out == NULL || sock == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "socket", pid);
+        json_int(out, "fd", fd);
+        json_str(out, "proto", socket_proto_to_string(sock));
+        json_str(out, "family", family_to_string(sock->family));
+        if (sock->family == AF_UNIX) {
+            json_str(out, "path", sock->path);
+        } else {
+            char ip[INET6_ADDRSTRLEN];
+            format_bare_ip(sock, &sock->local_addr, ip, sizeof(ip));
+            json_str(out, "local_addr", ip);
+            json_uint(out, "local_port", sock->local_port);
+            format_bare_ip(sock, &sock->remote_addr, ip, sizeof(ip));
+            json_str(out, "remote_addr", ip);
+            json_uint(out, "remote_port", sock->remote_port);
+        }
+        json_str(out, "state", tcp_state_to_string(sock->state));
+        json_uint(out, "inode", sock->inode);
+        json_end(out);
+        return;
+    }
+
+    size_t path_len = bin_string_len(sock->path);
+    bin_begin(out, OUTPUT_RECORD_SOCKET, BIN_SOCKET_FIXED + path_len);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)fd);
+    put_u8(out, (uint8_t)sock->proto);
+    put_u8(out, (uint8_t)sock->family);
+    put_u8(out, (uint8_t)sock->state);
+    put_u16(out, sock->local_port);
+    put_u16(out, sock->remote_port);
+    put_bin_addr(out, sock, &sock->local_addr);
+    put_bin_addr(out, sock, &sock->remote_addr);
+    put_u64(out, sock->inode);
+    put_bin_string(out, sock->path, path_len);
+}
+
+void output_memory(output_t *out, pid_t pid, const mem_usage_t *usage)
+{
+    if (out == NULL || usage == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "memory", pid);
+        json_usage(out, usage);
+        json_end(out);
+        return;
+    }
+
+    bin_begin(out, OUTPUT_RECORD_MEMORY, BIN_MEMORY_FIXED);
+    put_u32(out, (uint32_t)pid);
+    put_bin_usage(out, usage);
+}
+
+void output_mem_file(output_t *out, pid_t pid, const mem_file_t *entry,
+                     const char *name)
+{
+    if (out == NULL || entry == NULL || name == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "mem_file", pid);
+        json_str(out, "name", name);
+        json_int(out, "vma_count", entry->vma_count);
+        json_usage(out, &entry->usage);
+        json_end(out);
+        return;
+    }
+
+    size_t name_len = bin_string_len(name);
+    bin_begin(out, OUTPUT_RECORD_MEM_FILE, BIN_MEM_FILE_FIXED + name_len);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)entry->vma_count);
+    put_bin_usage(out, &entry->usage);
+    put_bin_string(out, name, name_len);
+}
+
+void output_counts(output_t *out, pid_t pid, int fd_count, int socket_count)
+{
+    if (out == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "counts", pid);
+        json_int(out, "fd_count", fd_count);
+        json_int(out, "socket_count", socket_count);
+        json_end(out);
+        return;
+    }
+
+    bin_begin(out, OUTPUT_RECORD_COUNTS, BIN_COUNTS_FIXED);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)fd_count);
+    put_u32(out, (uint32_t)socket_count);
+}
+
+void output_error(output_t *out, pid_t pid, int err)
+{
+    if (out == NULL || out->error != 0) {
+        return;
+    }
+
+    if (out->format == OUTPUT_JSONL) {
+        json_begin(out, "error", pid);
+        json_int(out, "errno", err);
+        json_str(out, "message", strerror(err));
+        json_end(out);
+        return;
+    }
+
+    bin_begin(out, OUTPUT_RECORD_ERROR, BIN_ERROR_FIXED);
+    put_u32(out, (uint32_t)pid);
+    put_u32(out, (uint32_t)err);
+}
+
+int output_close(output_t *out)
+{
+    if (out == NULL || out->buf == NULL) {
+        return 0;
+    }
+
+    int ret = output_flush(out);
+    int saved_errno = errno;
+
+    free(out->buf);
+    out->buf = NULL;
+    errno = saved_errno;
+    return ret;
+}
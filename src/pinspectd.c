@@ -0,0 +1,407 @@
+/*
+ * pinspectd.c - pinspect sampling daemon
+ *
+ * Samples a fixed PID set every interval with collect_process_reports()
+ * and publishes one shm_sample_t per PID per tick into a shared-memory
+ * ring (shmring.h), so any number of consumers read fresh status, FD and
+ * socket counts without starting a process or touching /proc. The same
+ * binary with --read prints the newest tick of a running daemon.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include "pinspect.h"
+#include "batch.h"
+#include "shmring.h"
+#include "budget.h"
+#include "util.h"
+
+#define PROGRAM_NAME "pinspectd"
+#define VERSION "1.0.0"
+
+#define DEFAULT_CAPACITY 4096
+#define DEFAULT_MODE 0600
+
+/* Long-only option codes (outside the range of short option characters) */
+enum {
+    OPT_PGREP = 256,
+    OPT_MODE,
+    OPT_MAX_SYSCALLS,
+    OPT_MAX_CPU
+};
+
+/* Set by SIGINT/SIGTERM to stop after the current tick */
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void print_usage(void)
+{
+    printf("Usage: %s [OPTIONS] <PID>...\n", PROGRAM_NAME);
+    printf("       %s [OPTIONS] --pgrep=NAME\n", PROGRAM_NAME);
+    printf("       %s --read [-s NAME]\n", PROGRAM_NAME);
+    printf("\n");
+    printf("Sample processes on a schedule and publish the results to a\n");
+    printf("shared-memory ring that readers map without syscalls.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -i, --interval=SEC  Seconds between samples (default 1)\n");
+    printf("  -n, --count=N       Stop after N samples (default: until "
+           "SIGINT/SIGTERM)\n");
+    printf("  -s, --shm=NAME      Ring name for shm_open() (default %s)\n",
+           SHMRING_DEFAULT_NAME);
+    printf("  -c, --capacity=N    Records the ring holds (default %d, "
+           "rounded up\n", DEFAULT_CAPACITY);
+    printf("                      to a power of two)\n");
+    printf("      --mode=OCTAL    Permissions of the ring (default %04o)\n",
+           DEFAULT_MODE);
+    printf("      --pgrep=NAME    Also sample every process whose name "
+           "contains NAME\n");
+    printf("                      (matched once, at startup)\n");
+    printf("      --max-syscalls=N  Spend at most N /proc syscalls per "
+           "second\n");
+    printf("      --max-cpu=PCT   Use at most PCT%% of one CPU while "
+           "sampling\n");
+    printf("  -r, --read          Print the newest sample of each PID in "
+           "the ring\n");
+    printf("  -h, --help          Display this help message\n");
+    printf("  -V, --version       Display version information\n");
+}
+
+/*
+ * Parse a positive integer option value. Returns 0 on success, -1 on a
+ * malformed or out-of-range value.
+ */
+static int parse_positive(const char *text, long max, long *value)
+{
+    char *end;
+    errno = 0;
+    long n = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || n <= 0 || n > max) {
+        return -1;
+    }
+    *value = n;
+    return 0;
+}
+
+/* Fill sample from report for the tick that started at time_ns */
+static void fill_sample(shm_sample_t *sample, const process_report_t *r,
+                        uint64_t tick, uint64_t time_ns)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->tick = tick;
+    sample->time_ns = time_ns;
+    sample->pid = (int32_t)r->pid;
+    sample->status_errno = r->status_errno;
+    sample->info = r->info;
+    sample->fd_errno = r->fd_errno;
+    sample->fd_count = (r->status_errno == 0 && r->fd_errno == 0)
+                           ? r->fds.count : -1;
+    sample->socket_errno = r->socket_errno;
+    sample->socket_count = (r->status_errno == 0 && r->socket_errno == 0)
+                               ? r->socket_count : -1;
+}
+
+/* Advance deadline by interval_sec, to now if it has already passed */
+static void next_deadline(struct timespec *deadline, double interval_sec)
+{
+    long long ns = deadline->tv_nsec + (long long)(interval_sec * 1e9);
+    deadline->tv_sec += (time_t)(ns / 1000000000LL);
+    deadline->tv_nsec = (long)(ns % 1000000000LL);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > deadline->tv_sec ||
+        (now.tv_sec == deadline->tv_sec && now.tv_nsec > deadline->tv_nsec)) {
+        *deadline = now;
+    }
+}
+
+/*
+ * Sample pids every interval_sec into ring until max_ticks samples (0 for
+ * no limit) or a stop signal. Returns the process exit code.
+ */
+static int run_daemon(shmring_t *ring, const pid_t *pids, int count,
+                      double interval_sec, long max_ticks)
+{
+    batch_options_t opts = {
+        .status_fields = FIELDS_STATUS,
+        .fds = true,
+        .sockets = true,
+        .counts_only = true,
+    };
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    for (uint64_t tick = 1; !stop_requested; tick++) {
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        uint64_t time_ns = (uint64_t)wall.tv_sec * 1000000000u +
+                           (uint64_t)wall.tv_nsec;
+
+        process_report_t *reports = NULL;
+        if (collect_process_reports(pids, count, &opts, &reports) != 0) {
+            fprintf(stderr, "%s: sampling failed: %s\n", PROGRAM_NAME,
+                    strerror(errno));
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            shm_sample_t sample;
+            fill_sample(&sample, &reports[i], tick, time_ns);
+            shmring_publish(ring, &sample);
+        }
+        process_reports_free(reports, count);
+
+        if (max_ticks > 0 && tick >= (uint64_t)max_ticks) {
+            break;
+        }
+        next_deadline(&deadline, interval_sec);
+        while (!stop_requested &&
+               clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                               NULL) == EINTR) {
+            /* Retry unless a stop signal interrupted the sleep */
+        }
+    }
+    return 0;
+}
+
+/*
+ * --read: print the newest tick in the ring called name. Returns the
+ * process exit code.
+ */
+static int run_reader(const char *name)
+{
+    shmring_reader_t reader;
+    if (shmring_open(&reader, name, sizeof(shm_sample_t)) != 0) {
+        fprintf(stderr, "%s: cannot open ring %s: %s\n", PROGRAM_NAME, name,
+                strerror(errno));
+        return (errno == ENOENT) ? 2 : 1;
+    }
+
+    /* Read everything the ring holds, keeping the newest tick's records */
+    size_t cap = 16;
+    size_t n = 0;
+    shm_sample_t *rows = malloc(cap * sizeof(*rows));
+    shm_sample_t sample;
+    while (rows != NULL && shmring_read(&reader, &sample) == 1) {
+        if (n > 0 && sample.tick != rows[0].tick) {
+            n = 0;
+        }
+        if (n == cap) {
+            shm_sample_t *grown = realloc(rows, 2 * cap * sizeof(*rows));
+            if (grown == NULL) {
+                break;
+            }
+            rows = grown;
+            cap *= 2;
+        }
+        rows[n++] = sample;
+    }
+    if (rows == NULL) {
+        shmring_close(&reader);
+        fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(ENOMEM));
+        return 1;
+    }
+
+    printf("Ring %s from producer %d, %llu records published\n", name,
+           (int)shmring_producer(&reader),
+           (unsigned long long)shmring_head(&reader));
+    if (n > 0) {
+        printf("Tick %llu\n", (unsigned long long)rows[0].tick);
+    }
+    printf("%-8s %-16s %-9s %10s %7s %6s %7s\n", "PID", "NAME", "STATE",
+           "RSS_KB", "THREADS", "FDS", "SOCKETS");
+    for (size_t i = 0; i < n; i++) {
+        const shm_sample_t *s = &rows[i];
+        if (s->status_errno != 0) {
+            printf("%-8d %s\n", (int)s->pid, strerror(s->status_errno));
+            continue;
+        }
+        printf("%-8d %-16s %-9s %10lu %7d %6d %7d\n", (int)s->pid,
+               s->info.name, state_to_string(s->info.state),
+               s->info.vm_rss_kb, s->info.thread_count, (int)s->fd_count,
+               (int)s->socket_count);
+    }
+
+    free(rows);
+    shmring_close(&reader);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"interval", required_argument, NULL, 'i'},
+        {"count",    required_argument, NULL, 'n'},
+        {"shm",      required_argument, NULL, 's'},
+        {"capacity", required_argument, NULL, 'c'},
+        {"mode",     required_argument, NULL, OPT_MODE},
+        {"pgrep",    required_argument, NULL, OPT_PGREP},
+        {"max-syscalls", required_argument, NULL, OPT_MAX_SYSCALLS},
+        {"max-cpu",  required_argument, NULL, OPT_MAX_CPU},
+        {"read",     no_argument,       NULL, 'r'},
+        {"help",     no_argument,       NULL, 'h'},
+        {"version",  no_argument,       NULL, 'V'},
+        {NULL,       0,                 NULL,  0}
+    };
+
+    double interval_sec = 1.0;
+    long max_ticks = 0;
+    long capacity = DEFAULT_CAPACITY;
+    long mode = DEFAULT_MODE;
+    const char *name = SHMRING_DEFAULT_NAME;
+    const char *pattern = NULL;
+    bool read_mode = false;
+    budget_t budget = { 0, 0 };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:n:s:c:rhV", long_options,
+                              NULL)) != -1) {
+        switch (opt) {
+        case 'i': {
+            char *end;
+            errno = 0;
+            interval_sec = strtod(optarg, &end);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                !(interval_sec > 0)) {
+                fprintf(stderr, "Invalid interval: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'n':
+            if (parse_positive(optarg, LONG_MAX, &max_ticks) != 0) {
+                fprintf(stderr, "Invalid count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            name = optarg;
+            break;
+        case 'c':
+            if (parse_positive(optarg, 1L << 24, &capacity) != 0) {
+                fprintf(stderr, "Invalid capacity: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_MODE: {
+            char *end;
+            errno = 0;
+            mode = strtol(optarg, &end, 8);
+            if (errno != 0 || end == optarg || *end != '\0' || mode < 0 ||
+                mode > 0777) {
+                fprintf(stderr, "Invalid mode: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case OPT_PGREP:
+            pattern = optarg;
+            break;
+        case OPT_MAX_SYSCALLS:
+        case OPT_MAX_CPU: {
+            long value;
+            if (parse_positive(optarg, INT_MAX, &value) != 0) {
+                fprintf(stderr, "Invalid limit: %s\n", optarg);
+                return 1;
+            }
+            if (opt == OPT_MAX_SYSCALLS) {
+                budget.syscalls_per_sec = (unsigned long)value;
+            } else {
+                budget.cpu_percent = (unsigned)value;
+            }
+            break;
+        }
+        case 'r':
+            read_mode = true;
+            break;
+        case 'h':
+            print_usage();
+            return 0;
+        case 'V':
+            printf("%s version %s\n", PROGRAM_NAME, VERSION);
+            return 0;
+        case '?':
+            fprintf(stderr, "Try '%s --help' for more information.\n",
+                    PROGRAM_NAME);
+            return 1;
+        }
+    }
+
+    if (read_mode) {
+        return run_reader(name);
+    }
+
+    /* Spread each tick's reads out rather than bursting at the deadline */
+    budget_set(&budget);
+
+    int count = 0;
+    pid_t *pids = NULL;
+    if (pattern != NULL && find_pids_by_name(pattern, &pids, &count) != 0) {
+        fprintf(stderr, "%s: cannot scan processes: %s\n", PROGRAM_NAME,
+                strerror(errno));
+        return 1;
+    }
+    int extra = argc - optind;
+    if (extra > 0) {
+        pid_t *grown = realloc(pids, (size_t)(count + extra) * sizeof(*pids));
+        if (grown == NULL) {
+            free(pids);
+            fprintf(stderr, "%s: %s\n", PROGRAM_NAME, strerror(ENOMEM));
+            return 1;
+        }
+        pids = grown;
+        for (int i = optind; i < argc; i++) {
+            pid_t pid = parse_pid(argv[i]);
+            if (pid == -1) {
+                fprintf(stderr, "Invalid PID: %s\n", argv[i]);
+                free(pids);
+                return 1;
+            }
+            pids[count++] = pid;
+        }
+    }
+    count = sort_unique_pids(pids, count);
+    if (count == 0) {
+        fprintf(stderr, "%s: no processes to sample\n", PROGRAM_NAME);
+        fprintf(stderr, "Try '%s --help' for more information.\n",
+                PROGRAM_NAME);
+        free(pids);
+        return 1;
+    }
+
+    shmring_t ring;
+    if (shmring_create(&ring, name, sizeof(shm_sample_t),
+                       (uint32_t)capacity, (mode_t)mode) != 0) {
+        fprintf(stderr, "%s: cannot create ring %s: %s\n", PROGRAM_NAME,
+                name, strerror(errno));
+        free(pids);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int ret = run_daemon(&ring, pids, count, interval_sec, max_ticks);
+
+    /* With a sample count the ring outlives us for readers to collect */
+    shmring_destroy(&ring, max_ticks == 0 || stop_requested);
+    free(pids);
+    return ret;
+}
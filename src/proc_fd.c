@@ -1,7 +1,15 @@
 /*
  * proc_fd.c - Enumerate file descriptors from /proc/<PID>/fd
  *
- * Uses readdir() to list FD directory and readlink() to resolve targets.
+ * Lists the FD directory with getdents64() and resolves each target with
+ * readlinkat() relative to it, all through one proc_handle_t. The
+ * optional io_uring backend instead statx()es a whole getdents64() batch
+ * at once while the next batch is read, naming sockets and pipes from
+ * the inode it returns and reading only the remaining links.
+ * for_each_fd_at() hands each entry to a visitor from the stack;
+ * enumerate_fds() is one such visitor that copies targets into a growing
+ * string arena, with entries referring to them by offset so the arena
+ * can be reallocated freely.
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -10,158 +18,847 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-#include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
-#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <linux/stat.h>
 #include "proc_fd.h"
 #include "util.h"
 #include "pinspect.h"
+#include "stats.h"
+#include "budget.h"
+#include "sample.h"
+#include "uring.h"
 
 /* Initial capacity for FD array (will grow if needed) */
 #define INITIAL_FD_CAPACITY 64
 
+/* Initial target arena size; most targets are under 32 bytes */
+#define INITIAL_ARENA_CAPACITY (INITIAL_FD_CAPACITY * 32)
+
 /*
- * Check if directory entry is numeric (filter out "." and "..").
+ * getdents64() buffer per io_uring batch. The shortest record, a one-digit
+ * name, is 24 bytes, which bounds the FDs in one batch.
  */
-static bool is_numeric(const char *name)
+#define URING_DIR_BUFFER (16 * 1024)
+#define URING_BATCH_MAX (URING_DIR_BUFFER / 24)
+
+/* From <linux/fcntl.h>, which clashes with glibc's <fcntl.h> */
+#ifndef AT_STATX_DONT_SYNC
+#define AT_STATX_DONT_SYNC 0x4000
+#endif
+
+static fd_backend_t selected_backend = FD_BACKEND_READLINK;
+
+void fd_set_backend(fd_backend_t backend)
 {
-    if (name == NULL || *name == '\0') {
-        return false;
+    selected_backend = backend;
+}
+
+fd_backend_t fd_get_backend(void)
+{
+    return selected_backend;
+}
+
+/*
+ * Classify a symlink target by its prefix.
+ */
+fd_type_t classify_fd_target(const char *target)
+{
+    if (target == NULL) {
+        return FD_TYPE_OTHER;
     }
 
-    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
-        return false;
+    if (strncmp(target, "socket:[", 8) == 0) {
+        return FD_TYPE_SOCKET;
+    }
+    if (strncmp(target, "pipe:[", 6) == 0) {
+        return FD_TYPE_PIPE;
+    }
+    if (strncmp(target, "anon_inode:", 11) == 0) {
+        return FD_TYPE_ANON_INODE;
+    }
+    if (strncmp(target, "/dev/", 5) == 0) {
+        return FD_TYPE_DEVICE;
+    }
+    if (target[0] == '/') {
+        return FD_TYPE_FILE;
     }
 
-    const char *c = name;
-    while (*c != '\0') {
-        if (!isdigit((unsigned char)*c)) {
-            return false;
-        }
-        c++;
+    return FD_TYPE_OTHER;
+}
+
+const char *fd_type_to_string(fd_type_t type)
+{
+    switch (type) {
+    case FD_TYPE_FILE:       return "file";
+    case FD_TYPE_DEVICE:     return "device";
+    case FD_TYPE_SOCKET:     return "socket";
+    case FD_TYPE_PIPE:       return "pipe";
+    case FD_TYPE_ANON_INODE: return "anon_inode";
+    case FD_TYPE_OTHER:
+    default:                 return "other";
+    }
+}
+
+const char *fd_target(const fd_list_t *list, const fd_entry_t *entry)
+{
+    if (list == NULL || entry == NULL || list->strings == NULL) {
+        return "";
+    }
+    return list->strings + entry->target_offset;
+}
+
+/* scan_numeric_dir() visitor counting entries; ctx is an int counter */
+static int count_entry(const char *name, long id, void *ctx)
+{
+    (void)name;
+    (void)id;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+/* count_fds_at() body, run inside the fds stats phase */
+static int count_fd_entries(const proc_handle_t *h, int *count)
+{
+    if (count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *count = 0;
+
+    int dirfd = proc_handle_openat(h, "fd", O_RDONLY | O_DIRECTORY);
+    if (dirfd < 0) {
+        return -1;
+    }
+
+    /*
+     * Since Linux 6.2 procfs reports the number of open FDs as the size
+     * of the fd directory; older kernels report 0. Only trust it on a
+     * real procfs mount.
+     */
+    struct stat st;
+    struct statfs fs;
+    if (fstat(dirfd, &st) == 0 && st.st_size > 0 &&
+        fstatfs(dirfd, &fs) == 0 && fs.f_type == PROC_SUPER_MAGIC) {
+        *count = (st.st_size > INT_MAX) ? INT_MAX : (int)st.st_size;
+        STATS_COUNT(STATS_ENTRIES, *count);
+        close(dirfd);
+        return 0;
     }
 
-    return true;
+    int ret = scan_numeric_dir(dirfd, count_entry, count);
+    int saved_errno = errno;
+    close(dirfd);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Implementation of count_fds_at() - see proc_fd.h for API docs.
+ */
+int count_fds_at(const proc_handle_t *h, int *count)
+{
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_FDS);
+    int ret = count_fd_entries(h, count);
+    STATS_PHASE_END(prev);
+    return ret;
 }
 
+/* Per-walk state for count_socket_entry() */
+typedef struct {
+    int dirfd;          /* /proc/<pid>/fd */
+    int fds;
+    int sockets;
+    int error;          /* errno of a readlinkat() that stopped the walk */
+} socket_counter_t;
+
 /*
- * Resolve FD symlink to target.
- * Note: readlink() does not null-terminate, so we must do it explicitly.
- * Returns 0 on success, -1 on error.
+ * scan_numeric_dir() visitor: read just enough of one symlink to tell
+ * whether it is a socket.
  */
-static int resolve_fd_target(const char *path, char *target, size_t size)
+static int count_socket_entry(const char *name, long id, void *ctx)
 {
-    ssize_t len = readlink(path, target, size - 1);
+    (void)id;
+    socket_counter_t *c = ctx;
 
+    /* readlinkat() truncates silently, returning the bytes it stored */
+    static const char prefix[] = "socket:[";
+    char target[sizeof(prefix) - 1];
+    ssize_t len = readlinkat(c->dirfd, name, target, sizeof(target));
+    STATS_COUNT(STATS_READLINKS, 1);
+    BUDGET_CHARGE(1);
+    if (len < 0 && errno == ENOENT) {
+        /* TOCTOU race: FD closed between getdents64 and readlinkat */
+        return 0;
+    }
     if (len < 0) {
-        return -1;
+        /* fd/ of a process we may not ptrace lists, but won't resolve */
+        c->error = errno;
+        return 1;
     }
 
-    target[len] = '\0';  /* Critical: readlink() doesn't null-terminate */
+    c->fds++;
+    if ((size_t)len == sizeof(target) &&
+        memcmp(target, prefix, sizeof(target)) == 0) {
+        c->sockets++;
+    }
     return 0;
 }
 
+/* count_socket_fds_at() body, run inside the fds stats phase */
+static int count_socket_entries(const proc_handle_t *h, int *fd_count,
+                                int *socket_count)
+{
+    if (fd_count == NULL || socket_count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *fd_count = 0;
+    *socket_count = 0;
+
+    socket_counter_t c = { .fds = 0, .sockets = 0, .error = 0 };
+    c.dirfd = proc_handle_openat(h, "fd", O_RDONLY | O_DIRECTORY);
+    if (c.dirfd < 0) {
+        return -1;
+    }
+
+    int ret = scan_numeric_dir(c.dirfd, count_socket_entry, &c);
+    int saved_errno = errno;
+    close(c.dirfd);
+
+    if (ret == 0 && c.error != 0) {
+        ret = -1;
+        saved_errno = c.error;
+    }
+    if (ret == 0) {
+        *fd_count = c.fds;
+        *socket_count = c.sockets;
+    }
+    errno = saved_errno;
+    return ret;
+}
+
 /*
- * Parse FD entry from directory name and resolved symlink target.
+ * Implementation of count_socket_fds_at() - see proc_fd.h for API docs.
  */
-static void parse_fd_entry(const char *name, const char *target,
-                           fd_entry_t *entry)
+int count_socket_fds_at(const proc_handle_t *h, int *fd_count,
+                        int *socket_count)
 {
-    entry->fd = atoi(name);
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_FDS);
+    int ret = count_socket_entries(h, fd_count, socket_count);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/* sample_fds_at() body, run inside the fds stats phase */
+static int sample_fd_entries(const proc_handle_t *h, int size, uint64_t seed,
+                             fd_sample_t *out)
+{
+    if (out == NULL || size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
 
-    strncpy(entry->target, target, sizeof(entry->target) - 1);
-    entry->target[sizeof(entry->target) - 1] = '\0';
+    memset(out, 0, sizeof(*out));
 
-    if (parse_socket_inode(target, &entry->socket_inode)) {
-        entry->is_socket = true;
-    } else {
-        entry->is_socket = false;
-        entry->socket_inode = 0;
+    reservoir_t r;
+    if (reservoir_init(&r, size, seed) != 0) {
+        return -1;
+    }
+    int dirfd = proc_handle_openat(h, "fd", O_RDONLY | O_DIRECTORY);
+    if (dirfd < 0) {
+        int saved_errno = errno;
+        reservoir_free(&r);
+        errno = saved_errno;
+        return -1;
+    }
+
+    int ret = sample_numeric_dir(dirfd, &r);
+    reservoir_sort(&r);
+    for (int i = 0; ret == 0 && i < r.count; i++) {
+        char name[24];
+        snprintf(name, sizeof(name), "%ld", r.ids[i]);
+
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(dirfd, name, target, sizeof(target) - 1);
+        STATS_COUNT(STATS_READLINKS, 1);
+        BUDGET_CHARGE(1);
+        if (len < 0 && errno == ENOENT) {
+            /* Closed since the listing: neither counted nor sampled */
+            continue;
+        }
+        if (len < 0) {
+            ret = -1;
+            break;
+        }
+        target[len] = '\0';
+        out->type_counts[classify_fd_target(target)]++;
+        out->sampled++;
+        BUDGET_YIELD();
     }
+    out->total = (r.seen > INT_MAX) ? INT_MAX : (int)r.seen;
+
+    int saved_errno = errno;
+    close(dirfd);
+    reservoir_free(&r);
+    if (ret != 0) {
+        memset(out, 0, sizeof(*out));
+    }
+    errno = saved_errno;
+    return ret;
 }
 
 /*
- * Implementation of enumerate_fds() - see proc_fd.h for API docs.
+ * Implementation of sample_fds_at() - see proc_fd.h for API docs.
  */
-int enumerate_fds(pid_t pid, fd_entry_t **entries, int *count)
+int sample_fds_at(const proc_handle_t *h, int size, uint64_t seed,
+                  fd_sample_t *out)
 {
-    *entries = NULL;
-    *count = 0;
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_FDS);
+    int ret = sample_fd_entries(h, size, seed, out);
+    STATS_PHASE_END(prev);
+    return ret;
+}
 
-    char path_buf[256];
-    if (build_proc_path(pid, "fd", path_buf, sizeof(path_buf)) != 0) {
-        return -1;
+/* Per-walk state for resolve_fd() */
+typedef struct {
+    int dirfd;          /* /proc/<pid>/fd */
+    fd_visit_fn visit;
+    void *ctx;
+    int error;          /* errno of a readlinkat() that stopped the walk */
+} fd_walk_t;
+
+/* Build the entry for one resolved target and pass it on */
+static int deliver_fd(fd_walk_t *walk, long id, const char *target,
+                      size_t len)
+{
+    fd_entry_t entry;
+    entry.fd = (int)id;
+    entry.type = classify_fd_target(target);
+    entry.target_offset = 0;
+    entry.target_len = (uint32_t)len;
+    entry.socket_inode = 0;
+    if (entry.type == FD_TYPE_SOCKET &&
+        !parse_socket_inode(target, &entry.socket_inode)) {
+        entry.socket_inode = 0;
+    }
+
+    return walk->visit(&entry, target, walk->ctx);
+}
+
+/*
+ * scan_numeric_dir() visitor: resolve one FD relative to the fd directory
+ * and pass it on.
+ */
+static int resolve_fd(const char *name, long id, void *ctx)
+{
+    fd_walk_t *walk = ctx;
+
+    char target[PATH_MAX];
+    ssize_t len = readlinkat(walk->dirfd, name, target, sizeof(target) - 1);
+    STATS_COUNT(STATS_READLINKS, 1);
+    BUDGET_CHARGE(1);
+    if (len < 0 && errno == ENOENT) {
+        /* TOCTOU race: FD closed between getdents64 and readlinkat */
+        return 0;
+    }
+    if (len < 0) {
+        /* fd/ of a process we may not ptrace lists, but won't resolve */
+        walk->error = errno;
+        return 1;
+    }
+    target[len] = '\0';  /* Critical: readlink() doesn't null-terminate */
+
+    return deliver_fd(walk, id, target, (size_t)len);
+}
+
+/* One getdents64() batch of FD names, pointing into dir */
+typedef struct {
+    char dir[URING_DIR_BUFFER];
+    const char *names[URING_BATCH_MAX];
+    long ids[URING_BATCH_MAX];
+    unsigned count;
+    bool submitted;     /* statx() requests for it are on the ring */
+} uring_batch_t;
+
+/*
+ * io_uring walk state. Two batches alternate: while the kernel statx()es
+ * one, the next is read from the directory. One statx array serves both,
+ * as a batch is only submitted after the previous one is consumed.
+ */
+typedef struct {
+    uring_t ring;
+    bool ring_ok;
+    int own_ring_fd;    /* ring.fd when walking ourselves, else -1 */
+    uring_batch_t batch[2];
+    struct statx stx[URING_BATCH_MAX];
+    int res[URING_BATCH_MAX];
+} uring_walk_t;
+
+/* st_dev of sockfs and pipefs, for telling their inodes apart */
+static pthread_once_t pseudo_devs_once = PTHREAD_ONCE_INIT;
+static dev_t sockfs_dev;
+static dev_t pipefs_dev;
+static bool have_sockfs_dev = false;
+static bool have_pipefs_dev = false;
+
+/* pthread_once() routine: stat a socket and a pipe of our own */
+static void find_pseudo_devs(void)
+{
+    struct stat st;
+    int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (sock >= 0) {
+        if (fstat(sock, &st) == 0) {
+            sockfs_dev = st.st_dev;
+            have_sockfs_dev = true;
+        }
+        close(sock);
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) == 0) {
+        if (fstat(pipefd[0], &st) == 0) {
+            pipefs_dev = st.st_dev;
+            have_pipefs_dev = true;
+        }
+        close(pipefd[0]);
+        close(pipefd[1]);
     }
+}
 
-    DIR *dir = opendir(path_buf);
-    if (dir == NULL) {
+/*
+ * Write the readlink() text of a socket or pipe FD from its statx() into
+ * target. Returns the length, or -1 if only readlink() can tell.
+ */
+static int format_pseudo_target(const struct statx *stx, char *target,
+                                size_t size)
+{
+    dev_t dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    const char *prefix = NULL;
+    if (S_ISSOCK(stx->stx_mode) && have_sockfs_dev && dev == sockfs_dev) {
+        prefix = "socket";
+    } else if (S_ISFIFO(stx->stx_mode) && have_pipefs_dev &&
+               dev == pipefs_dev) {
+        prefix = "pipe";
+    }
+    if (prefix == NULL) {
         return -1;
     }
+    return snprintf(target, size, "%s:[%llu]", prefix,
+                    (unsigned long long)stx->stx_ino);
+}
+
+/* visit_numeric_entries() visitor: add one name to the batch */
+static int add_to_batch(const char *name, long id, void *ctx)
+{
+    uring_batch_t *b = ctx;
+    b->names[b->count] = name;
+    b->ids[b->count] = id;
+    b->count++;
+    return 0;
+}
+
+/*
+ * Read the next getdents64() batch into b. Returns bytes read, 0 at end
+ * of directory or -1 on error.
+ */
+static long fill_batch(int dirfd, uring_batch_t *b)
+{
+    b->count = 0;
+    b->submitted = false;
+    long nread = read_dir_batch(dirfd, b->dir, sizeof(b->dir));
+    if (nread > 0) {
+        visit_numeric_entries(b->dir, (size_t)nread, add_to_batch, b);
+    }
+    return nread;
+}
 
-    int capacity = INITIAL_FD_CAPACITY;
-    int num_fds = 0;
+/* Queue statx() for every FD of b; on failure b is resolved by readlink */
+static void submit_batch(fd_walk_t *walk, uring_walk_t *u, uring_batch_t *b)
+{
+    if (!u->ring_ok || b->count == 0) {
+        return;
+    }
+    /* DONT_SYNC: use cached attributes rather than ask NFS or FUSE */
+    if (uring_submit_statx(&u->ring, walk->dirfd, b->names, b->count,
+                           AT_STATX_DONT_SYNC, STATX_TYPE | STATX_INO,
+                           u->stx) == 0) {
+        b->submitted = true;
+    } else if (u->ring.pending == 0) {
+        uring_free(&u->ring);
+        u->ring_ok = false;
+        u->own_ring_fd = -1;
+    }
+}
 
-    fd_entry_t *array = malloc(capacity * sizeof(fd_entry_t));
-    if (array == NULL) {
-        closedir(dir);
+/*
+ * Wait for b's statx() results and pass every FD in it on. Returns 1 if
+ * visit stopped the walk, 0 to go on, -1 if the ring failed with requests
+ * still in flight.
+ */
+static int resolve_batch(fd_walk_t *walk, uring_walk_t *u, uring_batch_t *b)
+{
+    if (u->ring_ok && u->ring.pending > 0 &&
+        uring_wait(&u->ring, u->res) != 0) {
         return -1;
     }
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (!is_numeric(entry->d_name)) {
+    for (unsigned i = 0; i < b->count; i++) {
+        if (b->ids[i] == u->own_ring_fd) {
+            /* Our ring, opened mid-walk; not one of the process's FDs */
             continue;
         }
+        if (b->submitted) {
+            int res = u->res[i];
+            if (res == -ENOENT) {
+                /* TOCTOU race: FD closed between getdents64 and statx */
+                continue;
+            }
+            char target[32];
+            int len = (res == 0) ? format_pseudo_target(&u->stx[i], target,
+                                                        sizeof(target))
+                                 : -1;
+            if (len > 0) {
+                if (deliver_fd(walk, b->ids[i], target, (size_t)len) != 0) {
+                    return 1;
+                }
+                continue;
+            }
+        }
+        if (resolve_fd(b->names[i], b->ids[i], walk) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * FD_BACKEND_URING walk; self is set when walking the calling process.
+ * Returns 0 when the walk completed or visit
+ * stopped it, -1 on error.
+ */
+static int walk_fds_uring(fd_walk_t *walk, bool self)
+{
+    /* Zeroed: ring is only set up once a batch is big enough for it */
+    uring_walk_t *u = calloc(1, sizeof(*u));
+    if (u == NULL) {
+        return -1;
+    }
 
-        char fd_path[PATH_MAX];
-        snprintf(fd_path, sizeof(fd_path), "%s/%s", path_buf, entry->d_name);
+    int cur = 0;
+    long nread = fill_batch(walk->dirfd, &u->batch[cur]);
+    u->ring_ok = nread > 0 && u->batch[cur].count >= FD_URING_MIN_FDS &&
+                 uring_init(&u->ring, URING_BATCH_MAX) == 0;
+    u->own_ring_fd = (u->ring_ok && self) ? u->ring.fd : -1;
+    submit_batch(walk, u, &u->batch[cur]);
 
-        char target[PATH_MAX];
-        if (resolve_fd_target(fd_path, target, sizeof(target)) != 0) {
-            /* TOCTOU race: FD closed between readdir and readlink */
-            continue;
+    while (nread > 0) {
+        /* Read the next batch while the kernel works through this one */
+        int next = cur ^ 1;
+        long next_read = fill_batch(walk->dirfd, &u->batch[next]);
+        int saved_errno = errno;
+
+        int stop = resolve_batch(walk, u, &u->batch[cur]);
+        if (stop < 0) {
+            /*
+             * The kernel may still write into u, so it cannot be freed;
+             * io_uring_enter() only fails here if the ring is broken.
+             */
+            return -1;
+        }
+        if (stop > 0) {
+            break;
+        }
+        if (next_read < 0) {
+            nread = -1;
+            errno = saved_errno;
+            break;
         }
 
-        parse_fd_entry(entry->d_name, target, &array[num_fds]);
-        num_fds++;
-
-        /* Double capacity when full (amortized O(1) insertion) */
-        if (num_fds == capacity) {
-            capacity *= 2;
-            fd_entry_t *new_array = realloc(array,
-                                            capacity * sizeof(fd_entry_t));
-            if (new_array == NULL) {
-                free(array);
-                closedir(dir);
-                return -1;
-            }
-            array = new_array;
+        /* Nothing is in flight here, so a budget sleep holds no SQEs */
+        BUDGET_YIELD();
+        submit_batch(walk, u, &u->batch[next]);
+        cur = next;
+        nread = next_read;
+    }
+
+    int saved_errno = errno;
+    if (u->ring_ok) {
+        uring_free(&u->ring);
+    }
+    free(u);
+    errno = saved_errno;
+    return (nread < 0) ? -1 : 0;
+}
+
+/* for_each_fd_at() body, run inside the fds stats phase */
+static int walk_fds(const proc_handle_t *h, fd_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd_walk_t walk = { .visit = visit, .ctx = ctx };
+    walk.dirfd = proc_handle_openat(h, "fd", O_RDONLY | O_DIRECTORY);
+    if (walk.dirfd < 0) {
+        return -1;
+    }
+
+    /* Fixture trees hold plain symlinks, which statx() would follow */
+    int ret;
+    if (selected_backend == FD_BACKEND_URING && proc_root_is_live()) {
+        pthread_once(&pseudo_devs_once, find_pseudo_devs);
+        ret = walk_fds_uring(&walk, h->pid == getpid());
+    } else {
+        ret = scan_numeric_dir(walk.dirfd, resolve_fd, &walk);
+    }
+    if (ret == 0 && walk.error != 0) {
+        errno = walk.error;
+        ret = -1;
+    }
+    int saved_errno = errno;
+    close(walk.dirfd);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Implementation of for_each_fd_at() - see proc_fd.h for API docs.
+ */
+int for_each_fd_at(const proc_handle_t *h, fd_visit_fn visit, void *ctx)
+{
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_FDS);
+    int ret = walk_fds(h, visit, ctx);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/* Growing arrays filled by collect_fd() */
+typedef struct {
+    fd_entry_t *entries;
+    int count;
+    int capacity;
+    char *strings;
+    size_t strings_len;
+    size_t strings_capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} fd_collector_t;
+
+/*
+ * for_each_fd() visitor that appends the entry and copies its target into
+ * the arena. Stops the walk on allocation failure.
+ */
+static int collect_fd(const fd_entry_t *entry, const char *target, void *ctx)
+{
+    fd_collector_t *c = ctx;
+    size_t need = (size_t)entry->target_len + 1;
+
+    if (reserve_arena(&c->strings, &c->strings_capacity, c->strings_len,
+                      need) != 0) {
+        c->failed = true;
+        return 1;
+    }
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = c->capacity * 2;
+        fd_entry_t *new_entries = realloc(c->entries,
+                                          new_capacity * sizeof(fd_entry_t));
+        if (new_entries == NULL) {
+            c->failed = true;
+            return 1;
         }
+        c->entries = new_entries;
+        c->capacity = new_capacity;
     }
 
-    closedir(dir);
+    memcpy(c->strings + c->strings_len, target, need);
 
-    if (num_fds == 0) {
-        free(array);
-        *entries = NULL;
-        *count = 0;
+    fd_entry_t *slot = &c->entries[c->count++];
+    *slot = *entry;
+    slot->target_offset = (uint32_t)c->strings_len;
+    c->strings_len += need;
+    return 0;
+}
+
+/*
+ * Implementation of enumerate_fds_at() - see proc_fd.h for API docs.
+ */
+int enumerate_fds_at(const proc_handle_t *h, fd_list_t *list)
+{
+    if (list == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(list, 0, sizeof(*list));
+
+    fd_collector_t c = {
+        .capacity = INITIAL_FD_CAPACITY,
+        .strings_capacity = INITIAL_ARENA_CAPACITY,
+    };
+    c.entries = malloc(c.capacity * sizeof(fd_entry_t));
+    c.strings = malloc(c.strings_capacity);
+    if (c.entries == NULL || c.strings == NULL) {
+        free(c.entries);
+        free(c.strings);
+        return -1;
+    }
+
+    if (for_each_fd_at(h, collect_fd, &c) != 0 || c.failed) {
+        int saved_errno = errno;
+        free(c.entries);
+        free(c.strings);
+        errno = saved_errno;
+        return -1;
+    }
+
+    if (c.count == 0) {
+        free(c.entries);
+        free(c.strings);
         return 0;
     }
 
-    /* Shrink to exact size to minimize memory footprint */
-    fd_entry_t *final_array = realloc(array, num_fds * sizeof(fd_entry_t));
-    if (final_array != NULL) {
-        array = final_array;
+    /* Shrink both to exact size to minimize memory footprint */
+    fd_entry_t *final_entries = realloc(c.entries,
+                                        c.count * sizeof(fd_entry_t));
+    if (final_entries != NULL) {
+        c.entries = final_entries;
+    }
+    char *final_strings = realloc(c.strings, c.strings_len);
+    if (final_strings != NULL) {
+        c.strings = final_strings;
     }
 
-    *entries = array;
-    *count = num_fds;
+    list->entries = c.entries;
+    list->count = c.count;
+    list->strings = c.strings;
+    list->strings_len = c.strings_len;
     return 0;
 }
 
-void fd_entries_free(fd_entry_t *entries)
+/*
+ * Pid-based entry points: open a handle for the duration of one call.
+ */
+int count_fds(pid_t pid, int *count)
+{
+    if (count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        *count = 0;
+        return -1;
+    }
+
+    int ret = count_fds_at(&h, count);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int count_socket_fds(pid_t pid, int *fd_count, int *socket_count)
+{
+    if (fd_count == NULL || socket_count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        *fd_count = 0;
+        *socket_count = 0;
+        return -1;
+    }
+
+    int ret = count_socket_fds_at(&h, fd_count, socket_count);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int sample_fds(pid_t pid, int size, uint64_t seed, fd_sample_t *out)
+{
+    if (out == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(out, 0, sizeof(*out));
+        return -1;
+    }
+
+    int ret = sample_fds_at(&h, size, seed, out);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int for_each_fd(pid_t pid, fd_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        return -1;
+    }
+
+    int ret = for_each_fd_at(&h, visit, ctx);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int enumerate_fds(pid_t pid, fd_list_t *list)
+{
+    if (list == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(list, 0, sizeof(*list));
+        return -1;
+    }
+
+    int ret = enumerate_fds_at(&h, list);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+void fd_list_free(fd_list_t *list)
 {
-    free(entries);
+    if (list == NULL) {
+        return;
+    }
+
+    free(list->entries);
+    free(list->strings);
+    memset(list, 0, sizeof(*list));
 }
 
 bool parse_socket_inode(const char *target, unsigned long *inode)
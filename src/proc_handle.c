@@ -0,0 +1,208 @@
+/*
+ * proc_handle.c - Open handle on one process's /proc directory
+ *
+ * The pidfd comes from the raw pidfd_open() syscall, since glibc only
+ * wraps it from 2.36.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     /* syscall() */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "proc_handle.h"
+#include "util.h"
+#include "stats.h"
+#include "budget.h"
+
+/*
+ * pidfd_open(pid, 0), or -1 where the kernel or headers lack it.
+ */
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * Implementation of proc_handle_open() - see proc_handle.h for API docs.
+ */
+int proc_handle_open(proc_handle_t *h, pid_t pid)
+{
+    if (h == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    h->pid = pid;
+    h->dirfd = -1;
+    h->pidfd = -1;
+
+    if (pid <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    if (build_proc_path(pid, NULL, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    h->dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (h->dirfd < 0) {
+        return -1;
+    }
+
+    /*
+     * Open the pidfd second and then confirm the directory still resolves:
+     * if it does, the original process was alive (at least as a zombie,
+     * which keeps its PID) when the pidfd was taken, so both refer to it.
+     * A tree under another root has no process behind it to pin.
+     */
+    h->pidfd = proc_root_is_live() ? open_pidfd(pid) : -1;
+    if (h->pidfd >= 0 && faccessat(h->dirfd, "stat", F_OK, 0) != 0) {
+        int saved_errno = errno;
+        proc_handle_close(h);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return 0;
+}
+
+void proc_handle_close(proc_handle_t *h)
+{
+    if (h == NULL) {
+        return;
+    }
+
+    if (h->dirfd >= 0) {
+        close(h->dirfd);
+    }
+    if (h->pidfd >= 0) {
+        close(h->pidfd);
+    }
+    h->dirfd = -1;
+    h->pidfd = -1;
+}
+
+int proc_handle_openat(const proc_handle_t *h, const char *rel, int flags)
+{
+    if (h == NULL || h->dirfd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    STATS_COUNT(STATS_OPENS, 1);
+
+    BUDGET_CHARGE(1);
+    return openat(h->dirfd, rel, flags | O_CLOEXEC);
+}
+
+ssize_t proc_handle_read(const proc_handle_t *h, const char *rel,
+                         char *buf, size_t size)
+{
+    if (buf != NULL && size > 0) {
+        buf[0] = '\0';
+    }
+
+    if (h == NULL || h->dirfd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    return read_file_at(h->dirfd, rel, buf, size);
+}
+
+/*
+ * Implementation of proc_handle_netns() - see proc_handle.h for API docs.
+ */
+int proc_handle_netns(const proc_handle_t *h, unsigned long *netns)
+{
+    if (h == NULL || h->dirfd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (netns == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* stat() follows the link to the namespace's nsfs inode */
+    struct stat st;
+    if (fstatat(h->dirfd, "ns/net", &st, 0) != 0) {
+        return -1;
+    }
+    *netns = (unsigned long)st.st_ino;
+    return 0;
+}
+
+bool proc_handle_exited(const proc_handle_t *h)
+{
+    if (h == NULL || h->dirfd < 0) {
+        return true;
+    }
+
+    /* A pidfd polls readable as soon as the process exits */
+    if (h->pidfd >= 0) {
+        struct pollfd pfd = { .fd = h->pidfd, .events = POLLIN };
+        return poll(&pfd, 1, 0) > 0;
+    }
+
+    return faccessat(h->dirfd, "stat", F_OK, 0) != 0;
+}
+
+/*
+ * Implementation of proc_handle_wait() - see proc_handle.h for API docs.
+ */
+int proc_handle_wait(const proc_handle_t *h, const struct timespec *deadline)
+{
+    if (h == NULL || h->dirfd < 0 || deadline == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (h->pidfd < 0) {
+        int err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline,
+                                  NULL);
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
+    for (;;) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long remaining_ns =
+            (long long)(deadline->tv_sec - now.tv_sec) * 1000000000LL +
+            (deadline->tv_nsec - now.tv_nsec);
+        if (remaining_ns <= 0) {
+            return 0;
+        }
+
+        /* Round up so a sub-millisecond remainder doesn't spin */
+        int timeout_ms = (int)((remaining_ns + 999999) / 1000000);
+        struct pollfd pfd = { .fd = h->pidfd, .events = POLLIN };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0) {
+            return -1;
+        }
+        if (ready > 0) {
+            return 0;
+        }
+    }
+}
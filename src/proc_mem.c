@@ -0,0 +1,699 @@
+/*
+ * proc_mem.c - Memory usage from /proc/<PID>/smaps_rollup and smaps
+ *
+ * Both files are "Key: <n> kB" lines; smaps repeats them after a header
+ * line per mapping. They are streamed through a fixed buffer with
+ * read_lines_at() and parsed in place: the first byte of a line picks the
+ * handful of keys it could be and the value is added into a mem_usage_t.
+ * The per-file breakdown folds each mapping into its file's entry as soon
+ * as the mapping ends, so no mapping is kept.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include "proc_mem.h"
+#include "idmap.h"
+#include "util.h"
+#include "stats.h"
+
+/* smaps_rollup is about 1 KiB */
+#define ROLLUP_READ_SIZE 4096
+
+/* smaps is about 1 KiB per mapping; read many mappings per syscall */
+#define SMAPS_READ_SIZE (64 * 1024)
+
+/* Initial capacity for the per-file array (will grow if needed) */
+#define INITIAL_MEM_FILE_CAPACITY 64
+
+/* Initial name arena size; most library paths are under 64 bytes */
+#define INITIAL_MEM_ARENA_CAPACITY (INITIAL_MEM_FILE_CAPACITY * 64)
+
+/* One smaps key and the mem_usage_t field it adds into */
+typedef struct {
+    const char *key;
+    size_t len;
+    size_t offset;
+} usage_key_t;
+
+#define USAGE_KEY(key, field) \
+    { key, sizeof(key) - 1, offsetof(mem_usage_t, field) }
+
+/* Keys by first byte; others (Referenced, KSM, ...) are skipped */
+static const usage_key_t keys_a[] = {
+    USAGE_KEY("Anonymous:", anonymous_kb),
+    USAGE_KEY("AnonHugePages:", anon_huge_kb),
+};
+static const usage_key_t keys_f[] = {
+    USAGE_KEY("FilePmdMapped:", file_huge_kb),
+};
+static const usage_key_t keys_l[] = {
+    USAGE_KEY("Locked:", locked_kb),
+};
+static const usage_key_t keys_p[] = {
+    USAGE_KEY("Pss:", pss_kb),
+    USAGE_KEY("Pss_Anon:", pss_anon_kb),
+    USAGE_KEY("Pss_File:", pss_file_kb),
+    USAGE_KEY("Pss_Shmem:", pss_shmem_kb),
+    USAGE_KEY("Private_Clean:", private_clean_kb),
+    USAGE_KEY("Private_Dirty:", private_dirty_kb),
+    USAGE_KEY("Private_Hugetlb:", hugetlb_kb),
+};
+static const usage_key_t keys_r[] = {
+    USAGE_KEY("Rss:", rss_kb),
+};
+static const usage_key_t keys_s[] = {
+    USAGE_KEY("Size:", size_kb),
+    USAGE_KEY("Shared_Clean:", shared_clean_kb),
+    USAGE_KEY("Shared_Dirty:", shared_dirty_kb),
+    USAGE_KEY("Shared_Hugetlb:", hugetlb_kb),
+    USAGE_KEY("ShmemPmdMapped:", shmem_huge_kb),
+    USAGE_KEY("Swap:", swap_kb),
+    USAGE_KEY("SwapPss:", swap_pss_kb),
+};
+
+#define KEY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+/*
+ * Add one "Key: <n> kB" line [line, end) into usage if it is a field we
+ * track. Returns true if it was.
+ */
+static bool add_usage_line(const char *line, const char *end,
+                           mem_usage_t *usage)
+{
+    const usage_key_t *keys;
+    size_t count;
+
+    if (line == end) {
+        return false;
+    }
+
+    switch (line[0]) {
+    case 'A': keys = keys_a; count = KEY_COUNT(keys_a); break;
+    case 'F': keys = keys_f; count = KEY_COUNT(keys_f); break;
+    case 'L': keys = keys_l; count = KEY_COUNT(keys_l); break;
+    case 'P': keys = keys_p; count = KEY_COUNT(keys_p); break;
+    case 'R': keys = keys_r; count = KEY_COUNT(keys_r); break;
+    case 'S': keys = keys_s; count = KEY_COUNT(keys_s); break;
+    default:
+        return false;
+    }
+
+    size_t line_len = (size_t)(end - line);
+    for (size_t i = 0; i < count; i++) {
+        if (line_len < keys[i].len ||
+            memcmp(line, keys[i].key, keys[i].len) != 0) {
+            continue;
+        }
+        unsigned long long value;
+        if (scan_decimal(line + keys[i].len, end, &value) == NULL) {
+            return false;
+        }
+        unsigned long *field =
+            (unsigned long *)((char *)usage + keys[i].offset);
+        *field += (unsigned long)value;
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Implementation of parse_mem_usage() - see proc_mem.h for API docs.
+ */
+unsigned parse_mem_usage(const char *text, size_t len, mem_usage_t *usage)
+{
+    if (text == NULL || usage == NULL) {
+        return 0;
+    }
+
+    unsigned added = 0;
+    const char *p = text;
+    const char *end = text + len;
+
+    while (p < end) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = (newline != NULL) ? newline : end;
+        if (add_usage_line(p, line_end, usage)) {
+            added++;
+        }
+        p = (newline != NULL) ? newline + 1 : end;
+    }
+
+    return added;
+}
+
+/*
+ * Add every field of src into dst.
+ */
+static void mem_usage_add(mem_usage_t *dst, const mem_usage_t *src)
+{
+    dst->size_kb += src->size_kb;
+    dst->rss_kb += src->rss_kb;
+    dst->pss_kb += src->pss_kb;
+    dst->pss_anon_kb += src->pss_anon_kb;
+    dst->pss_file_kb += src->pss_file_kb;
+    dst->pss_shmem_kb += src->pss_shmem_kb;
+    dst->shared_clean_kb += src->shared_clean_kb;
+    dst->shared_dirty_kb += src->shared_dirty_kb;
+    dst->private_clean_kb += src->private_clean_kb;
+    dst->private_dirty_kb += src->private_dirty_kb;
+    dst->anonymous_kb += src->anonymous_kb;
+    dst->anon_huge_kb += src->anon_huge_kb;
+    dst->shmem_huge_kb += src->shmem_huge_kb;
+    dst->file_huge_kb += src->file_huge_kb;
+    dst->hugetlb_kb += src->hugetlb_kb;
+    dst->swap_kb += src->swap_kb;
+    dst->swap_pss_kb += src->swap_pss_kb;
+    dst->locked_kb += src->locked_kb;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/*
+ * Parse lowercase hex digits at p. Returns a pointer past the last digit,
+ * or NULL if there is none.
+ */
+static const char *scan_hex(const char *p, const char *end,
+                            unsigned long *value)
+{
+    const char *start = p;
+    unsigned long v = 0;
+    int digit;
+
+    while (p < end && (digit = hex_value(*p)) >= 0) {
+        v = (v << 4) | (unsigned long)digit;
+        p++;
+    }
+    if (p == start) {
+        return NULL;
+    }
+    *value = v;
+    return p;
+}
+
+/* Skip one space-delimited field and the blanks after it */
+static const char *skip_field(const char *p, const char *end)
+{
+    while (p < end && *p != ' ') {
+        p++;
+    }
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Implementation of parse_vma_header() - see proc_mem.h for API docs.
+ */
+int parse_vma_header(const char *line, size_t len, vma_info_t *vma,
+                     size_t *path_len)
+{
+    if (line == NULL || vma == NULL || path_len == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const char *end = line + len;
+    const char *p;
+
+    memset(vma, 0, sizeof(*vma));
+
+    /* start-end perms offset dev inode [path] */
+    p = scan_hex(line, end, &vma->start);
+    if (p == NULL || p == end || *p != '-') {
+        errno = EINVAL;
+        return -1;
+    }
+    p = scan_hex(p + 1, end, &vma->end);
+    if (p == NULL || end - p < 6 || *p != ' ') {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(vma->perms, p + 1, 4);
+    vma->perms[4] = '\0';
+
+    p = skip_field(p + 1, end);     /* perms */
+    p = skip_field(p, end);         /* offset */
+    p = skip_field(p, end);         /* dev */
+
+    unsigned long long inode;
+    p = scan_decimal(p, end, &inode);
+    if (p == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    vma->inode = (unsigned long)inode;
+
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    vma->path = p;
+    *path_len = (size_t)(end - p);
+    return 0;
+}
+
+/* Per-walk state for parse_smaps_lines() */
+typedef struct {
+    vma_visit_fn visit;
+    void *ctx;
+    bool have_vma;          /* vma holds a mapping still being summed */
+    bool stopped;           /* visit returned non-zero */
+    vma_info_t vma;
+    char path[PATH_MAX];    /* Copy of vma.path; the line buffer moves */
+} vma_walk_t;
+
+/*
+ * Hand the finished mapping to the visitor. Returns non-zero to stop.
+ */
+static int finish_vma(vma_walk_t *walk)
+{
+    if (!walk->have_vma) {
+        return 0;
+    }
+    walk->have_vma = false;
+    STATS_COUNT(STATS_ENTRIES, 1);
+    if (walk->visit(&walk->vma, walk->ctx) != 0) {
+        walk->stopped = true;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * read_lines_at() visitor: a line starting with a hex digit opens a new
+ * mapping (keys all start with an uppercase letter), anything else is
+ * summed into the current one.
+ */
+static int parse_smaps_lines(const char *text, size_t len, void *ctx)
+{
+    vma_walk_t *walk = ctx;
+    const char *p = text;
+    const char *end = text + len;
+
+    while (p < end) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = (newline != NULL) ? newline : end;
+
+        if (hex_value(*p) >= 0) {
+            if (finish_vma(walk) != 0) {
+                return 1;
+            }
+            size_t path_len;
+            if (parse_vma_header(p, (size_t)(line_end - p), &walk->vma,
+                                 &path_len) == 0) {
+                if (path_len > sizeof(walk->path) - 1) {
+                    path_len = sizeof(walk->path) - 1;
+                }
+                memcpy(walk->path, walk->vma.path, path_len);
+                walk->path[path_len] = '\0';
+                walk->vma.path = walk->path;
+                walk->have_vma = true;
+            }
+        } else if (walk->have_vma) {
+            add_usage_line(p, line_end, &walk->vma.usage);
+        }
+
+        p = (newline != NULL) ? newline + 1 : end;
+    }
+
+    return 0;
+}
+
+/* for_each_vma_at() body, run inside the memory stats phase */
+static int walk_vmas(const proc_handle_t *h, vma_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (h == NULL || h->dirfd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    char *buf = malloc(SMAPS_READ_SIZE);
+    vma_walk_t *walk = malloc(sizeof(*walk));
+    if (buf == NULL || walk == NULL) {
+        free(buf);
+        free(walk);
+        return -1;
+    }
+    walk->visit = visit;
+    walk->ctx = ctx;
+    walk->have_vma = false;
+    walk->stopped = false;
+
+    int ret = read_lines_at(h->dirfd, "smaps", buf, SMAPS_READ_SIZE,
+                            parse_smaps_lines, walk);
+    if (ret == 0 && !walk->stopped) {
+        finish_vma(walk);
+    }
+
+    int saved_errno = errno;
+    free(buf);
+    free(walk);
+    errno = saved_errno;
+    return ret;
+}
+
+/*
+ * Implementation of for_each_vma_at() - see proc_mem.h for API docs.
+ */
+int for_each_vma_at(const proc_handle_t *h, vma_visit_fn visit, void *ctx)
+{
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_MEMORY);
+    int ret = walk_vmas(h, visit, ctx);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/* read_lines_at() visitor summing smaps_rollup */
+static int parse_rollup_lines(const char *text, size_t len, void *ctx)
+{
+    parse_mem_usage(text, len, ctx);
+    return 0;
+}
+
+/* for_each_vma() visitor summing every mapping; ctx is a mem_usage_t */
+static int sum_vma(const vma_info_t *vma, void *ctx)
+{
+    mem_usage_add(ctx, &vma->usage);
+    return 0;
+}
+
+/* read_mem_usage_at() body, run inside the memory stats phase */
+static int read_usage(const proc_handle_t *h, mem_usage_t *usage)
+{
+    if (usage == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(usage, 0, sizeof(*usage));
+
+    if (h == NULL || h->dirfd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+    char buf[ROLLUP_READ_SIZE];
+    if (read_lines_at(h->dirfd, "smaps_rollup", buf, sizeof(buf),
+                      parse_rollup_lines, usage) == 0) {
+        STATS_COUNT(STATS_ENTRIES, 1);
+        return 0;
+    }
+
+    /* ENOENT from a live process means the kernel predates smaps_rollup */
+    if (errno != ENOENT || proc_handle_exited(h)) {
+        return -1;
+    }
+    memset(usage, 0, sizeof(*usage));
+    if (for_each_vma_at(h, sum_vma, usage) != 0) {
+        int saved_errno = errno;
+        memset(usage, 0, sizeof(*usage));
+        errno = saved_errno;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Implementation of read_mem_usage_at() - see proc_mem.h for API docs.
+ */
+int read_mem_usage_at(const proc_handle_t *h, mem_usage_t *usage)
+{
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_MEMORY);
+    int ret = read_usage(h, usage);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/* Growing arrays and name index filled by collect_vma() */
+typedef struct {
+    mem_file_t *entries;
+    int count;
+    int capacity;
+    char *strings;
+    size_t strings_len;
+    size_t strings_capacity;
+    id_map_t index;         /* Name hash -> entry index */
+    bool failed;            /* Allocation failed; errno is set */
+} mem_file_collector_t;
+
+/* Hash a name for the index, never 0 (reserved by id_map_t) */
+static unsigned long name_key(const char *name, size_t len)
+{
+    uint64_t hash = fnv1a64(name, len);
+    return (hash == 0) ? 1 : (unsigned long)hash;
+}
+
+/*
+ * Find the entry for name or append a zeroed one.
+ * Returns its index, or -1 on allocation failure.
+ */
+static int find_or_add_file(mem_file_collector_t *c, const char *name,
+                            size_t len)
+{
+    unsigned long key = name_key(name, len);
+    int index;
+
+    /* Different names with equal hashes take the next free key */
+    while (id_map_get(&c->index, key, &index)) {
+        const mem_file_t *entry = &c->entries[index];
+        if (entry->name_len == len &&
+            memcmp(c->strings + entry->name_offset, name, len) == 0) {
+            return index;
+        }
+        key = (key + 1 == 0) ? 1 : key + 1;
+    }
+
+    if (reserve_arena(&c->strings, &c->strings_capacity, c->strings_len,
+                      len + 1) != 0) {
+        return -1;
+    }
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = c->capacity * 2;
+        mem_file_t *new_entries = realloc(c->entries,
+                                          new_capacity * sizeof(mem_file_t));
+        if (new_entries == NULL) {
+            return -1;
+        }
+        c->entries = new_entries;
+        c->capacity = new_capacity;
+    }
+
+    if (id_map_put(&c->index, key, c->count) != 0) {
+        return -1;
+    }
+
+    memcpy(c->strings + c->strings_len, name, len);
+    c->strings[c->strings_len + len] = '\0';
+
+    mem_file_t *entry = &c->entries[c->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->name_offset = (uint32_t)c->strings_len;
+    entry->name_len = (uint32_t)len;
+    c->strings_len += len + 1;
+    return c->count++;
+}
+
+/*
+ * for_each_vma() visitor folding the mapping into its file's entry. Stops
+ * the walk on allocation failure.
+ */
+static int collect_vma(const vma_info_t *vma, void *ctx)
+{
+    mem_file_collector_t *c = ctx;
+    const char *name = vma->path;
+
+    if (name[0] == '\0') {
+        name = MEM_ANON_NAME;
+    }
+
+    int index = find_or_add_file(c, name, strlen(name));
+    if (index < 0) {
+        c->failed = true;
+        return 1;
+    }
+
+    mem_file_t *entry = &c->entries[index];
+    entry->vma_count++;
+    mem_usage_add(&entry->usage, &vma->usage);
+    return 0;
+}
+
+/* Highest PSS first, then RSS, then first mapped */
+static int compare_mem_file(const void *a, const void *b)
+{
+    const mem_file_t *x = a, *y = b;
+    if (x->usage.pss_kb != y->usage.pss_kb) {
+        return (x->usage.pss_kb < y->usage.pss_kb) ? 1 : -1;
+    }
+    if (x->usage.rss_kb != y->usage.rss_kb) {
+        return (x->usage.rss_kb < y->usage.rss_kb) ? 1 : -1;
+    }
+    return (x->name_offset > y->name_offset) -
+           (x->name_offset < y->name_offset);
+}
+
+/*
+ * Implementation of enumerate_mem_files_at() - see proc_mem.h for API docs.
+ */
+int enumerate_mem_files_at(const proc_handle_t *h, mem_file_list_t *list)
+{
+    if (list == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(list, 0, sizeof(*list));
+
+    mem_file_collector_t c = {
+        .capacity = INITIAL_MEM_FILE_CAPACITY,
+        .strings_capacity = INITIAL_MEM_ARENA_CAPACITY,
+    };
+    c.entries = malloc(c.capacity * sizeof(mem_file_t));
+    c.strings = malloc(c.strings_capacity);
+    if (c.entries == NULL || c.strings == NULL ||
+        id_map_init(&c.index, INITIAL_MEM_FILE_CAPACITY) != 0) {
+        free(c.entries);
+        free(c.strings);
+        return -1;
+    }
+
+    int ret = for_each_vma_at(h, collect_vma, &c);
+    int saved_errno = errno;
+    id_map_free(&c.index);
+
+    if (ret != 0 || c.failed) {
+        free(c.entries);
+        free(c.strings);
+        errno = saved_errno;
+        return -1;
+    }
+
+    if (c.count == 0) {
+        free(c.entries);
+        free(c.strings);
+        return 0;
+    }
+
+    qsort(c.entries, c.count, sizeof(mem_file_t), compare_mem_file);
+
+    /* Shrink both to exact size to minimize memory footprint */
+    mem_file_t *final_entries = realloc(c.entries,
+                                        c.count * sizeof(mem_file_t));
+    if (final_entries != NULL) {
+        c.entries = final_entries;
+    }
+    char *final_strings = realloc(c.strings, c.strings_len);
+    if (final_strings != NULL) {
+        c.strings = final_strings;
+    }
+
+    list->entries = c.entries;
+    list->count = c.count;
+    list->strings = c.strings;
+    list->strings_len = c.strings_len;
+    return 0;
+}
+
+const char *mem_file_name(const mem_file_list_t *list,
+                          const mem_file_t *entry)
+{
+    if (list == NULL || entry == NULL || list->strings == NULL) {
+        return "";
+    }
+    return list->strings + entry->name_offset;
+}
+
+void mem_file_list_free(mem_file_list_t *list)
+{
+    if (list == NULL) {
+        return;
+    }
+
+    free(list->entries);
+    free(list->strings);
+    memset(list, 0, sizeof(*list));
+}
+
+/*
+ * Pid-based entry points: open a handle for the duration of one call.
+ */
+int read_mem_usage(pid_t pid, mem_usage_t *usage)
+{
+    if (usage == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(usage, 0, sizeof(*usage));
+        return -1;
+    }
+
+    int ret = read_mem_usage_at(&h, usage);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int for_each_vma(pid_t pid, vma_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        return -1;
+    }
+
+    int ret = for_each_vma_at(&h, visit, ctx);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int enumerate_mem_files(pid_t pid, mem_file_list_t *list)
+{
+    if (list == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(list, 0, sizeof(*list));
+        return -1;
+    }
+
+    int ret = enumerate_mem_files_at(&h, list);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
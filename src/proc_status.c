@@ -1,96 +1,322 @@
 /*
  * proc_status.c - Parse /proc/<PID>/status
  *
- * Reads and extracts process information from the status file.
+ * Reads and extracts process information from the status file, opened
+ * relative to a proc_handle_t. Each file is read with plain read() into a
+ * stack buffer and scanned in place: the first byte of a line selects the
+ * one key it could be, numbers are parsed by hand, and parsing stops once
+ * every requested field is filled.
  */
 
-#include <stdio.h>
-#include <stdlib.h>
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "proc_status.h"
 #include "util.h"
 #include "pinspect.h"
+#include "stats.h"
+
+/* Bytes per read(); a whole status file is usually about 1.5 KiB */
+#define STATUS_READ_SIZE 4096
+
+/* Memory lines, which kernel threads and zombies don't have */
+#define STATUS_VM_FIELDS \
+    (STATUS_FIELD_VM_PEAK | STATUS_FIELD_VM_SIZE | STATUS_FIELD_VM_RSS)
 
-/* Maximum line length in /proc/<pid>/status */
-#define STATUS_LINE_MAX 256
+/* --fields masks are passed to the parser unchanged */
+_Static_assert(FIELD_NAME == STATUS_FIELD_NAME &&
+               FIELD_VM_RSS == STATUS_FIELD_VM_RSS &&
+               FIELD_THREADS == STATUS_FIELD_THREADS &&
+               FIELDS_STATUS == STATUS_FIELDS_DEFAULT,
+               "FIELD_* status bits must match STATUS_FIELD_*");
+
+static const char *skip_blanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
 
 /*
- * Parse a single line from /proc/<pid>/status.
- * Returns 0 if line matched a known field, 1 if not recognized.
+ * Return the text after key if the line starts with it, otherwise NULL.
  */
-static int parse_status_line(const char *line, proc_info_t *info)
+static const char *field_value(const char *line, const char *end,
+                               const char *key, size_t key_len)
+{
+    if ((size_t)(end - line) < key_len || memcmp(line, key, key_len) != 0) {
+        return NULL;
+    }
+    return line + key_len;
+}
+
+#define FIELD_VALUE(line, end, key) \
+    field_value((line), (end), key, sizeof(key) - 1)
+
+/* Parse a "Key:\t<n>" line into *value. Returns the field bit or 0. */
+static unsigned parse_ulong_field(const char *value, const char *end,
+                                  unsigned long *out, unsigned field)
 {
-    if (strncmp(line, "Name:", 5) == 0) {
-        sscanf(line, "Name:\t%15s", info->name);
+    unsigned long long v;
+    if (value == NULL || scan_decimal(value, end, &v) == NULL) {
         return 0;
     }
-    if (strncmp(line, "State:", 6) == 0) {
-        char state_char;
-        if (sscanf(line, "State:\t%c", &state_char) == 1) {
-            info->state = char_to_state(state_char);
-        }
+    *out = (unsigned long)v;
+    return field;
+}
+
+/* Parse the real and effective IDs of a Uid:/Gid: line */
+static unsigned parse_id_field(const char *value, const char *end,
+                               unsigned *real, unsigned *effective,
+                               unsigned field)
+{
+    unsigned long long r, e;
+    if (value == NULL || (value = scan_decimal(value, end, &r)) == NULL ||
+        scan_decimal(value, end, &e) == NULL) {
+        return 0;
+    }
+    *real = (unsigned)r;
+    *effective = (unsigned)e;
+    return field;
+}
+
+/*
+ * Parse one status line [line, end) if it holds a wanted field. The first
+ * byte picks the candidate key, so most lines cost one comparison.
+ * Returns the fields the line settled, 0 if none.
+ */
+static unsigned parse_status_line(const char *line, const char *end,
+                                  unsigned wanted, proc_info_t *info)
+{
+    if (line == end) {
         return 0;
     }
-    if (strncmp(line, "Uid:", 4) == 0) {
-        if (sscanf(line, "Uid:\t%u\t%u", &info->uid_real,
-                   &info->uid_effective) == 2) {
+
+    const char *value;
+
+    switch (line[0]) {
+    case 'N':   /* Name, Ngid, NStgid, ... */
+        value = FIELD_VALUE(line, end, "Name:");
+        if (value == NULL || !(wanted & STATUS_FIELD_NAME)) {
             return 0;
         }
-    }
-    if (strncmp(line, "Gid:", 4) == 0) {
-        if (sscanf(line, "Gid:\t%u\t%u", &info->gid_real,
-                   &info->gid_effective) == 2) {
+        value = skip_blanks(value, end);
+        size_t len = (size_t)(end - value);
+        if (len > sizeof(info->name) - 1) {
+            len = sizeof(info->name) - 1;
+        }
+        memcpy(info->name, value, len);
+        info->name[len] = '\0';
+        return STATUS_FIELD_NAME;
+
+    case 'S':   /* State, SigQ, Seccomp, ... */
+        value = FIELD_VALUE(line, end, "State:");
+        if (value == NULL || !(wanted & STATUS_FIELD_STATE)) {
             return 0;
         }
-    }
-    if (strncmp(line, "VmSize:", 7) == 0) {
-        if (sscanf(line, "VmSize:\t%lu", &info->vm_size_kb) == 1) {
+        value = skip_blanks(value, end);
+        if (value == end) {
             return 0;
         }
-    }
-    if (strncmp(line, "VmRSS:", 6) == 0) {
-        if (sscanf(line, "VmRSS:\t%lu", &info->vm_rss_kb) == 1) {
+        info->state = char_to_state(*value);
+        return STATUS_FIELD_STATE;
+
+    case 'U':   /* Uid, Umask */
+        if (!(wanted & STATUS_FIELD_UID)) {
             return 0;
         }
-    }
-    if (strncmp(line, "VmPeak:", 7) == 0) {
-        if (sscanf(line, "VmPeak:\t%lu", &info->vm_peak_kb) == 1) {
+        return parse_id_field(FIELD_VALUE(line, end, "Uid:"), end,
+                              &info->uid_real, &info->uid_effective,
+                              STATUS_FIELD_UID);
+
+    case 'G':   /* Gid, Groups */
+        if (!(wanted & STATUS_FIELD_GID)) {
             return 0;
         }
+        return parse_id_field(FIELD_VALUE(line, end, "Gid:"), end,
+                              &info->gid_real, &info->gid_effective,
+                              STATUS_FIELD_GID);
+
+    case 'V':   /* Vm*: the third byte tells VmPeak/VmSize/VmRSS apart */
+        if (end - line < 3 || line[1] != 'm') {
+            return 0;
+        }
+        switch (line[2]) {
+        case 'P':
+            if (!(wanted & STATUS_FIELD_VM_PEAK)) {
+                return 0;
+            }
+            return parse_ulong_field(FIELD_VALUE(line, end, "VmPeak:"), end,
+                                     &info->vm_peak_kb, STATUS_FIELD_VM_PEAK);
+        case 'S':
+            if (!(wanted & STATUS_FIELD_VM_SIZE)) {
+                return 0;
+            }
+            return parse_ulong_field(FIELD_VALUE(line, end, "VmSize:"), end,
+                                     &info->vm_size_kb, STATUS_FIELD_VM_SIZE);
+        case 'R':
+            if (!(wanted & STATUS_FIELD_VM_RSS)) {
+                return 0;
+            }
+            return parse_ulong_field(FIELD_VALUE(line, end, "VmRSS:"), end,
+                                     &info->vm_rss_kb, STATUS_FIELD_VM_RSS);
+        default:
+            return 0;
+        }
+
+    case 'T': { /* Threads, Tgid, TracerPid, THP_enabled */
+        unsigned long threads;
+        if (!(wanted & STATUS_FIELD_THREADS) ||
+            parse_ulong_field(FIELD_VALUE(line, end, "Threads:"), end,
+                              &threads, STATUS_FIELD_THREADS) == 0) {
+            return 0;
+        }
+        info->thread_count = (int)threads;
+
+        /* Vm* lines come before Threads, so any still missing are absent */
+        return STATUS_FIELD_THREADS | (wanted & STATUS_VM_FIELDS);
     }
-    if (strncmp(line, "Threads:", 8) == 0) {
-        if (sscanf(line, "Threads:\t%d", &info->thread_count) == 1) {
+
+    case 'v':
+        if (!(wanted & STATUS_FIELD_VOLUNTARY_CTXT)) {
             return 0;
         }
+        return parse_ulong_field(
+            FIELD_VALUE(line, end, "voluntary_ctxt_switches:"), end,
+            &info->voluntary_ctxt_switches, STATUS_FIELD_VOLUNTARY_CTXT);
+
+    case 'n':
+        if (!(wanted & STATUS_FIELD_NONVOLUNTARY_CTXT)) {
+            return 0;
+        }
+        return parse_ulong_field(
+            FIELD_VALUE(line, end, "nonvoluntary_ctxt_switches:"), end,
+            &info->nonvoluntary_ctxt_switches,
+            STATUS_FIELD_NONVOLUNTARY_CTXT);
+
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Implementation of parse_proc_status() - see proc_status.h for API docs.
+ */
+unsigned parse_proc_status(const char *text, size_t len, unsigned wanted,
+                           proc_info_t *info)
+{
+    if (text == NULL || info == NULL) {
+        return 0;
     }
 
-    return 1;
+    unsigned settled = 0;
+    const char *p = text;
+    const char *end = text + len;
+
+    /* Stop as soon as every wanted field is settled */
+    while (p < end && (settled & wanted) != wanted) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = (newline != NULL) ? newline : end;
+        settled |= parse_status_line(p, line_end, wanted & ~settled, info);
+        p = (newline != NULL) ? newline + 1 : end;
+    }
+
+    return settled & wanted;
 }
+
+/* Per-file state for parse_status_lines() */
+typedef struct {
+    unsigned wanted;
+    unsigned settled;
+    proc_info_t *info;
+} status_reader_t;
+
+/* read_lines_at() visitor; stops once every wanted field is settled */
+static int parse_status_lines(const char *text, size_t len, void *ctx)
+{
+    status_reader_t *r = ctx;
+    r->settled |= parse_proc_status(text, len, r->wanted & ~r->settled,
+                                    r->info);
+    return (r->settled & r->wanted) == r->wanted;
+}
+
 /*
- * Implementation of read_proc_status() - see proc_status.h for API docs.
+ * Implementation of read_status_fields_at() - see proc_status.h for API docs.
  */
-int read_proc_status(pid_t pid, proc_info_t *info)
+int read_status_fields_at(int dirfd, const char *path, unsigned wanted,
+                          proc_info_t *info)
 {
-    memset(info, 0, sizeof(*info));
-    info->pid = pid;
+    if (path == NULL || info == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
 
-    char path_buf[256];
+    /*
+     * Usually the first read() returns the whole file and parsing stops
+     * there. A single line longer than the buffer (a huge Groups: list)
+     * holds no field parsed here and is skipped.
+     */
+    char buf[STATUS_READ_SIZE];
+    status_reader_t r = { .wanted = wanted, .info = info };
+    return read_lines_at(dirfd, path, buf, sizeof(buf), parse_status_lines,
+                         &r);
+}
 
-    if (build_proc_path(pid, "status", path_buf, sizeof(path_buf)) != 0) {
+/*
+ * Implementation of read_proc_status_at() - see proc_status.h for API docs.
+ */
+int read_proc_status_at(const proc_handle_t *h, proc_info_t *info)
+{
+    return read_proc_status_fields_at(h, STATUS_FIELDS_DEFAULT, info);
+}
+
+/*
+ * Implementation of read_proc_status_fields_at() - see proc_status.h for
+ * API docs.
+ */
+int read_proc_status_fields_at(const proc_handle_t *h, unsigned wanted,
+                               proc_info_t *info)
+{
+    if (h == NULL || info == NULL) {
+        errno = EINVAL;
         return -1;
     }
 
-    FILE *file = fopen(path_buf, "r");
-    if (file == NULL) {
+    memset(info, 0, sizeof(*info));
+    info->pid = h->pid;
+    info->state = PROC_STATE_UNKNOWN;   /* Zero would read as Running */
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_STATUS);
+    STATS_COUNT(STATS_ENTRIES, 1);
+    int ret = read_status_fields_at(h->dirfd, "status", wanted, info);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/*
+ * Implementation of read_proc_status() - see proc_status.h for API docs.
+ */
+int read_proc_status(pid_t pid, proc_info_t *info)
+{
+    if (info == NULL) {
+        errno = EINVAL;
         return -1;
     }
 
-    char line_buffer[256];
-    while (fgets(line_buffer, sizeof(line_buffer), file) != NULL) {
-        parse_status_line(line_buffer, info);
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(info, 0, sizeof(*info));
+        info->pid = pid;
+        return -1;
     }
 
-    fclose(file);
-    return 0;
+    int ret = read_proc_status_at(&h, info);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
 }
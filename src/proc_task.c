@@ -1,8 +1,14 @@
 /*
  * proc_task.c - Enumerate threads from /proc/<PID>/task
  *
- * Uses readdir() to list task directory and reads per-thread
- * comm and status files for thread details.
+ * Lists the task directory with getdents64() and reads each thread's stat
+ * line relative to it, all through one proc_handle_t. One read of stat
+ * gives the name, state, CPU times and last CPU, so a thread costs one
+ * open; status is only read as well when context switches are requested.
+ * for_each_thread_at() does the walk; enumerate_threads_at() collects its
+ * results into an array. enumerate_threads_parallel_at() lists the TIDs
+ * first and reads them in contiguous slices on a worker pool, each worker
+ * writing only its own slice of the result.
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -10,188 +16,564 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
-#include <dirent.h>
-#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "proc_task.h"
+#include "proc_status.h"
 #include "util.h"
+#include "stats.h"
+#include "budget.h"
+#include "sample.h"
+#include "workpool.h"
 
 /* Initial capacity for thread array (will grow if needed) */
 #define INITIAL_THREAD_CAPACITY 32
 
+/* Fewest threads worth a worker of their own, and most workers per walk */
+#define THREAD_SLICE_MIN 512
+#define THREAD_WORKERS_MAX 8
+
+/* A stat line is ~40 numbers plus comm (up to 64 bytes for kworkers) */
+#define THREAD_STAT_MAX 1024
+
+/* 1-based field numbers in /proc/<pid>/task/<tid>/stat (see proc(5)) */
+#define STAT_FIELD_UTIME 14
+#define STAT_FIELD_STIME 15
+#define STAT_FIELD_PROCESSOR 39
+
 /*
- * Check if directory entry is numeric (filter out "." and "..").
+ * Implementation of parse_thread_stat() - see proc_task.h for API docs.
  */
-static bool is_numeric(const char *name)
+int parse_thread_stat(const char *text, size_t len, thread_info_t *thread)
 {
-    if (name == NULL || *name == '\0') {
-        return false;
+    if (text == NULL || thread == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(thread, 0, sizeof(*thread));
+    thread->state = PROC_STATE_UNKNOWN;
+
+    const char *end = text + len;
+    unsigned long long value;
+    const char *p = scan_decimal(text, end, &value);
+    if (p == NULL || p == end || *p != ' ' || p + 1 == end || p[1] != '(') {
+        errno = EINVAL;
+        return -1;
     }
+    thread->tid = (pid_t)value;
 
-    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
-        return false;
+    /* comm may itself contain ") ", so it ends at the last ')' */
+    const char *open = p + 2;
+    const char *close = end;
+    while (close > open && close[-1] != ')') {
+        close--;
+    }
+    if (close == open || end - close < 2) {
+        errno = EINVAL;
+        return -1;
     }
+    close--;    /* Now on the ')' */
 
-    const char *c = name;
-    while (*c != '\0') {
-        if (!isdigit((unsigned char)*c)) {
-            return false;
+    size_t name_len = (size_t)(close - open);
+    if (name_len > sizeof(thread->name) - 1) {
+        name_len = sizeof(thread->name) - 1;
+    }
+    memcpy(thread->name, open, name_len);
+    thread->name[name_len] = '\0';
+
+    /* ") S ..." - field 3 is the state letter */
+    p = close + 2;
+    thread->state = char_to_state(*p++);
+
+    /* Walk the space-separated fields after it, parsing only ours */
+    for (int field = 4; field <= STAT_FIELD_PROCESSOR; field++) {
+        while (p < end && *p == ' ') {
+            p++;
+        }
+        if (p == end) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        if (field == STAT_FIELD_UTIME || field == STAT_FIELD_STIME ||
+            field == STAT_FIELD_PROCESSOR) {
+            if (scan_decimal(p, end, &value) == NULL) {
+                errno = EINVAL;
+                return -1;
+            }
+            if (field == STAT_FIELD_UTIME) {
+                thread->utime = value;
+            } else if (field == STAT_FIELD_STIME) {
+                thread->stime = value;
+            } else {
+                thread->processor = (int)value;
+            }
+        }
+
+        while (p < end && *p != ' ' && *p != '\n') {
+            p++;
         }
-        c++;
     }
 
-    return true;
+    return 0;
 }
 
+/* Per-walk state for visit_task() */
+typedef struct {
+    int taskfd;         /* /proc/<pid>/task */
+    unsigned flags;     /* THREAD_READ_* */
+    thread_visit_fn visit;
+    void *ctx;
+} thread_walk_t;
+
 /*
- * Read thread name from /proc/<pid>/task/<tid>/comm.
- * Returns 0 on success, -1 on error (uses "???" as fallback name).
+ * Add context switch counts from task/<tid>/status. They are best effort:
+ * left at 0 if the thread exits before its status is read.
  */
-static int read_thread_name(pid_t pid, pid_t tid, char *name, size_t size)
+static void read_ctxt_switches(int taskfd, const char *tid,
+                               thread_info_t *thread)
 {
-    char path[PATH_MAX];
-    if (build_task_path(pid, tid, "comm", path, sizeof(path)) != 0) {
-        strncpy(name, "???", size - 1);
-        name[size - 1] = '\0';
-        return -1;
+    char rel[64];
+    int written = snprintf(rel, sizeof(rel), "%s/status", tid);
+    if (written < 0 || written >= (int)sizeof(rel)) {
+        return;
     }
 
-    FILE *fp = fopen(path, "r");
-    if (fp == NULL) {
-        /* TOCTOU race: thread exited between readdir and fopen */
-        strncpy(name, "???", size - 1);
-        name[size - 1] = '\0';
+    proc_info_t info;
+    info.voluntary_ctxt_switches = 0;
+    info.nonvoluntary_ctxt_switches = 0;
+    if (read_status_fields_at(taskfd, rel,
+                              STATUS_FIELD_VOLUNTARY_CTXT |
+                              STATUS_FIELD_NONVOLUNTARY_CTXT, &info) == 0) {
+        thread->nr_voluntary_ctxt_switches = info.voluntary_ctxt_switches;
+        thread->nr_involuntary_ctxt_switches =
+            info.nonvoluntary_ctxt_switches;
+    }
+}
+
+/*
+ * Read task/<name>/stat, and status if flags ask for it, into thread.
+ * Returns 0 on success, -1 if the thread has gone.
+ */
+static int read_thread(int taskfd, const char *name, long id, unsigned flags,
+                       thread_info_t *thread)
+{
+    char rel[64];
+    int written = snprintf(rel, sizeof(rel), "%s/stat", name);
+    if (written < 0 || written >= (int)sizeof(rel)) {
         return -1;
     }
 
-    if (fgets(name, size, fp) == NULL) {
-        strncpy(name, "???", size - 1);
-        name[size - 1] = '\0';
-        fclose(fp);
+    char buf[THREAD_STAT_MAX];
+    ssize_t len = read_file_at(taskfd, rel, buf, sizeof(buf));
+    if (len <= 0 || parse_thread_stat(buf, (size_t)len, thread) != 0) {
+        /* TOCTOU race: thread exited between getdents64 and openat */
         return -1;
     }
+    thread->tid = (pid_t)id;
 
-    fclose(fp);
+    if (flags & THREAD_READ_CTXT_SWITCHES) {
+        read_ctxt_switches(taskfd, name, thread);
+    }
+    return 0;
+}
+
+/*
+ * scan_numeric_dir() visitor: read one thread's stat and pass it on.
+ */
+static int visit_task(const char *name, long id, void *ctx)
+{
+    thread_walk_t *walk = ctx;
 
-    /* Strip trailing newline from comm file */
-    size_t len = strlen(name);
-    if (len > 0 && name[len - 1] == '\n') {
-        name[len - 1] = '\0';
+    thread_info_t thread;
+    if (read_thread(walk->taskfd, name, id, walk->flags, &thread) != 0) {
+        return 0;
     }
 
-    return 0;
+    return walk->visit(&thread, walk->ctx);
 }
 
 /*
- * Read thread state from /proc/<pid>/task/<tid>/status.
- * Returns PROC_STATE_UNKNOWN on error.
+ * Implementation of for_each_thread_at() - see proc_task.h for API docs.
  */
-static proc_state_t read_thread_state(pid_t pid, pid_t tid)
+int for_each_thread_at(const proc_handle_t *h, unsigned flags,
+                       thread_visit_fn visit, void *ctx)
 {
-    char path[PATH_MAX];
-    if (build_task_path(pid, tid, "status", path, sizeof(path)) != 0) {
-        return PROC_STATE_UNKNOWN;
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
     }
 
-    FILE *fp = fopen(path, "r");
-    if (fp == NULL) {
-        /* TOCTOU race: thread exited between readdir and fopen */
-        return PROC_STATE_UNKNOWN;
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_THREADS);
+    thread_walk_t walk = { .flags = flags, .visit = visit, .ctx = ctx };
+    walk.taskfd = proc_handle_openat(h, "task", O_RDONLY | O_DIRECTORY);
+    int ret = -1;
+    if (walk.taskfd >= 0) {
+        ret = scan_numeric_dir(walk.taskfd, visit_task, &walk);
+        int saved_errno = errno;
+        close(walk.taskfd);
+        errno = saved_errno;
+    }
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/*
+ * Implementation of sample_threads_at() - see proc_task.h for API docs.
+ */
+int sample_threads_at(const proc_handle_t *h, int size, uint64_t seed,
+                      thread_sample_t *out)
+{
+    if (out == NULL || size <= 0) {
+        errno = EINVAL;
+        return -1;
     }
 
-    char line[256];
-    proc_state_t state = PROC_STATE_UNKNOWN;
+    memset(out, 0, sizeof(*out));
 
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        char state_char;
-        if (sscanf(line, "State: %c", &state_char) == 1) {
-            state = char_to_state(state_char);
-            break;
+    reservoir_t r;
+    if (reservoir_init(&r, size, seed) != 0) {
+        return -1;
+    }
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_THREADS);
+    int taskfd = proc_handle_openat(h, "task", O_RDONLY | O_DIRECTORY);
+    int ret = (taskfd >= 0) ? sample_numeric_dir(taskfd, &r) : -1;
+    int saved_errno = errno;
+    if (ret == 0) {
+        reservoir_sort(&r);
+        for (int i = 0; i < r.count; i++) {
+            char name[24];
+            snprintf(name, sizeof(name), "%ld", r.ids[i]);
+            thread_info_t thread;
+            if (read_thread(taskfd, name, r.ids[i], 0, &thread) != 0) {
+                /* Exited since the listing: neither counted nor sampled */
+                continue;
+            }
+            out->state_counts[thread.state]++;
+            out->sampled++;
+            BUDGET_YIELD();
         }
+        out->total = (r.seen > INT_MAX) ? INT_MAX : (int)r.seen;
     }
+    if (taskfd >= 0) {
+        close(taskfd);
+    }
+    STATS_PHASE_END(prev);
 
-    fclose(fp);
-    return state;
+    reservoir_free(&r);
+    errno = saved_errno;
+    return ret;
 }
 
+/* Growing array filled by collect_thread() */
+typedef struct {
+    thread_info_t *array;
+    int count;
+    int capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} thread_collector_t;
+
 /*
- * Implementation of enumerate_threads() - see proc_task.h for API docs.
+ * for_each_thread() visitor that appends a copy of the thread. Stops the
+ * walk on allocation failure.
  */
-int enumerate_threads(pid_t pid, thread_info_t **threads, int *count)
+static int collect_thread(const thread_info_t *thread, void *ctx)
+{
+    thread_collector_t *c = ctx;
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = c->capacity * 2;
+        thread_info_t *new_array = realloc(c->array,
+                                           new_capacity * sizeof(thread_info_t));
+        if (new_array == NULL) {
+            c->failed = true;
+            return 1;
+        }
+        c->array = new_array;
+        c->capacity = new_capacity;
+    }
+
+    c->array[c->count++] = *thread;
+    return 0;
+}
+
+/*
+ * Implementation of enumerate_threads_at() - see proc_task.h for API docs.
+ */
+int enumerate_threads_at(const proc_handle_t *h, unsigned flags,
+                         thread_info_t **threads, int *count)
 {
     *threads = NULL;
     *count = 0;
 
-    char path[PATH_MAX];
-    if (build_proc_path(pid, "task", path, sizeof(path)) != 0) {
+    thread_collector_t c = { .capacity = INITIAL_THREAD_CAPACITY };
+    c.array = malloc(c.capacity * sizeof(thread_info_t));
+    if (c.array == NULL) {
         return -1;
     }
 
-    DIR *dir = opendir(path);
-    if (dir == NULL) {
+    if (for_each_thread_at(h, flags, collect_thread, &c) != 0 || c.failed) {
+        int saved_errno = errno;
+        free(c.array);
+        errno = saved_errno;
         return -1;
     }
 
-    int capacity = INITIAL_THREAD_CAPACITY;
-    int num_threads = 0;
+    if (c.count == 0) {
+        free(c.array);
+        return 0;
+    }
 
-    thread_info_t *array = malloc(capacity * sizeof(thread_info_t));
-    if (array == NULL) {
-        closedir(dir);
-        return -1;
+    /* Shrink to exact size to minimize memory footprint */
+    thread_info_t *final_array = realloc(c.array,
+                                         c.count * sizeof(thread_info_t));
+    if (final_array != NULL) {
+        c.array = final_array;
     }
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (!is_numeric(entry->d_name)) {
-            continue;
-        }
+    *threads = c.array;
+    *count = c.count;
+    return 0;
+}
 
-        pid_t tid = atoi(entry->d_name);
+/*
+ * Implementation of thread_workers_for() - see proc_task.h for API docs.
+ */
+int thread_workers_for(int thread_count)
+{
+    int workers = thread_count / THREAD_SLICE_MIN;
+    int cpus = workpool_default_size();
+    if (workers > cpus) {
+        workers = cpus;
+    }
+    if (workers > THREAD_WORKERS_MAX) {
+        workers = THREAD_WORKERS_MAX;
+    }
+    return (workers > 1) ? workers : 1;
+}
 
-        read_thread_name(pid, tid, array[num_threads].name,
-                        sizeof(array[num_threads].name));
-        array[num_threads].tid = tid;
-        array[num_threads].state = read_thread_state(pid, tid);
+/* Growing TID array filled by collect_tid() */
+typedef struct {
+    pid_t *tids;
+    int count;
+    int capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} tid_collector_t;
 
-        num_threads++;
+/* scan_numeric_dir() visitor appending one TID */
+static int collect_tid(const char *name, long id, void *ctx)
+{
+    (void)name;
+    tid_collector_t *c = ctx;
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = c->capacity * 2;
+        pid_t *new_tids = realloc(c->tids, new_capacity * sizeof(pid_t));
+        if (new_tids == NULL) {
+            c->failed = true;
+            return 1;
+        }
+        c->tids = new_tids;
+        c->capacity = new_capacity;
+    }
 
-        /* Double capacity when full (amortized O(1) insertion) */
-        if (num_threads == capacity) {
-            capacity *= 2;
-            thread_info_t *new_array = realloc(array,
-                                              capacity * sizeof(thread_info_t));
-            if (new_array == NULL) {
-                free(array);
-                closedir(dir);
-                return -1;
-            }
-            array = new_array;
+    c->tids[c->count++] = (pid_t)id;
+    return 0;
+}
+
+/* Shared read-only input and disjoint output slices for read_slice() */
+typedef struct {
+    int taskfd;
+    unsigned flags;
+    const pid_t *tids;
+    thread_info_t *out;     /* out[i] is for tids[i]; tid 0 if it exited */
+    int count;
+    int slices;
+} thread_split_t;
+
+/* workpool_run() job: read slice index of the TID list */
+static void read_slice(void *ctx, size_t index)
+{
+    const thread_split_t *s = ctx;
+    int start = (int)((long long)s->count * (long long)index / s->slices);
+    int end = (int)((long long)s->count * (long long)(index + 1) / s->slices);
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_THREADS);
+    for (int i = start; i < end; i++) {
+        char name[24];
+        snprintf(name, sizeof(name), "%d", (int)s->tids[i]);
+        if (read_thread(s->taskfd, name, s->tids[i], s->flags,
+                        &s->out[i]) != 0) {
+            s->out[i].tid = 0;
         }
     }
+    STATS_PHASE_END(prev);
+}
+
+/*
+ * List task/ into a sorted TID array and read it on workers (automatic
+ * when workers <= 0) into a packed, TID-ordered thread array.
+ */
+static int split_threads(const proc_handle_t *h, unsigned flags, int workers,
+                         thread_info_t **threads, int *count)
+{
+    thread_split_t s = { .flags = flags };
+    s.taskfd = proc_handle_openat(h, "task", O_RDONLY | O_DIRECTORY);
+    if (s.taskfd < 0) {
+        return -1;
+    }
+
+    tid_collector_t c = { .capacity = INITIAL_THREAD_CAPACITY };
+    c.tids = malloc(c.capacity * sizeof(pid_t));
+    if (c.tids == NULL ||
+        scan_numeric_dir(s.taskfd, collect_tid, &c) != 0 || c.failed) {
+        int saved_errno = errno;
+        free(c.tids);
+        close(s.taskfd);
+        errno = saved_errno;
+        return -1;
+    }
+    s.count = sort_unique_pids(c.tids, c.count);
+    s.tids = c.tids;
+
+    s.out = (s.count > 0) ? malloc(s.count * sizeof(thread_info_t)) : NULL;
+    if (s.count > 0 && s.out == NULL) {
+        free(c.tids);
+        close(s.taskfd);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    s.slices = (workers > 0) ? workers : thread_workers_for(s.count);
+    if (s.slices > s.count) {
+        s.slices = (s.count > 0) ? s.count : 1;
+    }
 
-    closedir(dir);
+    /* One slice per worker; a pool that fails to start runs them inline */
+    workpool_t pool;
+    if (s.slices > 1 && workpool_init(&pool, s.slices) == 0) {
+        workpool_run(&pool, (size_t)s.slices, read_slice, &s);
+        workpool_destroy(&pool);
+    } else {
+        for (int i = 0; i < s.slices; i++) {
+            read_slice(&s, (size_t)i);
+        }
+    }
+    close(s.taskfd);
+    free(c.tids);
+
+    /* Drop threads that exited mid-walk, keeping TID order */
+    int kept = 0;
+    for (int i = 0; i < s.count; i++) {
+        if (s.out[i].tid != 0) {
+            s.out[kept++] = s.out[i];
+        }
+    }
 
-    if (num_threads == 0) {
-        free(array);
-        *threads = NULL;
-        *count = 0;
+    if (kept == 0) {
+        free(s.out);
         return 0;
     }
 
     /* Shrink to exact size to minimize memory footprint */
-    thread_info_t *final_array = realloc(array,
-                                         num_threads * sizeof(thread_info_t));
+    thread_info_t *final_array = realloc(s.out, kept * sizeof(thread_info_t));
     if (final_array != NULL) {
-        array = final_array;
+        s.out = final_array;
     }
 
-    *threads = array;
-    *count = num_threads;
+    *threads = s.out;
+    *count = kept;
     return 0;
 }
 
+/*
+ * Implementation of enumerate_threads_parallel_at() - see proc_task.h for
+ * API docs.
+ */
+int enumerate_threads_parallel_at(const proc_handle_t *h, unsigned flags,
+                                  int workers, thread_info_t **threads,
+                                  int *count)
+{
+    if (threads == NULL || count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *threads = NULL;
+    *count = 0;
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_THREADS);
+    int ret = split_threads(h, flags, workers, threads, count);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/*
+ * Pid-based entry points: open a handle for the duration of one call.
+ */
+int for_each_thread(pid_t pid, thread_visit_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        return -1;
+    }
+
+    int ret = for_each_thread_at(&h, 0, visit, ctx);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int sample_threads(pid_t pid, int size, uint64_t seed, thread_sample_t *out)
+{
+    if (out == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        memset(out, 0, sizeof(*out));
+        return -1;
+    }
+
+    int ret = sample_threads_at(&h, size, seed, out);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
+int enumerate_threads(pid_t pid, thread_info_t **threads, int *count)
+{
+    *threads = NULL;
+    *count = 0;
+
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        return -1;
+    }
+
+    int ret = enumerate_threads_at(&h, 0, threads, count);
+    int saved_errno = errno;
+    proc_handle_close(&h);
+    errno = saved_errno;
+    return ret;
+}
+
 void thread_info_free(thread_info_t *threads)
 {
     free(threads);
@@ -0,0 +1,167 @@
+/*
+ * sample.c - Reservoir sampling and Wilson score count estimates
+ *
+ * The reservoir keeps the first capacity IDs, then replaces a random
+ * slot with the n-th ID with probability capacity / n, which leaves
+ * every ID offered equally likely to be kept. xorshift64 is plenty for
+ * picking slots and keeps samples reproducible from a seed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "sample.h"
+#include "util.h"
+
+/*
+ * splitmix64 finalizer: spreads small seeds (1, 2, 3...) over all 64
+ * bits, whose first xorshift outputs would otherwise be small numbers
+ * that favour low reservoir slots.
+ */
+static uint64_t mix_seed(uint64_t seed)
+{
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return (z != 0) ? z : 1;
+}
+
+static uint64_t next_random(reservoir_t *r)
+{
+    r->rng ^= r->rng << 13;
+    r->rng ^= r->rng >> 7;
+    r->rng ^= r->rng << 17;
+    return r->rng;
+}
+
+/*
+ * Implementation of reservoir_init() - see sample.h for API docs.
+ */
+int reservoir_init(reservoir_t *r, int capacity, uint64_t seed)
+{
+    if (r == NULL || capacity <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    r->ids = malloc((size_t)capacity * sizeof(long));
+    if (r->ids == NULL) {
+        return -1;
+    }
+    r->capacity = capacity;
+    r->count = 0;
+    r->seen = 0;
+    r->rng = mix_seed(seed);
+    return 0;
+}
+
+void reservoir_offer(reservoir_t *r, long id)
+{
+    r->seen++;
+    if (r->count < r->capacity) {
+        r->ids[r->count++] = id;
+        return;
+    }
+
+    uint64_t slot = next_random(r) % (uint64_t)r->seen;
+    if (slot < (uint64_t)r->capacity) {
+        r->ids[slot] = id;
+    }
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+void reservoir_sort(reservoir_t *r)
+{
+    if (r != NULL && r->count > 1) {
+        qsort(r->ids, (size_t)r->count, sizeof(long), compare_ids);
+    }
+}
+
+void reservoir_free(reservoir_t *r)
+{
+    if (r == NULL) {
+        return;
+    }
+    free(r->ids);
+    r->ids = NULL;
+    r->capacity = 0;
+    r->count = 0;
+    r->seen = 0;
+}
+
+/* scan_numeric_dir() visitor offering one entry to the reservoir */
+static int offer_entry(const char *name, long id, void *ctx)
+{
+    (void)name;
+    reservoir_offer(ctx, id);
+    return 0;
+}
+
+/*
+ * Implementation of sample_numeric_dir() - see sample.h for API docs.
+ */
+int sample_numeric_dir(int dirfd, reservoir_t *r)
+{
+    if (r == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    return scan_numeric_dir(dirfd, offer_entry, r);
+}
+
+/*
+ * Implementation of estimate_count() - see sample.h for API docs.
+ */
+int estimate_count(int hits, int sampled, int population,
+                   count_estimate_t *out)
+{
+    if (out == NULL || hits < 0 || sampled < hits || population < sampled) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    double N = (double)population;
+    if (sampled == population) {
+        out->estimate = out->low = out->high = (double)hits;
+        return 0;
+    }
+    if (sampled == 0) {
+        /* Nothing was seen, so nothing is ruled out */
+        out->estimate = 0;
+        out->low = 0;
+        out->high = N;
+        return 0;
+    }
+
+    /*
+     * Sampling without replacement: the variance of the proportion
+     * shrinks by (N - n) / (N - 1), as if the sample were that much
+     * larger.
+     */
+    double n = (double)sampled;
+    double p = (double)hits / n;
+    double neff = n * (N - 1) / (N - n);
+    double z2 = SAMPLE_Z * SAMPLE_Z;
+    double denom = 1 + z2 / neff;
+    double center = (p + z2 / (2 * neff)) / denom;
+    double half = SAMPLE_Z *
+                  sqrt(p * (1 - p) / neff + z2 / (4 * neff * neff)) / denom;
+
+    double low = (center - half) * N;
+    double high = (center + half) * N;
+    double proven = (double)hits;
+    double ruled_out = (double)(sampled - hits);
+    out->estimate = p * N;
+    out->low = (low > proven) ? low : proven;
+    out->high = (high < N - ruled_out) ? high : N - ruled_out;
+    return 0;
+}
@@ -0,0 +1,440 @@
+/*
+ * scan.c - Host-wide process table scan
+ *
+ * The PID list comes from one getdents64() pass over /proc. Each worker
+ * then fills the summary slot of its own index, opening /proc/<pid>
+ * relative to a shared /proc descriptor, so no locking is needed beyond
+ * the pool's index counter. Dropped processes are marked with PID 0 and
+ * squeezed out once the pool is done.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "scan.h"
+#include "workpool.h"
+#include "proc_handle.h"
+#include "proc_status.h"
+#include "proc_fd.h"
+#include "util.h"
+#include "stats.h"
+#include "budget.h"
+
+/* Initial capacity of the PID list; doubles as needed */
+#define INITIAL_SCAN_CAPACITY 1024
+
+/* Growing PID array filled by add_pid() */
+typedef struct {
+    pid_t *pids;
+    int count;
+    int capacity;
+    bool failed;        /* Allocation failed; errno is set */
+} pid_collector_t;
+
+/* Shared, read-only job context */
+typedef struct {
+    int proc_fd;        /* Open /proc directory */
+    const pid_t *pids;
+    const scan_options_t *opts;
+    unsigned fields;    /* opts->fields plus what filters and sort need */
+    proc_summary_t *items;
+} scan_job_t;
+
+/*
+ * scan_numeric_dir() visitor appending one PID. Stops the scan on
+ * allocation failure.
+ */
+static int add_pid(const char *name, long id, void *ctx)
+{
+    (void)name;
+    pid_collector_t *c = ctx;
+
+    /* Double capacity when full (amortized O(1) insertion) */
+    if (c->count == c->capacity) {
+        int new_capacity = c->capacity * 2;
+        pid_t *new_pids = realloc(c->pids, new_capacity * sizeof(pid_t));
+        if (new_pids == NULL) {
+            c->failed = true;
+            return 1;
+        }
+        c->pids = new_pids;
+        c->capacity = new_capacity;
+    }
+
+    c->pids[c->count++] = (pid_t)id;
+    return 0;
+}
+
+/*
+ * Filters that only need status. Checked before fd/ is read so that
+ * dropped processes cost a single status read.
+ */
+static bool passes_status_filters(const scan_options_t *opts,
+                                  const proc_info_t *info)
+{
+    if (opts->match_uid && info->uid_effective != opts->uid) {
+        return false;
+    }
+    if (info->vm_rss_kb < opts->min_rss_kb) {
+        return false;
+    }
+    return info->thread_count >= opts->min_threads;
+}
+
+/*
+ * Fill the summary of one PID, or leave its PID 0 if the process is gone,
+ * unreadable or filtered out.
+ */
+static void collect_summary(void *ctx, size_t index)
+{
+    scan_job_t *job = ctx;
+    const scan_options_t *opts = job->opts;
+    proc_summary_t *s = &job->items[index];
+
+    /* Settle the previous process's syscalls before starting this one */
+    BUDGET_YIELD();
+
+    char name[16];
+    snprintf(name, sizeof(name), "%d", (int)job->pids[index]);
+
+    /*
+     * A bare directory handle, without the pidfd proc_handle_open() adds:
+     * reads through it already fail once the process is reaped, and the
+     * scan never waits on a process.
+     */
+    proc_handle_t h = { .pid = job->pids[index], .pidfd = -1 };
+    h.dirfd = openat(job->proc_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (h.dirfd < 0) {
+        return;
+    }
+
+    unsigned status = job->fields & FIELDS_STATUS;
+    s->info.pid = h.pid;
+    s->info.state = PROC_STATE_UNKNOWN;
+    if ((status != 0 &&
+         read_proc_status_fields_at(&h, status, &s->info) != 0) ||
+        !passes_status_filters(opts, &s->info)) {
+        s->info.pid = 0;
+        proc_handle_close(&h);
+        return;
+    }
+
+    /*
+     * Sockets need every link read. When that is refused (fd/ of a
+     * process we may not ptrace can be listed but not resolved) the FD
+     * count alone is still worth having.
+     */
+    s->fd_count = -1;
+    s->socket_count = -1;
+    if ((job->fields & FIELD_SOCKETS) &&
+        count_socket_fds_at(&h, &s->fd_count, &s->socket_count) != 0) {
+        s->fd_count = -1;
+        s->socket_count = -1;
+    }
+    if ((job->fields & FIELD_FDS) && s->fd_count < 0 &&
+        count_fds_at(&h, &s->fd_count) != 0) {
+        s->fd_count = -1;
+    }
+
+    if (opts->min_fds > 0 && s->fd_count < opts->min_fds) {
+        s->info.pid = 0;
+    }
+
+    proc_handle_close(&h);
+}
+
+/*
+ * Fields to collect: the requested ones plus those the filters and the
+ * sort key read.
+ */
+static unsigned scan_fields(const scan_options_t *opts)
+{
+    static const unsigned sort_fields[] = {
+        [SCAN_SORT_PID] = 0,
+        [SCAN_SORT_RSS] = FIELD_VM_RSS,
+        [SCAN_SORT_FDS] = FIELD_FDS,
+        [SCAN_SORT_SOCKETS] = FIELD_SOCKETS,
+        [SCAN_SORT_THREADS] = FIELD_THREADS,
+        [SCAN_SORT_UID] = FIELD_UID,
+    };
+
+    unsigned fields = (opts->fields != 0) ? opts->fields : FIELDS_ALL;
+
+    if ((unsigned)opts->sort < sizeof(sort_fields) / sizeof(sort_fields[0])) {
+        fields |= sort_fields[opts->sort];
+    }
+    if (opts->match_uid) {
+        fields |= FIELD_UID;
+    }
+    if (opts->min_rss_kb > 0) {
+        fields |= FIELD_VM_RSS;
+    }
+    if (opts->min_threads > 0) {
+        fields |= FIELD_THREADS;
+    }
+    if (opts->min_fds > 0) {
+        fields |= FIELD_FDS;
+    }
+    return fields;
+}
+
+/*
+ * Compare two summaries by key. Returns < 0 if a comes first in sort
+ * order, > 0 if b does; ties go to the lower PID.
+ */
+static int compare_summaries(const proc_summary_t *a, const proc_summary_t *b,
+                             scan_sort_t sort)
+{
+    unsigned long ka = 0;
+    unsigned long kb = 0;
+    bool descending = true;
+
+    switch (sort) {
+    case SCAN_SORT_RSS:
+        ka = a->info.vm_rss_kb;
+        kb = b->info.vm_rss_kb;
+        break;
+    case SCAN_SORT_FDS:
+        /* Unreadable (-1) sorts below 0 */
+        ka = (unsigned long)(a->fd_count + 1);
+        kb = (unsigned long)(b->fd_count + 1);
+        break;
+    case SCAN_SORT_SOCKETS:
+        ka = (unsigned long)(a->socket_count + 1);
+        kb = (unsigned long)(b->socket_count + 1);
+        break;
+    case SCAN_SORT_THREADS:
+        ka = (unsigned long)a->info.thread_count;
+        kb = (unsigned long)b->info.thread_count;
+        break;
+    case SCAN_SORT_UID:
+        ka = a->info.uid_effective;
+        kb = b->info.uid_effective;
+        descending = false;
+        break;
+    case SCAN_SORT_PID:
+    default:
+        descending = false;
+        break;
+    }
+
+    if (ka != kb) {
+        return ((ka < kb) != descending) ? -1 : 1;
+    }
+    if (a->info.pid != b->info.pid) {
+        return (a->info.pid < b->info.pid) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void swap_summaries(proc_summary_t *a, proc_summary_t *b)
+{
+    proc_summary_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/*
+ * Restore the heap property below root in items[0, size). The heap keeps
+ * the entry that sorts last at the root, so it is the one to replace.
+ */
+static void sift_down(proc_summary_t *items, int size, int root,
+                      scan_sort_t sort)
+{
+    for (;;) {
+        int last = root;
+        int left = 2 * root + 1;
+        int right = left + 1;
+
+        if (left < size &&
+            compare_summaries(&items[left], &items[last], sort) > 0) {
+            last = left;
+        }
+        if (right < size &&
+            compare_summaries(&items[right], &items[last], sort) > 0) {
+            last = right;
+        }
+        if (last == root) {
+            return;
+        }
+        swap_summaries(&items[root], &items[last]);
+        root = last;
+    }
+}
+
+/*
+ * Implementation of select_top_summaries() - see scan.h for API docs.
+ */
+int select_top_summaries(proc_summary_t *items, int count, scan_sort_t sort,
+                         int limit)
+{
+    if (items == NULL || count <= 0) {
+        return 0;
+    }
+
+    int keep = (limit > 0 && limit < count) ? limit : count;
+
+    /* Heapify the first keep entries, worst at the root */
+    for (int i = keep / 2 - 1; i >= 0; i--) {
+        sift_down(items, keep, i, sort);
+    }
+
+    /* Anything that sorts before the current worst replaces it */
+    for (int i = keep; i < count; i++) {
+        if (compare_summaries(&items[i], &items[0], sort) < 0) {
+            items[0] = items[i];
+            sift_down(items, keep, 0, sort);
+        }
+    }
+
+    /* Heapsort: moving the worst to the back leaves the rest in order */
+    for (int end = keep - 1; end > 0; end--) {
+        swap_summaries(&items[0], &items[end]);
+        sift_down(items, end, 0, sort);
+    }
+
+    return keep;
+}
+
+/*
+ * Implementation of scan_processes() - see scan.h for API docs.
+ */
+int scan_processes(const scan_options_t *opts, proc_summary_t **summaries,
+                   int *count)
+{
+    if (summaries == NULL || count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *summaries = NULL;
+    *count = 0;
+
+    if (opts == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_LIST);
+    int proc_fd = open(proc_get_root(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (proc_fd < 0) {
+        STATS_PHASE_END(prev);
+        return -1;
+    }
+
+    pid_collector_t c = { .capacity = INITIAL_SCAN_CAPACITY };
+    c.pids = malloc(c.capacity * sizeof(pid_t));
+    bool listed = c.pids != NULL &&
+                  scan_numeric_dir(proc_fd, add_pid, &c) == 0 && !c.failed;
+    STATS_PHASE_END(prev);
+    if (!listed) {
+        int saved_errno = errno;
+        free(c.pids);
+        close(proc_fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    proc_summary_t *items = NULL;
+    if (c.count > 0) {
+        items = calloc(c.count, sizeof(proc_summary_t));
+    }
+    if (c.count > 0 && items == NULL) {
+        free(c.pids);
+        close(proc_fd);
+        return -1;
+    }
+
+    /* No point starting more threads than there are PIDs */
+    int workers = (opts->workers > 0) ? opts->workers
+                                      : workpool_default_size();
+    if (workers > c.count) {
+        workers = (c.count > 0) ? c.count : 1;
+    }
+
+    workpool_t pool;
+    if (workpool_init(&pool, workers) != 0) {
+        int saved_errno = errno;
+        free(items);
+        free(c.pids);
+        close(proc_fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    scan_job_t job = {
+        .proc_fd = proc_fd, .pids = c.pids, .opts = opts,
+        .fields = scan_fields(opts), .items = items,
+    };
+    workpool_run(&pool, (size_t)c.count, collect_summary, &job);
+    workpool_destroy(&pool);
+    free(c.pids);
+    close(proc_fd);
+
+    int kept = 0;
+    for (int i = 0; i < c.count; i++) {
+        if (items[i].info.pid != 0) {
+            items[kept++] = items[i];
+        }
+    }
+
+    kept = select_top_summaries(items, kept, opts->sort, opts->limit);
+
+    if (kept == 0) {
+        free(items);
+        return 0;
+    }
+
+    /* Shrink to exact size; keep the larger block if realloc fails */
+    proc_summary_t *shrunk = realloc(items, kept * sizeof(proc_summary_t));
+    *summaries = (shrunk != NULL) ? shrunk : items;
+    *count = kept;
+    return 0;
+}
+
+/*
+ * Implementation of scan_parse_sort() - see scan.h for API docs.
+ */
+int scan_parse_sort(const char *name, scan_sort_t *sort)
+{
+    static const struct {
+        const char *name;
+        scan_sort_t sort;
+    } keys[] = {
+        { "pid", SCAN_SORT_PID },
+        { "rss", SCAN_SORT_RSS },
+        { "fds", SCAN_SORT_FDS },
+        { "sockets", SCAN_SORT_SOCKETS },
+        { "threads", SCAN_SORT_THREADS },
+        { "uid", SCAN_SORT_UID },
+    };
+
+    if (name == NULL || sort == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strcmp(name, keys[i].name) == 0) {
+            *sort = keys[i].sort;
+            return 0;
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+void proc_summary_list_free(proc_summary_t *summaries)
+{
+    free(summaries);
+}
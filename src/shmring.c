@@ -0,0 +1,321 @@
+/*
+ * shmring.c - Single-producer, multi-consumer ring in POSIX shared memory
+ *
+ * The object is a header followed by capacity slots. A slot is a sequence
+ * word and the record, stored as 64-bit words with relaxed atomics so the
+ * reader's copy racing the producer's is defined; the release/acquire
+ * fences around the sequence word order the copy (a seqlock). Slots are
+ * padded to a cache line so a reader of slot i never shares a line with
+ * the producer writing slot i + 1.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmring.h"
+
+/* The ring is shared across processes, which lock-based atomics are not */
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "shmring needs lock-free 64-bit atomics"
+#endif
+
+#define CACHE_LINE 64
+#define RECORD_MAX (64 * 1024)
+#define CAPACITY_MAX (1u << 24)
+
+struct shmring_header {
+    _Atomic uint32_t magic;     /* Stored last, once the rest is set */
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;          /* Power of two */
+    uint32_t slot_size;         /* Bytes from one slot to the next */
+    int32_t producer;
+    alignas(CACHE_LINE) _Atomic uint64_t head;  /* Records published */
+};
+
+typedef struct {
+    _Atomic uint64_t seq;
+    _Atomic uint64_t words[];
+} slot_t;
+
+/* Offset of slot 0: the header rounded up to a cache line */
+#define SLOTS_OFFSET \
+    ((sizeof(struct shmring_header) + CACHE_LINE - 1) & \
+     ~(size_t)(CACHE_LINE - 1))
+
+static size_t words_for(size_t record_size)
+{
+    return (record_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+static slot_t *slot_at(const struct shmring_header *h, uint64_t index)
+{
+    uint64_t i = index & (h->capacity - 1);
+    return (slot_t *)((char *)h + SLOTS_OFFSET + i * h->slot_size);
+}
+
+/* shm_open() names are "/" and then 1..NAME_MAX-1 bytes without "/" */
+static bool valid_name(const char *name)
+{
+    if (name == NULL || name[0] != '/' || name[1] == '\0') {
+        return false;
+    }
+    size_t len = strlen(name);
+    return len <= NAME_MAX && strchr(name + 1, '/') == NULL;
+}
+
+/*
+ * Implementation of shmring_create() - see shmring.h for API docs.
+ */
+int shmring_create(shmring_t *ring, const char *name, size_t record_size,
+                   uint32_t capacity, mode_t mode)
+{
+    if (ring == NULL || !valid_name(name) || record_size == 0 ||
+        record_size > RECORD_MAX || capacity == 0 ||
+        capacity > CAPACITY_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint32_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    size_t slot_size = sizeof(slot_t) + words_for(record_size) *
+                       sizeof(uint64_t);
+    slot_size = (slot_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    size_t map_size = SLOTS_OFFSET + (size_t)slots * slot_size;
+
+    /* Replace a stale ring rather than attach to its layout */
+    if (shm_unlink(name) != 0 && errno != ENOENT) {
+        return -1;
+    }
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fd < 0) {
+        return -1;
+    }
+    void *map = MAP_FAILED;
+    if (fchmod(fd, mode) == 0 && ftruncate(fd, (off_t)map_size) == 0) {
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                   0);
+    }
+    if (map == MAP_FAILED) {
+        int saved_errno = errno;
+        close(fd);
+        shm_unlink(name);
+        errno = saved_errno;
+        return -1;
+    }
+    close(fd);
+
+    /* ftruncate() zero-filled it: every slot's sequence is 0, head is 0 */
+    struct shmring_header *h = map;
+    h->version = SHMRING_VERSION;
+    h->record_size = (uint32_t)record_size;
+    h->capacity = slots;
+    h->slot_size = (uint32_t)slot_size;
+    h->producer = (int32_t)getpid();
+    atomic_store_explicit(&h->magic, SHMRING_MAGIC, memory_order_release);
+
+    ring->header = h;
+    ring->map_size = map_size;
+    strcpy(ring->name, name);
+    return 0;
+}
+
+/*
+ * Implementation of shmring_publish() - see shmring.h for API docs.
+ */
+void shmring_publish(shmring_t *ring, const void *record)
+{
+    struct shmring_header *h = ring->header;
+    uint64_t n = atomic_load_explicit(&h->head, memory_order_relaxed);
+    slot_t *slot = slot_at(h, n);
+
+    /* Odd: readers that load it now, or after their copy, retry */
+    atomic_store_explicit(&slot->seq, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    const char *src = record;
+    size_t words = words_for(h->record_size);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t w = 0;
+        size_t left = h->record_size - i * sizeof(w);
+        memcpy(&w, src + i * sizeof(w), left < sizeof(w) ? left : sizeof(w));
+        atomic_store_explicit(&slot->words[i], w, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&slot->seq, 2 * n + 2, memory_order_release);
+    atomic_store_explicit(&h->head, n + 1, memory_order_release);
+}
+
+/*
+ * Implementation of shmring_destroy() - see shmring.h for API docs.
+ */
+void shmring_destroy(shmring_t *ring, bool unlink)
+{
+    if (ring == NULL || ring->header == NULL) {
+        return;
+    }
+    munmap(ring->header, ring->map_size);
+    if (unlink) {
+        shm_unlink(ring->name);
+    }
+    ring->header = NULL;
+}
+
+/*
+ * Implementation of shmring_open() - see shmring.h for API docs.
+ */
+int shmring_open(shmring_reader_t *reader, const char *name,
+                 size_t record_size)
+{
+    if (reader == NULL || !valid_name(name) || record_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    if ((size_t)st.st_size < SLOTS_OFFSET) {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    size_t map_size = (size_t)st.st_size;
+    void *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    int saved_errno = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = saved_errno;
+        return -1;
+    }
+
+    const struct shmring_header *h = map;
+    int err = 0;
+    if (atomic_load_explicit(&h->magic, memory_order_acquire) !=
+            SHMRING_MAGIC ||
+        h->version != SHMRING_VERSION || h->capacity == 0 ||
+        (h->capacity & (h->capacity - 1)) != 0 ||
+        h->slot_size < sizeof(slot_t) + words_for(h->record_size) *
+                                        sizeof(uint64_t) ||
+        map_size < SLOTS_OFFSET + (size_t)h->capacity * h->slot_size) {
+        err = EPROTO;
+    } else if (h->record_size != record_size) {
+        err = EINVAL;
+    }
+    if (err != 0) {
+        munmap(map, map_size);
+        errno = err;
+        return -1;
+    }
+
+    reader->header = h;
+    reader->map_size = map_size;
+    reader->cursor = 0;
+    reader->dropped = 0;
+    shmring_seek(reader, 0);
+    return 0;
+}
+
+/*
+ * Implementation of shmring_read() - see shmring.h for API docs.
+ */
+int shmring_read(shmring_reader_t *reader, void *out)
+{
+    const struct shmring_header *h = reader->header;
+    char *dst = out;
+    size_t words = words_for(h->record_size);
+
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&h->head, memory_order_acquire);
+        if (reader->cursor >= head) {
+            return 0;
+        }
+        if (head - reader->cursor > h->capacity) {
+            reader->dropped += head - h->capacity - reader->cursor;
+            reader->cursor = head - h->capacity;
+        }
+
+        const slot_t *slot = slot_at(h, reader->cursor);
+        uint64_t expected = 2 * reader->cursor + 2;
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) ==
+            expected) {
+            for (size_t i = 0; i < words; i++) {
+                uint64_t w = atomic_load_explicit(&slot->words[i],
+                                                  memory_order_relaxed);
+                size_t left = h->record_size - i * sizeof(w);
+                memcpy(dst + i * sizeof(w), &w,
+                       left < sizeof(w) ? left : sizeof(w));
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->seq, memory_order_relaxed) ==
+                expected) {
+                reader->cursor++;
+                return 1;
+            }
+        }
+
+        /* The producer lapped us onto this slot; the record is gone */
+        reader->dropped++;
+        reader->cursor++;
+    }
+}
+
+/*
+ * Implementation of shmring_head() - see shmring.h for API docs.
+ */
+uint64_t shmring_head(const shmring_reader_t *reader)
+{
+    return atomic_load_explicit(&reader->header->head, memory_order_acquire);
+}
+
+/*
+ * Implementation of shmring_seek() - see shmring.h for API docs.
+ */
+void shmring_seek(shmring_reader_t *reader, uint64_t index)
+{
+    uint64_t head = shmring_head(reader);
+    uint64_t oldest = head > reader->header->capacity
+                          ? head - reader->header->capacity : 0;
+    if (index < oldest) {
+        index = oldest;
+    }
+    reader->cursor = index < head ? index : head;
+}
+
+/*
+ * Implementation of shmring_producer() - see shmring.h for API docs.
+ */
+pid_t shmring_producer(const shmring_reader_t *reader)
+{
+    return (pid_t)reader->header->producer;
+}
+
+/*
+ * Implementation of shmring_close() - see shmring.h for API docs.
+ */
+void shmring_close(shmring_reader_t *reader)
+{
+    if (reader == NULL || reader->header == NULL) {
+        return;
+    }
+    munmap((void *)reader->header, reader->map_size);
+    reader->header = NULL;
+}
@@ -0,0 +1,201 @@
+/*
+ * stats.c - Self-profiling counters for --stats
+ *
+ * One relaxed atomic per phase and counter, shared by all threads. Each
+ * thread keeps its own current phase and the time it entered it, so a
+ * phase change costs one clock_gettime() and two atomic adds.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+static const char *const phase_names[STATS_PHASE_COUNT] = {
+    [STATS_PHASE_OTHER]   = "other",
+    [STATS_PHASE_LIST]    = "list",
+    [STATS_PHASE_STATUS]  = "status",
+    [STATS_PHASE_FDS]     = "fds",
+    [STATS_PHASE_THREADS] = "threads",
+    [STATS_PHASE_NET]     = "net",
+    [STATS_PHASE_MEMORY]  = "memory",
+    [STATS_PHASE_OUTPUT]  = "output",
+};
+
+const char *stats_phase_name(stats_phase_t phase)
+{
+    if ((unsigned)phase >= STATS_PHASE_COUNT) {
+        return "?";
+    }
+    return phase_names[phase];
+}
+
+#ifdef PINSPECT_STATS
+
+bool stats_active = false;
+
+static _Atomic uint64_t counters[STATS_PHASE_COUNT][STATS_COUNTER_COUNT];
+static uint64_t enabled_at_ns;
+
+/* The calling thread's phase and when it entered it */
+static _Thread_local int current_phase = STATS_PHASE_OTHER;
+static _Thread_local uint64_t phase_start_ns;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void add_to(int phase, stats_counter_t counter, uint64_t n)
+{
+    atomic_fetch_add_explicit(&counters[phase][counter], n,
+                              memory_order_relaxed);
+}
+
+bool stats_supported(void)
+{
+    return true;
+}
+
+void stats_enable(void)
+{
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+            atomic_store_explicit(&counters[p][c], 0, memory_order_relaxed);
+        }
+    }
+    enabled_at_ns = now_ns();
+    stats_active = true;
+}
+
+void stats_add(stats_counter_t counter, uint64_t n)
+{
+    add_to(current_phase, counter, n);
+}
+
+/*
+ * Implementation of stats_phase_begin() - see stats.h for API docs.
+ */
+int stats_phase_begin(stats_phase_t phase)
+{
+    int prev = current_phase;
+    if ((int)phase == prev) {
+        return -1;
+    }
+
+    int saved_errno = errno;
+    uint64_t now = now_ns();
+    if (prev != STATS_PHASE_OTHER) {
+        add_to(prev, STATS_WALL_NS, now - phase_start_ns);
+    }
+    add_to(phase, STATS_CALLS, 1);
+    current_phase = phase;
+    phase_start_ns = now;
+    errno = saved_errno;
+    return prev;
+}
+
+void stats_phase_end(int prev)
+{
+    int saved_errno = errno;
+    uint64_t now = now_ns();
+    add_to(current_phase, STATS_WALL_NS, now - phase_start_ns);
+    current_phase = prev;
+    phase_start_ns = now;
+    errno = saved_errno;
+}
+
+void stats_snapshot(stats_snapshot_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+
+    memset(out, 0, sizeof(*out));
+    if (!stats_active) {
+        return;
+    }
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+            out->values[p][c] = atomic_load_explicit(&counters[p][c],
+                                                     memory_order_relaxed);
+        }
+    }
+    out->elapsed_ns = now_ns() - enabled_at_ns;
+}
+
+#else
+
+bool stats_supported(void)
+{
+    return false;
+}
+
+void stats_enable(void)
+{
+}
+
+void stats_snapshot(stats_snapshot_t *out)
+{
+    if (out != NULL) {
+        memset(out, 0, sizeof(*out));
+    }
+}
+
+#endif /* PINSPECT_STATS */
+
+/* Print one table row; calls and wall are blank for the untimed phase */
+static void print_row(FILE *fp, const char *name, const uint64_t *v,
+                      bool timed)
+{
+    if (timed) {
+        fprintf(fp, "  %-8s  %6llu  %9.3f", name,
+                (unsigned long long)v[STATS_CALLS],
+                (double)v[STATS_WALL_NS] / 1e6);
+    } else {
+        fprintf(fp, "  %-8s  %6s  %9s", name, "-", "-");
+    }
+    fprintf(fp, "  %8llu  %6llu  %6llu  %8llu  %8llu  %5llu  %11llu\n",
+            (unsigned long long)v[STATS_ENTRIES],
+            (unsigned long long)v[STATS_OPENS],
+            (unsigned long long)v[STATS_READS],
+            (unsigned long long)v[STATS_READLINKS],
+            (unsigned long long)v[STATS_GETDENTS],
+            (unsigned long long)v[STATS_RING_ENTERS],
+            (unsigned long long)v[STATS_BYTES_READ]);
+}
+
+/*
+ * Implementation of stats_print() - see stats.h for API docs.
+ */
+void stats_print(FILE *fp)
+{
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+
+    fprintf(fp, "\npinspect stats: %.3f ms wall (phase times add up "
+                "across worker threads)\n", (double)snap.elapsed_ns / 1e6);
+    fprintf(fp, "  Phase      Calls    Wall ms   Entries   Opens   Reads  "
+                "Readlink  Getdents  Uring   Bytes read\n");
+    fprintf(fp, "  --------  ------  ---------  --------  ------  ------  "
+                "--------  --------  -----  -----------\n");
+
+    uint64_t total[STATS_COUNTER_COUNT] = { 0 };
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        bool used = false;
+        for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+            total[c] += snap.values[p][c];
+            used = used || snap.values[p][c] != 0;
+        }
+        if (used) {
+            print_row(fp, phase_names[p], snap.values[p],
+                      p != STATS_PHASE_OTHER);
+        }
+    }
+    print_row(fp, "total", total, true);
+}
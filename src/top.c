@@ -0,0 +1,372 @@
+/*
+ * top.c - Per-thread CPU sampling ("pinspect top -H")
+ *
+ * Each refresh walks the task directory into a reused array, looks every
+ * thread up in the previous sample through a TID index, and turns the
+ * tick and context switch deltas into rates. The two sample arrays then
+ * swap roles and the index is rebuilt in place.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include "top.h"
+#include "proc_task.h"
+#include "util.h"
+
+/* Initial slots in the sample arrays; doubled as threads appear */
+#define INITIAL_TOP_CAPACITY 64
+
+/* Set by SIGINT/SIGTERM to end top_run() after the current refresh */
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* Busiest first; equal CPU keeps a stable TID order between refreshes */
+static int compare_rate(const void *a, const void *b)
+{
+    const thread_rate_t *x = a, *y = b;
+    if (x->cpu_percent != y->cpu_percent) {
+        return (x->cpu_percent < y->cpu_percent) ? 1 : -1;
+    }
+    return (x->tid > y->tid) - (x->tid < y->tid);
+}
+
+/*
+ * Grow prev, cur and rates together so every slot index is valid in all
+ * three. Returns 0 on success, -1 on allocation failure (arrays that were
+ * already grown are kept; capacity only changes once all three succeed).
+ */
+static int grow_arrays(top_state_t *state)
+{
+    int new_capacity = state->capacity ? state->capacity * 2
+                                       : INITIAL_TOP_CAPACITY;
+
+    thread_info_t *prev = realloc(state->prev,
+                                  new_capacity * sizeof(thread_info_t));
+    if (prev == NULL) {
+        return -1;
+    }
+    state->prev = prev;
+
+    thread_info_t *cur = realloc(state->cur,
+                                 new_capacity * sizeof(thread_info_t));
+    if (cur == NULL) {
+        return -1;
+    }
+    state->cur = cur;
+
+    thread_rate_t *rates = realloc(state->rates,
+                                   new_capacity * sizeof(thread_rate_t));
+    if (rates == NULL) {
+        return -1;
+    }
+    state->rates = rates;
+
+    state->capacity = new_capacity;
+    return 0;
+}
+
+/* Per-refresh context for collect_thread() */
+typedef struct {
+    top_state_t *state;
+    bool failed;        /* Allocation failed; errno is set */
+} top_collector_t;
+
+/*
+ * for_each_thread_at() visitor appending into state->cur. Stops the walk
+ * on allocation failure.
+ */
+static int collect_thread(const thread_info_t *thread, void *ctx)
+{
+    top_collector_t *c = ctx;
+    top_state_t *state = c->state;
+
+    if (state->cur_count == state->capacity && grow_arrays(state) != 0) {
+        c->failed = true;
+        return 1;
+    }
+
+    state->cur[state->cur_count++] = *thread;
+    return 0;
+}
+
+/*
+ * Implementation of top_init() - see top.h for API docs.
+ */
+int top_init(top_state_t *state, pid_t pid)
+{
+    if (state == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->pid = pid;
+    state->handle.dirfd = -1;
+    state->handle.pidfd = -1;
+
+    state->ticks_per_sec = sysconf(_SC_CLK_TCK);
+    if (state->ticks_per_sec <= 0) {
+        state->ticks_per_sec = 100;
+    }
+
+    if (id_map_init(&state->index, INITIAL_TOP_CAPACITY) != 0) {
+        return -1;
+    }
+    return proc_handle_open(&state->handle, pid);
+}
+
+void top_free(top_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    free(state->prev);
+    free(state->cur);
+    free(state->rates);
+    id_map_free(&state->index);
+    proc_handle_close(&state->handle);
+
+    state->prev = NULL;
+    state->cur = NULL;
+    state->rates = NULL;
+    state->prev_count = 0;
+    state->cur_count = 0;
+    state->capacity = 0;
+    state->primed = false;
+}
+
+/*
+ * Fill state->rates from cur against prev over elapsed seconds.
+ */
+static void compute_rates(const top_state_t *state, double elapsed)
+{
+    double ticks_per_sec = (double)state->ticks_per_sec;
+
+    for (int i = 0; i < state->cur_count; i++) {
+        const thread_info_t *cur = &state->cur[i];
+        thread_rate_t *rate = &state->rates[i];
+
+        /* A thread new since the last sample is charged its whole life */
+        unsigned long long ticks = cur->utime + cur->stime;
+        unsigned long voluntary = cur->nr_voluntary_ctxt_switches;
+        unsigned long involuntary = cur->nr_involuntary_ctxt_switches;
+
+        int slot;
+        if (id_map_get(&state->index, (unsigned long)cur->tid, &slot)) {
+            const thread_info_t *old = &state->prev[slot];
+            unsigned long long old_ticks = old->utime + old->stime;
+
+            /* Counters only go down if the TID was reused in between */
+            if (ticks >= old_ticks &&
+                voluntary >= old->nr_voluntary_ctxt_switches &&
+                involuntary >= old->nr_involuntary_ctxt_switches) {
+                ticks -= old_ticks;
+                voluntary -= old->nr_voluntary_ctxt_switches;
+                involuntary -= old->nr_involuntary_ctxt_switches;
+            }
+        }
+
+        rate->tid = cur->tid;
+        memcpy(rate->name, cur->name, sizeof(rate->name));
+        rate->state = cur->state;
+        rate->processor = cur->processor;
+        rate->cpu_percent = (double)ticks / ticks_per_sec / elapsed * 100.0;
+        rate->voluntary_per_sec = (double)voluntary / elapsed;
+        rate->involuntary_per_sec = (double)involuntary / elapsed;
+    }
+}
+
+/*
+ * Implementation of top_sample() - see top.h for API docs.
+ */
+int top_sample(top_state_t *state, const thread_rate_t **rates, int *count)
+{
+    if (state == NULL || rates == NULL || count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *rates = NULL;
+    *count = 0;
+
+    if (state->capacity == 0 && grow_arrays(state) != 0) {
+        return -1;
+    }
+
+    state->cur_count = 0;
+    top_collector_t c = { .state = state };
+    if (for_each_thread_at(&state->handle, THREAD_READ_CTXT_SWITCHES,
+                           collect_thread, &c) != 0 || c.failed) {
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (state->primed) {
+        double elapsed = timespec_diff_sec(&state->prev_time, &now);
+        if (elapsed > 0) {
+            compute_rates(state, elapsed);
+            *count = state->cur_count;
+            if (*count > 1) {
+                qsort(state->rates, *count, sizeof(thread_rate_t),
+                      compare_rate);
+            }
+            *rates = state->rates;
+        }
+    }
+
+    /* Current sample becomes the baseline; the old array is reused next */
+    thread_info_t *old = state->prev;
+    state->prev = state->cur;
+    state->prev_count = state->cur_count;
+    state->cur = old;
+    state->cur_count = 0;
+    state->prev_time = now;
+    state->primed = true;
+
+    id_map_clear(&state->index);
+    for (int i = 0; i < state->prev_count; i++) {
+        if (id_map_put(&state->index, (unsigned long)state->prev[i].tid,
+                       i) != 0) {
+            /* Without a complete index the next deltas would be wrong */
+            state->primed = false;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Print one refresh: a summary line, then the busiest limit threads.
+ */
+static void print_refresh(FILE *out, pid_t pid, const thread_rate_t *rates,
+                          int count, int limit)
+{
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        total += rates[i].cpu_percent;
+    }
+
+    int shown = (limit > 0 && limit < count) ? limit : count;
+
+    fprintf(out, "\nPID %d: %d threads, %.1f%% CPU\n", pid, count, total);
+    fprintf(out, "%-8s %6s %9s %9s %4s %-10s %s\n",
+            "TID", "CPU%", "VCSW/s", "ICSW/s", "CPU", "State", "Name");
+    for (int i = 0; i < shown; i++) {
+        const thread_rate_t *r = &rates[i];
+        fprintf(out, "%-8d %6.1f %9.1f %9.1f %4d %-10s %s\n",
+                r->tid, r->cpu_percent, r->voluntary_per_sec,
+                r->involuntary_per_sec, r->processor,
+                state_to_string(r->state), r->name);
+    }
+}
+
+/*
+ * Sleep until the absolute monotonic deadline, a stop signal, or the
+ * process exiting.
+ */
+static void wait_for_refresh(const proc_handle_t *h,
+                             const struct timespec *deadline)
+{
+    while (!stop_requested && proc_handle_wait(h, deadline) != 0 &&
+           errno == EINTR) {
+        /* Retry unless a stop signal interrupted the wait */
+    }
+}
+
+/*
+ * Implementation of top_run() - see top.h for API docs.
+ */
+int top_run(pid_t pid, const top_options_t *opts, FILE *out)
+{
+    if (opts == NULL || out == NULL || !(opts->interval_sec > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    stop_requested = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    top_state_t state;
+    if (top_init(&state, pid) != 0) {
+        int saved_errno = errno;
+        top_free(&state);
+        sigaction(SIGINT, &old_int, NULL);
+        sigaction(SIGTERM, &old_term, NULL);
+        errno = saved_errno;
+        return -1;
+    }
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    int ret = 0;
+    int samples = 0;
+
+    while (!stop_requested) {
+        if (proc_handle_exited(&state.handle)) {
+            fprintf(out, "process %d exited\n", pid);
+            break;
+        }
+
+        const thread_rate_t *rates;
+        int count;
+        if (top_sample(&state, &rates, &count) != 0) {
+            if (errno == ENOENT || errno == ESRCH) {
+                fprintf(out, "process %d exited\n", pid);
+            } else {
+                ret = -1;
+            }
+            break;
+        }
+
+        /* The first sample is only a baseline */
+        if (rates != NULL) {
+            print_refresh(out, pid, rates, count, opts->limit);
+            fflush(out);
+
+            samples++;
+            if (opts->max_samples > 0 && samples >= opts->max_samples) {
+                break;
+            }
+        }
+
+        timespec_add_sec(&next, opts->interval_sec);
+
+        /* If a refresh overran the interval, restart the schedule */
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec ||
+            (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now;
+        }
+
+        wait_for_refresh(&state.handle, &next);
+    }
+
+    int saved_errno = errno;
+    top_free(&state);
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    errno = saved_errno;
+    return ret;
+}
@@ -0,0 +1,273 @@
+/*
+ * uring.c - Minimal io_uring for batched statx()
+ *
+ * Maps the submission and completion rings and the SQE array the way
+ * io_uring_setup(2) describes, with acquire/release ordering on the
+ * head and tail indices shared with the kernel.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     /* syscall(), MAP_POPULATE */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include "uring.h"
+#include "stats.h"
+#include "budget.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+static bool probe_result = false;
+
+/* pthread_once() routine: try a one-entry ring */
+static void probe_uring(void)
+{
+    uring_t ring;
+    if (uring_init(&ring, 1) == 0) {
+        probe_result = true;
+        uring_free(&ring);
+    }
+}
+
+bool uring_supported(void)
+{
+    pthread_once(&probe_once, probe_uring);
+    return probe_result;
+}
+
+/* Map one region of the ring fd; NULL on failure */
+static void *map_ring(int fd, size_t size, off_t offset)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, offset);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+
+/*
+ * Implementation of uring_init() - see uring.h for API docs.
+ */
+int uring_init(uring_t *ring, unsigned entries)
+{
+    if (ring == NULL || entries == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(SYS_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_ring_size = params.sq_off.array +
+                         params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = map_ring(ring->fd, ring->sq_ring_size,
+                             IORING_OFF_SQ_RING);
+    ring->cq_ring = map_ring(ring->fd, ring->cq_ring_size,
+                             IORING_OFF_CQ_RING);
+    ring->sqes = map_ring(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+    if (ring->sq_ring == NULL || ring->cq_ring == NULL ||
+        ring->sqes == NULL) {
+        int saved_errno = errno;
+        uring_free(ring);
+        errno = saved_errno;
+        return -1;
+    }
+
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head = (_Atomic unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (_Atomic unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (const unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (_Atomic unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (_Atomic unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (const unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->entries = params.sq_entries;
+    return 0;
+}
+
+void uring_free(uring_t *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+/* io_uring_enter(), counted; EINTR is left to the caller */
+static int enter(uring_t *ring, unsigned submit, unsigned wait)
+{
+    STATS_COUNT(STATS_RING_ENTERS, 1);
+    BUDGET_CHARGE(1);
+    return (int)syscall(SYS_io_uring_enter, ring->fd, submit, wait,
+                        wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/*
+ * Implementation of uring_submit_statx() - see uring.h for API docs.
+ */
+int uring_submit_statx(uring_t *ring, int dirfd, const char *const *names,
+                       unsigned count, int flags, unsigned mask,
+                       struct statx *out)
+{
+    if (ring == NULL || names == NULL || out == NULL ||
+        count > ring->entries) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (ring->pending > 0) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    /* The kernel consumed every earlier SQE, so the whole ring is free */
+    unsigned tail = atomic_load_explicit(ring->sq_tail,
+                                         memory_order_relaxed);
+    for (unsigned i = 0; i < count; i++) {
+        unsigned index = (tail + i) & *ring->sq_mask;
+        struct io_uring_sqe *sqe = &ring->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dirfd;
+        sqe->addr = (uint64_t)(uintptr_t)names[i];
+        sqe->len = mask;
+        sqe->off = (uint64_t)(uintptr_t)&out[i];
+        sqe->statx_flags = (uint32_t)flags;
+        sqe->user_data = i;
+        ring->sq_array[index] = index;
+    }
+    atomic_store_explicit(ring->sq_tail, tail + count,
+                          memory_order_release);
+
+    unsigned submitted = 0;
+    while (submitted < count) {
+        int n = enter(ring, count - submitted, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            /* Whatever did go in must still be reaped */
+            ring->pending = submitted;
+            return -1;
+        }
+        submitted += (unsigned)n;
+    }
+    ring->pending = count;
+    return 0;
+}
+
+/*
+ * Implementation of uring_wait() - see uring.h for API docs.
+ */
+int uring_wait(uring_t *ring, int *res)
+{
+    if (ring == NULL || res == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned head = atomic_load_explicit(ring->cq_head,
+                                         memory_order_relaxed);
+    while (ring->pending > 0) {
+        unsigned tail = atomic_load_explicit(ring->cq_tail,
+                                             memory_order_acquire);
+        if (head == tail) {
+            if (enter(ring, 0, ring->pending) < 0 && errno != EINTR) {
+                return -1;
+            }
+            continue;
+        }
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe =
+                &ring->cqes[head & *ring->cq_mask];
+            res[cqe->user_data] = cqe->res;
+            ring->pending--;
+        }
+        atomic_store_explicit(ring->cq_head, head, memory_order_release);
+    }
+    return 0;
+}
+
+#else
+
+bool uring_supported(void)
+{
+    return false;
+}
+
+int uring_init(uring_t *ring, unsigned entries)
+{
+    (void)entries;
+    if (ring != NULL) {
+        memset(ring, 0, sizeof(*ring));
+        ring->fd = -1;
+    }
+    errno = ENOSYS;
+    return -1;
+}
+
+void uring_free(uring_t *ring)
+{
+    (void)ring;
+}
+
+int uring_submit_statx(uring_t *ring, int dirfd, const char *const *names,
+                       unsigned count, int flags, unsigned mask,
+                       struct statx *out)
+{
+    (void)ring;
+    (void)dirfd;
+    (void)names;
+    (void)count;
+    (void)flags;
+    (void)mask;
+    (void)out;
+    errno = ENOSYS;
+    return -1;
+}
+
+int uring_wait(uring_t *ring, int *res)
+{
+    (void)ring;
+    (void)res;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif /* HAVE_IO_URING */
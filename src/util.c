@@ -4,21 +4,67 @@
  * Helper functions for path building, validation, and conversions.
  */
 
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     /* syscall() */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/syscall.h>
 #include "util.h"
 #include "pinspect.h"
+#include "stats.h"
+#include "budget.h"
+
+/* FNV-1a, 64-bit */
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
 
 #define BASE 10
 
+/* Record layout returned by getdents64(2); glibc has no public header */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Initial capacity for --pgrep match array */
+#define INITIAL_PID_CAPACITY 16
+
+/* Tree every collector reads, set with proc_set_root() */
+static const char *proc_root = PROC_ROOT;
+
+/*
+ * Implementation of proc_set_root() - see util.h for API docs.
+ */
+void proc_set_root(const char *root)
+{
+    proc_root = (root != NULL) ? root : PROC_ROOT;
+}
+
+const char *proc_get_root(void)
+{
+    return proc_root;
+}
+
+bool proc_root_is_live(void)
+{
+    return strcmp(proc_root, PROC_ROOT) == 0;
+}
+
 /*
- * Build a path to a /proc file.
- * If file is NULL, builds path to /proc/<pid> directory.
+ * Build a path to a file under the proc root.
+ * If file is NULL, builds path to <root>/<pid> directory.
  * Returns 0 on success, -1 if path would be truncated.
  */
 int build_proc_path(pid_t pid, const char *file, char *out_path,
@@ -27,9 +73,10 @@ int build_proc_path(pid_t pid, const char *file, char *out_path,
     int ret;
 
     if (file != NULL) {
-        ret = snprintf(out_path, out_path_len, "/proc/%d/%s", pid, file);
+        ret = snprintf(out_path, out_path_len, "%s/%d/%s", proc_root, pid,
+                       file);
     } else {
-        ret = snprintf(out_path, out_path_len, "/proc/%d", pid);
+        ret = snprintf(out_path, out_path_len, "%s/%d", proc_root, pid);
     }
 
     if (ret < 0 || ret >= (int)out_path_len) {
@@ -40,14 +87,14 @@ int build_proc_path(pid_t pid, const char *file, char *out_path,
 }
 
 /*
- * Build a path to a thread-specific /proc file.
+ * Build a path to a thread-specific file under the proc root.
  * Returns 0 on success, -1 if path would be truncated.
  */
 int build_task_path(pid_t pid, pid_t tid, const char *file,
                     char *buf, size_t buflen)
 {
-    int written = snprintf(buf, buflen, "/proc/%d/task/%d/%s",
-                           pid, tid, file);
+    int written = snprintf(buf, buflen, "%s/%d/task/%d/%s",
+                           proc_root, pid, tid, file);
     if (written < 0 || (size_t)written >= buflen) {
         return -1;
     }
@@ -59,7 +106,7 @@ int build_task_path(pid_t pid, pid_t tid, const char *file,
  */
 bool pid_exists(pid_t pid)
 {
-    char buf[256];
+    char buf[PATH_MAX];
 
     if (build_proc_path(pid, NULL, buf, sizeof(buf)) != 0) {
         return false;
@@ -98,6 +145,209 @@ pid_t parse_pid(const char *str)
     return pid;
 }
 
+/*
+ * Read /proc/<pid>/comm into name. Falls back to "?" if unreadable.
+ */
+void read_process_name(pid_t pid, char *name, size_t size)
+{
+    proc_handle_t h;
+    if (proc_handle_open(&h, pid) != 0) {
+        strncpy(name, "?", size - 1);
+        name[size - 1] = '\0';
+        return;
+    }
+
+    read_process_name_at(&h, name, size);
+    proc_handle_close(&h);
+}
+
+/*
+ * Read comm through an open handle. Falls back to "?" if unreadable.
+ */
+void read_process_name_at(const proc_handle_t *h, char *name, size_t size)
+{
+    ssize_t len = proc_handle_read(h, "comm", name, size);
+    if (len <= 0) {
+        strncpy(name, "?", size - 1);
+        name[size - 1] = '\0';
+        return;
+    }
+
+    if (name[len - 1] == '\n') {
+        name[len - 1] = '\0';
+    }
+}
+
+static int compare_pid(const void *a, const void *b)
+{
+    pid_t x = *(const pid_t *)a;
+    pid_t y = *(const pid_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Sort and deduplicate a PID list in place.
+ */
+int sort_unique_pids(pid_t *pids, int count)
+{
+    if (pids == NULL || count <= 1) {
+        return (count < 0) ? 0 : count;
+    }
+
+    qsort(pids, count, sizeof(pid_t), compare_pid);
+
+    int unique = 1;
+    for (int i = 1; i < count; i++) {
+        if (pids[i] != pids[unique - 1]) {
+            pids[unique++] = pids[i];
+        }
+    }
+
+    return unique;
+}
+
+/*
+ * Scan /proc for processes whose comm contains pattern.
+ * Returns 0 on success, -1 on error.
+ */
+static int scan_pids_by_name(const char *pattern, pid_t **pids, int *count)
+{
+    if (pids == NULL || count == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *pids = NULL;
+    *count = 0;
+
+    if (pattern == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    DIR *dir = opendir(proc_root);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    int capacity = INITIAL_PID_CAPACITY;
+    pid_t *array = malloc(capacity * sizeof(pid_t));
+    if (array == NULL) {
+        closedir(dir);
+        return -1;
+    }
+
+    pid_t self = getpid();
+    int n = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        pid_t pid = parse_pid(entry->d_name);
+        if (pid <= 0 || pid == self) {
+            continue;
+        }
+        STATS_COUNT(STATS_ENTRIES, 1);
+
+        char name[PROC_NAME_MAX];
+        read_process_name(pid, name, sizeof(name));
+        if (strstr(name, pattern) == NULL) {
+            continue;
+        }
+
+        /* Double capacity when full (amortized O(1) insertion) */
+        if (n == capacity) {
+            int new_capacity = capacity * 2;
+            pid_t *new_array = realloc(array, new_capacity * sizeof(pid_t));
+            if (new_array == NULL) {
+                free(array);
+                closedir(dir);
+                return -1;
+            }
+            array = new_array;
+            capacity = new_capacity;
+        }
+        array[n++] = pid;
+    }
+
+    closedir(dir);
+
+    if (n == 0) {
+        free(array);
+        return 0;
+    }
+
+    *count = sort_unique_pids(array, n);
+    *pids = array;
+    return 0;
+}
+
+/*
+ * Implementation of find_pids_by_name() - see util.h for API docs.
+ */
+int find_pids_by_name(const char *pattern, pid_t **pids, int *count)
+{
+    int prev = STATS_PHASE_BEGIN(STATS_PHASE_LIST);
+    int ret = scan_pids_by_name(pattern, pids, count);
+    STATS_PHASE_END(prev);
+    return ret;
+}
+
+/*
+ * Implementation of parse_field_list() - see util.h for API docs.
+ */
+int parse_field_list(const char *list, unsigned *fields)
+{
+    static const struct {
+        const char *name;
+        unsigned field;
+    } names[] = {
+        { "name", FIELD_NAME },
+        { "state", FIELD_STATE },
+        { "uid", FIELD_UID },
+        { "gid", FIELD_GID },
+        { "vmpeak", FIELD_VM_PEAK },
+        { "vmsize", FIELD_VM_SIZE },
+        { "rss", FIELD_VM_RSS },
+        { "threads", FIELD_THREADS },
+        { "fds", FIELD_FDS },
+        { "sockets", FIELD_SOCKETS },
+        { "all", FIELDS_ALL },
+    };
+
+    if (list == NULL || fields == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned mask = 0;
+    const char *p = list;
+
+    for (;;) {
+        size_t len = strcspn(p, ",");
+        size_t i = 0;
+        while (i < sizeof(names) / sizeof(names[0]) &&
+               (strlen(names[i].name) != len ||
+                strncmp(p, names[i].name, len) != 0)) {
+            i++;
+        }
+        if (i == sizeof(names) / sizeof(names[0])) {
+            errno = EINVAL;
+            return -1;
+        }
+        mask |= names[i].field;
+
+        if (p[len] == '\0') {
+            break;
+        }
+        p += len + 1;
+    }
+
+    *fields = mask;
+    return 0;
+}
+
 /*
  * Convert process state enum to human-readable string.
  */
@@ -145,3 +395,297 @@ proc_state_t char_to_state(char c)
         return PROC_STATE_UNKNOWN;
     }
 }
+
+const char *scan_decimal(const char *p, const char *end,
+                         unsigned long long *value)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+
+    unsigned long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (unsigned long long)(*p - '0');
+        p++;
+    }
+    *value = v;
+    return p;
+}
+
+#define NSEC_PER_SEC 1000000000L
+
+void timespec_add_sec(struct timespec *ts, double sec)
+{
+    long whole = (long)sec;
+    long nsec = (long)((sec - (double)whole) * NSEC_PER_SEC);
+
+    ts->tv_sec += whole;
+    ts->tv_nsec += nsec;
+    if (ts->tv_nsec >= NSEC_PER_SEC) {
+        ts->tv_sec++;
+        ts->tv_nsec -= NSEC_PER_SEC;
+    }
+}
+
+double timespec_diff_sec(const struct timespec *start,
+                         const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) +
+           (double)(end->tv_nsec - start->tv_nsec) / NSEC_PER_SEC;
+}
+
+/*
+ * Implementation of read_file_at() - see util.h for API docs.
+ */
+ssize_t read_file_at(int dirfd, const char *path, char *buf, size_t size)
+{
+    if (buf == NULL || size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    buf[0] = '\0';
+
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* procfs fills small files in one read; loop in case it doesn't */
+    size_t len = 0;
+    while (len < size - 1) {
+        ssize_t n = read(fd, buf + len, size - 1 - len);
+        STATS_COUNT(STATS_READS, 1);
+        BUDGET_CHARGE(1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int saved_errno = errno;
+            close(fd);
+            errno = saved_errno;
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        STATS_COUNT(STATS_BYTES_READ, n);
+        len += (size_t)n;
+    }
+
+    close(fd);
+    buf[len] = '\0';
+    return (ssize_t)len;
+}
+
+/*
+ * Implementation of reserve_arena() - see util.h for API docs.
+ */
+int reserve_arena(char **strings, size_t *capacity, size_t used,
+                  size_t need)
+{
+    if (*capacity - used >= need) {
+        return 0;
+    }
+
+    /* Offsets are 32-bit; refuse to grow past what they can address */
+    if (used + need > UINT32_MAX) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t new_capacity = *capacity * 2;
+    if (new_capacity < used + need) {
+        new_capacity = used + need;
+    }
+
+    char *new_strings = realloc(*strings, new_capacity);
+    if (new_strings == NULL) {
+        return -1;
+    }
+    *strings = new_strings;
+    *capacity = new_capacity;
+    return 0;
+}
+
+uint64_t fnv1a64(const void *data, size_t len)
+{
+    const unsigned char *bytes = data;
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+ * Index just past the last newline in buf[from, len), or from if none.
+ */
+static size_t complete_lines_end(const char *buf, size_t from, size_t len)
+{
+    while (len > from && buf[len - 1] != '\n') {
+        len--;
+    }
+    return len;
+}
+
+/*
+ * Implementation of read_lines_at() - see util.h for API docs.
+ */
+int read_lines_at(int dirfd, const char *path, char *buf, size_t size,
+                  lines_visit_fn visit, void *ctx)
+{
+    if (path == NULL || buf == NULL || size == 0 || visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    STATS_COUNT(STATS_OPENS, 1);
+    BUDGET_CHARGE(1);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t kept = 0;
+    bool skipping = false;
+
+    for (;;) {
+        ssize_t n = read(fd, buf + kept, size - kept);
+        STATS_COUNT(STATS_READS, 1);
+        BUDGET_CHARGE(1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int saved_errno = errno;
+            close(fd);
+            errno = saved_errno;
+            return -1;
+        }
+        STATS_COUNT(STATS_BYTES_READ, n);
+
+        size_t len = kept + (size_t)n;
+        size_t start = 0;
+        if (skipping) {
+            const char *newline = memchr(buf, '\n', len);
+            if (newline == NULL) {
+                kept = 0;
+                if (n == 0) {
+                    break;
+                }
+                continue;
+            }
+            start = (size_t)(newline + 1 - buf);
+            skipping = false;
+        }
+
+        /* At EOF the final line needs no newline */
+        size_t complete = (n == 0) ? len : complete_lines_end(buf, start, len);
+        if (complete > start &&
+            visit(buf + start, complete - start, ctx) != 0) {
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        /* A budgeted caller pauses between chunks, keeping no lock */
+        BUDGET_YIELD();
+
+        kept = len - complete;
+        if (kept == size) {
+            skipping = true;
+            kept = 0;
+        } else {
+            memmove(buf, buf + complete, kept);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+/*
+ * Implementation of read_dir_batch() - see util.h for API docs.
+ */
+long read_dir_batch(int dirfd, char *buf, size_t size)
+{
+    long nread = syscall(SYS_getdents64, dirfd, buf, size);
+    STATS_COUNT(STATS_GETDENTS, 1);
+    BUDGET_CHARGE(1);
+    return nread;
+}
+
+/*
+ * Implementation of visit_numeric_entries() - see util.h for API docs.
+ */
+int visit_numeric_entries(const char *buf, size_t len, numeric_entry_fn visit,
+                          void *ctx)
+{
+    for (size_t pos = 0; pos < len;) {
+        const struct linux_dirent64 *d =
+            (const struct linux_dirent64 *)(buf + pos);
+        pos += d->d_reclen;
+
+        /* Hand-rolled decimal; rejects ".", ".." and any non-digit */
+        const char *c = d->d_name;
+        long id = 0;
+        while (*c >= '0' && *c <= '9' && id <= (LONG_MAX - 9) / 10) {
+            id = id * 10 + (*c - '0');
+            c++;
+        }
+        if (c == d->d_name || *c != '\0') {
+            continue;
+        }
+        STATS_COUNT(STATS_ENTRIES, 1);
+
+        if (visit(d->d_name, id, ctx) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Implementation of scan_numeric_dir() - see util.h for API docs.
+ */
+int scan_numeric_dir(int dirfd, numeric_entry_fn visit, void *ctx)
+{
+    if (visit == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Heap, not stack: worker threads call this; stays below mmap threshold */
+    char *buf = malloc(DIR_SCAN_BUFFER);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    /* Under a budget, smaller batches spread its sleeps out */
+    size_t size = budget_active ? BUDGET_DIR_BUFFER : DIR_SCAN_BUFFER;
+    for (;;) {
+        long nread = read_dir_batch(dirfd, buf, size);
+        if (nread < 0) {
+            int saved_errno = errno;
+            free(buf);
+            errno = saved_errno;
+            return -1;
+        }
+        if (nread == 0 ||
+            visit_numeric_entries(buf, (size_t)nread, visit, ctx) != 0) {
+            break;
+        }
+        BUDGET_YIELD();
+    }
+
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * watch.c - Continuous sampling with delta output
+ *
+ * Each tick re-collects FDs, threads and sockets, sorts them by key (fd,
+ * tid, inode) and merge-walks them against the previous sample, so output
+ * size tracks churn rather than total object count.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include "watch.h"
+#include "proc_fd.h"
+#include "proc_task.h"
+#include "net.h"
+#include "util.h"
+
+/* Set by SIGINT/SIGTERM to end watch_run() after the current sample */
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static int compare_fd(const void *a, const void *b)
+{
+    const fd_entry_t *x = a, *y = b;
+    return (x->fd > y->fd) - (x->fd < y->fd);
+}
+
+static int compare_tid(const void *a, const void *b)
+{
+    const thread_info_t *x = a, *y = b;
+    return (x->tid > y->tid) - (x->tid < y->tid);
+}
+
+static int compare_inode(const void *a, const void *b)
+{
+    const socket_info_t *x = a, *y = b;
+    return (x->inode > y->inode) - (x->inode < y->inode);
+}
+
+/*
+ * Print "HH:MM:SS.mmm " wall-clock prefix for a change line.
+ */
+static void print_timestamp(FILE *out)
+{
+    struct timespec now;
+    struct tm tm;
+    char buf[16];
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    localtime_r(&now.tv_sec, &tm);
+    strftime(buf, sizeof(buf), "%H:%M:%S", &tm);
+    fprintf(out, "%s.%03ld ", buf, now.tv_nsec / 1000000L);
+}
+
+static void print_socket(FILE *out, const socket_info_t *sock)
+{
+    char local[SOCKET_ADDR_MAX], remote[SOCKET_ADDR_MAX];
+    format_socket_addr(sock, true, local, sizeof(local));
+    format_socket_addr(sock, false, remote, sizeof(remote));
+    fprintf(out, "%-5s %s -> %s", socket_proto_to_string(sock), local, remote);
+}
+
+/*
+ * Merge-walk two fd-sorted arrays and print opened, closed and
+ * retargeted descriptors. Returns number of changes printed.
+ */
+static int diff_fds(FILE *out, const fd_list_t *old_list,
+                    const fd_list_t *cur_list)
+{
+    const fd_entry_t *old = old_list->entries;
+    const fd_entry_t *cur = cur_list->entries;
+    int old_count = old_list->count;
+    int cur_count = cur_list->count;
+    int changes = 0;
+    int i = 0, j = 0;
+
+    while (i < old_count || j < cur_count) {
+        if (j >= cur_count || (i < old_count && old[i].fd < cur[j].fd)) {
+            print_timestamp(out);
+            fprintf(out, "-fd     %-6d %s\n", old[i].fd,
+                    fd_target(old_list, &old[i]));
+            i++;
+        } else if (i >= old_count || cur[j].fd < old[i].fd) {
+            print_timestamp(out);
+            fprintf(out, "+fd     %-6d %s\n", cur[j].fd,
+                    fd_target(cur_list, &cur[j]));
+            j++;
+        } else {
+            /* Same number reused for a different file between samples */
+            const char *old_target = fd_target(old_list, &old[i]);
+            const char *cur_target = fd_target(cur_list, &cur[j]);
+            if (old[i].target_len != cur[j].target_len ||
+                strcmp(old_target, cur_target) != 0) {
+                print_timestamp(out);
+                fprintf(out, "~fd     %-6d %s -> %s\n",
+                        cur[j].fd, old_target, cur_target);
+                changes++;
+            }
+            i++;
+            j++;
+            continue;
+        }
+        changes++;
+    }
+
+    return changes;
+}
+
+/*
+ * Merge-walk two tid-sorted arrays and print spawned and exited threads.
+ * Returns number of changes printed.
+ */
+static int diff_threads(FILE *out, const thread_info_t *old, int old_count,
+                        const thread_info_t *cur, int cur_count)
+{
+    int changes = 0;
+    int i = 0, j = 0;
+
+    while (i < old_count || j < cur_count) {
+        if (j >= cur_count || (i < old_count && old[i].tid < cur[j].tid)) {
+            print_timestamp(out);
+            fprintf(out, "-thread %-6d %s\n", old[i].tid, old[i].name);
+            i++;
+            changes++;
+        } else if (i >= old_count || cur[j].tid < old[i].tid) {
+            print_timestamp(out);
+            fprintf(out, "+thread %-6d %s (%s)\n", cur[j].tid, cur[j].name,
+                    state_to_string(cur[j].state));
+            j++;
+            changes++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    return changes;
+}
+
+/*
+ * Merge-walk two inode-sorted arrays and print new, closed and
+ * state-changed connections. Returns number of changes printed.
+ */
+static int diff_sockets(FILE *out, const socket_info_t *old, int old_count,
+                        const socket_info_t *cur, int cur_count)
+{
+    int changes = 0;
+    int i = 0, j = 0;
+
+    while (i < old_count || j < cur_count) {
+        if (j >= cur_count ||
+            (i < old_count && old[i].inode < cur[j].inode)) {
+            print_timestamp(out);
+            fprintf(out, "-conn   ");
+            print_socket(out, &old[i]);
+            fprintf(out, " %s\n", tcp_state_to_string(old[i].state));
+            i++;
+        } else if (i >= old_count || cur[j].inode < old[i].inode) {
+            print_timestamp(out);
+            fprintf(out, "+conn   ");
+            print_socket(out, &cur[j]);
+            fprintf(out, " %s\n", tcp_state_to_string(cur[j].state));
+            j++;
+        } else {
+            if (old[i].state != cur[j].state) {
+                print_timestamp(out);
+                fprintf(out, "~conn   ");
+                print_socket(out, &cur[j]);
+                fprintf(out, " %s -> %s\n", tcp_state_to_string(old[i].state),
+                        tcp_state_to_string(cur[j].state));
+                changes++;
+            }
+            i++;
+            j++;
+            continue;
+        }
+        changes++;
+    }
+
+    return changes;
+}
+
+/*
+ * Implementation of watch_init() - see watch.h for API docs.
+ */
+int watch_init(watch_state_t *state, pid_t pid, bool network_only)
+{
+    if (state == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(state, 0, sizeof(*state));
+    state->pid = pid;
+    state->network_only = network_only;
+    return proc_handle_open(&state->handle, pid);
+}
+
+/*
+ * Drop the previous sample but keep the process handle.
+ */
+static void free_sample(watch_state_t *state)
+{
+    fd_list_free(&state->fds);
+    thread_info_free(state->threads);
+    socket_list_free(state->sockets);
+    state->threads = NULL;
+    state->sockets = NULL;
+    state->thread_count = 0;
+    state->socket_count = 0;
+    state->primed = false;
+}
+
+void watch_free(watch_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    free_sample(state);
+    proc_handle_close(&state->handle);
+}
+
+/*
+ * Implementation of watch_sample() - see watch.h for API docs.
+ */
+int watch_sample(watch_state_t *state, FILE *out)
+{
+    fd_list_t fds = {0};
+    thread_info_t *threads = NULL;
+    int thread_count = 0;
+    socket_info_t *sockets = NULL;
+    int socket_count = 0;
+
+    /* One fd/ walk per tick serves both the FD diff and the sockets */
+    if (enumerate_fds_at(&state->handle, &fds) != 0) {
+        return -1;
+    }
+
+    if (!state->network_only &&
+        enumerate_threads_parallel_at(&state->handle, 0, 0, &threads,
+                                      &thread_count) != 0) {
+        fd_list_free(&fds);
+        return -1;
+    }
+
+    if (find_fd_list_sockets(&fds, &sockets, &socket_count) != 0) {
+        fd_list_free(&fds);
+        thread_info_free(threads);
+        return -1;
+    }
+
+    if (state->network_only) {
+        fd_list_free(&fds);
+    }
+
+    /* Sort by identity so diffs are a single linear merge */
+    if (fds.count > 1) {
+        qsort(fds.entries, fds.count, sizeof(fd_entry_t), compare_fd);
+    }
+    if (thread_count > 1) {
+        qsort(threads, thread_count, sizeof(thread_info_t), compare_tid);
+    }
+    if (socket_count > 1) {
+        qsort(sockets, socket_count, sizeof(socket_info_t), compare_inode);
+    }
+
+    int changes = 0;
+
+    if (!state->primed) {
+        print_timestamp(out);
+        if (state->network_only) {
+            fprintf(out, "baseline: %d connections\n", socket_count);
+        } else {
+            fprintf(out, "baseline: %d fds, %d threads, %d connections\n",
+                    fds.count, thread_count, socket_count);
+        }
+    } else {
+        changes += diff_fds(out, &state->fds, &fds);
+        changes += diff_threads(out, state->threads, state->thread_count,
+                                threads, thread_count);
+        changes += diff_sockets(out, state->sockets, state->socket_count,
+                                sockets, socket_count);
+    }
+
+    /* Current sample becomes the baseline for the next tick */
+    free_sample(state);
+    state->fds = fds;
+    state->threads = threads;
+    state->thread_count = thread_count;
+    state->sockets = sockets;
+    state->socket_count = socket_count;
+    state->primed = true;
+
+    return changes;
+}
+
+/*
+ * Sleep until the absolute monotonic deadline, a stop signal, or (with a
+ * pidfd) the process exiting.
+ */
+static void wait_for_tick(const proc_handle_t *h,
+                          const struct timespec *deadline)
+{
+    while (!stop_requested && proc_handle_wait(h, deadline) != 0 &&
+           errno == EINTR) {
+        /* Retry unless a stop signal interrupted the wait */
+    }
+}
+
+/*
+ * Implementation of watch_run() - see watch.h for API docs.
+ */
+int watch_run(pid_t pid, const watch_options_t *opts, FILE *out)
+{
+    if (opts == NULL || out == NULL || !(opts->interval_sec > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    stop_requested = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    watch_state_t state;
+    if (watch_init(&state, pid, opts->network_only) != 0) {
+        int saved_errno = errno;
+        sigaction(SIGINT, &old_int, NULL);
+        sigaction(SIGTERM, &old_term, NULL);
+        if (saved_errno == ENOENT || saved_errno == ESRCH) {
+            print_timestamp(out);
+            fprintf(out, "process %d exited\n", pid);
+            return 0;
+        }
+        errno = saved_errno;
+        return -1;
+    }
+
+    /* Absolute deadlines on the monotonic clock keep ticks from drifting */
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    int ret = 0;
+    int samples = 0;
+
+    while (!stop_requested) {
+        /* Checked via the pidfd, so a zombie counts as exited too */
+        if (proc_handle_exited(&state.handle)) {
+            print_timestamp(out);
+            fprintf(out, "process %d exited\n", pid);
+            break;
+        }
+
+        int changes = watch_sample(&state, out);
+        if (changes < 0) {
+            if (errno == ENOENT || errno == ESRCH) {
+                print_timestamp(out);
+                fprintf(out, "process %d exited\n", pid);
+            } else {
+                ret = -1;
+            }
+            break;
+        }
+        fflush(out);
+
+        samples++;
+        if (opts->max_samples > 0 && samples >= opts->max_samples) {
+            break;
+        }
+
+        timespec_add_sec(&next, opts->interval_sec);
+
+        /* If a sample overran the interval, restart the schedule from now */
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec ||
+            (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            next = now;
+        }
+
+        wait_for_tick(&state.handle, &next);
+    }
+
+    int saved_errno = errno;
+    watch_free(&state);
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    errno = saved_errno;
+    return ret;
+}
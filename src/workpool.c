@@ -0,0 +1,164 @@
+/*
+ * workpool.c - Fixed-size pthread worker pool
+ *
+ * Workers sleep on a condition variable between batches. A batch is a
+ * shared counter over [0, count): every participant, including the caller,
+ * claims the next index under the lock and runs the job without it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "workpool.h"
+
+/*
+ * Claim and run items until the batch is exhausted.
+ * Called and returns with pool->lock held.
+ */
+static void drain_batch(workpool_t *pool)
+{
+    while (pool->next < pool->count) {
+        size_t index = pool->next++;
+        workpool_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+
+        pthread_mutex_unlock(&pool->lock);
+        fn(ctx, index);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    workpool_t *pool = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+
+        seen = pool->generation;
+        drain_batch(pool);
+
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+int workpool_default_size(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus > 0) ? (int)cpus : 1;
+}
+
+/*
+ * Implementation of workpool_init() - see workpool.h for API docs.
+ */
+int workpool_init(workpool_t *pool, int size)
+{
+    if (pool == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->size = (size > 0) ? size : workpool_default_size();
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    if (pool->size == 1) {
+        return 0;
+    }
+
+    pool->threads = malloc((pool->size - 1) * sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        pool->size = 1;
+        workpool_destroy(pool);
+        return -1;
+    }
+
+    for (int i = 0; i < pool->size - 1; i++) {
+        int err = pthread_create(&pool->threads[i], NULL, worker_main, pool);
+        if (err != 0) {
+            /* Keep the workers that did start so destroy joins them */
+            pool->size = i + 1;
+            workpool_destroy(pool);
+            errno = err;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Implementation of workpool_run() - see workpool.h for API docs.
+ */
+int workpool_run(workpool_t *pool, size_t count, workpool_fn fn, void *ctx)
+{
+    if (pool == NULL || fn == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->next = 0;
+    pool->busy = pool->size - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    /* Caller works too, then waits for workers still finishing an item */
+    drain_batch(pool);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+
+    pool->fn = NULL;
+    pool->ctx = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+void workpool_destroy(workpool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->size - 1; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    free(pool->threads);
+    pool->threads = NULL;
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+}
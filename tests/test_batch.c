@@ -0,0 +1,440 @@
+/*
+ * test_batch.c - Unit tests for multi-process inspection
+ *
+ * Tests collect_process_reports() and process_reports_free() against the
+ * test process, forked children and a non-existent PID
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../include/batch.h"
+#include "../include/proc_fd.h"
+#include "../include/util.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define CHILDREN 8
+
+/* Test collect_process_reports */
+void test_collect_self(void)
+{
+    TEST("collect_process_reports for current process");
+    pid_t self = getpid();
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = true, .sockets = true,
+                             .workers = 2 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(&self, 1, &opts, &reports);
+    ASSERT_TRUE(ret == 0 && reports != NULL && reports[0].pid == self &&
+                reports[0].status_errno == 0 &&
+                reports[0].info.pid == self &&
+                reports[0].fd_errno == 0 && reports[0].fds.count >= 3 &&
+                reports[0].thread_errno == 0 && reports[0].thread_count >= 1);
+    process_reports_free(reports, 1);
+}
+
+void test_collect_netns(void)
+{
+    TEST("collect_process_reports records the network namespace");
+    pid_t self = getpid();
+    batch_options_t opts = { .sockets = true, .counts_only = true };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(&self, 1, &opts, &reports);
+    struct stat st;
+    ASSERT_TRUE(ret == 0 && reports[0].socket_errno == 0 &&
+                stat("/proc/self/ns/net", &st) == 0 &&
+                reports[0].netns == (unsigned long)st.st_ino);
+    process_reports_free(reports, 1);
+}
+
+void test_collect_children_in_order(void)
+{
+    TEST("collect_process_reports keeps input order across workers");
+    pid_t pids[CHILDREN];
+    int started = 0;
+
+    for (int i = 0; i < CHILDREN; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            pause();
+            _exit(0);
+        }
+        if (child < 0) {
+            break;
+        }
+        pids[started++] = child;
+    }
+
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = false, .sockets = false,
+                             .workers = 4 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(pids, started, &opts, &reports);
+
+    bool ok = (ret == 0 && started == CHILDREN);
+    for (int i = 0; ok && i < started; i++) {
+        ok = reports[i].pid == pids[i] && reports[i].info.pid == pids[i] &&
+             reports[i].status_errno == 0 && reports[i].threads == NULL;
+    }
+    ASSERT_TRUE(ok);
+
+    process_reports_free(reports, started);
+    for (int i = 0; i < started; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+void test_collect_counts_only(void)
+{
+    TEST("collect_process_reports counts_only keeps counts, no entries");
+    pid_t self = getpid();
+    batch_options_t full = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .sockets = true, .workers = 1 };
+    batch_options_t counts = { .status_fields = FIELDS_STATUS,
+                               .fds = true, .sockets = true,
+                               .counts_only = true, .workers = 1 };
+    process_report_t *a = NULL, *b = NULL;
+    int ret1 = collect_process_reports(&self, 1, &full, &a);
+    int ret2 = collect_process_reports(&self, 1, &counts, &b);
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 &&
+                b[0].fd_errno == 0 && b[0].socket_errno == 0 &&
+                b[0].fds.count == a[0].fds.count &&
+                b[0].socket_count == a[0].socket_count &&
+                b[0].fds.entries == NULL && b[0].fds.strings == NULL &&
+                b[0].sockets == NULL);
+    process_reports_free(a, 1);
+    process_reports_free(b, 1);
+}
+
+void test_collect_shared_sockets(void)
+{
+    TEST("collect_process_reports gives shared sockets to every holder");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    pid_t pids[3] = { getpid(), -1, -1 };
+    int started = 1;
+
+    /* Both children inherit the pair; the sockets-only report drops FDs */
+    for (int i = 1; ret0 == 0 && i < 3; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            pause();
+            _exit(0);
+        }
+        if (child < 0) {
+            break;
+        }
+        pids[started++] = child;
+    }
+
+    batch_options_t opts = { .status_fields = FIELD_NAME, .sockets = true,
+                             .workers = 2 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(pids, started, &opts, &reports);
+
+    bool ok = (ret0 == 0 && ret == 0 && started == 3);
+    for (int i = 0; ok && i < started; i++) {
+        int found = 0;
+        for (int j = 0; j < reports[i].socket_count; j++) {
+            found += reports[i].socket_fds[j] == pair[0] ||
+                     reports[i].socket_fds[j] == pair[1];
+        }
+        ok = reports[i].socket_errno == 0 && found == 2 &&
+             reports[i].socket_count == reports[0].socket_count &&
+             reports[i].fds.count == 0 && reports[i].fds.entries == NULL;
+    }
+    ASSERT_TRUE(ok);
+
+    process_reports_free(reports, ret == 0 ? started : 0);
+    for (int i = 1; i < started; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+    }
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+void test_collect_dup_socket_fds(void)
+{
+    TEST("collect_process_reports lists every FD of a dup'd socket once");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    int a = (ret0 == 0) ? dup(pair[0]) : -1;
+    pid_t self = getpid();
+    batch_options_t opts = { .status_fields = FIELD_NAME, .sockets = true,
+                             .workers = 1 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(&self, 1, &opts, &reports);
+
+    bool ok = ret0 == 0 && a >= 0 && ret == 0;
+    int listed = 0;
+    int n = 0;
+    const int *fds = NULL;
+    for (int j = 0; ok && j < reports[0].socket_count; j++) {
+        if (reports[0].socket_fds[j] == pair[0] ||
+            reports[0].socket_fds[j] == a) {
+            listed++;
+            const inode_set_t *set = &reports[0].socket_inodes;
+            fds = inode_set_fds(set,
+                                inode_set_find(set,
+                                               reports[0].sockets[j].inode),
+                                &n);
+        }
+    }
+    ASSERT_TRUE(ok && listed == 1 && fds != NULL && n == 2 &&
+                fds[0] == pair[0] && fds[1] == a);
+
+    process_reports_free(reports, ret == 0 ? 1 : 0);
+    if (a >= 0) {
+        close(a);
+    }
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+void test_collect_memory(void)
+{
+    TEST("collect_process_reports with memory and per-file breakdown");
+    pid_t self = getpid();
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .memory = true, .memory_files = true,
+                             .workers = 1 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(&self, 1, &opts, &reports);
+    ASSERT_TRUE(ret == 0 && reports[0].memory_errno == 0 &&
+                reports[0].memory.pss_kb > 0 &&
+                reports[0].memory_files_errno == 0 &&
+                reports[0].memory_files.count > 0 &&
+                reports[0].fds.entries == NULL);
+    process_reports_free(reports, 1);
+}
+
+void test_collect_field_selection(void)
+{
+    TEST("collect_process_reports runs only the selected collectors");
+    pid_t pids[2] = { getpid(), 999999 };
+    batch_options_t opts = { .status_fields = FIELD_VM_RSS, .fds = true,
+                             .counts_only = true, .workers = 1 };
+    process_report_t *reports = NULL;
+    int ret1 = collect_process_reports(pids, 2, &opts, &reports);
+    bool rss_ok = ret1 == 0 && reports[0].status_errno == 0 &&
+                  reports[0].info.pid == pids[0] &&
+                  reports[0].info.vm_rss_kb > 0 &&
+                  reports[0].info.name[0] == '\0' &&
+                  reports[0].info.state == PROC_STATE_UNKNOWN &&
+                  reports[0].fds.count >= 3 && reports[0].sockets == NULL &&
+                  reports[1].status_errno == ENOENT;
+    process_reports_free(reports, ret1 == 0 ? 2 : 0);
+
+    /* No status fields: status is not read, but a missing PID still fails */
+    opts.status_fields = 0;
+    int ret2 = collect_process_reports(pids, 2, &opts, &reports);
+    bool none_ok = ret2 == 0 && reports[0].status_errno == 0 &&
+                   reports[0].info.pid == pids[0] &&
+                   reports[0].info.vm_rss_kb == 0 &&
+                   reports[0].fds.count >= 3 &&
+                   reports[1].status_errno == ENOENT;
+    ASSERT_TRUE(rss_ok && none_ok);
+    process_reports_free(reports, ret2 == 0 ? 2 : 0);
+}
+
+void test_collect_nonexistent(void)
+{
+    TEST("collect_process_reports records per-PID ENOENT");
+    pid_t pids[] = { getpid(), 999999 };
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = false, .sockets = false,
+                             .workers = 0 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(pids, 2, &opts, &reports);
+    ASSERT_TRUE(ret == 0 && reports[0].status_errno == 0 &&
+                reports[1].status_errno == ENOENT && reports[1].fds.entries == NULL);
+    process_reports_free(reports, 2);
+}
+
+/*
+ * Test a process whose fd/ lists but whose links cannot be read: under a
+ * fixture root, 77/fd holds a /dev/null link and a plain file, whose
+ * readlinkat() fails with EINVAL. The count still comes from the listing;
+ * only sockets fail.
+ */
+void test_collect_unresolvable_fds(void)
+{
+    TEST("collect_process_reports counts fd/ whose links cannot be read");
+    char root[] = "/tmp/test_batch_root_XXXXXX";
+    char path[128];
+    bool built = mkdtemp(root) != NULL;
+    static const char *const dirs[] = { "77", "77/fd" };
+    for (size_t i = 0; built && i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        built = mkdir(path, 0755) == 0;
+    }
+    snprintf(path, sizeof(path), "%s/77/fd/0", root);
+    built = built && symlink("/dev/null", path) == 0;
+    snprintf(path, sizeof(path), "%s/77/fd/3", root);
+    FILE *fp = built ? fopen(path, "w") : NULL;
+    built = fp != NULL && fclose(fp) == 0;
+
+    pid_t pid = 77;
+    batch_options_t opts = { .fds = true, .sockets = true,
+                             .counts_only = true, .workers = 1 };
+    process_report_t *reports = NULL;
+    proc_set_root(root);
+    int ret = built ? collect_process_reports(&pid, 1, &opts, &reports) : -1;
+    proc_set_root(NULL);
+
+    ASSERT_TRUE(ret == 0 && reports[0].status_errno == 0 &&
+                reports[0].fd_errno == 0 && reports[0].fds.count == 2 &&
+                reports[0].socket_errno == EINVAL &&
+                reports[0].socket_count == 0);
+    process_reports_free(reports, 1);
+
+    static const char *const files[] = { "77/fd/3", "77/fd/0", "77/fd",
+                                         "77", "" };
+    for (size_t i = 0; i < 5; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        remove(path);
+    }
+}
+
+void test_collect_sampled(void)
+{
+    TEST("collect_process_reports with sample_size fills the samples only");
+    pid_t self = getpid();
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = true,
+                             .sample_size = 2, .seed = 5, .workers = 1 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(&self, 1, &opts, &reports);
+    const process_report_t *r = reports;
+    ASSERT_TRUE(ret == 0 && r->fd_errno == 0 && r->thread_errno == 0 &&
+                r->fd_sample.total >= 3 && r->fd_sample.sampled == 2 &&
+                r->thread_sample.total >= 1 &&
+                r->thread_sample.sampled == r->thread_sample.total &&
+                r->fds.count == 0 && r->fds.entries == NULL &&
+                r->threads == NULL);
+    process_reports_free(reports, 1);
+}
+
+void test_collect_fd_summary(void)
+{
+    TEST("collect_process_reports with fd_summary keeps no FD list");
+    pid_t self = getpid();
+    int fd_count = 0;
+    batch_options_t opts = { .status_fields = FIELDS_STATUS, .fds = true,
+                             .fd_summary = true, .workers = 1 };
+    process_report_t *reports = NULL;
+    int ret1 = count_fds(self, &fd_count);
+    int ret2 = collect_process_reports(&self, 1, &opts, &reports);
+    const process_report_t *r = reports;
+    /* The summary's walk holds one directory FD that count_fds() did */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && r->fd_errno == 0 &&
+                r->fd_summary.total == fd_count &&
+                r->fd_summary.kind_counts[FD_KIND_DEVICE] +
+                    r->fd_summary.kind_counts[FD_KIND_FILE] > 0 &&
+                r->fds.count == 0 && r->fds.entries == NULL);
+    process_reports_free(reports, 1);
+}
+
+void test_collect_invalid(void)
+{
+    TEST("collect_process_reports with no PIDs, sampled or summarized "
+         "sockets (EINVAL)");
+    batch_options_t opts = { .status_fields = FIELDS_STATUS,
+                             .fds = true, .threads = true, .sockets = true,
+                             .workers = 0 };
+    process_report_t *reports = NULL;
+    int ret = collect_process_reports(NULL, 0, &opts, &reports);
+    int err = errno;
+
+    /* Socket matching needs every FD, which a sample does not read */
+    pid_t self = getpid();
+    opts.sample_size = 10;
+    int ret2 = collect_process_reports(&self, 1, &opts, &reports);
+    int err2 = errno;
+
+    /* Nor does a summary, and a sample and a summary exclude each other */
+    opts.sample_size = 0;
+    opts.fd_summary = true;
+    int ret3 = collect_process_reports(&self, 1, &opts, &reports);
+    int err3 = errno;
+    opts.sockets = false;
+    opts.sample_size = 10;
+    int ret4 = collect_process_reports(&self, 1, &opts, &reports);
+    ASSERT_TRUE(ret == -1 && err == EINVAL && ret2 == -1 &&
+                err2 == EINVAL && ret3 == -1 && err3 == EINVAL &&
+                ret4 == -1 && errno == EINVAL && reports == NULL);
+}
+
+/* Test process_reports_free */
+void test_process_reports_free_null(void)
+{
+    TEST("process_reports_free with NULL");
+    process_reports_free(NULL, 0);
+    ASSERT_TRUE(1);
+}
+
+int main(void)
+{
+    printf("\n=== Running Batch Inspection Tests ===\n\n");
+
+    /* collect_process_reports tests */
+    test_collect_self();
+    test_collect_netns();
+    test_collect_children_in_order();
+    test_collect_counts_only();
+    test_collect_shared_sockets();
+    test_collect_dup_socket_fds();
+    test_collect_memory();
+    test_collect_field_selection();
+    test_collect_nonexistent();
+    test_collect_unresolvable_fds();
+    test_collect_sampled();
+    test_collect_fd_summary();
+    test_collect_invalid();
+
+    /* process_reports_free tests */
+    test_process_reports_free_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/*
+ * test_budget.c - Unit tests for the collection rate limits
+ *
+ * Tests budget_set()/budget_get(), that budget_yield() stretches work to
+ * the syscall and CPU limits, that idle credit is capped at
+ * BUDGET_BURST_NS, and that a limited count_socket_fds() takes as long
+ * as its syscalls are allowed to
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/budget.h"
+#include "../include/proc_fd.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define EXTRA_FDS 500
+
+static double now_ms(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000,
+                           .tv_nsec = (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* Test budget_set / budget_get */
+void test_budget_set_get(void)
+{
+    TEST("budget_get returns the limits set and NULL clears them");
+    budget_t none;
+    budget_get(&none);
+    budget_t set = { .syscalls_per_sec = 1234, .cpu_percent = 25 };
+    budget_set(&set);
+    budget_t got;
+    budget_get(&got);
+    bool active = budget_active;
+    budget_set(NULL);
+    budget_t cleared;
+    budget_get(&cleared);
+    ASSERT_TRUE(none.syscalls_per_sec == 0 && none.cpu_percent == 0 &&
+                got.syscalls_per_sec == 1234 && got.cpu_percent == 25 &&
+                active && !budget_active &&
+                cleared.syscalls_per_sec == 0 && cleared.cpu_percent == 0);
+    budget_get(NULL);
+}
+
+void test_budget_unset_never_sleeps(void)
+{
+    TEST("without a budget the macros neither count nor sleep");
+    budget_set(NULL);
+    double start = now_ms(CLOCK_MONOTONIC);
+    for (int i = 0; i < 100000; i++) {
+        BUDGET_CHARGE(1);
+        BUDGET_YIELD();
+    }
+    double ms = now_ms(CLOCK_MONOTONIC) - start;
+    ASSERT_TRUE(budget_slept_ns() == 0 && ms < 100);
+}
+
+/* Test the syscall limit */
+void test_budget_syscall_rate(void)
+{
+    TEST("500 syscalls at 2000/s take at least 240 ms");
+    budget_t b = { .syscalls_per_sec = 2000 };
+    budget_set(&b);
+    double start = now_ms(CLOCK_MONOTONIC);
+    for (int i = 0; i < 500; i++) {
+        BUDGET_CHARGE(1);
+        BUDGET_YIELD();
+    }
+    double ms = now_ms(CLOCK_MONOTONIC) - start;
+    uint64_t slept = budget_slept_ns();
+    budget_set(NULL);
+    ASSERT_TRUE(ms >= 240 && ms < 2000 && slept > 200000000ull);
+}
+
+/* Test the CPU limit */
+void test_budget_cpu_percent(void)
+{
+    TEST("40 ms of CPU at 50% takes at least 75 ms of wall time");
+    budget_t b = { .cpu_percent = 50 };
+    budget_set(&b);
+    double start = now_ms(CLOCK_MONOTONIC);
+    double cpu_start = now_ms(CLOCK_PROCESS_CPUTIME_ID);
+    double cpu = 0;
+    while (cpu < 40) {
+        /* Spin in 2 ms slices, settling after each like a batch would */
+        double slice = now_ms(CLOCK_PROCESS_CPUTIME_ID);
+        while (now_ms(CLOCK_PROCESS_CPUTIME_ID) - slice < 2) {
+        }
+        BUDGET_YIELD();
+        cpu = now_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    }
+    double ms = now_ms(CLOCK_MONOTONIC) - start;
+    budget_set(NULL);
+    ASSERT_TRUE(ms >= 75 && ms >= 1.8 * cpu);
+}
+
+/* Test the burst cap */
+void test_budget_idle_credit_capped(void)
+{
+    TEST("300 ms idle banks only 100 ms towards a 300 ms burst");
+    budget_t b = { .syscalls_per_sec = 1000 };
+    budget_set(&b);
+    sleep_ms(300);
+    double start = now_ms(CLOCK_MONOTONIC);
+    BUDGET_CHARGE(300);
+    BUDGET_YIELD();
+    double ms = now_ms(CLOCK_MONOTONIC) - start;
+    budget_set(NULL);
+    ASSERT_TRUE(ms >= 180 && ms < 1000);
+}
+
+/* Test a real collector under a budget */
+void test_budget_limits_collector(void)
+{
+    TEST("count_socket_fds over 500 extra FDs at 5000 syscalls/s");
+    int fds[EXTRA_FDS];
+    int opened = 0;
+    for (int i = 0; i < EXTRA_FDS; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        if (fds[i] < 0) {
+            break;
+        }
+        opened++;
+    }
+
+    int fd_count = 0;
+    int sockets = 0;
+    double start = now_ms(CLOCK_MONOTONIC);
+    int ret1 = count_socket_fds(getpid(), &fd_count, &sockets);
+    double unlimited = now_ms(CLOCK_MONOTONIC) - start;
+
+    budget_t b = { .syscalls_per_sec = 5000 };
+    budget_set(&b);
+    start = now_ms(CLOCK_MONOTONIC);
+    int limited_count = 0;
+    int ret2 = count_socket_fds(getpid(), &limited_count, &sockets);
+    double limited = now_ms(CLOCK_MONOTONIC) - start;
+    budget_set(NULL);
+
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+    /* One readlinkat() per FD: at least fd_count / 5000 seconds */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && opened == EXTRA_FDS &&
+                limited_count == fd_count &&
+                limited >= 0.9 * fd_count / 5.0 && limited > unlimited);
+}
+
+int main(void)
+{
+    printf("\n=== Running Budget Tests ===\n\n");
+
+    /* budget_set / budget_get tests */
+    test_budget_set_get();
+    test_budget_unset_never_sleeps();
+
+    /* budget_yield tests */
+    test_budget_syscall_rate();
+    test_budget_cpu_percent();
+    test_budget_idle_credit_capped();
+    test_budget_limits_collector();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+/*
+ * test_fd_summary.c - Unit tests for the FD kind histogram
+ *
+ * Tests classify_fd_kind(), fd_kind_to_string(), summarize_fds() on the
+ * test's own FDs under both backends, fd_summary_top() ordering and
+ * fd_summary_free()
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "../include/fd_summary.h"
+#include "../include/proc_fd.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/* Enough for FD_BACKEND_URING to set up a ring */
+#define SAME_FILE_FDS 300
+#define DELETED_FDS 3
+
+/* FDs opened by open_fixture_fds(), closed by close_fixture_fds() */
+static int fixture_fds[SAME_FILE_FDS + DELETED_FDS + 3];
+static int fixture_count = 0;
+static const char kept_template[] = "/tmp/pinspect_summaryXXXXXX";
+static const char deleted_template[] = "/tmp/pinspect_deletedXXXXXX";
+static char kept_path[sizeof(kept_template)];
+static char deleted_path[sizeof(deleted_template)];
+
+/*
+ * Open SAME_FILE_FDS FDs on one file, DELETED_FDS on an unlinked one,
+ * and an eventfd, an epoll and a timerfd. Returns 0 on success.
+ */
+static int open_fixture_fds(void)
+{
+    memcpy(kept_path, kept_template, sizeof(kept_template));
+    memcpy(deleted_path, deleted_template, sizeof(deleted_template));
+    int kept = mkstemp(kept_path);
+    int deleted = mkstemp(deleted_path);
+    if (kept < 0 || deleted < 0) {
+        return -1;
+    }
+    fixture_fds[fixture_count++] = kept;
+    fixture_fds[fixture_count++] = deleted;
+    for (int i = 1; i < SAME_FILE_FDS; i++) {
+        fixture_fds[fixture_count++] = dup(kept);
+    }
+    for (int i = 1; i < DELETED_FDS; i++) {
+        fixture_fds[fixture_count++] = dup(deleted);
+    }
+    unlink(deleted_path);
+
+    fixture_fds[fixture_count++] = eventfd(0, 0);
+    fixture_fds[fixture_count++] = epoll_create1(0);
+    fixture_fds[fixture_count++] = timerfd_create(CLOCK_MONOTONIC, 0);
+    for (int i = 0; i < fixture_count; i++) {
+        if (fixture_fds[i] < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void close_fixture_fds(void)
+{
+    for (int i = 0; i < fixture_count; i++) {
+        if (fixture_fds[i] >= 0) {
+            close(fixture_fds[i]);
+        }
+    }
+    fixture_count = 0;
+    unlink(kept_path);
+}
+
+/* Count of path in summary, found through fd_summary_top() */
+static int path_count(const fd_summary_t *summary, const char *path)
+{
+    fd_path_count_t *top = malloc((summary->distinct + 1) *
+                                  sizeof(*top));
+    int n = (top != NULL) ? fd_summary_top(summary, top,
+                                           (int)summary->distinct)
+                          : 0;
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (strcmp(top[i].path, path) == 0) {
+            count = top[i].count;
+        }
+    }
+    free(top);
+    return count;
+}
+
+/* Test classify_fd_kind / fd_kind_to_string */
+void test_classify_fd_kind(void)
+{
+    TEST("classify_fd_kind splits anon inodes and deleted paths");
+    ASSERT_TRUE(classify_fd_kind("/var/log/app.log") == FD_KIND_FILE &&
+                classify_fd_kind("/tmp/x (deleted)") == FD_KIND_DELETED &&
+                classify_fd_kind("/memfd:jit (deleted)") == FD_KIND_DELETED &&
+                classify_fd_kind("/dev/shm/a (deleted)") == FD_KIND_DELETED &&
+                classify_fd_kind("/dev/null") == FD_KIND_DEVICE &&
+                classify_fd_kind("socket:[123]") == FD_KIND_SOCKET &&
+                classify_fd_kind("pipe:[456]") == FD_KIND_PIPE &&
+                classify_fd_kind("anon_inode:[eventfd]") == FD_KIND_EVENTFD &&
+                classify_fd_kind("anon_inode:[eventpoll]") ==
+                    FD_KIND_EVENTPOLL &&
+                classify_fd_kind("anon_inode:[timerfd]") == FD_KIND_TIMERFD &&
+                classify_fd_kind("anon_inode:inotify") ==
+                    FD_KIND_ANON_OTHER &&
+                classify_fd_kind("anon_inode:[eventfd-x]") ==
+                    FD_KIND_ANON_OTHER &&
+                classify_fd_kind("net:[4026531840]") == FD_KIND_OTHER &&
+                classify_fd_kind(" (deleted)") == FD_KIND_OTHER &&
+                classify_fd_kind(NULL) == FD_KIND_OTHER);
+}
+
+void test_fd_kind_to_string(void)
+{
+    TEST("fd_kind_to_string labels every kind");
+    ASSERT_TRUE(strcmp(fd_kind_to_string(FD_KIND_DELETED), "deleted") == 0 &&
+                strcmp(fd_kind_to_string(FD_KIND_EVENTPOLL),
+                       "eventpoll") == 0 &&
+                strcmp(fd_kind_to_string(FD_KIND_ANON_OTHER),
+                       "anon_inode") == 0 &&
+                strcmp(fd_kind_to_string((fd_kind_t)99), "other") == 0);
+}
+
+/* Test summarize_fds */
+void test_summarize_fds_self(void)
+{
+    TEST("summarize_fds counts our own FDs by kind and by path");
+    fd_summary_t base;
+    fd_summary_t s;
+    bool ok = summarize_fds(getpid(), &base) == 0 && open_fixture_fds() == 0;
+    ok = ok && summarize_fds(getpid(), &s) == 0;
+
+    int sum = 0;
+    for (int k = 0; ok && k <= FD_KIND_OTHER; k++) {
+        sum += s.kind_counts[k];
+    }
+    char deleted_target[sizeof(deleted_path) + 16];
+    snprintf(deleted_target, sizeof(deleted_target), "%s (deleted)",
+             deleted_path);
+    ASSERT_TRUE(ok && sum == s.total &&
+                s.total == base.total + fixture_count &&
+                s.kind_counts[FD_KIND_FILE] >=
+                    base.kind_counts[FD_KIND_FILE] + SAME_FILE_FDS &&
+                s.kind_counts[FD_KIND_DELETED] ==
+                    base.kind_counts[FD_KIND_DELETED] + DELETED_FDS &&
+                s.kind_counts[FD_KIND_EVENTFD] ==
+                    base.kind_counts[FD_KIND_EVENTFD] + 1 &&
+                s.kind_counts[FD_KIND_EVENTPOLL] ==
+                    base.kind_counts[FD_KIND_EVENTPOLL] + 1 &&
+                s.kind_counts[FD_KIND_TIMERFD] ==
+                    base.kind_counts[FD_KIND_TIMERFD] + 1 &&
+                path_count(&s, kept_path) == SAME_FILE_FDS &&
+                path_count(&s, deleted_target) == DELETED_FDS);
+    close_fixture_fds();
+    fd_summary_free(&base);
+    fd_summary_free(&s);
+}
+
+void test_summarize_fds_distinct_storage(void)
+{
+    TEST("300 FDs on one file add one path to the summary");
+    fd_summary_t base;
+    fd_summary_t s;
+    bool ok = summarize_fds(getpid(), &base) == 0 && open_fixture_fds() == 0;
+    ok = ok && summarize_fds(getpid(), &s) == 0;
+    /* The kept file and the deleted one are the only new paths */
+    ASSERT_TRUE(ok && s.distinct == base.distinct + 2 &&
+                s.capacity >= 2 * s.distinct &&
+                s.strings_len < base.strings_len + 2 * sizeof(kept_path) +
+                                    16);
+    close_fixture_fds();
+    fd_summary_free(&base);
+    fd_summary_free(&s);
+}
+
+void test_summarize_fds_uring(void)
+{
+    TEST("summarize_fds gives the same counts under FD_BACKEND_URING");
+    fd_summary_t plain;
+    fd_summary_t ring;
+    bool ok = open_fixture_fds() == 0 &&
+              summarize_fds(getpid(), &plain) == 0;
+    fd_set_backend(FD_BACKEND_URING);
+    ok = ok && summarize_fds(getpid(), &ring) == 0;
+    fd_set_backend(FD_BACKEND_READLINK);
+    ok = ok && ring.distinct == plain.distinct &&
+         path_count(&ring, kept_path) == SAME_FILE_FDS;
+    /* A ring FD of our own is skipped, so even the total must match */
+    ASSERT_TRUE(ok && ring.total == plain.total &&
+                memcmp(ring.kind_counts, plain.kind_counts,
+                       sizeof(plain.kind_counts)) == 0);
+    close_fixture_fds();
+    fd_summary_free(&plain);
+    fd_summary_free(&ring);
+}
+
+void test_summarize_fds_errors(void)
+{
+    TEST("summarize_fds with NULL (EINVAL) or a missing PID (ENOENT)");
+    fd_summary_t s;
+    int ret1 = summarize_fds(getpid(), NULL);
+    int err1 = errno;
+    int ret2 = summarize_fds(999999, &s);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                err2 == ENOENT && s.total == 0 && s.hashes == NULL);
+}
+
+/* Test fd_summary_top */
+void test_fd_summary_top_order(void)
+{
+    TEST("fd_summary_top ranks by count, then path");
+    fd_summary_t base;
+    fd_summary_t s;
+    bool ok = summarize_fds(getpid(), &base) == 0 && open_fixture_fds() == 0;
+    ok = ok && summarize_fds(getpid(), &s) == 0;
+
+    fd_path_count_t top[2];
+    int n = ok ? fd_summary_top(&s, top, 2) : -1;
+    /* Nothing else this test holds is open 300 times */
+    ok = ok && n == 2 && strcmp(top[0].path, kept_path) == 0 &&
+         top[0].count == SAME_FILE_FDS && top[1].count <= top[0].count;
+
+    fd_path_count_t *all = malloc(s.distinct * sizeof(*all));
+    int total = (ok && all != NULL) ? fd_summary_top(&s, all,
+                                                     (int)s.distinct + 5)
+                                    : -1;
+    ok = ok && total == (int)s.distinct;
+    for (int i = 1; ok && i < total; i++) {
+        ok = all[i - 1].count > all[i].count ||
+             (all[i - 1].count == all[i].count &&
+              strcmp(all[i - 1].path, all[i].path) < 0);
+    }
+    ASSERT_TRUE(ok && fd_summary_top(&s, top, 0) == 0);
+    free(all);
+    close_fixture_fds();
+    fd_summary_free(&base);
+    fd_summary_free(&s);
+}
+
+void test_fd_summary_top_errors(void)
+{
+    TEST("fd_summary_top on NULL or with k < 0 (EINVAL), empty summary");
+    fd_summary_t empty = {0};
+    fd_path_count_t top[1];
+    int ret1 = fd_summary_top(NULL, top, 1);
+    int ret2 = fd_summary_top(&empty, NULL, 1);
+    int ret3 = fd_summary_top(&empty, top, -1);
+    int err = errno;
+    ASSERT_TRUE(ret1 == -1 && ret2 == -1 && ret3 == -1 && err == EINVAL &&
+                fd_summary_top(&empty, top, 1) == 0);
+}
+
+/* Test fd_summary_free */
+void test_fd_summary_free(void)
+{
+    TEST("fd_summary_free with NULL, zeroed, and twice");
+    fd_summary_t s = {0};
+    fd_summary_free(NULL);
+    fd_summary_free(&s);
+    bool ok = summarize_fds(getpid(), &s) == 0;
+    fd_summary_free(&s);
+    fd_summary_free(&s);
+    ASSERT_TRUE(ok && s.hashes == NULL && s.strings == NULL &&
+                s.distinct == 0 && s.total == 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running FD Summary Tests ===\n\n");
+
+    /* classify_fd_kind / fd_kind_to_string tests */
+    test_classify_fd_kind();
+    test_fd_kind_to_string();
+
+    /* summarize_fds tests */
+    test_summarize_fds_self();
+    test_summarize_fds_distinct_storage();
+    test_summarize_fds_uring();
+    test_summarize_fds_errors();
+
+    /* fd_summary_top tests */
+    test_fd_summary_top_order();
+    test_fd_summary_top_errors();
+
+    /* fd_summary_free tests */
+    test_fd_summary_free();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/*
+ * test_idmap.c - Unit tests for the inode/TID hash map
+ *
+ * Tests id_map_init(), id_map_put(), id_map_get(), id_map_clear()
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "../include/idmap.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_FALSE(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was true)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/* Test put followed by get returns the stored value */
+void test_id_map_put_get(void)
+{
+    TEST("id_map_put then id_map_get");
+    id_map_t map;
+    int value = -1;
+    id_map_init(&map, 4);
+    id_map_put(&map, 12345, 7);
+    bool found = id_map_get(&map, 12345, &value);
+    id_map_free(&map);
+    ASSERT_TRUE(found && value == 7);
+}
+
+/* Test missing key is reported absent */
+void test_id_map_missing(void)
+{
+    TEST("id_map_contains with missing key");
+    id_map_t map;
+    id_map_init(&map, 4);
+    id_map_put(&map, 100, 0);
+    bool found = id_map_contains(&map, 101);
+    id_map_free(&map);
+    ASSERT_FALSE(found);
+}
+
+/* Test overwriting a key keeps count stable */
+void test_id_map_overwrite(void)
+{
+    TEST("id_map_put overwrites existing key");
+    id_map_t map;
+    int value = -1;
+    id_map_init(&map, 4);
+    id_map_put(&map, 42, 1);
+    id_map_put(&map, 42, 2);
+    id_map_get(&map, 42, &value);
+    bool pass = (value == 2 && map.count == 1);
+    id_map_free(&map);
+    ASSERT_TRUE(pass);
+}
+
+/* Test key 0 is rejected (reserved as empty marker) */
+void test_id_map_zero_key(void)
+{
+    TEST("id_map_put rejects key 0");
+    id_map_t map;
+    id_map_init(&map, 4);
+    errno = 0;
+    int ret = id_map_put(&map, 0, 1);
+    bool pass = (ret == -1 && errno == EINVAL && map.count == 0);
+    id_map_free(&map);
+    ASSERT_TRUE(pass);
+}
+
+/* Test growth past the initial capacity keeps every key */
+void test_id_map_growth(void)
+{
+    TEST("id_map grows and keeps 100000 keys");
+    id_map_t map;
+    id_map_init(&map, 1);
+    bool pass = true;
+    for (unsigned long k = 1; k <= 100000; k++) {
+        if (id_map_put(&map, k * 7919, (int)k) != 0) {
+            pass = false;
+        }
+    }
+    for (unsigned long k = 1; k <= 100000 && pass; k++) {
+        int value = 0;
+        if (!id_map_get(&map, k * 7919, &value) || value != (int)k) {
+            pass = false;
+        }
+    }
+    pass = pass && map.count == 100000 && !id_map_contains(&map, 7918);
+    id_map_free(&map);
+    ASSERT_TRUE(pass);
+}
+
+/* Test clear removes keys but keeps storage */
+void test_id_map_clear(void)
+{
+    TEST("id_map_clear empties map");
+    id_map_t map;
+    id_map_init(&map, 4);
+    id_map_put(&map, 5, 5);
+    size_t capacity = map.capacity;
+    id_map_clear(&map);
+    bool pass = (map.count == 0 && map.capacity == capacity &&
+                 !id_map_contains(&map, 5));
+    id_map_free(&map);
+    ASSERT_TRUE(pass);
+}
+
+/* Test lookups on a zeroed map are safe */
+void test_id_map_zeroed(void)
+{
+    TEST("id_map_contains on zeroed map");
+    id_map_t map;
+    memset(&map, 0, sizeof(map));
+    ASSERT_FALSE(id_map_contains(&map, 1));
+}
+
+/* Test id_map_free with NULL is safe */
+void test_id_map_free_null(void)
+{
+    TEST("id_map_free with NULL");
+    id_map_free(NULL); /* Should not crash */
+    ASSERT_TRUE(1);
+}
+
+int main(void)
+{
+    printf("\n=== Running ID Map Tests ===\n\n");
+
+    test_id_map_put_get();
+    test_id_map_missing();
+    test_id_map_overwrite();
+    test_id_map_zero_key();
+    test_id_map_growth();
+    test_id_map_clear();
+    test_id_map_zeroed();
+    test_id_map_free_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
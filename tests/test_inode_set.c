@@ -0,0 +1,312 @@
+/*
+ * test_inode_set.c - Unit tests for the sorted socket inode set
+ *
+ * Tests radix_sort_ids() against a reference sort, and inode_set_build(),
+ * inode_set_find() and inode_set_fds() on synthetic FD lists and on the
+ * test process's own dup'd sockets
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../include/inode_set.h"
+#include "../include/proc_fd.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define SORT_KEYS 100000
+#define LOOKUP_INODES 100000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* Sorted by key, then by original position: what a stable sort gives */
+typedef struct {
+    unsigned long key;
+    int value;
+} pair_t;
+
+static int compare_pairs(const void *a, const void *b)
+{
+    const pair_t *x = a;
+    const pair_t *y = b;
+    if (x->key != y->key) {
+        return (x->key < y->key) ? -1 : 1;
+    }
+    return (x->value > y->value) - (x->value < y->value);
+}
+
+/* Sort count keys drawn below limit; compare with qsort of the pairs */
+static bool sort_matches_reference(size_t count, unsigned long limit)
+{
+    unsigned long *keys = malloc(count * sizeof(*keys));
+    int *values = malloc(count * sizeof(*values));
+    pair_t *ref = malloc(count * sizeof(*ref));
+    bool ok = keys != NULL && values != NULL && ref != NULL;
+    for (size_t i = 0; ok && i < count; i++) {
+        keys[i] = (unsigned long)(next_random() % limit);
+        values[i] = (int)i;
+        ref[i].key = keys[i];
+        ref[i].value = (int)i;
+    }
+    if (ok) {
+        qsort(ref, count, sizeof(*ref), compare_pairs);
+        ok = radix_sort_ids(keys, values, count) == 0;
+    }
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = keys[i] == ref[i].key && values[i] == ref[i].value;
+    }
+    free(keys);
+    free(values);
+    free(ref);
+    return ok;
+}
+
+/* Test radix_sort_ids */
+void test_radix_sort_32bit(void)
+{
+    TEST("radix_sort_ids matches a stable sort of 100000 inode-sized keys");
+    /* Few distinct values, so stability is exercised */
+    ASSERT_TRUE(sort_matches_reference(SORT_KEYS, 1ul << 32) &&
+                sort_matches_reference(SORT_KEYS, 1000));
+}
+
+void test_radix_sort_full_width(void)
+{
+    TEST("radix_sort_ids with full-width keys and an odd pass count");
+    /* Keys below 2^24 differ in three digits: the result is in scratch */
+    ASSERT_TRUE(sort_matches_reference(SORT_KEYS, ~0ul) &&
+                sort_matches_reference(SORT_KEYS, 1ul << 24));
+}
+
+void test_radix_sort_small(void)
+{
+    TEST("radix_sort_ids below the insertion-sort cutoff and empty");
+    ASSERT_TRUE(sort_matches_reference(1, 10) &&
+                sort_matches_reference(63, 10) &&
+                sort_matches_reference(64, 10) &&
+                radix_sort_ids(NULL, NULL, 0) == 0);
+}
+
+/* Append an FD entry to a list built by hand */
+static void add_entry(fd_list_t *list, int fd, fd_type_t type,
+                      unsigned long inode)
+{
+    fd_entry_t *e = &list->entries[list->count++];
+    memset(e, 0, sizeof(*e));
+    e->fd = fd;
+    e->type = type;
+    e->socket_inode = inode;
+}
+
+/* Test inode_set_build / inode_set_fds */
+void test_build_groups_shared_sockets(void)
+{
+    TEST("inode_set_build groups dup'd FDs under one inode");
+    fd_entry_t entries[8];
+    fd_list_t list = { .entries = entries, .count = 0 };
+    add_entry(&list, 12, FD_TYPE_SOCKET, 500);
+    add_entry(&list, 3, FD_TYPE_SOCKET, 500);
+    add_entry(&list, 4, FD_TYPE_FILE, 0);
+    add_entry(&list, 5, FD_TYPE_SOCKET, 200);
+    add_entry(&list, 7, FD_TYPE_SOCKET, 500);
+    add_entry(&list, 8, FD_TYPE_SOCKET, 0);
+    add_entry(&list, 9, FD_TYPE_PIPE, 0);
+
+    inode_set_t set;
+    int ret = inode_set_build(&set, &list);
+    int n200 = 0;
+    int n500 = 0;
+    const int *fds200 = inode_set_fds(&set, 0, &n200);
+    const int *fds500 = inode_set_fds(&set, 1, &n500);
+    ASSERT_TRUE(ret == 0 && set.count == 2 && set.fd_count == 4 &&
+                set.inodes[0] == 200 && set.inodes[1] == 500 &&
+                n200 == 1 && fds200[0] == 5 && n500 == 3 &&
+                fds500[0] == 3 && fds500[1] == 7 && fds500[2] == 12);
+    inode_set_free(&set);
+}
+
+void test_build_empty(void)
+{
+    TEST("inode_set_build with no socket FDs finds nothing");
+    fd_entry_t entries[2];
+    fd_list_t list = { .entries = entries, .count = 0 };
+    add_entry(&list, 0, FD_TYPE_DEVICE, 0);
+    inode_set_t set;
+    int ret = inode_set_build(&set, &list);
+    int n = -1;
+    ASSERT_TRUE(ret == 0 && set.count == 0 &&
+                inode_set_find(&set, 1) == -1 &&
+                inode_set_fds(&set, 0, &n) == NULL && n == 0);
+    inode_set_free(&set);
+}
+
+/* Test inode_set_find */
+void test_find_every_inode(void)
+{
+    TEST("inode_set_find hits all 100000 inodes and misses their gaps");
+    fd_entry_t *entries = malloc(LOOKUP_INODES * sizeof(*entries));
+    fd_list_t list = { .entries = entries, .count = 0 };
+    /* Odd inodes in shuffled order; the even ones between are absent */
+    for (int i = 0; entries != NULL && i < LOOKUP_INODES; i++) {
+        add_entry(&list, i, FD_TYPE_SOCKET,
+                  2ul * (((unsigned long)i * 7919) % LOOKUP_INODES) + 1001);
+    }
+
+    inode_set_t set;
+    bool ok = entries != NULL && inode_set_build(&set, &list) == 0 &&
+              set.count == LOOKUP_INODES;
+    for (int i = 0; ok && i < LOOKUP_INODES; i++) {
+        unsigned long inode = 2ul * (unsigned long)i + 1001;
+        int index = inode_set_find(&set, inode);
+        ok = index == i && set.inodes[index] == inode &&
+             inode_set_find(&set, inode + 1) == -1;
+    }
+    ok = ok && inode_set_find(&set, 1) == -1 && inode_set_find(&set, 0) == -1;
+    ASSERT_TRUE(ok);
+    if (entries != NULL) {
+        inode_set_free(&set);
+    }
+    free(entries);
+}
+
+void test_find_small_sets(void)
+{
+    TEST("inode_set_find on every set size from 1 to 40");
+    fd_entry_t entries[40];
+    bool ok = true;
+    for (int n = 1; ok && n <= 40; n++) {
+        fd_list_t list = { .entries = entries, .count = 0 };
+        for (int i = 0; i < n; i++) {
+            add_entry(&list, i, FD_TYPE_SOCKET, 10ul * (unsigned long)i + 10);
+        }
+        inode_set_t set;
+        ok = inode_set_build(&set, &list) == 0;
+        for (int i = 0; ok && i < n; i++) {
+            ok = inode_set_find(&set, 10ul * (unsigned long)i + 10) == i &&
+                 inode_set_find(&set, 10ul * (unsigned long)i + 15) == -1;
+        }
+        ok = ok && inode_set_find(&set, 5) == -1;
+        inode_set_free(&set);
+    }
+    ASSERT_TRUE(ok);
+}
+
+void test_live_dup_socket(void)
+{
+    TEST("a socket dup'd twice in this process lists all three FDs");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    int a = (ret0 == 0) ? dup(pair[0]) : -1;
+    int b = (ret0 == 0) ? dup(pair[0]) : -1;
+
+    fd_list_t list;
+    inode_set_t set;
+    int ret = enumerate_fds(getpid(), &list);
+    bool ok = ret0 == 0 && a >= 0 && b >= 0 && ret == 0 &&
+              inode_set_build(&set, &list) == 0;
+    unsigned long inode = 0;
+    for (int i = 0; ok && i < list.count; i++) {
+        if (list.entries[i].fd == pair[0]) {
+            inode = list.entries[i].socket_inode;
+        }
+    }
+    int n = 0;
+    const int *fds = ok ? inode_set_fds(&set, inode_set_find(&set, inode),
+                                        &n)
+                        : NULL;
+    ASSERT_TRUE(ok && inode != 0 && fds != NULL && n == 3 &&
+                fds[0] == pair[0] && fds[1] == a && fds[2] == b);
+    if (ok) {
+        inode_set_free(&set);
+    }
+    if (ret == 0) {
+        fd_list_free(&list);
+    }
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+    if (a >= 0) {
+        close(a);
+    }
+    if (b >= 0) {
+        close(b);
+    }
+}
+
+/* Test error handling */
+void test_null_safety(void)
+{
+    TEST("NULL arguments and out-of-range indexes");
+    inode_set_t set;
+    fd_list_t list = {0};
+    int n = -1;
+    ASSERT_TRUE(inode_set_build(NULL, &list) == -1 &&
+                inode_set_build(&set, NULL) == -1 &&
+                inode_set_find(NULL, 1) == -1 &&
+                inode_set_fds(NULL, 0, &n) == NULL && n == 0);
+    inode_set_free(NULL);
+}
+
+int main(void)
+{
+    printf("\n=== Running Inode Set Tests ===\n\n");
+
+    /* radix_sort_ids tests */
+    test_radix_sort_32bit();
+    test_radix_sort_full_width();
+    test_radix_sort_small();
+
+    /* inode_set_build / inode_set_fds tests */
+    test_build_groups_shared_sockets();
+    test_build_empty();
+
+    /* inode_set_find tests */
+    test_find_every_inode();
+    test_find_small_sets();
+    test_live_dup_socket();
+
+    /* Error handling tests */
+    test_null_safety();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -2,11 +2,19 @@
  * test_net.c - Unit tests for network connection parsing
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include "../include/net.h"
+#include "../include/proc_fd.h"
+#include "../include/util.h"
 
 /*Test macros*/
 #define TEST_PASS "\33[32m[PASS]\33[0m"
@@ -88,6 +96,42 @@ void test_format_ip_port_null_buffer(void)
     ASSERT_TRUE(1);
 }
 
+/* Test format_socket_addr */
+void test_format_socket_addr_ipv6(void)
+{
+    TEST("format_socket_addr [::1]:443");
+    char buf[SOCKET_ADDR_MAX];
+    socket_info_t sock;
+    memset(&sock, 0, sizeof(sock));
+    sock.family = AF_INET6;
+    sock.local_addr.v6[15] = 1;
+    sock.local_port = 443;
+    format_socket_addr(&sock, true, buf, sizeof(buf));
+    ASSERT_STREQ(buf, "[::1]:443");
+}
+
+void test_format_socket_addr_unix_unnamed(void)
+{
+    TEST("format_socket_addr unnamed UNIX socket");
+    char buf[SOCKET_ADDR_MAX];
+    socket_info_t sock;
+    memset(&sock, 0, sizeof(sock));
+    sock.family = AF_UNIX;
+    format_socket_addr(&sock, true, buf, sizeof(buf));
+    ASSERT_STREQ(buf, "*");
+}
+
+/* Test socket_proto_to_string */
+void test_socket_proto_tcp6(void)
+{
+    TEST("socket_proto_to_string TCP over IPv6");
+    socket_info_t sock;
+    memset(&sock, 0, sizeof(sock));
+    sock.proto = SOCK_PROTO_TCP;
+    sock.family = AF_INET6;
+    ASSERT_STREQ(socket_proto_to_string(&sock), "TCP6");
+}
+
 /* Test find_process_sockets */
 void test_find_process_sockets_current(void)
 {
@@ -112,6 +156,53 @@ void test_find_process_sockets_nonexistent(void)
     ASSERT_TRUE(ret == -1);
 }
 
+void test_find_process_sockets_custom_root(void)
+{
+    TEST("find_process_sockets reads net/ tables under proc_set_root");
+    char root[] = "/tmp/test_net_root_XXXXXX";
+    char path[128];
+    bool built = mkdtemp(root) != NULL;
+
+    /* <root>/77/fd/{0,3} and a one-row <root>/net/tcp owning inode 424242 */
+    static const char *const dirs[] = { "77", "77/fd", "net" };
+    for (size_t i = 0; built && i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        built = mkdir(path, 0755) == 0;
+    }
+    snprintf(path, sizeof(path), "%s/77/fd/0", root);
+    built = built && symlink("/dev/null", path) == 0;
+    snprintf(path, sizeof(path), "%s/77/fd/3", root);
+    built = built && symlink("socket:[424242]", path) == 0;
+    snprintf(path, sizeof(path), "%s/net/tcp", root);
+    FILE *fp = built ? fopen(path, "w") : NULL;
+    if (fp != NULL) {
+        fprintf(fp, "  sl  local_address rem_address   st tx_queue rx_queue "
+                    "tr tm->when retrnsmt   uid  timeout inode\n"
+                    "   0: 0100007F:1F90 00000000:0000 0A 00000000:00000000 "
+                    "00:00000000 00000000  1000        0 424242 1 "
+                    "0000000000000000 100 0 0 10 0\n");
+        built = fclose(fp) == 0;
+    }
+
+    proc_set_root(root);
+    socket_info_t *sockets = NULL;
+    int count = 0;
+    int ret = built ? find_process_sockets(77, &sockets, &count) : -1;
+    proc_set_root(NULL);
+
+    ASSERT_TRUE(built && ret == 0 && count == 1 &&
+                sockets[0].inode == 424242 && sockets[0].local_port == 8080 &&
+                sockets[0].state == TCP_LISTEN);
+    socket_list_free(sockets);
+
+    static const char *const files[] = { "net/tcp", "net", "77/fd/3",
+                                         "77/fd/0", "77/fd", "77", "" };
+    for (size_t i = 0; i < 7; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        remove(path);
+    }
+}
+
 void test_socket_list_free_null(void)
 {
     TEST("socket_list_free with NULL");
@@ -119,6 +210,471 @@ void test_socket_list_free_null(void)
     ASSERT_TRUE(1);
 }
 
+/* Test find_all_socket_owners */
+void test_find_all_socket_owners_own_socket(void)
+{
+    TEST("find_all_socket_owners finds own listening socket");
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool pass = false;
+    if (sock >= 0 &&
+        bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        listen(sock, 1) == 0) {
+        socket_owner_t *owners = NULL;
+        int count = 0;
+        if (find_all_socket_owners(&owners, &count) == 0) {
+            for (int i = 0; i < count; i++) {
+                if (owners[i].pid == getpid() && owners[i].fd == sock &&
+                    owners[i].socket.proto == SOCK_PROTO_TCP &&
+                    owners[i].socket.state == TCP_LISTEN) {
+                    pass = true;
+                }
+            }
+            socket_owner_list_free(owners);
+        }
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    ASSERT_TRUE(pass);
+}
+
+/* Find socket with given local port among the current process's sockets */
+static bool find_own_listener(uint16_t port, socket_info_t *out)
+{
+    socket_info_t *sockets = NULL;
+    int count = 0;
+    bool found = false;
+    if (find_process_sockets(getpid(), &sockets, &count) == 0) {
+        for (int i = 0; i < count; i++) {
+            if (sockets[i].proto == SOCK_PROTO_TCP &&
+                sockets[i].local_port == port) {
+                *out = sockets[i];
+                found = true;
+            }
+        }
+        socket_list_free(sockets);
+    }
+    return found;
+}
+
+void test_net_backends_agree(void)
+{
+    TEST("netlink and /proc/net backends return same socket");
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool pass = false;
+    if (sock >= 0 &&
+        bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        listen(sock, 1) == 0 &&
+        getsockname(sock, (struct sockaddr *)&addr, &len) == 0) {
+        uint16_t port = ntohs(addr.sin_port);
+        socket_info_t from_proc, from_netlink;
+        net_set_backend(NET_BACKEND_PROC);
+        bool got_proc = find_own_listener(port, &from_proc);
+        net_set_backend(NET_BACKEND_NETLINK);
+        bool got_netlink = find_own_listener(port, &from_netlink);
+        net_set_backend(NET_BACKEND_AUTO);
+        if (!got_netlink) {
+            /* sock_diag may be unavailable (e.g. seccomp); proc must work */
+            pass = got_proc;
+        } else {
+            pass = got_proc &&
+                   from_proc.family == from_netlink.family &&
+                   from_proc.local_addr.v4 == from_netlink.local_addr.v4 &&
+                   from_proc.remote_addr.v4 == from_netlink.remote_addr.v4 &&
+                   from_proc.remote_port == from_netlink.remote_port &&
+                   from_proc.state == from_netlink.state &&
+                   from_proc.inode == from_netlink.inode;
+        }
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    ASSERT_TRUE(pass);
+}
+
+/* for_each_socket visitor recording the FD of the first TCP match */
+typedef struct {
+    int visited;
+    int limit;          /* Stop after this many, 0 for no limit */
+    uint16_t port;      /* Local port to look for */
+    int fd;             /* FD it was found on, or -1 */
+} socket_visit_t;
+
+static int visit_socket(const socket_info_t *sock, int fd, void *ctx)
+{
+    socket_visit_t *v = ctx;
+    v->visited++;
+    if (sock->proto == SOCK_PROTO_TCP && sock->local_port == v->port) {
+        v->fd = fd;
+    }
+    return v->limit > 0 && v->visited >= v->limit;
+}
+
+/* Test for_each_socket */
+void test_for_each_socket(void)
+{
+    TEST("for_each_socket reports socket with its FD and stops early");
+    int socks[2];
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    bool pair = socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0;
+    bool pass = false;
+    if (sock >= 0 && pair &&
+        bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        listen(sock, 1) == 0 &&
+        getsockname(sock, (struct sockaddr *)&addr, &len) == 0) {
+        socket_visit_t all = { .limit = 0, .port = ntohs(addr.sin_port),
+                               .fd = -1 };
+        socket_visit_t one = { .limit = 1, .port = 0, .fd = -1 };
+        socket_info_t *sockets = NULL;
+        int count = 0;
+        int ret1 = for_each_socket(getpid(), visit_socket, &all);
+        int ret2 = for_each_socket(getpid(), visit_socket, &one);
+        int ret3 = find_process_sockets(getpid(), &sockets, &count);
+        pass = ret1 == 0 && ret2 == 0 && ret3 == 0 &&
+               all.fd == sock && all.visited == count && count >= 3 &&
+               one.visited == 1;
+        socket_list_free(sockets);
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    if (pair) {
+        close(socks[0]);
+        close(socks[1]);
+    }
+    ASSERT_TRUE(pass);
+}
+
+void test_for_each_socket_errors(void)
+{
+    TEST("for_each_socket with NULL visitor and bad PID");
+    socket_visit_t v = { .fd = -1 };
+    int ret1 = for_each_socket(getpid(), NULL, NULL);
+    int ret2 = for_each_socket(999999, visit_socket, &v);
+    ASSERT_TRUE(ret1 == -1 && ret2 == -1 && v.visited == 0);
+}
+
+/* Test find_fd_list_sockets */
+void test_find_fd_list_sockets(void)
+{
+    TEST("find_fd_list_sockets matches find_process_sockets from the list");
+    int socks[2];
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int copy = (sock >= 0) ? dup(sock) : -1;
+    bool pair = socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0;
+    bool pass = false;
+    if (copy >= 0 && pair &&
+        bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        listen(sock, 1) == 0) {
+        fd_list_t fds;
+        socket_info_t *from_list = NULL;
+        socket_info_t *from_pid = NULL;
+        int list_count = 0;
+        int pid_count = 0;
+        int ret1 = enumerate_fds(getpid(), &fds);
+        int ret2 = find_fd_list_sockets(&fds, &from_list, &list_count);
+        int ret3 = find_process_sockets(getpid(), &from_pid, &pid_count);
+
+        /* The dup is the same socket, so it is listed once */
+        pass = ret1 == 0 && ret2 == 0 && ret3 == 0 &&
+               list_count == pid_count && list_count >= 3;
+        for (int i = 0; pass && i < list_count; i++) {
+            pass = from_list[i].inode == from_pid[i].inode;
+        }
+        socket_list_free(from_list);
+        socket_list_free(from_pid);
+        fd_list_free(&fds);
+    }
+    if (copy >= 0) {
+        close(copy);
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    if (pair) {
+        close(socks[0]);
+        close(socks[1]);
+    }
+    ASSERT_TRUE(pass);
+}
+
+/* socket_snapshot_walk visitor counting visits per owner */
+static int count_owner(const socket_info_t *sock, int owner, int fd,
+                       void *ctx)
+{
+    int *per_owner = ctx;
+    (void)sock;
+    (void)fd;
+    per_owner[owner]++;
+    return 0;
+}
+
+/* Test socket_snapshot_* */
+void test_socket_snapshot_owners(void)
+{
+    TEST("socket_snapshot_walk visits each socket once per owner");
+    int socks[2];
+    bool pair = socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0;
+    fd_list_t fds;
+    int ret1 = enumerate_fds(getpid(), &fds);
+    socket_snapshot_t snap;
+    int ret2 = socket_snapshot_init(&snap);
+    int per_owner[2] = { 0, 0 };
+    int ret3 = socket_snapshot_add_fds(&snap, &fds, 0);
+    int ret4 = socket_snapshot_add_fds(&snap, &fds, 1);
+    int ret5 = socket_snapshot_walk(&snap, count_owner, per_owner);
+    int ret6 = socket_snapshot_walk(&snap, NULL, NULL);
+    int ret7 = socket_snapshot_add_fds(&snap, NULL, 0);
+    ASSERT_TRUE(pair && ret1 == 0 && ret2 == 0 && ret3 == 0 && ret4 == 0 &&
+                ret5 == 0 && ret6 == -1 && ret7 == -1 &&
+                per_owner[0] >= 2 && per_owner[0] == per_owner[1]);
+    socket_snapshot_free(&snap);
+    socket_snapshot_free(&snap);
+    fd_list_free(&fds);
+    if (pair) {
+        close(socks[0]);
+        close(socks[1]);
+    }
+}
+
+/*
+ * A proc tree with three network namespaces, told apart by ns/net
+ * inodes as the kernel's are: hard links are one namespace. The caller
+ * (self) and 78 share the root's net/tcp; 77 and 79 are in a container
+ * namespace with its own tables; 80's recorded namespace is one nobody
+ * is in any more.
+ */
+#define NETNS_PATHS 32
+
+typedef struct {
+    char root[32];
+    char paths[NETNS_PATHS][96];    /* Created, in creation order */
+    int count;
+    bool built;
+} netns_fixture_t;
+
+static const char *fixture_path(netns_fixture_t *f, const char *rel)
+{
+    if (f->count == NETNS_PATHS) {
+        f->built = false;
+        return f->paths[NETNS_PATHS - 1];
+    }
+    snprintf(f->paths[f->count], sizeof(f->paths[0]), "%s/%s", f->root, rel);
+    return f->paths[f->count++];
+}
+
+static void fixture_dir(netns_fixture_t *f, const char *rel)
+{
+    f->built = f->built && mkdir(fixture_path(f, rel), 0755) == 0;
+}
+
+static void fixture_link(netns_fixture_t *f, const char *rel,
+                         const char *target)
+{
+    f->built = f->built && symlink(target, fixture_path(f, rel)) == 0;
+}
+
+static void fixture_hardlink(netns_fixture_t *f, const char *rel,
+                             const char *existing)
+{
+    char from[96];
+    snprintf(from, sizeof(from), "%s/%s", f->root, existing);
+    f->built = f->built && link(from, fixture_path(f, rel)) == 0;
+}
+
+/* A tcp table listening on 127.0.0.1 with one row per inode */
+static void fixture_tcp(netns_fixture_t *f, const char *rel,
+                        const unsigned long *inodes, int count)
+{
+    FILE *fp = f->built ? fopen(fixture_path(f, rel), "w") : NULL;
+    if (fp == NULL) {
+        f->built = false;
+        return;
+    }
+    fprintf(fp, "  sl  local_address rem_address   st tx_queue rx_queue "
+                "tr tm->when retrnsmt   uid  timeout inode\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, "   %d: 0100007F:%04X 00000000:0000 0A 00000000:00000000 "
+                    "00:00000000 00000000  1000        0 %lu 1 "
+                    "0000000000000000 100 0 0 10 0\n",
+                i, (unsigned)(8000 + i), inodes[i]);
+    }
+    f->built = fclose(fp) == 0 && f->built;
+}
+
+static void fixture_file(netns_fixture_t *f, const char *rel)
+{
+    fixture_tcp(f, rel, NULL, 0);
+}
+
+static bool build_netns_fixture(netns_fixture_t *f)
+{
+    static const unsigned long host_rows[] = { 100001 };
+    static const unsigned long container_rows[] = { 200001, 200002 };
+    static const unsigned long unread_rows[] = { 300001 };
+
+    memset(f, 0, sizeof(*f));
+    snprintf(f->root, sizeof(f->root), "/tmp/test_netns_XXXXXX");
+    f->built = mkdtemp(f->root) != NULL;
+
+    static const char *const dirs[] = {
+        "net", "self", "self/ns", "77", "77/fd", "77/ns", "77/net",
+        "78", "78/fd", "78/ns", "78/net", "79", "79/fd", "79/ns", "79/net",
+    };
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        fixture_dir(f, dirs[i]);
+    }
+    fixture_tcp(f, "net/tcp", host_rows, 1);
+    fixture_file(f, "self/ns/net");
+
+    /* 77 and 79: container; 200001 and 200002 are only in its table */
+    fixture_file(f, "77/ns/net");
+    fixture_hardlink(f, "79/ns/net", "77/ns/net");
+    fixture_tcp(f, "77/net/tcp", container_rows, 2);
+    fixture_tcp(f, "79/net/tcp", container_rows, 2);
+    fixture_link(f, "77/fd/3", "socket:[200001]");
+    fixture_link(f, "79/fd/3", "socket:[200002]");
+
+    /* 78: caller's namespace; its net/tcp must not be read again */
+    fixture_hardlink(f, "78/ns/net", "self/ns/net");
+    fixture_tcp(f, "78/net/tcp", unread_rows, 1);
+    fixture_link(f, "78/fd/3", "socket:[100001]");
+    fixture_link(f, "78/fd/4", "socket:[300001]");
+    return f->built;
+}
+
+static void remove_netns_fixture(netns_fixture_t *f)
+{
+    for (int i = f->count - 1; i >= 0; i--) {
+        remove(f->paths[i]);
+    }
+    remove(f->root);
+}
+
+/* ns/net inode of a fixture process, 0 if unreadable */
+static unsigned long fixture_netns(pid_t pid)
+{
+    proc_handle_t h;
+    unsigned long netns = 0;
+    if (proc_handle_open(&h, pid) == 0) {
+        proc_handle_netns(&h, &netns);
+        proc_handle_close(&h);
+    }
+    return netns;
+}
+
+/* Test network namespaces */
+void test_find_process_sockets_other_netns(void)
+{
+    TEST("find_process_sockets reads a container's tables via <pid>/net");
+    netns_fixture_t f;
+    bool built = build_netns_fixture(&f);
+
+    proc_set_root(f.root);
+    socket_info_t *in_container = NULL;
+    socket_info_t *on_host = NULL;
+    int container_count = 0;
+    int host_count = 0;
+    int ret1 = built ? find_process_sockets(77, &in_container,
+                                            &container_count) : -1;
+    int ret2 = built ? find_process_sockets(78, &on_host, &host_count) : -1;
+    proc_set_root(NULL);
+
+    /* 78's 300001 is only in a table of a namespace it isn't in */
+    ASSERT_TRUE(built && ret1 == 0 && container_count == 1 &&
+                in_container[0].inode == 200001 &&
+                in_container[0].local_port == 8000 &&
+                ret2 == 0 && host_count == 1 && on_host[0].inode == 100001);
+    socket_list_free(in_container);
+    socket_list_free(on_host);
+    remove_netns_fixture(&f);
+}
+
+void test_socket_snapshot_netns_once(void)
+{
+    TEST("socket_snapshot_walk reads each namespace's tables once");
+    netns_fixture_t f;
+    bool built = build_netns_fixture(&f);
+    static const pid_t pids[] = { 77, 78, 79 };
+
+    proc_set_root(f.root);
+    socket_snapshot_t snap;
+    int per_owner[3] = { 0, 0, 0 };
+    bool ok = built && socket_snapshot_init(&snap) == 0;
+    for (int i = 0; ok && i < 3; i++) {
+        fd_list_t fds;
+        ok = enumerate_fds(pids[i], &fds) == 0 &&
+             socket_snapshot_add_fds(&snap, &fds, i) == 0 &&
+             socket_snapshot_add_netns(&snap, fixture_netns(pids[i]),
+                                       pids[i]) == 0;
+        fd_list_free(&fds);
+    }
+
+    /* Recorded last, so tried first: it has gone, so 79 is used */
+    ok = ok && socket_snapshot_add_netns(&snap, fixture_netns(77), 80) == 0 &&
+         snap.namespaces.count == 3 &&
+         socket_snapshot_walk(&snap, count_owner, per_owner) == 0;
+    proc_set_root(NULL);
+
+    /* A second read of the container tables would count 77 and 79 twice */
+    ASSERT_TRUE(ok && per_owner[0] == 1 && per_owner[1] == 1 &&
+                per_owner[2] == 1 &&
+                socket_snapshot_add_netns(NULL, 1, 1) == -1);
+    if (built) {
+        socket_snapshot_free(&snap);
+    }
+    remove_netns_fixture(&f);
+}
+
+void test_find_all_socket_owners_netns(void)
+{
+    TEST("find_all_socket_owners covers every owner's namespace");
+    netns_fixture_t f;
+    bool built = build_netns_fixture(&f);
+
+    proc_set_root(f.root);
+    socket_owner_t *owners = NULL;
+    int count = 0;
+    int ret = built ? find_all_socket_owners(&owners, &count) : -1;
+    proc_set_root(NULL);
+
+    bool seen[3] = { false, false, false };
+    for (int i = 0; ret == 0 && i < count; i++) {
+        seen[0] |= owners[i].pid == 78 && owners[i].socket.inode == 100001;
+        seen[1] |= owners[i].pid == 77 && owners[i].socket.inode == 200001;
+        seen[2] |= owners[i].pid == 79 && owners[i].socket.inode == 200002;
+    }
+    ASSERT_TRUE(built && ret == 0 && count == 3 && seen[0] && seen[1] &&
+                seen[2]);
+    socket_owner_list_free(owners);
+    remove_netns_fixture(&f);
+}
+
+void test_socket_owner_list_free_null(void)
+{
+    TEST("socket_owner_list_free with NULL");
+    socket_owner_list_free(NULL);  /* Should not crash */
+    ASSERT_TRUE(1);
+}
+
 int main(void)
 {
     printf("\n=== Running Network Connection Tests ===\n\n");
@@ -133,11 +689,35 @@ int main(void)
     test_format_ip_port_any();
     test_format_ip_port_null_buffer();
 
+    /* format_socket_addr / socket_proto_to_string tests */
+    test_format_socket_addr_ipv6();
+    test_format_socket_addr_unix_unnamed();
+    test_socket_proto_tcp6();
+
     /* find_process_sockets tests */
     test_find_process_sockets_current();
     test_find_process_sockets_nonexistent();
+    test_find_process_sockets_custom_root();
+    test_find_process_sockets_other_netns();
     test_socket_list_free_null();
 
+    /* for_each_socket tests */
+    test_for_each_socket();
+    test_for_each_socket_errors();
+
+    /* find_fd_list_sockets / socket_snapshot tests */
+    test_find_fd_list_sockets();
+    test_socket_snapshot_owners();
+    test_socket_snapshot_netns_once();
+
+    /* find_all_socket_owners tests */
+    test_find_all_socket_owners_own_socket();
+    test_find_all_socket_owners_netns();
+    test_socket_owner_list_free_null();
+
+    /* Backend selection tests */
+    test_net_backends_agree();
+
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
@@ -0,0 +1,386 @@
+/*
+ * test_net_parse.c - Unit tests for /proc/net row parsing
+ *
+ * Tests parse_hex_u32() and parse_hex_words() against a scalar reference,
+ * parse_inet_row() and parse_unix_row() against rows captured from real
+ * /proc/net tables, and parse_net_table() on a fixture file read through
+ * a small buffer
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "../include/net_parse.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_FALSE(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was true)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+static const char TCP_ROW[] =
+    "   1: 0100007F:1F90 0200007F:D431 01 00000000:00000000 00:00000000 "
+    "00000000  1000        0 3469235 1 0000000000000000 20 4 30 10 -1\n";
+
+static const char TCP6_ROW[] =
+    "   0: 00000000000000000000000001000000:0016 "
+    "00000000000000000000000000000000:0000 0A 00000000:00000000 "
+    "00:00000000 00000000     0        0 23456 1 0000000000000000 100 0 0 10 0\n";
+
+static const char UDP_ROW[] =
+    " 1234: 00000000:14E9 00000000:0000 07 00000000:00000000 00:00000000 "
+    "00000000   104        0 98765 2 0000000000000000 0\n";
+
+static const char UNIX_LISTEN_ROW[] =
+    "0000000000000000: 00000002 00000000 00010000 0001 01 31337 /run/dbus/system_bus_socket\n";
+
+static const char UNIX_UNNAMED_ROW[] =
+    "0000000000000000: 00000003 00000000 00000000 0001 03 4242\n";
+
+/* Test parse_hex_u32 */
+void test_parse_hex_u32_mixed_case(void)
+{
+    TEST("parse_hex_u32 with mixed case");
+    uint32_t v = 0;
+    bool ok = parse_hex_u32("DeadBeef", 8, &v);
+    ASSERT_TRUE(ok && v == 0xDEADBEEF);
+}
+
+void test_parse_hex_u32_invalid(void)
+{
+    TEST("parse_hex_u32 rejects non-hex digit");
+    uint32_t v = 0;
+    ASSERT_FALSE(parse_hex_u32("12G4", 4, &v));
+}
+
+void test_parse_hex_u32_too_long(void)
+{
+    TEST("parse_hex_u32 rejects more than 8 digits");
+    uint32_t v = 0;
+    ASSERT_FALSE(parse_hex_u32("123456789", 9, &v));
+}
+
+/* Scalar decoder copied from net_parse.c before the SWAR/SSE2 paths */
+static bool reference_hex_u32(const char *s, size_t len, uint32_t *value)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        int d;
+        if (c >= '0' && c <= '9') {
+            d = c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            d = (c | 0x20) - 'a' + 10;
+        } else {
+            return false;
+        }
+        v = (v << 4) | (uint32_t)d;
+    }
+    *value = v;
+    return true;
+}
+
+/* Fill len bytes with random hex digits of both cases */
+static void random_hex(char *s, size_t len, uint32_t *seed)
+{
+    static const char digits[] = "0123456789abcdefABCDEF";
+    for (size_t i = 0; i < len; i++) {
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 17;
+        *seed ^= *seed << 5;
+        s[i] = digits[*seed % 22];
+    }
+}
+
+void test_parse_hex_u32_matches_scalar(void)
+{
+    TEST("parse_hex_u32 8-digit path matches the scalar decoder");
+    uint32_t seed = 2463534242u;
+    bool same = true;
+
+    /* Every byte value at every position, then random valid digits */
+    for (int pos = 0; pos < 8; pos++) {
+        for (int c = 0; c < 256; c++) {
+            char s[8];
+            random_hex(s, sizeof(s), &seed);
+            s[pos] = (char)c;
+            uint32_t a = 0, b = 0;
+            bool ok_a = parse_hex_u32(s, 8, &a);
+            bool ok_b = reference_hex_u32(s, 8, &b);
+            same = same && ok_a == ok_b && (!ok_a || a == b);
+        }
+    }
+    for (int i = 0; i < 100000; i++) {
+        char s[8];
+        random_hex(s, sizeof(s), &seed);
+        uint32_t a = 0, b = 0;
+        same = same && parse_hex_u32(s, 8, &a) &&
+               reference_hex_u32(s, 8, &b) && a == b;
+    }
+    ASSERT_TRUE(same);
+}
+
+/* Test parse_hex_words */
+void test_parse_hex_words_matches_scalar(void)
+{
+    TEST("parse_hex_words on 32 digits matches four scalar decodes");
+    uint32_t seed = 88675123u;
+    bool same = true;
+
+    for (int pos = 0; pos < 32; pos++) {
+        for (int c = 0; c < 256; c++) {
+            char s[32];
+            random_hex(s, sizeof(s), &seed);
+            s[pos] = (char)c;
+            uint32_t a[4], b[4];
+            bool ok_a = parse_hex_words(s, 4, a);
+            bool ok_b = true;
+            for (int w = 0; w < 4; w++) {
+                ok_b = ok_b && reference_hex_u32(s + w * 8, 8, &b[w]);
+            }
+            same = same && ok_a == ok_b &&
+                   (!ok_a || memcmp(a, b, sizeof(a)) == 0);
+        }
+    }
+
+    /* Odd word counts take the 8-digit path for the last word */
+    char s[24];
+    random_hex(s, sizeof(s), &seed);
+    uint32_t a[3], b[3];
+    bool ok = parse_hex_words(s, 3, a);
+    for (int w = 0; w < 3; w++) {
+        ok = ok && reference_hex_u32(s + w * 8, 8, &b[w]) && a[w] == b[w];
+    }
+    ASSERT_TRUE(same && ok && !parse_hex_words(s, 0, a) &&
+                !parse_hex_words(NULL, 1, a));
+}
+
+/* Test parse_inet_row */
+void test_parse_inet_row_tcp(void)
+{
+    TEST("parse_inet_row with TCP row");
+    socket_info_t sock;
+    int ret = parse_inet_row(TCP_ROW, strlen(TCP_ROW), &sock);
+    ASSERT_TRUE(ret == 0 && sock.family == AF_INET &&
+                sock.local_addr.v4 == htonl(0x7F000001) &&
+                sock.local_port == 8080 &&
+                sock.remote_addr.v4 == htonl(0x7F000002) &&
+                sock.remote_port == 54321 &&
+                sock.state == TCP_ESTABLISHED && sock.inode == 3469235);
+}
+
+void test_parse_inet_row_tcp6(void)
+{
+    TEST("parse_inet_row with TCP6 row (::1 listener)");
+    socket_info_t sock;
+    int ret = parse_inet_row(TCP6_ROW, strlen(TCP6_ROW), &sock);
+    char ip[INET6_ADDRSTRLEN] = "";
+    if (ret == 0) {
+        inet_ntop(AF_INET6, sock.local_addr.v6, ip, sizeof(ip));
+    }
+    ASSERT_TRUE(ret == 0 && sock.family == AF_INET6 &&
+                strcmp(ip, "::1") == 0 && sock.local_port == 22 &&
+                sock.state == TCP_LISTEN && sock.inode == 23456);
+}
+
+void test_parse_inet_row_udp(void)
+{
+    TEST("parse_inet_row with UDP row");
+    socket_info_t sock;
+    int ret = parse_inet_row(UDP_ROW, strlen(UDP_ROW), &sock);
+    ASSERT_TRUE(ret == 0 && sock.local_addr.v4 == 0 &&
+                sock.local_port == 5353 && sock.state == TCP_CLOSE &&
+                sock.inode == 98765);
+}
+
+void test_parse_inet_row_header(void)
+{
+    TEST("parse_inet_row rejects header line");
+    const char *header = "  sl  local_address rem_address   st tx_queue "
+                         "rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+    socket_info_t sock;
+    ASSERT_TRUE(parse_inet_row(header, strlen(header), &sock) == -1);
+}
+
+void test_parse_inet_row_truncated(void)
+{
+    TEST("parse_inet_row rejects truncated row");
+    socket_info_t sock;
+    ASSERT_TRUE(parse_inet_row(TCP_ROW, 40, &sock) == -1);
+}
+
+/* Test parse_unix_row */
+void test_parse_unix_row_listen(void)
+{
+    TEST("parse_unix_row with listening socket");
+    socket_info_t sock;
+    int ret = parse_unix_row(UNIX_LISTEN_ROW, strlen(UNIX_LISTEN_ROW), &sock);
+    ASSERT_TRUE(ret == 0 && sock.family == AF_UNIX &&
+                sock.state == TCP_LISTEN && sock.inode == 31337 &&
+                strcmp(sock.path, "/run/dbus/system_bus_socket") == 0);
+}
+
+void test_parse_unix_row_unnamed(void)
+{
+    TEST("parse_unix_row with unnamed connected socket");
+    socket_info_t sock;
+    int ret = parse_unix_row(UNIX_UNNAMED_ROW, strlen(UNIX_UNNAMED_ROW),
+                             &sock);
+    ASSERT_TRUE(ret == 0 && sock.state == TCP_ESTABLISHED &&
+                sock.inode == 4242 && sock.path[0] == '\0');
+}
+
+void test_parse_unix_row_header(void)
+{
+    TEST("parse_unix_row rejects header line");
+    const char *header = "Num       RefCount Protocol Flags    Type St Inode Path\n";
+    socket_info_t sock;
+    ASSERT_TRUE(parse_unix_row(header, strlen(header), &sock) == -1);
+}
+
+void test_parse_row_null(void)
+{
+    TEST("parse_inet_row and parse_unix_row with NULL");
+    socket_info_t sock;
+    ASSERT_TRUE(parse_inet_row(NULL, 0, &sock) == -1 &&
+                parse_unix_row(NULL, 0, &sock) == -1);
+}
+
+/* Rows seen by count_rows(), stopping after limit if non-zero */
+typedef struct {
+    int rows;
+    int limit;
+    unsigned long inode_sum;
+    bool all_tcp6;
+} row_count_t;
+
+static int count_rows(socket_info_t *sock, void *ctx)
+{
+    row_count_t *c = ctx;
+    c->rows++;
+    c->inode_sum += sock->inode;
+    c->all_tcp6 = c->all_tcp6 && sock->family == AF_INET6;
+    return c->limit > 0 && c->rows >= c->limit;
+}
+
+/* Test parse_net_table */
+void test_parse_net_table_chunks(void)
+{
+    TEST("parse_net_table parses rows cut across 200-byte reads");
+    char path[] = "/tmp/test_net_parse_XXXXXX";
+    int fd = mkstemp(path);
+    static const char header[] =
+        "  sl  local_address                         remote_address"
+        "                        st tx_queue rx_queue tr tm->when "
+        "retrnsmt   uid  timeout inode\n";
+    bool written = fd >= 0 &&
+                   write(fd, header, strlen(header)) ==
+                       (ssize_t)strlen(header);
+    for (int i = 0; written && i < 50; i++) {
+        written = write(fd, TCP6_ROW, strlen(TCP6_ROW)) ==
+                  (ssize_t)strlen(TCP6_ROW);
+    }
+
+    char buf[200];
+    row_count_t all = { .all_tcp6 = true };
+    row_count_t some = { .limit = 7, .all_tcp6 = true };
+    int ret1 = parse_net_table(AT_FDCWD, path, parse_inet_row, buf,
+                               sizeof(buf), count_rows, &all);
+    int ret2 = parse_net_table(AT_FDCWD, path, parse_inet_row, buf,
+                               sizeof(buf), count_rows, &some);
+    ASSERT_TRUE(written && ret1 == 0 && all.rows == 50 && all.all_tcp6 &&
+                all.inode_sum == 50UL * 23456 && ret2 == 0 &&
+                some.rows == 7);
+    if (fd >= 0) {
+        close(fd);
+        unlink(path);
+    }
+}
+
+void test_parse_net_table_errors(void)
+{
+    TEST("parse_net_table with NULL parser and missing file");
+    char buf[64];
+    row_count_t c = {0};
+    int ret1 = parse_net_table(AT_FDCWD, "/proc/net/unix", NULL, buf,
+                               sizeof(buf), count_rows, &c);
+    int err1 = errno;
+    int ret2 = parse_net_table(AT_FDCWD, "/nonexistent/net/tcp",
+                               parse_inet_row, buf, sizeof(buf),
+                               count_rows, &c);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                errno == ENOENT && c.rows == 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running /proc/net Row Parser Tests ===\n\n");
+
+    /* parse_hex_u32 tests */
+    test_parse_hex_u32_mixed_case();
+    test_parse_hex_u32_invalid();
+    test_parse_hex_u32_too_long();
+    test_parse_hex_u32_matches_scalar();
+
+    /* parse_hex_words tests */
+    test_parse_hex_words_matches_scalar();
+
+    /* parse_inet_row tests */
+    test_parse_inet_row_tcp();
+    test_parse_inet_row_tcp6();
+    test_parse_inet_row_udp();
+    test_parse_inet_row_header();
+    test_parse_inet_row_truncated();
+
+    /* parse_unix_row tests */
+    test_parse_unix_row_listen();
+    test_parse_unix_row_unnamed();
+    test_parse_unix_row_header();
+    test_parse_row_null();
+
+    /* parse_net_table tests */
+    test_parse_net_table_chunks();
+    test_parse_net_table_errors();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
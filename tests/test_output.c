@@ -0,0 +1,494 @@
+/*
+ * test_output.c - Unit tests for JSON Lines and binary record output
+ *
+ * Tests output_parse_format(), the record writers and buffer flushing by
+ * writing into a temporary file and reading the bytes back
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "../include/output.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/* Captured output from one writer session */
+typedef struct {
+    FILE *file;
+    char *data;
+    size_t len;
+} capture_t;
+
+static int capture_start(capture_t *cap, output_t *out, output_format_t fmt)
+{
+    memset(cap, 0, sizeof(*cap));
+    cap->file = tmpfile();
+    if (cap->file == NULL) {
+        return -1;
+    }
+    return output_open(out, fileno(cap->file), fmt);
+}
+
+/* Close the writer and slurp everything it wrote */
+static int capture_finish(capture_t *cap, output_t *out)
+{
+    int ret = output_close(out);
+
+    off_t end = lseek(fileno(cap->file), 0, SEEK_END);
+    cap->data = malloc((size_t)end + 1);
+    if (cap->data == NULL) {
+        fclose(cap->file);
+        return -1;
+    }
+    cap->len = (size_t)pread(fileno(cap->file), cap->data, (size_t)end, 0);
+    cap->data[cap->len] = '\0';
+    fclose(cap->file);
+    return ret;
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static void sample_process(proc_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->pid = 4321;
+    strcpy(info->name, "nginx");
+    info->state = PROC_STATE_SLEEPING;
+    info->uid_real = 33;
+    info->uid_effective = 33;
+    info->gid_real = 34;
+    info->gid_effective = 34;
+    info->vm_size_kb = 123456;
+    info->vm_rss_kb = 7890;
+    info->vm_peak_kb = 130000;
+    info->thread_count = 4;
+}
+
+static void sample_tcp6(socket_info_t *sock)
+{
+    memset(sock, 0, sizeof(*sock));
+    sock->proto = SOCK_PROTO_TCP;
+    sock->family = AF_INET6;
+    inet_pton(AF_INET6, "::1", sock->local_addr.v6);
+    sock->local_port = 443;
+    inet_pton(AF_INET6, "2001:db8::7", sock->remote_addr.v6);
+    sock->remote_port = 51000;
+    sock->state = TCP_ESTABLISHED;
+    sock->inode = 987654;
+}
+
+/* Test output_parse_format */
+void test_parse_format(void)
+{
+    TEST("output_parse_format with known and unknown names");
+    output_format_t fmt = OUTPUT_TEXT;
+    bool ok = output_parse_format("jsonl", &fmt) == 0 && fmt == OUTPUT_JSONL &&
+              output_parse_format("binary", &fmt) == 0 &&
+              fmt == OUTPUT_BINARY &&
+              output_parse_format("text", &fmt) == 0 && fmt == OUTPUT_TEXT;
+    ASSERT_TRUE(ok && output_parse_format("xml", &fmt) == -1 &&
+                errno == EINVAL);
+}
+
+void test_open_text_rejected(void)
+{
+    TEST("output_open rejects OUTPUT_TEXT (EINVAL)");
+    output_t out;
+    ASSERT_TRUE(output_open(&out, STDOUT_FILENO, OUTPUT_TEXT) == -1 &&
+                errno == EINVAL);
+}
+
+/* Test JSON Lines */
+void test_jsonl_process(void)
+{
+    TEST("JSONL process record carries every proc_info_t field");
+    output_t out;
+    capture_t cap;
+    proc_info_t info;
+    sample_process(&info);
+
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_process(&out, &info);
+        ret = capture_finish(&cap, &out);
+    }
+    ASSERT_TRUE(ret == 0 && cap.data != NULL && strcmp(cap.data,
+        "{\"type\":\"process\",\"pid\":4321,\"name\":\"nginx\","
+        "\"state\":\"Sleeping\",\"uid_real\":33,\"uid_effective\":33,"
+        "\"gid_real\":34,\"gid_effective\":34,\"vm_size_kb\":123456,"
+        "\"vm_rss_kb\":7890,\"vm_peak_kb\":130000,\"thread_count\":4}\n") == 0);
+    free(cap.data);
+}
+
+void test_jsonl_fd_escaping(void)
+{
+    TEST("JSONL fd record escapes quotes, backslash and control chars");
+    output_t out;
+    capture_t cap;
+    fd_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.fd = 5;
+
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_fd(&out, 1, &entry, "/tmp/a\"b\\c\nd\x01");
+        ret = capture_finish(&cap, &out);
+    }
+    ASSERT_TRUE(ret == 0 && cap.data != NULL && strstr(cap.data,
+        "\"target\":\"/tmp/a\\\"b\\\\c\\nd\\u0001\"") != NULL);
+    free(cap.data);
+}
+
+void test_jsonl_socket(void)
+{
+    TEST("JSONL socket record with IPv6 addresses");
+    output_t out;
+    capture_t cap;
+    socket_info_t sock;
+    sample_tcp6(&sock);
+
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_socket(&out, 10, 7, &sock);
+        ret = capture_finish(&cap, &out);
+    }
+    ASSERT_TRUE(ret == 0 && cap.data != NULL && strcmp(cap.data,
+        "{\"type\":\"socket\",\"pid\":10,\"fd\":7,\"proto\":\"TCP6\","
+        "\"family\":\"inet6\",\"local_addr\":\"::1\",\"local_port\":443,"
+        "\"remote_addr\":\"2001:db8::7\",\"remote_port\":51000,"
+        "\"state\":\"ESTABLISHED\",\"inode\":987654}\n") == 0);
+    free(cap.data);
+}
+
+void test_jsonl_error(void)
+{
+    TEST("JSONL error record");
+    output_t out;
+    capture_t cap;
+
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_error(&out, 999999, ENOENT);
+        ret = capture_finish(&cap, &out);
+    }
+    ASSERT_TRUE(ret == 0 && cap.data != NULL &&
+                strncmp(cap.data, "{\"type\":\"error\",\"pid\":999999,"
+                        "\"errno\":2,", 38) == 0);
+    free(cap.data);
+}
+
+/* Test binary */
+void test_binary_header_and_process(void)
+{
+    TEST("binary stream header and process record layout");
+    output_t out;
+    capture_t cap;
+    proc_info_t info;
+    sample_process(&info);
+
+    int ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        output_process(&out, &info);
+        ret = capture_finish(&cap, &out);
+    }
+
+    const unsigned char *p = (const unsigned char *)cap.data;
+    bool ok = ret == 0 && cap.len >= 12 && memcmp(p, "PNSP", 4) == 0 &&
+              get_u16(p + 4) == OUTPUT_BINARY_VERSION;
+    if (ok) {
+        const unsigned char *rec = p + 8;
+        uint32_t len = get_u32(rec);
+        const unsigned char *body = rec + 4;
+        ok = cap.len == 8 + 4 + len &&
+             body[0] == OUTPUT_RECORD_PROCESS &&
+             get_u32(body + 1) == 4321 &&
+             body[5] == PROC_STATE_SLEEPING &&
+             get_u32(body + 6) == 33 &&          /* uid_real */
+             get_u32(body + 18) == 34 &&         /* gid_effective */
+             get_u32(body + 22) == 123456 &&     /* vm_size_kb low word */
+             get_u32(body + 46) == 4 &&          /* thread_count */
+             get_u16(body + 50) == 5 &&
+             memcmp(body + 52, "nginx", 5) == 0;
+    }
+    ASSERT_TRUE(ok);
+    free(cap.data);
+}
+
+void test_binary_socket(void)
+{
+    TEST("binary socket record layout");
+    output_t out;
+    capture_t cap;
+    socket_info_t sock;
+    sample_tcp6(&sock);
+
+    int ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        output_socket(&out, 10, 7, &sock);
+        ret = capture_finish(&cap, &out);
+    }
+
+    const unsigned char *body = (const unsigned char *)cap.data + 12;
+    bool ok = ret == 0 && cap.len == 8 + 4 + get_u32(body - 4) &&
+              body[0] == OUTPUT_RECORD_SOCKET &&
+              get_u32(body + 1) == 10 && get_u32(body + 5) == 7 &&
+              body[9] == SOCK_PROTO_TCP && body[10] == AF_INET6 &&
+              body[11] == TCP_ESTABLISHED &&
+              get_u16(body + 12) == 443 && get_u16(body + 14) == 51000 &&
+              memcmp(body + 16, sock.local_addr.v6, 16) == 0 &&
+              memcmp(body + 32, sock.remote_addr.v6, 16) == 0 &&
+              get_u32(body + 48) == 987654 && get_u16(body + 56) == 0;
+    ASSERT_TRUE(ok);
+    free(cap.data);
+}
+
+void test_thread_record(void)
+{
+    TEST("thread record carries CPU times in both formats");
+    thread_info_t thread;
+    memset(&thread, 0, sizeof(thread));
+    thread.tid = 4322;
+    strcpy(thread.name, "gc");
+    thread.state = PROC_STATE_RUNNING;
+    thread.utime = 1500;
+    thread.stime = 25;
+    thread.processor = 3;
+
+    output_t out;
+    capture_t cap;
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_thread(&out, 4321, &thread);
+        ret = capture_finish(&cap, &out);
+    }
+    bool json_ok = ret == 0 && cap.data != NULL && strcmp(cap.data,
+        "{\"type\":\"thread\",\"pid\":4321,\"tid\":4322,\"name\":\"gc\","
+        "\"state\":\"Running\",\"utime\":1500,\"stime\":25,"
+        "\"processor\":3}\n") == 0;
+    free(cap.data);
+
+    ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        output_thread(&out, 4321, &thread);
+        ret = capture_finish(&cap, &out);
+    }
+    const unsigned char *body = (const unsigned char *)cap.data + 12;
+    bool bin_ok = ret == 0 && cap.len == 12 + 1 + 4 + 4 + 1 + 8 + 8 + 4 +
+                                         2 + 2 &&
+                  body[0] == OUTPUT_RECORD_THREAD &&
+                  get_u32(body + 5) == 4322 &&
+                  body[9] == PROC_STATE_RUNNING &&
+                  get_u32(body + 10) == 1500 &&  /* utime low word */
+                  get_u32(body + 18) == 25 &&    /* stime low word */
+                  get_u32(body + 26) == 3 &&     /* processor */
+                  get_u16(body + 30) == 2 && memcmp(body + 32, "gc", 2) == 0;
+    ASSERT_TRUE(json_ok && bin_ok);
+    free(cap.data);
+}
+
+void test_memory_records(void)
+{
+    TEST("memory and mem_file records in both formats");
+    mem_usage_t usage;
+    memset(&usage, 0, sizeof(usage));
+    usage.rss_kb = 1384;
+    usage.pss_kb = 471;
+    usage.locked_kb = 4;
+    mem_file_t entry = { .vma_count = 5, .usage = usage };
+
+    output_t out;
+    capture_t cap;
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_memory(&out, 4321, &usage);
+        output_mem_file(&out, 4321, &entry, "/usr/lib/libc.so.6");
+        ret = capture_finish(&cap, &out);
+    }
+    bool json_ok = ret == 0 && cap.data != NULL &&
+        strncmp(cap.data, "{\"type\":\"memory\",\"pid\":4321,"
+                "\"size_kb\":0,\"rss_kb\":1384,\"pss_kb\":471,", 59) == 0 &&
+        strstr(cap.data, "\"locked_kb\":4}\n{\"type\":\"mem_file\","
+               "\"pid\":4321,\"name\":\"/usr/lib/libc.so.6\","
+               "\"vma_count\":5,\"size_kb\":0,") != NULL;
+    free(cap.data);
+
+    ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        output_mem_file(&out, 4321, &entry, "libc");
+        ret = capture_finish(&cap, &out);
+    }
+
+    /* Header, length, type, pid, vma_count, 18 u64 fields, name */
+    const unsigned char *body = (const unsigned char *)cap.data + 12;
+    bool bin_ok = ret == 0 &&
+                  cap.len == 12 + 1 + 4 + 4 + 18 * 8 + 2 + 4 &&
+                  body[0] == OUTPUT_RECORD_MEM_FILE &&
+                  get_u32(body + 1) == 4321 && get_u32(body + 5) == 5 &&
+                  get_u32(body + 9 + 8) == 1384 &&    /* rss_kb */
+                  get_u32(body + 9 + 16) == 471 &&    /* pss_kb */
+                  get_u32(body + 9 + 17 * 8) == 4 &&  /* locked_kb */
+                  get_u16(body + 9 + 18 * 8) == 4 &&
+                  memcmp(body + 9 + 18 * 8 + 2, "libc", 4) == 0;
+    ASSERT_TRUE(json_ok && bin_ok);
+    free(cap.data);
+}
+
+void test_counts_record(void)
+{
+    TEST("counts record in both formats, -1 for unknown");
+    output_t out;
+    capture_t cap;
+    int ret = capture_start(&cap, &out, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_counts(&out, 77, 12, -1);
+        ret = capture_finish(&cap, &out);
+    }
+    bool json_ok = ret == 0 && cap.data != NULL &&
+        strcmp(cap.data, "{\"type\":\"counts\",\"pid\":77,"
+               "\"fd_count\":12,\"socket_count\":-1}\n") == 0;
+    free(cap.data);
+
+    ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        output_counts(&out, 77, 12, -1);
+        ret = capture_finish(&cap, &out);
+    }
+
+    /* Header, length, type, pid, fd_count, socket_count */
+    const unsigned char *body = (const unsigned char *)cap.data + 12;
+    bool bin_ok = ret == 0 && cap.len == 12 + 1 + 4 + 4 + 4 &&
+                  get_u32((const unsigned char *)cap.data + 8) == 13 &&
+                  body[0] == OUTPUT_RECORD_COUNTS &&
+                  get_u32(body + 1) == 77 && get_u32(body + 5) == 12 &&
+                  get_u32(body + 9) == 0xFFFFFFFFu;
+    ASSERT_TRUE(json_ok && bin_ok);
+    free(cap.data);
+}
+
+/* Test buffering */
+void test_large_stream(void)
+{
+    TEST("records spanning several buffer flushes stay intact");
+    output_t out;
+    capture_t cap;
+    thread_info_t thread;
+    memset(&thread, 0, sizeof(thread));
+    strcpy(thread.name, "worker");
+    thread.state = PROC_STATE_RUNNING;
+
+    int count = 50000;
+    int ret = capture_start(&cap, &out, OUTPUT_BINARY);
+    if (ret == 0) {
+        for (int i = 0; i < count; i++) {
+            thread.tid = i + 1;
+            output_thread(&out, 1, &thread);
+        }
+        ret = capture_finish(&cap, &out);
+    }
+
+    /* Walk every length prefix and check TIDs come back in order */
+    bool ok = (ret == 0 && cap.len > OUTPUT_BUFFER_SIZE);
+    size_t pos = 8;
+    int seen = 0;
+    while (ok && pos + 4 <= cap.len) {
+        const unsigned char *rec = (const unsigned char *)cap.data + pos;
+        uint32_t len = get_u32(rec);
+        ok = rec[4] == OUTPUT_RECORD_THREAD &&
+             get_u32(rec + 9) == (uint32_t)(seen + 1);
+        pos += 4 + len;
+        seen++;
+    }
+    ASSERT_TRUE(ok && seen == count && pos == cap.len);
+    free(cap.data);
+}
+
+void test_write_error(void)
+{
+    TEST("output_close reports write failure (EBADF)");
+    output_t out;
+    fd_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+
+    int ret = output_open(&out, -1, OUTPUT_JSONL);
+    if (ret == 0) {
+        output_fd(&out, 1, &entry, "/dev/null");
+        ret = output_close(&out);
+    }
+    ASSERT_TRUE(ret == -1 && errno == EBADF);
+}
+
+void test_close_null(void)
+{
+    TEST("output_close with NULL");
+    ASSERT_TRUE(output_close(NULL) == 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running Record Output Tests ===\n\n");
+
+    /* format selection tests */
+    test_parse_format();
+    test_open_text_rejected();
+
+    /* JSON Lines tests */
+    test_jsonl_process();
+    test_jsonl_fd_escaping();
+    test_jsonl_socket();
+    test_jsonl_error();
+
+    /* binary tests */
+    test_binary_header_and_process();
+    test_binary_socket();
+    test_thread_record();
+    test_memory_records();
+    test_counts_record();
+
+    /* buffering tests */
+    test_large_stream();
+    test_write_error();
+    test_close_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
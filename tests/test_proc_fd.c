@@ -1,15 +1,24 @@
 /*
  * test_proc_fd.c - Unit tests for file descriptor enumeration
  *
- * Tests enumerate_fds(), fd_entries_free(), and parse_socket_inode()
+ * Tests enumerate_fds(), for_each_fd(), count_fds(), count_socket_fds(),
+ * fd_list_free(), fd_target(), classify_fd_target(), fd_type_to_string(),
+ * parse_socket_inode() and fd_set_backend()
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include "../include/proc_fd.h"
+#include "../include/util.h"
 
 #define TEST_PASS "\033[32m[PASS]\033[0m"
 #define TEST_FAIL "\033[31m[FAIL]\033[0m"
@@ -60,12 +69,11 @@ static int tests_failed = 0;
 void test_enumerate_fds_current(void)
 {
     TEST("enumerate_fds with current process");
-    fd_entry_t *entries = NULL;
-    int count = 0;
-    int ret = enumerate_fds(getpid(), &entries, &count);
-    bool pass = (ret == 0 && entries != NULL && count >= 3); /* At least stdin, stdout, stderr */
-    if (pass) {
-        fd_entries_free(entries);
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
+    bool pass = (ret == 0 && list.entries != NULL && list.count >= 3); /* At least stdin, stdout, stderr */
+    if (ret == 0) {
+        fd_list_free(&list);
     }
     ASSERT_TRUE(pass);
 }
@@ -74,17 +82,16 @@ void test_enumerate_fds_current(void)
 void test_enumerate_fds_standard_fds(void)
 {
     TEST("enumerate_fds includes stdin/stdout/stderr");
-    fd_entry_t *entries = NULL;
-    int count = 0;
-    int ret = enumerate_fds(getpid(), &entries, &count);
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
     bool found_stdin = false, found_stdout = false, found_stderr = false;
-    if (ret == 0 && entries != NULL) {
-        for (int i = 0; i < count; i++) {
-            if (entries[i].fd == 0) found_stdin = true;
-            if (entries[i].fd == 1) found_stdout = true;
-            if (entries[i].fd == 2) found_stderr = true;
+    if (ret == 0 && list.entries != NULL) {
+        for (int i = 0; i < list.count; i++) {
+            if (list.entries[i].fd == 0) found_stdin = true;
+            if (list.entries[i].fd == 1) found_stdout = true;
+            if (list.entries[i].fd == 2) found_stderr = true;
         }
-        fd_entries_free(entries);
+        fd_list_free(&list);
     }
     ASSERT_TRUE(found_stdin && found_stdout && found_stderr);
 }
@@ -93,35 +100,119 @@ void test_enumerate_fds_standard_fds(void)
 void test_enumerate_fds_has_targets(void)
 {
     TEST("enumerate_fds entries have targets");
-    fd_entry_t *entries = NULL;
-    int count = 0;
-    int ret = enumerate_fds(getpid(), &entries, &count);
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
     bool has_targets = true;
-    if (ret == 0 && entries != NULL && count > 0) {
-        for (int i = 0; i < count; i++) {
-            if (strlen(entries[i].target) == 0) {
+    if (ret == 0 && list.entries != NULL && list.count > 0) {
+        for (int i = 0; i < list.count; i++) {
+            const char *target = fd_target(&list, &list.entries[i]);
+            if (strlen(target) == 0 ||
+                strlen(target) != list.entries[i].target_len) {
                 has_targets = false;
                 break;
             }
         }
-        fd_entries_free(entries);
+        fd_list_free(&list);
     } else {
         has_targets = false;
     }
     ASSERT_TRUE(has_targets);
 }
 
+/* Test a known FD resolves to the right target and type */
+void test_enumerate_fds_known_target(void)
+{
+    TEST("enumerate_fds resolves /dev/null as device");
+    int fd = open("/dev/null", O_RDONLY);
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
+    bool found = false;
+    if (ret == 0) {
+        for (int i = 0; i < list.count; i++) {
+            if (list.entries[i].fd == fd) {
+                found = strcmp(fd_target(&list, &list.entries[i]),
+                               "/dev/null") == 0 &&
+                        list.entries[i].type == FD_TYPE_DEVICE;
+            }
+        }
+        fd_list_free(&list);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    ASSERT_TRUE(found);
+}
+
+/* Test pipe and socket FDs are classified, sockets carry their inode */
+void test_enumerate_fds_classifies(void)
+{
+    TEST("enumerate_fds classifies pipes and sockets");
+    int pipefd[2] = { -1, -1 };
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool ok = pipe(pipefd) == 0 && sock >= 0;
+    bool saw_pipe = false, saw_socket = false;
+    fd_list_t list;
+    if (ok && enumerate_fds(getpid(), &list) == 0) {
+        for (int i = 0; i < list.count; i++) {
+            const fd_entry_t *e = &list.entries[i];
+            if (e->fd == pipefd[0]) {
+                saw_pipe = (e->type == FD_TYPE_PIPE);
+            }
+            if (e->fd == sock) {
+                saw_socket = (e->type == FD_TYPE_SOCKET &&
+                              e->socket_inode != 0);
+            }
+        }
+        fd_list_free(&list);
+    }
+    if (pipefd[0] >= 0) close(pipefd[0]);
+    if (pipefd[1] >= 0) close(pipefd[1]);
+    if (sock >= 0) close(sock);
+    ASSERT_TRUE(saw_pipe && saw_socket);
+}
+
+/* Test targets survive arena growth past the initial capacity */
+void test_enumerate_fds_many(void)
+{
+    TEST("enumerate_fds with 500 extra FDs");
+    enum { EXTRA = 500 };
+    int fds[EXTRA];
+    int opened = 0;
+    for (int i = 0; i < EXTRA; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        if (fds[i] < 0) {
+            break;
+        }
+        opened++;
+    }
+
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
+    int matches = 0;
+    if (ret == 0) {
+        for (int i = 0; i < list.count; i++) {
+            if (strcmp(fd_target(&list, &list.entries[i]), "/dev/null") == 0) {
+                matches++;
+            }
+        }
+        fd_list_free(&list);
+    }
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+    ASSERT_TRUE(ret == 0 && opened == EXTRA && matches >= EXTRA);
+}
+
 /* Test enumerate_fds with PID 1 */
 void test_enumerate_fds_pid1(void)
 {
     TEST("enumerate_fds with PID 1");
-    fd_entry_t *entries = NULL;
-    int count = 0;
-    int ret = enumerate_fds(1, &entries, &count);
+    fd_list_t list;
+    int ret = enumerate_fds(1, &list);
     /* May succeed or fail with EACCES depending on permissions */
     bool pass = (ret == 0) || (ret == -1 && errno == EACCES);
     if (ret == 0) {
-        fd_entries_free(entries);
+        fd_list_free(&list);
     }
     ASSERT_TRUE(pass);
 }
@@ -130,30 +221,383 @@ void test_enumerate_fds_pid1(void)
 void test_enumerate_fds_nonexistent(void)
 {
     TEST("enumerate_fds with non-existent PID");
-    fd_entry_t *entries = NULL;
-    int count = 0;
-    int ret = enumerate_fds(999999, &entries, &count);
+    fd_list_t list;
+    int ret = enumerate_fds(999999, &list);
     ASSERT_TRUE(ret == -1 && errno == ENOENT);
 }
 
-/* Test enumerate_fds sets count to 0 on error */
+/* Test enumerate_fds clears the list on error */
 void test_enumerate_fds_error_count(void)
 {
-    TEST("enumerate_fds sets count to 0 on error");
-    fd_entry_t *entries = (fd_entry_t *)0xDEADBEEF;
-    int count = 42;
-    enumerate_fds(999999, &entries, &count);
-    ASSERT_TRUE(entries == NULL && count == 0);
+    TEST("enumerate_fds clears list on error");
+    fd_list_t list;
+    list.entries = (fd_entry_t *)0xDEADBEEF;
+    list.count = 42;
+    list.strings = (char *)0xDEADBEEF;
+    list.strings_len = 42;
+    enumerate_fds(999999, &list);
+    ASSERT_TRUE(list.entries == NULL && list.count == 0 &&
+                list.strings == NULL && list.strings_len == 0);
+}
+
+/* Test enumerate_fds with NULL list */
+void test_enumerate_fds_null(void)
+{
+    TEST("enumerate_fds with NULL list");
+    int ret = enumerate_fds(getpid(), NULL);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
 }
 
-/* Test fd_entries_free with NULL is safe */
-void test_fd_entries_free_null(void)
+/*
+ * Build <root>/77/fd holding a /dev/null link "0" and a plain file "3",
+ * which is listed like an FD but whose readlinkat() fails with EINVAL.
+ * Returns true on success.
+ */
+static bool build_unresolvable_root(char *root)
 {
-    TEST("fd_entries_free with NULL");
-    fd_entries_free(NULL); /* Should not crash */
+    char path[128];
+    bool built = mkdtemp(root) != NULL;
+    static const char *const dirs[] = { "77", "77/fd" };
+    for (size_t i = 0; built && i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        built = mkdir(path, 0755) == 0;
+    }
+    snprintf(path, sizeof(path), "%s/77/fd/0", root);
+    built = built && symlink("/dev/null", path) == 0;
+    snprintf(path, sizeof(path), "%s/77/fd/3", root);
+    int fd = built ? open(path, O_CREAT | O_WRONLY, 0600) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    return built && fd >= 0;
+}
+
+static void remove_unresolvable_root(const char *root)
+{
+    char path[128];
+    static const char *const files[] = { "77/fd/3", "77/fd/0", "77/fd",
+                                         "77", "" };
+    for (size_t i = 0; i < 5; i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        remove(path);
+    }
+}
+
+/*
+ * Test an fd/ that lists but whose links cannot be read fails the walk,
+ * rather than passing for an empty table. Without root, a directory
+ * that can be read but not searched also gives EACCES.
+ */
+void test_enumerate_fds_unresolvable(void)
+{
+    TEST("enumerate_fds fails when fd/ links cannot be read");
+    char root[] = "/tmp/test_proc_fd_root_XXXXXX";
+    bool built = build_unresolvable_root(root);
+
+    proc_set_root(root);
+    fd_list_t list;
+    int ret = built ? enumerate_fds(77, &list) : 0;
+    int saved_errno = errno;
+    bool invalid = ret == -1 && saved_errno == EINVAL && list.count == 0;
+
+    /* CAP_DAC_READ_SEARCH ignores the missing search bit */
+    bool denied = true;
+    if (built && geteuid() != 0) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/77/fd/3", root);
+        remove(path);
+        snprintf(path, sizeof(path), "%s/77/fd", root);
+        denied = chmod(path, 0400) == 0 &&
+                 enumerate_fds(77, &list) == -1 && errno == EACCES;
+        chmod(path, 0755);
+    }
+    proc_set_root(NULL);
+
+    remove_unresolvable_root(root);
+    ASSERT_TRUE(built && invalid && denied);
+}
+
+/* Test fd_list_free with NULL is safe */
+void test_fd_list_free_null(void)
+{
+    TEST("fd_list_free with NULL");
+    fd_list_free(NULL); /* Should not crash */
     ASSERT_TRUE(1);
 }
 
+/* Test fd_target with an empty list */
+void test_fd_target_empty(void)
+{
+    TEST("fd_target with empty list");
+    fd_list_t list = {0};
+    fd_entry_t entry = {0};
+    ASSERT_TRUE(strcmp(fd_target(&list, &entry), "") == 0 &&
+                strcmp(fd_target(NULL, NULL), "") == 0);
+}
+
+/* Test classify_fd_target prefixes */
+void test_classify_fd_target(void)
+{
+    TEST("classify_fd_target prefixes");
+    ASSERT_TRUE(classify_fd_target("socket:[12345]") == FD_TYPE_SOCKET &&
+                classify_fd_target("pipe:[67890]") == FD_TYPE_PIPE &&
+                classify_fd_target("anon_inode:[eventfd]") == FD_TYPE_ANON_INODE &&
+                classify_fd_target("/dev/pts/1") == FD_TYPE_DEVICE &&
+                classify_fd_target("/var/log/syslog") == FD_TYPE_FILE &&
+                classify_fd_target("net:[4026531840]") == FD_TYPE_OTHER &&
+                classify_fd_target(NULL) == FD_TYPE_OTHER);
+}
+
+/* Test fd_type_to_string names */
+void test_fd_type_to_string(void)
+{
+    TEST("fd_type_to_string names");
+    ASSERT_TRUE(strcmp(fd_type_to_string(FD_TYPE_FILE), "file") == 0 &&
+                strcmp(fd_type_to_string(FD_TYPE_DEVICE), "device") == 0 &&
+                strcmp(fd_type_to_string(FD_TYPE_SOCKET), "socket") == 0 &&
+                strcmp(fd_type_to_string(FD_TYPE_PIPE), "pipe") == 0 &&
+                strcmp(fd_type_to_string(FD_TYPE_ANON_INODE), "anon_inode") == 0 &&
+                strcmp(fd_type_to_string(FD_TYPE_OTHER), "other") == 0);
+}
+
+/* Test the per-entry footprint stays small */
+void test_fd_entry_size(void)
+{
+    TEST("fd_entry_t is at most 32 bytes");
+    ASSERT_TRUE(sizeof(fd_entry_t) <= 32);
+}
+
+/* for_each_fd visitor counting every FD; ctx is an int counter */
+static int count_visitor(const fd_entry_t *entry, const char *target,
+                         void *ctx)
+{
+    (void)entry;
+    (void)target;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+/* for_each_fd visitor that stops after the first FD */
+static int stop_visitor(const fd_entry_t *entry, const char *target,
+                        void *ctx)
+{
+    (void)entry;
+    (void)target;
+    (*(int *)ctx)++;
+    return 1;
+}
+
+/* for_each_fd visitor checking entry/target consistency */
+static int check_visitor(const fd_entry_t *entry, const char *target,
+                         void *ctx)
+{
+    bool *ok = ctx;
+    if (strlen(target) != entry->target_len ||
+        entry->type != classify_fd_target(target) ||
+        entry->target_offset != 0) {
+        *ok = false;
+    }
+    return 0;
+}
+
+/* Test for_each_fd visits as many FDs as enumerate_fds returns */
+void test_for_each_fd_count(void)
+{
+    TEST("for_each_fd visits every FD");
+    fd_list_t list;
+    int visited = 0;
+    int ret1 = enumerate_fds(getpid(), &list);
+    int ret2 = for_each_fd(getpid(), count_visitor, &visited);
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && visited == list.count);
+    fd_list_free(&list);
+}
+
+/* Test for_each_fd passes consistent entries */
+void test_for_each_fd_entries(void)
+{
+    TEST("for_each_fd entries match their targets");
+    bool ok = true;
+    int ret = for_each_fd(getpid(), check_visitor, &ok);
+    ASSERT_TRUE(ret == 0 && ok);
+}
+
+/* Test for_each_fd stops when the visitor returns non-zero */
+void test_for_each_fd_early_stop(void)
+{
+    TEST("for_each_fd stops on non-zero visitor");
+    int visited = 0;
+    int ret = for_each_fd(getpid(), stop_visitor, &visited);
+    ASSERT_TRUE(ret == 0 && visited == 1);
+}
+
+/* Test for_each_fd error handling */
+void test_for_each_fd_errors(void)
+{
+    TEST("for_each_fd with NULL visitor and bad PID");
+    int visited = 0;
+    int ret1 = for_each_fd(getpid(), NULL, NULL);
+    int err1 = errno;
+    int ret2 = for_each_fd(999999, count_visitor, &visited);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL &&
+                ret2 == -1 && err2 == ENOENT && visited == 0);
+}
+
+/* Test count_fds agrees with a full enumeration */
+void test_count_fds_matches(void)
+{
+    TEST("count_fds matches enumerate_fds with 200 extra FDs");
+    enum { EXTRA = 200 };
+    int fds[EXTRA];
+    int opened = 0;
+    for (int i = 0; i < EXTRA; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        if (fds[i] < 0) {
+            break;
+        }
+        opened++;
+    }
+
+    fd_list_t list;
+    int count = -1;
+    int ret1 = enumerate_fds(getpid(), &list);
+    int ret2 = count_fds(getpid(), &count);
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && opened == EXTRA &&
+                count == list.count && count >= EXTRA + 3);
+    fd_list_free(&list);
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+}
+
+/* Test count_fds error handling */
+void test_count_fds_errors(void)
+{
+    TEST("count_fds with NULL count and bad PID");
+    int count = 42;
+    int ret1 = count_fds(getpid(), NULL);
+    int err1 = errno;
+    int ret2 = count_fds(999999, &count);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL &&
+                ret2 == -1 && err2 == ENOENT && count == 0);
+}
+
+/* Test count_socket_fds against a socketpair */
+void test_count_socket_fds_self(void)
+{
+    TEST("count_socket_fds counts a socketpair and matches count_fds");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+
+    int fds = -1;
+    int sockets = -1;
+    int total = -1;
+    int ret1 = count_socket_fds(getpid(), &fds, &sockets);
+    int ret2 = count_fds(getpid(), &total);
+    ASSERT_TRUE(ret0 == 0 && ret1 == 0 && ret2 == 0 &&
+                sockets >= 2 && sockets < fds && fds == total);
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+/* Test sample_fds with room for every FD */
+void test_sample_fds_census(void)
+{
+    TEST("sample_fds larger than the FD table matches enumerate_fds");
+    int pair[2];
+    int pipefd[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0 &&
+               pipe(pipefd) == 0;
+
+    fd_sample_t sample;
+    fd_list_t list;
+    int ret1 = sample_fds(getpid(), 100000, 1, &sample);
+    int ret2 = enumerate_fds(getpid(), &list);
+    int by_type[FD_TYPE_OTHER + 1] = { 0 };
+    for (int i = 0; ret2 == 0 && i < list.count; i++) {
+        by_type[list.entries[i].type]++;
+    }
+    ASSERT_TRUE(ret0 && ret1 == 0 && ret2 == 0 &&
+                sample.total == list.count && sample.sampled == list.count &&
+                memcmp(sample.type_counts, by_type, sizeof(by_type)) == 0 &&
+                sample.type_counts[FD_TYPE_SOCKET] >= 2 &&
+                sample.type_counts[FD_TYPE_PIPE] >= 2);
+    if (ret2 == 0) {
+        fd_list_free(&list);
+    }
+    if (ret0) {
+        close(pair[0]);
+        close(pair[1]);
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+}
+
+/* Test sample_fds reads only a subset */
+void test_sample_fds_subset(void)
+{
+    TEST("sample_fds of 100 among 500 extra FDs resolves just 100");
+    enum { EXTRA = 500 };
+    int fds[EXTRA];
+    int opened = 0;
+    for (int i = 0; i < EXTRA; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        if (fds[i] < 0) {
+            break;
+        }
+        opened++;
+    }
+
+    int total = 0;
+    fd_sample_t sample;
+    int ret1 = count_fds(getpid(), &total);
+    int ret2 = sample_fds(getpid(), 100, 7, &sample);
+    int sum = 0;
+    for (int t = 0; t <= FD_TYPE_OTHER; t++) {
+        sum += sample.type_counts[t];
+    }
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+    /* Over 96% of the FDs are /dev/null */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && opened == EXTRA &&
+                sample.total == total && sample.sampled == 100 &&
+                sum == 100 && sample.type_counts[FD_TYPE_DEVICE] >= 85);
+}
+
+/* Test sample_fds error handling */
+void test_sample_fds_errors(void)
+{
+    TEST("sample_fds with NULL out, size 0 and bad PID");
+    fd_sample_t sample;
+    int ret1 = sample_fds(getpid(), 10, 1, NULL);
+    int err1 = errno;
+    int ret2 = sample_fds(getpid(), 0, 1, &sample);
+    int err2 = errno;
+    int ret3 = sample_fds(999999, 10, 1, &sample);
+    int err3 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                err2 == EINVAL && ret3 == -1 && err3 == ENOENT &&
+                sample.total == 0 && sample.sampled == 0);
+}
+
+/* Test count_socket_fds error handling */
+void test_count_socket_fds_errors(void)
+{
+    TEST("count_socket_fds with NULL counts and bad PID");
+    int fds = 42;
+    int sockets = 42;
+    int ret1 = count_socket_fds(getpid(), &fds, NULL);
+    int err1 = errno;
+    int ret2 = count_socket_fds(999999, &fds, &sockets);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL &&
+                ret2 == -1 && err2 == ENOENT && fds == 0 && sockets == 0);
+}
+
 /* Test parse_socket_inode with valid socket format */
 void test_parse_socket_inode_valid(void)
 {
@@ -199,6 +643,181 @@ void test_parse_socket_inode_null(void)
     ASSERT_FALSE(result);
 }
 
+/* FD sets for the backend tests: 750 FDs, well past FD_URING_MIN_FDS */
+#define BACKEND_FD_SETS 150
+
+/*
+ * Open BACKEND_FD_SETS socket pairs, pipes and /dev/null FDs into fds.
+ * Returns how many FDs were opened.
+ */
+static int open_mixed_fds(int *fds)
+{
+    int n = 0;
+    for (int i = 0; i < BACKEND_FD_SETS; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[n]) == 0) {
+            n += 2;
+        }
+        if (pipe(&fds[n]) == 0) {
+            n += 2;
+        }
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0) {
+            fds[n++] = fd;
+        }
+    }
+    return n;
+}
+
+static void close_fds(const int *fds, int count)
+{
+    for (int i = 0; i < count; i++) {
+        close(fds[i]);
+    }
+}
+
+/* Test fd_get_backend */
+void test_fd_backend_default(void)
+{
+    TEST("fd_get_backend defaults to readlink");
+    ASSERT_TRUE(fd_get_backend() == FD_BACKEND_READLINK);
+}
+
+/*
+ * List the calling process with both backends. Returns true when both
+ * succeed with the same FDs, types, inodes and targets, and at least
+ * want FDs.
+ */
+static bool backends_match(int want)
+{
+    fd_list_t plain;
+    fd_list_t uring;
+    int ret1 = enumerate_fds(getpid(), &plain);
+    fd_set_backend(FD_BACKEND_URING);
+    int ret2 = enumerate_fds(getpid(), &uring);
+    fd_set_backend(FD_BACKEND_READLINK);
+
+    bool same = ret1 == 0 && ret2 == 0 && plain.count == uring.count &&
+                plain.count >= want;
+    for (int i = 0; same && i < plain.count; i++) {
+        const fd_entry_t *a = &plain.entries[i];
+        const fd_entry_t *b = &uring.entries[i];
+        same = a->fd == b->fd && a->type == b->type &&
+               a->socket_inode == b->socket_inode &&
+               strcmp(fd_target(&plain, a), fd_target(&uring, b)) == 0;
+    }
+    if (ret1 == 0) fd_list_free(&plain);
+    if (ret2 == 0) fd_list_free(&uring);
+    return same;
+}
+
+/* Test both backends produce identical lists */
+void test_fd_backend_uring_matches(void)
+{
+    TEST("uring and readlink backends list identical FDs");
+    int fds[BACKEND_FD_SETS * 5];
+    int opened = open_mixed_fds(fds);
+
+    bool same = backends_match(opened);
+    close_fds(fds, opened);
+    ASSERT_TRUE(same && opened == BACKEND_FD_SETS * 5);
+}
+
+/* Heap blocks of 200-320 KB dirtied before the small walk */
+#define DIRTY_BLOCKS 16
+
+/*
+ * Test a walk too small for the ring. The walk state is allocated from
+ * blocks just freed with a non-zero pattern, so a ring field read before
+ * it is set shows up as a bogus wait.
+ */
+void test_fd_backend_uring_small(void)
+{
+    TEST("uring backend under FD_URING_MIN_FDS on a dirty heap");
+    int pipes[2] = { -1, -1 };
+    bool ok = pipe(pipes) == 0;
+
+    /* Take every free chunk the walk state could reuse, dirty, release */
+    char *blocks[DIRTY_BLOCKS];
+    for (int i = 0; i < DIRTY_BLOCKS; i++) {
+        size_t size = (size_t)(200 + 8 * i) * 1024;
+        blocks[i] = malloc(size);
+        if (blocks[i] != NULL) {
+            memset(blocks[i], 0xbe, size);
+        }
+    }
+    for (int i = 0; i < DIRTY_BLOCKS; i++) {
+        free(blocks[i]);
+    }
+
+    ok = ok && backends_match(5);
+    if (pipes[0] >= 0) {
+        close(pipes[0]);
+        close(pipes[1]);
+    }
+    ASSERT_TRUE(ok);
+}
+
+/* FDs for the multi-batch test: several getdents64() batches' worth */
+#define BATCHED_FDS 2400
+
+/*
+ * Test a walk spanning several batches. The ring is set up on the first
+ * one, and its own FD, opened mid-walk, turns up in a later batch and
+ * must not be listed.
+ */
+void test_fd_backend_uring_batches(void)
+{
+    TEST("uring backend across batches skips its own ring FD");
+    struct rlimit lim;
+    bool ok = getrlimit(RLIMIT_NOFILE, &lim) == 0;
+    if (ok && lim.rlim_cur < BATCHED_FDS + 64 &&
+        lim.rlim_max >= BATCHED_FDS + 64) {
+        lim.rlim_cur = BATCHED_FDS + 64;
+        ok = setrlimit(RLIMIT_NOFILE, &lim) == 0;
+    }
+
+    static int fds[BATCHED_FDS];
+    int opened = 0;
+    while (ok && opened < BATCHED_FDS) {
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd < 0) {
+            break;
+        }
+        fds[opened++] = fd;
+    }
+
+    /* The ring takes the lowest free FD: past the ones just opened */
+    fd_list_t list;
+    fd_set_backend(FD_BACKEND_URING);
+    int ret = enumerate_fds(getpid(), &list);
+    fd_set_backend(FD_BACKEND_READLINK);
+    bool no_ring = ret == 0;
+    for (int i = 0; no_ring && i < list.count; i++) {
+        no_ring = strcmp(fd_target(&list, &list.entries[i]),
+                         "anon_inode:[io_uring]") != 0;
+    }
+    if (ret == 0) fd_list_free(&list);
+
+    ok = ok && opened == BATCHED_FDS && no_ring && backends_match(opened);
+    close_fds(fds, opened);
+    ASSERT_TRUE(ok);
+}
+
+/* Test the uring walk drains its batch when the visitor stops */
+void test_fd_backend_uring_early_stop(void)
+{
+    TEST("uring backend stops on non-zero visitor");
+    int fds[BACKEND_FD_SETS * 5];
+    int opened = open_mixed_fds(fds);
+
+    int visited = 0;
+    fd_set_backend(FD_BACKEND_URING);
+    int ret = for_each_fd(getpid(), stop_visitor, &visited);
+    fd_set_backend(FD_BACKEND_READLINK);
+    close_fds(fds, opened);
+    ASSERT_TRUE(ret == 0 && visited == 1);
+}
+
 int main(void)
 {
     printf("\n=== Running File Descriptor Tests ===\n\n");
@@ -207,10 +826,40 @@ int main(void)
     test_enumerate_fds_current();
     test_enumerate_fds_standard_fds();
     test_enumerate_fds_has_targets();
+    test_enumerate_fds_known_target();
+    test_enumerate_fds_classifies();
+    test_enumerate_fds_many();
     test_enumerate_fds_pid1();
     test_enumerate_fds_nonexistent();
     test_enumerate_fds_error_count();
-    test_fd_entries_free_null();
+    test_enumerate_fds_null();
+    test_enumerate_fds_unresolvable();
+    test_fd_list_free_null();
+
+    /* fd_target / classification tests */
+    test_fd_target_empty();
+    test_classify_fd_target();
+    test_fd_type_to_string();
+    test_fd_entry_size();
+
+    /* for_each_fd tests */
+    test_for_each_fd_count();
+    test_for_each_fd_entries();
+    test_for_each_fd_early_stop();
+    test_for_each_fd_errors();
+
+    /* count_fds tests */
+    test_count_fds_matches();
+    test_count_fds_errors();
+
+    /* count_socket_fds tests */
+    test_count_socket_fds_self();
+    test_count_socket_fds_errors();
+
+    /* sample_fds tests */
+    test_sample_fds_census();
+    test_sample_fds_subset();
+    test_sample_fds_errors();
 
     /* parse_socket_inode tests */
     test_parse_socket_inode_valid();
@@ -219,6 +868,13 @@ int main(void)
     test_parse_socket_inode_pipe();
     test_parse_socket_inode_null();
 
+    /* fd_set_backend tests */
+    test_fd_backend_default();
+    test_fd_backend_uring_matches();
+    test_fd_backend_uring_early_stop();
+    test_fd_backend_uring_small();
+    test_fd_backend_uring_batches();
+
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
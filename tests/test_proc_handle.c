@@ -0,0 +1,396 @@
+/*
+ * test_proc_handle.c - Unit tests for process handles
+ *
+ * Tests proc_handle_open(), proc_handle_close(), proc_handle_openat(),
+ * proc_handle_read(), proc_handle_exited(), proc_handle_wait() and the _at
+ * collectors that read through a handle, including a forked child that
+ * exits while the handle is held open
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../include/proc_handle.h"
+#include "../include/proc_status.h"
+#include "../include/proc_fd.h"
+#include "../include/proc_task.h"
+#include "../include/util.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_EQ(actual, expected) \
+    do { \
+        if ((actual) == (expected)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (expected %d, got %d)\n", TEST_FAIL, \
+                   (int)(expected), (int)(actual)); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/*
+ * Fork a child that blocks until killed. Returns its PID, or -1.
+ */
+static pid_t spawn_sleeper(void)
+{
+    pid_t child = fork();
+    if (child == 0) {
+        for (;;) {
+            pause();
+        }
+    }
+    return child;
+}
+
+/*
+ * Wait up to one second for proc_handle_exited() to turn true.
+ */
+static bool wait_exited(const proc_handle_t *h)
+{
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 10000000 };
+    for (int i = 0; i < 100; i++) {
+        if (proc_handle_exited(h)) {
+            return true;
+        }
+        nanosleep(&delay, NULL);
+    }
+    return false;
+}
+
+/* Test proc_handle_open */
+void test_proc_handle_open_self(void)
+{
+    TEST("proc_handle_open with current process");
+    proc_handle_t h;
+    int ret = proc_handle_open(&h, getpid());
+    ASSERT_TRUE(ret == 0 && h.pid == getpid() && h.dirfd >= 0);
+    proc_handle_close(&h);
+}
+
+void test_proc_handle_open_nonexistent(void)
+{
+    TEST("proc_handle_open with non-existent PID (ENOENT)");
+    proc_handle_t h;
+    int ret = proc_handle_open(&h, 999999);
+    ASSERT_TRUE(ret == -1 && errno == ENOENT && h.dirfd == -1 &&
+                h.pidfd == -1);
+}
+
+void test_proc_handle_open_invalid_pid(void)
+{
+    TEST("proc_handle_open rejects PID 0 (EINVAL)");
+    proc_handle_t h;
+    int ret = proc_handle_open(&h, 0);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL && h.dirfd == -1);
+}
+
+void test_proc_handle_open_null(void)
+{
+    TEST("proc_handle_open with NULL handle (EINVAL)");
+    int ret = proc_handle_open(NULL, getpid());
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+/* Test proc_handle_close */
+void test_proc_handle_close_twice(void)
+{
+    TEST("proc_handle_close is safe to call twice and with NULL");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+    proc_handle_close(&h);
+    proc_handle_close(&h);
+    proc_handle_close(NULL);
+    ASSERT_TRUE(h.dirfd == -1 && h.pidfd == -1);
+}
+
+/* Test proc_handle_openat */
+void test_proc_handle_openat_closed(void)
+{
+    TEST("proc_handle_openat on closed handle (EBADF)");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+    proc_handle_close(&h);
+    int fd = proc_handle_openat(&h, "status", O_RDONLY);
+    ASSERT_TRUE(fd == -1 && errno == EBADF);
+}
+
+/* Test proc_handle_read */
+void test_proc_handle_read_comm(void)
+{
+    TEST("proc_handle_read of comm matches read_process_name");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+
+    char buf[64];
+    ssize_t len = proc_handle_read(&h, "comm", buf, sizeof(buf));
+    char name[64];
+    read_process_name(getpid(), name, sizeof(name));
+
+    /* comm ends in a newline that read_process_name() strips */
+    ASSERT_TRUE(len > 1 && buf[len - 1] == '\n' &&
+                strncmp(buf, name, (size_t)len - 1) == 0);
+    proc_handle_close(&h);
+}
+
+/* Test proc_handle_netns */
+void test_proc_handle_netns(void)
+{
+    TEST("proc_handle_netns matches /proc/self/ns/net; errors");
+    proc_handle_t h;
+    unsigned long netns = 0;
+    struct stat st;
+    int ret = -1;
+    if (proc_handle_open(&h, getpid()) == 0) {
+        ret = proc_handle_netns(&h, &netns);
+    }
+    int null_ret = proc_handle_netns(&h, NULL);
+    int null_errno = errno;
+    proc_handle_close(&h);
+    int closed_ret = proc_handle_netns(&h, &netns);
+    ASSERT_TRUE(ret == 0 && stat("/proc/self/ns/net", &st) == 0 &&
+                netns == (unsigned long)st.st_ino &&
+                null_ret == -1 && null_errno == EINVAL &&
+                closed_ret == -1 && errno == EBADF);
+}
+
+/* Test the _at collectors */
+void test_read_proc_status_at(void)
+{
+    TEST("read_proc_status_at through a handle");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+
+    proc_info_t info;
+    int ret = read_proc_status_at(&h, &info);
+    ASSERT_TRUE(ret == 0 && info.pid == getpid() && info.name[0] != '\0' &&
+                info.thread_count >= 1);
+    proc_handle_close(&h);
+}
+
+void test_fds_at(void)
+{
+    TEST("enumerate_fds_at and count_fds_at agree");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+
+    fd_list_t list;
+    int count = 0;
+    int ret1 = enumerate_fds_at(&h, &list);
+    int ret2 = count_fds_at(&h, &count);
+
+    /* Both see the fd directory they open, so the totals match */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && list.count >= 3 &&
+                count == list.count);
+    fd_list_free(&list);
+    proc_handle_close(&h);
+}
+
+void test_enumerate_threads_at(void)
+{
+    TEST("enumerate_threads_at through a handle");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+
+    thread_info_t *threads = NULL;
+    int count = 0;
+    int ret = enumerate_threads_at(&h, 0, &threads, &count);
+    ASSERT_TRUE(ret == 0 && count >= 1 && threads[0].tid == getpid());
+    thread_info_free(threads);
+    proc_handle_close(&h);
+}
+
+/* Test proc_handle_exited */
+void test_proc_handle_exited_self(void)
+{
+    TEST("proc_handle_exited is false for a live process");
+    proc_handle_t h;
+    proc_handle_open(&h, getpid());
+    bool exited = proc_handle_exited(&h);
+    proc_handle_close(&h);
+
+    h.dirfd = -1;
+    ASSERT_TRUE(!exited && proc_handle_exited(&h) &&
+                proc_handle_exited(NULL));
+}
+
+void test_proc_handle_exited_zombie(void)
+{
+    TEST("proc_handle_exited sees child exit before it is reaped");
+    pid_t child = spawn_sleeper();
+    proc_handle_t h;
+    int ret = (child > 0) ? proc_handle_open(&h, child) : -1;
+    bool alive = (ret == 0) && !proc_handle_exited(&h);
+
+    if (child > 0) {
+        kill(child, SIGKILL);
+    }
+
+    /* Without a pidfd exit is only visible once reaped */
+    bool exited = false;
+    if (ret == 0 && h.pidfd >= 0) {
+        exited = wait_exited(&h);
+    }
+    if (child > 0) {
+        waitpid(child, NULL, 0);
+    }
+    if (ret == 0 && h.pidfd < 0) {
+        exited = wait_exited(&h);
+    }
+
+    ASSERT_TRUE(alive && exited);
+    if (ret == 0) {
+        proc_handle_close(&h);
+    }
+}
+
+void test_proc_handle_reaped(void)
+{
+    TEST("reads through a handle fail once its process is reaped");
+    pid_t child = spawn_sleeper();
+    proc_handle_t h;
+    int ret = (child > 0) ? proc_handle_open(&h, child) : -1;
+
+    if (child > 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+
+    /* The dirfd stays pinned to the dead process, never a reused PID */
+    proc_info_t info;
+    int status_ret = (ret == 0) ? read_proc_status_at(&h, &info) : 0;
+    ASSERT_TRUE(ret == 0 && status_ret == -1 &&
+                (errno == ESRCH || errno == ENOENT));
+    if (ret == 0) {
+        proc_handle_close(&h);
+    }
+}
+
+/* Test proc_handle_wait */
+void test_proc_handle_wait_deadline(void)
+{
+    TEST("proc_handle_wait returns at the deadline for a live process");
+    proc_handle_t h;
+    struct timespec start, deadline, end;
+    int open_ret = proc_handle_open(&h, getpid());
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    timespec_add_sec(&deadline, 0.05);
+    int ret = (open_ret == 0) ? proc_handle_wait(&h, &deadline) : -1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ASSERT_TRUE(ret == 0 && timespec_diff_sec(&start, &end) >= 0.049);
+    if (open_ret == 0) {
+        proc_handle_close(&h);
+    }
+}
+
+void test_proc_handle_wait_exit(void)
+{
+    TEST("proc_handle_wait wakes early when the process exits");
+    pid_t child = spawn_sleeper();
+    proc_handle_t h;
+    int open_ret = (child > 0) ? proc_handle_open(&h, child) : -1;
+    struct timespec start, deadline, end;
+
+    if (child > 0) {
+        kill(child, SIGKILL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    timespec_add_sec(&deadline, 2.0);
+    int ret = -1;
+    if (open_ret == 0) {
+        while ((ret = proc_handle_wait(&h, &deadline)) != 0 &&
+               errno == EINTR) {
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double waited = timespec_diff_sec(&start, &end);
+
+    if (child > 0) {
+        waitpid(child, NULL, 0);
+    }
+
+    /* Without a pidfd the wait can only sleep until the deadline */
+    bool early = (open_ret == 0 && h.pidfd < 0) || waited < 1.0;
+    proc_info_t info;
+    int bad_ret = proc_handle_wait(&h, NULL);
+    ASSERT_TRUE(ret == 0 && early && bad_ret == -1 && errno == EINVAL &&
+                read_proc_status_at(&h, &info) == -1);
+    if (open_ret == 0) {
+        proc_handle_close(&h);
+    }
+}
+
+int main(void)
+{
+    printf("\n=== Running Process Handle Tests ===\n\n");
+
+    /* proc_handle_open tests */
+    test_proc_handle_open_self();
+    test_proc_handle_open_nonexistent();
+    test_proc_handle_open_invalid_pid();
+    test_proc_handle_open_null();
+
+    /* proc_handle_close tests */
+    test_proc_handle_close_twice();
+
+    /* proc_handle_openat / proc_handle_read tests */
+    test_proc_handle_openat_closed();
+    test_proc_handle_read_comm();
+    test_proc_handle_netns();
+
+    /* _at collector tests */
+    test_read_proc_status_at();
+    test_fds_at();
+    test_enumerate_threads_at();
+
+    /* proc_handle_exited tests */
+    test_proc_handle_exited_self();
+    test_proc_handle_exited_zombie();
+    test_proc_handle_reaped();
+
+    /* proc_handle_wait tests */
+    test_proc_handle_wait_deadline();
+    test_proc_handle_wait_exit();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
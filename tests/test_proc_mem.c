@@ -0,0 +1,390 @@
+/*
+ * test_proc_mem.c - Unit tests for smaps_rollup and smaps parsing
+ *
+ * Tests parse_mem_usage() and parse_vma_header() on fixed text, and
+ * read_mem_usage(), for_each_vma() and enumerate_mem_files() on the test
+ * process with known anonymous mappings
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE     /* MAP_ANONYMOUS */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../include/proc_mem.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_EQ(actual, expected) \
+    do { \
+        if ((actual) == (expected)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (expected %d, got %d)\n", TEST_FAIL, \
+                   (int)(expected), (int)(actual)); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/* Pages in the test mapping; 16 x 4 KiB = 64 KB resident once touched */
+#define TEST_PAGES 16
+
+/* smaps_rollup excerpt from a 6.x kernel */
+static const char ROLLUP_TEXT[] =
+    "561f7274c000-7ffcc96ff000 ---p 00000000 00:00 0      [rollup]\n"
+    "Rss:                1384 kB\n"
+    "Pss:                 471 kB\n"
+    "Pss_Dirty:           100 kB\n"
+    "Pss_Anon:            100 kB\n"
+    "Pss_File:            371 kB\n"
+    "Pss_Shmem:             0 kB\n"
+    "Shared_Clean:       1236 kB\n"
+    "Shared_Dirty:          0 kB\n"
+    "Private_Clean:        48 kB\n"
+    "Private_Dirty:       100 kB\n"
+    "Referenced:         1384 kB\n"
+    "Anonymous:           100 kB\n"
+    "KSM:                   0 kB\n"
+    "LazyFree:              0 kB\n"
+    "AnonHugePages:      2048 kB\n"
+    "ShmemPmdMapped:        0 kB\n"
+    "FilePmdMapped:         0 kB\n"
+    "Shared_Hugetlb:     4096 kB\n"
+    "Private_Hugetlb:    2048 kB\n"
+    "Swap:                 12 kB\n"
+    "SwapPss:               6 kB\n"
+    "Locked:                4 kB";
+
+/* Two smaps mappings, the second anonymous */
+static const char SMAPS_TEXT[] =
+    "5619c40bb000-5619c40bd000 r--p 00000000 fe:00 463547  /usr/bin/head\n"
+    "Size:                  8 kB\n"
+    "Rss:                   8 kB\n"
+    "Pss:                   8 kB\n"
+    "VmFlags: rd mr mw me \n"
+    "7f0000000000-7f0000004000 rw-p 00000000 00:00 0 \n"
+    "Size:                 16 kB\n"
+    "Rss:                  12 kB\n"
+    "Pss:                  12 kB\n"
+    "Anonymous:            12 kB\n"
+    "THPeligible:           0\n";
+
+/*
+ * Map and touch TEST_PAGES anonymous pages. Returns NULL on failure.
+ */
+static char *map_test_pages(size_t *len)
+{
+    *len = (size_t)sysconf(_SC_PAGESIZE) * TEST_PAGES;
+    char *region = mmap(NULL, *len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        return NULL;
+    }
+    memset(region, 1, *len);
+    return region;
+}
+
+/* for_each_vma() visitor finding the mapping that contains ctx's addr */
+typedef struct {
+    unsigned long addr;
+    bool found;
+    vma_info_t vma;     /* path is not valid after the walk */
+    bool anonymous;     /* vma had an empty path */
+    int visited;
+    int stop_after;     /* Stop once this many were visited, 0 = never */
+} vma_search_t;
+
+static int find_vma(const vma_info_t *vma, void *ctx)
+{
+    vma_search_t *search = ctx;
+    search->visited++;
+    /* The kernel may merge the test mapping with a neighbour */
+    if (vma->start <= search->addr && search->addr < vma->end) {
+        search->found = true;
+        search->vma = *vma;
+        search->anonymous = (vma->path[0] == '\0');
+    }
+    return search->stop_after > 0 && search->visited >= search->stop_after;
+}
+
+/* Test parse_mem_usage */
+void test_parse_mem_usage_rollup(void)
+{
+    TEST("parse_mem_usage reads every tracked smaps_rollup field");
+    mem_usage_t u;
+    memset(&u, 0, sizeof(u));
+    unsigned added = parse_mem_usage(ROLLUP_TEXT, strlen(ROLLUP_TEXT), &u);
+
+    /* Pss_Dirty, Referenced, KSM and LazyFree are not tracked */
+    ASSERT_TRUE(added == 18 && u.size_kb == 0 && u.rss_kb == 1384 &&
+                u.pss_kb == 471 && u.pss_anon_kb == 100 &&
+                u.pss_file_kb == 371 && u.pss_shmem_kb == 0 &&
+                u.shared_clean_kb == 1236 && u.private_clean_kb == 48 &&
+                u.private_dirty_kb == 100 && u.anonymous_kb == 100 &&
+                u.anon_huge_kb == 2048 && u.hugetlb_kb == 6144 &&
+                u.swap_kb == 12 && u.swap_pss_kb == 6 && u.locked_kb == 4);
+}
+
+void test_parse_mem_usage_sums(void)
+{
+    TEST("parse_mem_usage sums mappings and skips headers");
+    mem_usage_t u;
+    memset(&u, 0, sizeof(u));
+    unsigned added = parse_mem_usage(SMAPS_TEXT, strlen(SMAPS_TEXT), &u);
+    unsigned none = parse_mem_usage(NULL, 10, &u);
+    ASSERT_TRUE(added == 7 && u.size_kb == 24 && u.rss_kb == 20 &&
+                u.pss_kb == 20 && u.anonymous_kb == 12 && none == 0);
+}
+
+/* Test parse_vma_header */
+void test_parse_vma_header_file(void)
+{
+    TEST("parse_vma_header with a file-backed mapping");
+    vma_info_t vma;
+    size_t path_len = 0;
+    const char *line = SMAPS_TEXT;
+    size_t len = (size_t)(strchr(line, '\n') - line);
+    int ret = parse_vma_header(line, len, &vma, &path_len);
+    ASSERT_TRUE(ret == 0 && vma.start == 0x5619c40bb000UL &&
+                vma.end == 0x5619c40bd000UL &&
+                strcmp(vma.perms, "r--p") == 0 && vma.inode == 463547 &&
+                path_len == 13 && memcmp(vma.path, "/usr/bin/head", 13) == 0);
+}
+
+void test_parse_vma_header_anon(void)
+{
+    TEST("parse_vma_header with an anonymous mapping and a spaced path");
+    const char anon[] = "7f0000000000-7f0000004000 rw-p 00000000 00:00 0 ";
+    const char deleted[] = "7f0000004000-7f0000005000 rw-s 00000000 00:01 77 "
+                           "/dev/shm/a b (deleted)";
+    vma_info_t vma;
+    size_t anon_len = 99, deleted_len = 0;
+    int ret1 = parse_vma_header(anon, strlen(anon), &vma, &anon_len);
+    unsigned long anon_inode = vma.inode;
+    int ret2 = parse_vma_header(deleted, strlen(deleted), &vma,
+                                &deleted_len);
+    ASSERT_TRUE(ret1 == 0 && anon_len == 0 && anon_inode == 0 &&
+                ret2 == 0 && strcmp(vma.perms, "rw-s") == 0 &&
+                deleted_len == strlen("/dev/shm/a b (deleted)"));
+}
+
+void test_parse_vma_header_invalid(void)
+{
+    TEST("parse_vma_header rejects key lines and NULL (EINVAL)");
+    vma_info_t vma;
+    size_t path_len;
+    const char key[] = "Rss:                   8 kB";
+    const char truncated[] = "5619c40bb000-5619c40bd000";
+    int ret1 = parse_vma_header(key, strlen(key), &vma, &path_len);
+    int ret2 = parse_vma_header(truncated, strlen(truncated), &vma,
+                                &path_len);
+    int ret3 = parse_vma_header(NULL, 0, &vma, &path_len);
+    ASSERT_TRUE(ret1 == -1 && ret2 == -1 && ret3 == -1 && errno == EINVAL);
+}
+
+/* Test read_mem_usage */
+void test_read_mem_usage_self(void)
+{
+    TEST("read_mem_usage for current process");
+    mem_usage_t u;
+    int ret = read_mem_usage(getpid(), &u);
+    ASSERT_TRUE(ret == 0 && u.rss_kb > 0 && u.pss_kb > 0 &&
+                u.pss_kb <= u.rss_kb && u.anonymous_kb > 0);
+}
+
+void test_read_mem_usage_errors(void)
+{
+    TEST("read_mem_usage with non-existent PID (ENOENT) and NULL (EINVAL)");
+    mem_usage_t u;
+    int ret1 = read_mem_usage(999999, &u);
+    int err1 = errno;
+    int ret2 = read_mem_usage(getpid(), NULL);
+    ASSERT_TRUE(ret1 == -1 && err1 == ENOENT && u.rss_kb == 0 &&
+                ret2 == -1 && errno == EINVAL);
+}
+
+/* Test for_each_vma */
+void test_for_each_vma_known_mapping(void)
+{
+    TEST("for_each_vma finds a touched anonymous mapping");
+    size_t len;
+    char *region = map_test_pages(&len);
+    vma_search_t search = { .addr = (unsigned long)region };
+
+    int ret = (region != NULL) ? for_each_vma(getpid(), find_vma, &search)
+                               : -1;
+    unsigned long want_kb = (unsigned long)(len / 1024);
+    ASSERT_TRUE(ret == 0 && search.found &&
+                search.vma.end - search.vma.start >= len &&
+                search.vma.usage.rss_kb >= want_kb &&
+                search.vma.usage.anonymous_kb >= want_kb &&
+                strcmp(search.vma.perms, "rw-p") == 0 &&
+                search.anonymous && search.visited > 5);
+
+    if (region != NULL) {
+        munmap(region, len);
+    }
+}
+
+void test_for_each_vma_early_stop(void)
+{
+    TEST("for_each_vma stops when the visitor returns non-zero");
+    vma_search_t search = { .stop_after = 2 };
+    int ret = for_each_vma(getpid(), find_vma, &search);
+    ASSERT_TRUE(ret == 0 && search.visited == 2);
+}
+
+void test_for_each_vma_errors(void)
+{
+    TEST("for_each_vma with NULL visitor (EINVAL) and non-existent PID");
+    int ret1 = for_each_vma(getpid(), NULL, NULL);
+    int err1 = errno;
+    vma_search_t search = { 0 };
+    int ret2 = for_each_vma(999999, find_vma, &search);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                errno == ENOENT && search.visited == 0);
+}
+
+/* Test enumerate_mem_files */
+void test_enumerate_mem_files_self(void)
+{
+    TEST("enumerate_mem_files groups by file, sorted by PSS");
+    size_t len;
+    char *region = map_test_pages(&len);
+    mem_file_list_t list;
+    int ret = enumerate_mem_files(getpid(), &list);
+
+    bool sorted = (ret == 0 && list.count > 0);
+    bool have_stack = false, have_anon = false;
+    int vma_total = 0;
+    for (int i = 0; sorted && i < list.count; i++) {
+        const char *name = mem_file_name(&list, &list.entries[i]);
+        if (i > 0 &&
+            list.entries[i - 1].usage.pss_kb < list.entries[i].usage.pss_kb) {
+            sorted = false;
+        }
+        if (strcmp(name, "[stack]") == 0) {
+            have_stack = true;
+        }
+        if (strcmp(name, MEM_ANON_NAME) == 0 &&
+            list.entries[i].usage.anonymous_kb >= len / 1024) {
+            have_anon = true;
+        }
+        vma_total += list.entries[i].vma_count;
+    }
+
+    /* Names are unique, so there are fewer entries than mappings */
+    ASSERT_TRUE(sorted && have_stack && have_anon && vma_total > list.count);
+
+    mem_file_list_free(&list);
+    if (region != NULL) {
+        munmap(region, len);
+    }
+}
+
+void test_enumerate_mem_files_matches_rollup(void)
+{
+    TEST("enumerate_mem_files totals agree with smaps_rollup");
+    mem_usage_t rollup;
+    mem_file_list_t list;
+    int ret1 = read_mem_usage(getpid(), &rollup);
+    int ret2 = enumerate_mem_files(getpid(), &list);
+
+    unsigned long rss = 0;
+    for (int i = 0; ret2 == 0 && i < list.count; i++) {
+        rss += list.entries[i].usage.rss_kb;
+    }
+
+    /* Allocations between the two reads move RSS a little */
+    unsigned long diff = (rss > rollup.rss_kb) ? rss - rollup.rss_kb
+                                               : rollup.rss_kb - rss;
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && diff <= rollup.rss_kb / 10 + 64);
+
+    mem_file_list_free(&list);
+}
+
+void test_enumerate_mem_files_errors(void)
+{
+    TEST("enumerate_mem_files with non-existent PID and NULL list");
+    mem_file_list_t list;
+    int ret1 = enumerate_mem_files(999999, &list);
+    int err1 = errno;
+    int ret2 = enumerate_mem_files(getpid(), NULL);
+    ASSERT_TRUE(ret1 == -1 && err1 == ENOENT && list.entries == NULL &&
+                list.count == 0 && ret2 == -1 && errno == EINVAL);
+}
+
+/* Test mem_file_name / mem_file_list_free */
+void test_mem_file_list_null(void)
+{
+    TEST("mem_file_name and mem_file_list_free with NULL");
+    mem_file_list_t empty = { 0 };
+    mem_file_list_free(NULL);
+    mem_file_list_free(&empty);
+    ASSERT_TRUE(strcmp(mem_file_name(NULL, NULL), "") == 0 &&
+                strcmp(mem_file_name(&empty, NULL), "") == 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running Memory Map Tests ===\n\n");
+
+    /* parse_mem_usage tests */
+    test_parse_mem_usage_rollup();
+    test_parse_mem_usage_sums();
+
+    /* parse_vma_header tests */
+    test_parse_vma_header_file();
+    test_parse_vma_header_anon();
+    test_parse_vma_header_invalid();
+
+    /* read_mem_usage tests */
+    test_read_mem_usage_self();
+    test_read_mem_usage_errors();
+
+    /* for_each_vma tests */
+    test_for_each_vma_known_mapping();
+    test_for_each_vma_early_stop();
+    test_for_each_vma_errors();
+
+    /* enumerate_mem_files tests */
+    test_enumerate_mem_files_self();
+    test_enumerate_mem_files_matches_rollup();
+    test_enumerate_mem_files_errors();
+
+    /* mem_file_name / mem_file_list_free tests */
+    test_mem_file_list_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
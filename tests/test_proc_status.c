@@ -1,13 +1,18 @@
 /*
  * test_proc_status.c - Unit tests for /proc/<PID>/status parsing
  *
- * Tests read_proc_status() with real processes
+ * Tests read_proc_status() with real processes, and parse_proc_status() and
+ * read_status_fields_at() with fixed status text
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include "../include/proc_status.h"
 #include "../include/pinspect.h"
 
@@ -133,6 +138,166 @@ void test_errno_nonexistent(void)
     ASSERT_EQ(errno, ENOENT);
 }
 
+/* Excerpt of a real status file, with the lines pinspect parses */
+static const char SAMPLE_STATUS[] =
+    "Name:\tnginx: worker\n"
+    "Umask:\t0022\n"
+    "State:\tS (sleeping)\n"
+    "Tgid:\t4242\n"
+    "Pid:\t4242\n"
+    "Uid:\t1000\t1001\t1000\t1000\n"
+    "Gid:\t100\t101\t100\t100\n"
+    "Groups:\t4 24 27\n"
+    "VmPeak:\t  123456 kB\n"
+    "VmSize:\t  120000 kB\n"
+    "VmLck:\t       0 kB\n"
+    "VmPin:\t       0 kB\n"
+    "VmHWM:\t    9000 kB\n"
+    "VmRSS:\t    8192 kB\n"
+    "VmSwap:\t       0 kB\n"
+    "Threads:\t7\n"
+    "SigQ:\t0/63429\n";
+
+/* Test parse_proc_status */
+void test_parse_all_fields(void)
+{
+    TEST("parse_proc_status fills every field");
+    proc_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned found = parse_proc_status(SAMPLE_STATUS, strlen(SAMPLE_STATUS),
+                                       STATUS_FIELDS_DEFAULT, &info);
+
+    /* Names may contain spaces; truncated to PROC_NAME_MAX - 1 */
+    ASSERT_TRUE(found == STATUS_FIELDS_DEFAULT &&
+                strcmp(info.name, "nginx: worker") == 0 &&
+                info.state == PROC_STATE_SLEEPING &&
+                info.uid_real == 1000 && info.uid_effective == 1001 &&
+                info.gid_real == 100 && info.gid_effective == 101 &&
+                info.vm_peak_kb == 123456 && info.vm_size_kb == 120000 &&
+                info.vm_rss_kb == 8192 && info.thread_count == 7,
+                "field mismatch");
+}
+
+void test_parse_subset(void)
+{
+    TEST("parse_proc_status leaves unwanted fields unchanged");
+    proc_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.uid_real = 77;
+    info.thread_count = -1;
+    unsigned found = parse_proc_status(SAMPLE_STATUS, strlen(SAMPLE_STATUS),
+                                       STATUS_FIELD_STATE |
+                                       STATUS_FIELD_VM_RSS, &info);
+    ASSERT_TRUE(found == (STATUS_FIELD_STATE | STATUS_FIELD_VM_RSS) &&
+                info.state == PROC_STATE_SLEEPING && info.vm_rss_kb == 8192 &&
+                info.uid_real == 77 && info.thread_count == -1 &&
+                info.name[0] == '\0',
+                "unwanted field was written");
+}
+
+void test_parse_early_stop(void)
+{
+    TEST("parse_proc_status stops once wanted fields are filled");
+    /* A second State: line after the first must never be reached */
+    static const char text[] =
+        "Name:\tfirst\n"
+        "State:\tR (running)\n"
+        "State:\tZ (zombie)\n";
+    proc_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned found = parse_proc_status(text, strlen(text),
+                                       STATUS_FIELD_NAME | STATUS_FIELD_STATE,
+                                       &info);
+    ASSERT_TRUE(found == (STATUS_FIELD_NAME | STATUS_FIELD_STATE) &&
+                info.state == PROC_STATE_RUNNING,
+                "parsed past the wanted fields");
+}
+
+void test_parse_kernel_thread(void)
+{
+    TEST("parse_proc_status settles missing Vm fields at Threads:");
+    /* Kernel threads and zombies have no Vm lines; no trailing newline */
+    static const char text[] =
+        "Name:\tkworker/0:1\n"
+        "State:\tI (idle)\n"
+        "Uid:\t0\t0\t0\t0\n"
+        "Gid:\t0\t0\t0\t0\n"
+        "Threads:\t1";
+    proc_info_t info;
+    memset(&info, 0, sizeof(info));
+    unsigned found = parse_proc_status(text, strlen(text),
+                                       STATUS_FIELDS_DEFAULT, &info);
+    ASSERT_TRUE(found == STATUS_FIELDS_DEFAULT &&
+                strcmp(info.name, "kworker/0:1") == 0 &&
+                info.thread_count == 1 && info.vm_size_kb == 0,
+                "kernel thread status misparsed");
+}
+
+/* Test read_status_fields_at */
+void test_read_fields_long_file(void)
+{
+    TEST("read_status_fields_at across several read buffers");
+    char path[] = "/tmp/pinspect_status_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        ASSERT_TRUE(0, "mkstemp failed");
+        return;
+    }
+
+    /* A 20000-byte Groups: line pushes the memory lines past 4 KiB */
+    FILE *fp = fdopen(fd, "w");
+    fputs("Name:\tbig\nState:\tD (disk sleep)\n"
+          "Uid:\t5\t6\t5\t5\nGid:\t7\t8\t7\t7\nGroups:\t", fp);
+    for (int i = 0; i < 4000; i++) {
+        fputs("1234 ", fp);
+    }
+    fputs("\nVmPeak:\t300 kB\nVmSize:\t200 kB\nVmRSS:\t100 kB\n"
+          "Threads:\t3\n", fp);
+    fclose(fp);
+
+    proc_info_t info;
+    memset(&info, 0, sizeof(info));
+    int ret = read_status_fields_at(AT_FDCWD, path, STATUS_FIELDS_DEFAULT,
+                                    &info);
+    unlink(path);
+    ASSERT_TRUE(ret == 0 && strcmp(info.name, "big") == 0 &&
+                info.state == PROC_STATE_DISK_SLEEP &&
+                info.uid_effective == 6 && info.gid_effective == 8 &&
+                info.vm_peak_kb == 300 && info.vm_rss_kb == 100 &&
+                info.thread_count == 3,
+                "long status file misparsed");
+}
+
+void test_read_fields_errors(void)
+{
+    TEST("read_status_fields_at with NULL path and missing file");
+    proc_info_t info;
+    int ret1 = read_status_fields_at(AT_FDCWD, NULL, STATUS_FIELDS_DEFAULT,
+                                     &info);
+    int errno1 = errno;
+    int ret2 = read_status_fields_at(AT_FDCWD, "/proc/999999/status",
+                                     STATUS_FIELDS_DEFAULT, &info);
+    ASSERT_TRUE(ret1 == -1 && errno1 == EINVAL && ret2 == -1 &&
+                errno == ENOENT, "wrong error handling");
+}
+
+/* Test read_proc_status_fields_at */
+void test_read_selected_fields(void)
+{
+    TEST("read_proc_status_fields_at parses only the wanted fields");
+    proc_handle_t h;
+    int ret0 = proc_handle_open(&h, getpid());
+    proc_info_t info;
+    int ret1 = read_proc_status_fields_at(&h, STATUS_FIELD_VM_RSS, &info);
+    bool rss_ok = ret1 == 0 && info.pid == getpid() && info.vm_rss_kb > 0 &&
+                  info.name[0] == '\0' && info.state == PROC_STATE_UNKNOWN &&
+                  info.vm_size_kb == 0 && info.thread_count == 0;
+    int ret2 = read_proc_status_fields_at(NULL, STATUS_FIELD_VM_RSS, &info);
+    ASSERT_TRUE(ret0 == 0 && rss_ok && ret2 == -1 && errno == EINVAL,
+                "unwanted fields set or wrong error handling");
+    proc_handle_close(&h);
+}
+
 int main(void)
 {
     printf("\n=== Running proc_status Tests ===\n\n");
@@ -147,6 +312,17 @@ int main(void)
     test_read_nonexistent_process();
     test_errno_nonexistent();
 
+    /* parse_proc_status / read_status_fields_at tests */
+    test_parse_all_fields();
+    test_parse_subset();
+    test_parse_early_stop();
+    test_parse_kernel_thread();
+    test_read_fields_long_file();
+    test_read_fields_errors();
+
+    /* read_proc_status_fields_at tests */
+    test_read_selected_fields();
+
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
@@ -1,14 +1,19 @@
 /*
  * test_proc_task.c - Unit tests for thread enumeration
  *
- * Tests enumerate_threads() and thread_info_free()
+ * Tests enumerate_threads(), for_each_thread(), thread_info_free() and
+ * enumerate_threads_parallel_at()
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
 #include "../include/proc_task.h"
 #include "../include/util.h"
 
@@ -167,6 +172,299 @@ void test_thread_info_free_null(void)
     ASSERT_TRUE(1); /* If we got here, it didn't crash */
 }
 
+/* for_each_thread visitor counting threads; stops once ctx[1] reached */
+static int count_threads(const thread_info_t *thread, void *ctx)
+{
+    int *counts = ctx;
+    (void)thread;
+    counts[0]++;
+    return counts[1] > 0 && counts[0] >= counts[1];
+}
+
+static void *idle_thread(void *arg)
+{
+    pthread_barrier_t *barrier = arg;
+    pthread_barrier_wait(barrier);  /* Started */
+    pthread_barrier_wait(barrier);  /* Released */
+    return NULL;
+}
+
+/* Test for_each_thread sees extra threads and stops early */
+void test_for_each_thread(void)
+{
+    TEST("for_each_thread visits all threads and stops early");
+    pthread_barrier_t barrier;
+    pthread_t workers[2];
+    pthread_barrier_init(&barrier, NULL, 3);
+    pthread_create(&workers[0], NULL, idle_thread, &barrier);
+    pthread_create(&workers[1], NULL, idle_thread, &barrier);
+    pthread_barrier_wait(&barrier);
+
+    int all[2] = { 0, 0 };
+    int first[2] = { 0, 1 };
+    int ret1 = for_each_thread(getpid(), count_threads, all);
+    int ret2 = for_each_thread(getpid(), count_threads, first);
+
+    pthread_barrier_wait(&barrier);
+    pthread_join(workers[0], NULL);
+    pthread_join(workers[1], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    ASSERT_TRUE(ret1 == 0 && all[0] == 3 && ret2 == 0 && first[0] == 1);
+}
+
+/* Test for_each_thread error handling */
+void test_for_each_thread_errors(void)
+{
+    TEST("for_each_thread with NULL visitor and bad PID");
+    int counts[2] = { 0, 0 };
+    int ret1 = for_each_thread(getpid(), NULL, NULL);
+    int err1 = errno;
+    int ret2 = for_each_thread(999999, count_threads, counts);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL &&
+                ret2 == -1 && err2 == ENOENT && counts[0] == 0);
+}
+
+/* Test parse_thread_stat */
+void test_parse_thread_stat(void)
+{
+    TEST("parse_thread_stat extracts name, state, times and CPU");
+    static const char line[] =
+        "4242 (java) S 1 4242 4242 0 -1 4194624 8000 0 12 0 1500 25 0 0 "
+        "20 0 57 0 12345 7000000000 90000 18446744073709551615 1 1 0 0 0 "
+        "0 0 2 16 0 0 0 17 3 0 0 0 0 0\n";
+    thread_info_t t;
+    int ret = parse_thread_stat(line, strlen(line), &t);
+    ASSERT_TRUE(ret == 0 && t.tid == 4242 && strcmp(t.name, "java") == 0 &&
+                t.state == PROC_STATE_SLEEPING && t.utime == 1500 &&
+                t.stime == 25 && t.processor == 3 &&
+                t.nr_voluntary_ctxt_switches == 0);
+}
+
+void test_parse_thread_stat_odd_name(void)
+{
+    TEST("parse_thread_stat with ') (' and spaces in the name");
+    /* comm is "a) R (b" - only the last ')' ends it */
+    static const char line[] =
+        "7 (a) R (b) R 1 7 7 0 -1 0 0 0 0 0 9 8 0 0 20 0 1 0 1 1 1 1 1 1 "
+        "1 1 1 0 0 0 0 0 0 0 17 1 0 0";
+    thread_info_t t;
+    int ret = parse_thread_stat(line, strlen(line), &t);
+    ASSERT_TRUE(ret == 0 && strcmp(t.name, "a) R (b") == 0 &&
+                t.state == PROC_STATE_RUNNING && t.utime == 9 &&
+                t.stime == 8 && t.processor == 1);
+}
+
+void test_parse_thread_stat_malformed(void)
+{
+    TEST("parse_thread_stat rejects truncated and NULL input (EINVAL)");
+    static const char line[] = "4242 (java) S 1 4242 4242 0 -1";
+    thread_info_t t;
+    int ret1 = parse_thread_stat(line, strlen(line), &t);
+    int err1 = errno;
+    int ret2 = parse_thread_stat("no parens", 9, &t);
+    int err2 = errno;
+    int ret3 = parse_thread_stat(NULL, 0, &t);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                err2 == EINVAL && ret3 == -1 && errno == EINVAL);
+}
+
+/* Test CPU times and context switches */
+void test_enumerate_threads_cpu_time(void)
+{
+    TEST("enumerate_threads reports CPU time after spinning");
+    /* Spin for ~200 ms of CPU so at least a few ticks are charged */
+    struct timespec start, now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    do {
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L +
+             (now.tv_nsec - start.tv_nsec) < 200000000L);
+
+    thread_info_t *threads = NULL;
+    int count = 0;
+    int ret = enumerate_threads(getpid(), &threads, &count);
+    ASSERT_TRUE(ret == 0 && count >= 1 &&
+                threads[0].utime + threads[0].stime > 0 &&
+                threads[0].processor >= 0);
+    thread_info_free(threads);
+}
+
+void test_enumerate_threads_ctxt_switches(void)
+{
+    TEST("THREAD_READ_CTXT_SWITCHES fills context switch counts");
+    /* Each sleep is at least one voluntary switch */
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+    nanosleep(&delay, NULL);
+    nanosleep(&delay, NULL);
+
+    proc_handle_t h;
+    thread_info_t *plain = NULL, *full = NULL;
+    int plain_count = 0, full_count = 0;
+    int ret = proc_handle_open(&h, getpid());
+    int ret1 = enumerate_threads_at(&h, 0, &plain, &plain_count);
+    int ret2 = enumerate_threads_at(&h, THREAD_READ_CTXT_SWITCHES, &full,
+                                    &full_count);
+    proc_handle_close(&h);
+
+    ASSERT_TRUE(ret == 0 && ret1 == 0 && ret2 == 0 &&
+                plain_count >= 1 && full_count >= 1 &&
+                plain[0].nr_voluntary_ctxt_switches == 0 &&
+                full[0].nr_voluntary_ctxt_switches >= 2);
+    thread_info_free(plain);
+    thread_info_free(full);
+}
+
+/* Idle threads parked for the parallel tests */
+#define PARKED_THREADS 64
+
+/* Test thread_workers_for */
+void test_thread_workers_for(void)
+{
+    TEST("thread_workers_for keeps small processes on one worker");
+    int big = thread_workers_for(1000000);
+    ASSERT_TRUE(thread_workers_for(0) == 1 && thread_workers_for(1) == 1 &&
+                thread_workers_for(1023) == 1 && big >= 1 && big <= 8);
+}
+
+/* Test the split walk agrees with the serial one */
+void test_enumerate_threads_parallel_matches(void)
+{
+    TEST("enumerate_threads_parallel_at matches the serial walk");
+    pthread_barrier_t barrier;
+    pthread_t parked[PARKED_THREADS];
+    pthread_barrier_init(&barrier, NULL, PARKED_THREADS + 1);
+    for (int i = 0; i < PARKED_THREADS; i++) {
+        pthread_create(&parked[i], NULL, idle_thread, &barrier);
+    }
+    pthread_barrier_wait(&barrier);
+
+    proc_handle_t h;
+    thread_info_t *serial = NULL, *split = NULL;
+    int serial_count = 0, split_count = 0;
+    int ret = proc_handle_open(&h, getpid());
+    int ret1 = enumerate_threads_at(&h, 0, &serial, &serial_count);
+    int ret2 = enumerate_threads_parallel_at(&h, 0, 4, &split, &split_count);
+    proc_handle_close(&h);
+
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < PARKED_THREADS; i++) {
+        pthread_join(parked[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    /* The split walk's own 3 workers may show up; ours must all match */
+    bool same = ret == 0 && ret1 == 0 && ret2 == 0 &&
+                serial_count >= PARKED_THREADS + 1 &&
+                split_count >= serial_count;
+    int matched = 0;
+    for (int i = 0; same && i < split_count; i++) {
+        same = i == 0 || split[i - 1].tid < split[i].tid;
+        for (int j = 0; j < serial_count; j++) {
+            if (serial[j].tid == split[i].tid &&
+                strcmp(serial[j].name, split[i].name) == 0) {
+                matched++;
+            }
+        }
+    }
+    ASSERT_TRUE(same && matched == serial_count);
+    thread_info_free(serial);
+    thread_info_free(split);
+}
+
+/* Test more workers than threads and the automatic count */
+void test_enumerate_threads_parallel_workers(void)
+{
+    TEST("enumerate_threads_parallel_at with 64 and automatic workers");
+    proc_handle_t h;
+    thread_info_t *many = NULL, *auto_split = NULL;
+    int many_count = 0, auto_count = 0;
+    int ret = proc_handle_open(&h, getpid());
+    int ret1 = enumerate_threads_parallel_at(&h, 0, 64, &many, &many_count);
+    int ret2 = enumerate_threads_parallel_at(&h, THREAD_READ_CTXT_SWITCHES,
+                                             0, &auto_split, &auto_count);
+    proc_handle_close(&h);
+    ASSERT_TRUE(ret == 0 && ret1 == 0 && ret2 == 0 && many_count >= 1 &&
+                auto_count == 1 && many[0].tid == getpid() &&
+                auto_split[0].nr_voluntary_ctxt_switches > 0);
+    thread_info_free(many);
+    thread_info_free(auto_split);
+}
+
+void test_enumerate_threads_parallel_errors(void)
+{
+    TEST("enumerate_threads_parallel_at with NULL outputs and closed handle");
+    thread_info_t *threads = NULL;
+    int count = 0;
+    proc_handle_t h = { .pid = 0, .dirfd = -1, .pidfd = -1 };
+    int ret1 = enumerate_threads_parallel_at(&h, 0, 0, NULL, &count);
+    int err1 = errno;
+    int ret2 = enumerate_threads_parallel_at(&h, 0, 0, &threads, &count);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                threads == NULL && count == 0);
+}
+
+/* Test sample_threads */
+void test_sample_threads(void)
+{
+    TEST("sample_threads reads 16 of 65 threads, or all of them");
+    pthread_barrier_t barrier;
+    pthread_t parked[PARKED_THREADS];
+    pthread_barrier_init(&barrier, NULL, PARKED_THREADS + 1);
+    for (int i = 0; i < PARKED_THREADS; i++) {
+        pthread_create(&parked[i], NULL, idle_thread, &barrier);
+    }
+    pthread_barrier_wait(&barrier);
+
+    thread_sample_t part;
+    thread_sample_t all;
+    int ret1 = sample_threads(getpid(), 16, 3, &part);
+    int ret2 = -1;
+    /* On one CPU a thread just past the barrier can still be runnable */
+    for (int attempt = 0; attempt < 100; attempt++) {
+        ret2 = sample_threads(getpid(), 1000, 3, &all);
+        if (ret2 != 0 ||
+            all.state_counts[PROC_STATE_SLEEPING] >= PARKED_THREADS) {
+            break;
+        }
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = 10000000 };
+        nanosleep(&pause, NULL);
+    }
+
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < PARKED_THREADS; i++) {
+        pthread_join(parked[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    int sum = 0;
+    for (int s = 0; s <= PROC_STATE_UNKNOWN; s++) {
+        sum += part.state_counts[s];
+    }
+    /* Parked threads sleep; only this one is running */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 &&
+                part.total == PARKED_THREADS + 1 && part.sampled == 16 &&
+                sum == 16 && all.sampled == all.total &&
+                all.total == PARKED_THREADS + 1 &&
+                all.state_counts[PROC_STATE_SLEEPING] >= PARKED_THREADS);
+}
+
+void test_sample_threads_errors(void)
+{
+    TEST("sample_threads with NULL out, size 0 and bad PID");
+    thread_sample_t sample;
+    int ret1 = sample_threads(getpid(), 10, 1, NULL);
+    int err1 = errno;
+    int ret2 = sample_threads(getpid(), 0, 1, &sample);
+    int err2 = errno;
+    int ret3 = sample_threads(999999, 10, 1, &sample);
+    int err3 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 &&
+                err2 == EINVAL && ret3 == -1 && err3 == ENOENT &&
+                sample.total == 0);
+}
+
 int main(void)
 {
     printf("\n=== Running Thread Enumeration Tests ===\n\n");
@@ -180,6 +478,29 @@ int main(void)
     test_enumerate_threads_error_count();
     test_thread_info_free_null();
 
+    /* for_each_thread tests */
+    test_for_each_thread();
+    test_for_each_thread_errors();
+
+    /* parse_thread_stat tests */
+    test_parse_thread_stat();
+    test_parse_thread_stat_odd_name();
+    test_parse_thread_stat_malformed();
+
+    /* CPU time and context switch tests */
+    test_enumerate_threads_cpu_time();
+    test_enumerate_threads_ctxt_switches();
+
+    /* enumerate_threads_parallel_at tests */
+    test_thread_workers_for();
+    test_enumerate_threads_parallel_matches();
+    test_enumerate_threads_parallel_workers();
+    test_enumerate_threads_parallel_errors();
+
+    /* sample_threads tests */
+    test_sample_threads();
+    test_sample_threads_errors();
+
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
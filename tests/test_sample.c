@@ -0,0 +1,287 @@
+/*
+ * test_sample.c - Unit tests for reservoir sampling and count estimates
+ *
+ * Tests that reservoir_offer() keeps every ID with equal probability,
+ * sample_numeric_dir() on a directory of numbered files, and that
+ * estimate_count() intervals are exact for a census, respect what the
+ * sample proves and cover the true count at about their confidence level
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/sample.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define STREAM_LENGTH 100
+#define UNIFORM_TRIALS 20000
+#define DIR_ENTRIES 1000
+#define COVERAGE_TRIALS 2000
+
+/* Test reservoir_init / reservoir_offer */
+void test_reservoir_short_stream(void)
+{
+    TEST("a stream shorter than the reservoir is kept whole, in order");
+    reservoir_t r;
+    int ret = reservoir_init(&r, 10, 1);
+    for (long id = 0; ret == 0 && id < 7; id++) {
+        reservoir_offer(&r, id * 3);
+    }
+    bool ok = ret == 0 && r.count == 7 && r.seen == 7;
+    for (int i = 0; ok && i < 7; i++) {
+        ok = r.ids[i] == i * 3;
+    }
+    ASSERT_TRUE(ok);
+    reservoir_free(&r);
+}
+
+void test_reservoir_uniform(void)
+{
+    TEST("every ID of a 100-ID stream lands in a 10-slot sample ~10% of runs");
+    int hits[STREAM_LENGTH] = { 0 };
+    bool ok = true;
+    for (int trial = 0; ok && trial < UNIFORM_TRIALS; trial++) {
+        reservoir_t r;
+        ok = reservoir_init(&r, 10, (uint64_t)trial + 1) == 0;
+        for (long id = 0; ok && id < STREAM_LENGTH; id++) {
+            reservoir_offer(&r, id);
+        }
+        for (int i = 0; ok && i < r.count; i++) {
+            hits[r.ids[i]]++;
+        }
+        ok = ok && r.count == 10 && r.seen == STREAM_LENGTH;
+        reservoir_free(&r);
+    }
+    /* Expected 2000 each; 15% is over six standard deviations */
+    for (int id = 0; ok && id < STREAM_LENGTH; id++) {
+        ok = hits[id] > 1700 && hits[id] < 2300;
+    }
+    ASSERT_TRUE(ok);
+}
+
+void test_reservoir_seeded(void)
+{
+    TEST("the same seed picks the same sample; reservoir_sort orders it");
+    reservoir_t a;
+    reservoir_t b;
+    bool ok = reservoir_init(&a, 20, 42) == 0 &&
+              reservoir_init(&b, 20, 42) == 0;
+    for (long id = 0; ok && id < 5000; id++) {
+        reservoir_offer(&a, id);
+        reservoir_offer(&b, id);
+    }
+    ok = ok && memcmp(a.ids, b.ids, 20 * sizeof(long)) == 0;
+    reservoir_sort(&a);
+    for (int i = 1; ok && i < a.count; i++) {
+        ok = a.ids[i - 1] < a.ids[i];
+    }
+    ASSERT_TRUE(ok);
+    reservoir_free(&a);
+    reservoir_free(&b);
+}
+
+void test_reservoir_errors(void)
+{
+    TEST("reservoir_init with NULL or a capacity of 0 (EINVAL)");
+    reservoir_t r;
+    int ret1 = reservoir_init(NULL, 10, 1);
+    int err1 = errno;
+    int ret2 = reservoir_init(&r, 0, 1);
+    int err2 = errno;
+    reservoir_free(NULL);
+    reservoir_sort(NULL);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 && err2 == EINVAL);
+}
+
+/* Test sample_numeric_dir */
+void test_sample_numeric_dir(void)
+{
+    TEST("sample_numeric_dir draws 50 distinct IDs from 1000 numbered files");
+    char dir[] = "/tmp/pinspect_sampleXXXXXX";
+    bool ok = mkdtemp(dir) != NULL;
+    int dirfd = ok ? open(dir, O_RDONLY | O_DIRECTORY) : -1;
+    ok = dirfd >= 0;
+    for (int i = 0; ok && i <= DIR_ENTRIES; i++) {
+        char name[16];
+        /* One non-numeric name, which the scan must skip */
+        snprintf(name, sizeof(name), (i < DIR_ENTRIES) ? "%d" : "x%d", i);
+        int fd = openat(dirfd, name, O_CREAT | O_WRONLY, 0600);
+        ok = fd >= 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    reservoir_t r;
+    ok = ok && reservoir_init(&r, 50, 7) == 0;
+    int ret = ok ? sample_numeric_dir(dirfd, &r) : -1;
+    reservoir_sort(&r);
+    ok = ok && ret == 0 && r.seen == DIR_ENTRIES && r.count == 50;
+    for (int i = 0; ok && i < r.count; i++) {
+        ok = r.ids[i] >= 0 && r.ids[i] < DIR_ENTRIES &&
+             (i == 0 || r.ids[i - 1] < r.ids[i]);
+    }
+    ASSERT_TRUE(ok && sample_numeric_dir(dirfd, NULL) == -1);
+    reservoir_free(&r);
+
+    for (int i = 0; dirfd >= 0 && i <= DIR_ENTRIES; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), (i < DIR_ENTRIES) ? "%d" : "x%d", i);
+        unlinkat(dirfd, name, 0);
+    }
+    if (dirfd >= 0) {
+        close(dirfd);
+    }
+    rmdir(dir);
+}
+
+/* Test estimate_count */
+void test_estimate_census(void)
+{
+    TEST("estimate_count of a full census is exact");
+    count_estimate_t e;
+    int ret = estimate_count(37, 120, 120, &e);
+    ASSERT_TRUE(ret == 0 && e.estimate == 37 && e.low == 37 && e.high == 37);
+}
+
+void test_estimate_bounds(void)
+{
+    TEST("estimate_count intervals respect what the sample saw");
+    count_estimate_t none;
+    count_estimate_t all;
+    count_estimate_t empty;
+    count_estimate_t half;
+    bool ok = estimate_count(0, 200, 10000, &none) == 0 &&
+              estimate_count(200, 200, 10000, &all) == 0 &&
+              estimate_count(0, 0, 10000, &empty) == 0 &&
+              estimate_count(100, 200, 10000, &half) == 0;
+    /* Wilson with 0 of 200 seen: upper bound about 1.9% */
+    ASSERT_TRUE(ok && none.estimate == 0 && none.low == 0 &&
+                none.high > 150 && none.high < 250 &&
+                all.estimate == 10000 && all.high == 10000 &&
+                all.low > 9750 && all.low < 9850 &&
+                empty.low == 0 && empty.high == 10000 &&
+                half.estimate == 5000 && half.low > 4250 &&
+                half.low < 4400 && half.high > 5600 && half.high < 5750);
+}
+
+void test_estimate_finite_population(void)
+{
+    TEST("estimate_count narrows as the sample nears the population");
+    count_estimate_t small;
+    count_estimate_t most;
+    int ret1 = estimate_count(50, 100, 1000000, &small);
+    int ret2 = estimate_count(50, 100, 110, &most);
+    /* At n = 100 of 110, at least 50 and at most 60 can be hits */
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 &&
+                (most.high - most.low) / 110 <
+                    0.5 * (small.high - small.low) / 1000000 &&
+                most.low >= 50 && most.high <= 60);
+}
+
+/* Shuffle-free sampling without replacement of n of N, k of which hit */
+static int draw_hits(int population, int positives, int sampled,
+                     uint64_t *rng)
+{
+    int hits = 0;
+    int left = population;
+    int left_positive = positives;
+    for (int i = 0; i < sampled; i++, left--) {
+        *rng ^= *rng << 13;
+        *rng ^= *rng >> 7;
+        *rng ^= *rng << 17;
+        if ((int)(*rng % (uint64_t)left) < left_positive) {
+            hits++;
+            left_positive--;
+        }
+    }
+    return hits;
+}
+
+void test_estimate_coverage(void)
+{
+    TEST("95% intervals cover the true count in about 95% of samples");
+    static const int positives[] = { 30, 1500, 5000 };
+    uint64_t rng = 0x2545f4914f6cdd1dull;
+    bool ok = true;
+    for (size_t p = 0; ok && p < sizeof(positives) / sizeof(*positives);
+         p++) {
+        int covered = 0;
+        for (int trial = 0; trial < COVERAGE_TRIALS; trial++) {
+            int hits = draw_hits(10000, positives[p], 400, &rng);
+            count_estimate_t e;
+            ok = ok && estimate_count(hits, 400, 10000, &e) == 0;
+            covered += e.low <= positives[p] && positives[p] <= e.high;
+        }
+        ok = ok && covered >= COVERAGE_TRIALS * 92 / 100;
+    }
+    ASSERT_TRUE(ok);
+}
+
+void test_estimate_errors(void)
+{
+    TEST("estimate_count with impossible counts (EINVAL)");
+    count_estimate_t e;
+    int ret1 = estimate_count(5, 4, 10, &e);
+    int ret2 = estimate_count(1, 20, 10, &e);
+    int ret3 = estimate_count(-1, 5, 10, &e);
+    int ret4 = estimate_count(1, 5, 10, NULL);
+    ASSERT_TRUE(ret1 == -1 && ret2 == -1 && ret3 == -1 && ret4 == -1 &&
+                errno == EINVAL);
+}
+
+int main(void)
+{
+    printf("\n=== Running Sampling Tests ===\n\n");
+
+    /* reservoir tests */
+    test_reservoir_short_stream();
+    test_reservoir_uniform();
+    test_reservoir_seeded();
+    test_reservoir_errors();
+
+    /* sample_numeric_dir tests */
+    test_sample_numeric_dir();
+
+    /* estimate_count tests */
+    test_estimate_census();
+    test_estimate_bounds();
+    test_estimate_finite_population();
+    test_estimate_coverage();
+    test_estimate_errors();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
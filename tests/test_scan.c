@@ -0,0 +1,331 @@
+/*
+ * test_scan.c - Unit tests for the host-wide process scan
+ *
+ * Tests select_top_summaries() on made-up summaries, and scan_processes(),
+ * scan_parse_sort() and proc_summary_list_free() against the live /proc
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "../include/scan.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ITEMS 10
+
+/* RSS 300, 100, 900, 500, 100, 700, 200, 900, 400, 600 for PIDs 1..10 */
+static void fill_items(proc_summary_t *items)
+{
+    static const unsigned long rss[ITEMS] = {
+        300, 100, 900, 500, 100, 700, 200, 900, 400, 600
+    };
+    memset(items, 0, ITEMS * sizeof(proc_summary_t));
+    for (int i = 0; i < ITEMS; i++) {
+        items[i].info.pid = ITEMS - i;      /* Reverse PID order */
+        items[i].info.vm_rss_kb = rss[i];
+        items[i].info.uid_effective = (uid_t)(i % 3);
+        items[i].fd_count = (i == 4) ? -1 : i;
+    }
+}
+
+/* Find the summary of pid in a scan result, or NULL */
+static const proc_summary_t *find_pid(const proc_summary_t *items, int count,
+                                      pid_t pid)
+{
+    for (int i = 0; i < count; i++) {
+        if (items[i].info.pid == pid) {
+            return &items[i];
+        }
+    }
+    return NULL;
+}
+
+/* Test select_top_summaries */
+void test_select_top_rss(void)
+{
+    TEST("select_top_summaries keeps the 3 largest RSS in order");
+    proc_summary_t items[ITEMS];
+    fill_items(items);
+    int kept = select_top_summaries(items, ITEMS, SCAN_SORT_RSS, 3);
+
+    /* The two 900s tie and go to the lower PID: 3 (index 7) then 8 */
+    ASSERT_TRUE(kept == 3 &&
+                items[0].info.vm_rss_kb == 900 && items[0].info.pid == 3 &&
+                items[1].info.vm_rss_kb == 900 && items[1].info.pid == 8 &&
+                items[2].info.vm_rss_kb == 700);
+}
+
+void test_select_full_sort(void)
+{
+    TEST("select_top_summaries with limit 0 sorts all by PID and UID");
+    proc_summary_t items[ITEMS];
+    fill_items(items);
+    int kept1 = select_top_summaries(items, ITEMS, SCAN_SORT_PID, 0);
+    bool pid_ok = (kept1 == ITEMS);
+    for (int i = 0; i < ITEMS; i++) {
+        pid_ok = pid_ok && items[i].info.pid == i + 1;
+    }
+
+    fill_items(items);
+    int kept2 = select_top_summaries(items, ITEMS, SCAN_SORT_UID, 0);
+    bool uid_ok = (kept2 == ITEMS);
+    for (int i = 1; i < ITEMS; i++) {
+        const proc_info_t *a = &items[i - 1].info;
+        const proc_info_t *b = &items[i].info;
+        uid_ok = uid_ok && (a->uid_effective < b->uid_effective ||
+                            (a->uid_effective == b->uid_effective &&
+                             a->pid < b->pid));
+    }
+    ASSERT_TRUE(pid_ok && uid_ok);
+}
+
+void test_select_unknown_fds_last(void)
+{
+    TEST("select_top_summaries sorts unreadable FD counts last");
+    proc_summary_t items[ITEMS];
+    fill_items(items);
+    int kept = select_top_summaries(items, ITEMS, SCAN_SORT_FDS, 20);
+    ASSERT_TRUE(kept == ITEMS && items[0].fd_count == ITEMS - 1 &&
+                items[ITEMS - 2].fd_count == 0 &&
+                items[ITEMS - 1].fd_count == -1);
+}
+
+void test_select_empty(void)
+{
+    TEST("select_top_summaries with NULL and zero count");
+    proc_summary_t items[1];
+    memset(items, 0, sizeof(items));
+    ASSERT_TRUE(select_top_summaries(NULL, 5, SCAN_SORT_RSS, 2) == 0 &&
+                select_top_summaries(items, 0, SCAN_SORT_RSS, 2) == 0);
+}
+
+/* Test scan_processes */
+void test_scan_finds_self(void)
+{
+    TEST("scan_processes lists this process with FD and socket counts");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+
+    scan_options_t opts = { .sort = SCAN_SORT_PID, .fields = FIELDS_ALL,
+                            .workers = 2 };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret = scan_processes(&opts, &items, &count);
+
+    const proc_summary_t *self = find_pid(items, count, getpid());
+    bool sorted = true;
+    for (int i = 1; i < count; i++) {
+        sorted = sorted && items[i - 1].info.pid < items[i].info.pid;
+    }
+    ASSERT_TRUE(ret0 == 0 && ret == 0 && count > 1 && sorted &&
+                self != NULL && self->info.thread_count >= 1 &&
+                self->fd_count >= 5 && self->socket_count >= 2 &&
+                find_pid(items, count, 1) != NULL);
+    proc_summary_list_free(items);
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+void test_scan_without_sockets(void)
+{
+    TEST("scan_processes without sockets leaves socket_count -1");
+    scan_options_t opts = { .sort = SCAN_SORT_PID,
+                            .fields = FIELDS_STATUS | FIELD_FDS };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret = scan_processes(&opts, &items, &count);
+    const proc_summary_t *self = find_pid(items, count, getpid());
+    ASSERT_TRUE(ret == 0 && self != NULL && self->fd_count >= 3 &&
+                self->socket_count == -1);
+    proc_summary_list_free(items);
+}
+
+void test_scan_fields(void)
+{
+    TEST("scan_processes collects only requested and sort fields");
+    scan_options_t rss_only = { .sort = SCAN_SORT_PID,
+                                .fields = FIELD_VM_RSS };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret1 = scan_processes(&rss_only, &items, &count);
+    const proc_summary_t *self = find_pid(items, count, getpid());
+    bool rss_ok = ret1 == 0 && self != NULL && self->info.vm_rss_kb > 0 &&
+                  self->info.name[0] == '\0' &&
+                  self->info.state == PROC_STATE_UNKNOWN &&
+                  self->info.thread_count == 0 &&
+                  self->fd_count == -1 && self->socket_count == -1;
+    proc_summary_list_free(items);
+
+    /* Sorting by FDs pulls the FD count in */
+    scan_options_t by_fds = { .sort = SCAN_SORT_FDS, .fields = FIELD_NAME };
+    int ret2 = scan_processes(&by_fds, &items, &count);
+    self = find_pid(items, count, getpid());
+    bool fds_ok = ret2 == 0 && self != NULL && self->fd_count >= 3 &&
+                  self->info.name[0] != '\0' && self->info.vm_rss_kb == 0;
+    ASSERT_TRUE(rss_ok && fds_ok);
+    proc_summary_list_free(items);
+}
+
+void test_scan_uid_filter(void)
+{
+    TEST("scan_processes UID filter keeps only matching processes");
+    scan_options_t opts = { .sort = SCAN_SORT_PID, .match_uid = true,
+                            .uid = geteuid() };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret = scan_processes(&opts, &items, &count);
+    bool all_match = true;
+    for (int i = 0; i < count; i++) {
+        all_match = all_match && items[i].info.uid_effective == geteuid();
+    }
+    ASSERT_TRUE(ret == 0 && all_match &&
+                find_pid(items, count, getpid()) != NULL);
+    proc_summary_list_free(items);
+}
+
+void test_scan_min_fds(void)
+{
+    TEST("scan_processes min_fds keeps this process with 100 extra FDs");
+    enum { EXTRA = 100 };
+    int fds[EXTRA];
+    int opened = 0;
+    for (int i = 0; i < EXTRA; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        if (fds[i] < 0) {
+            break;
+        }
+        opened++;
+    }
+
+    scan_options_t opts = { .sort = SCAN_SORT_FDS, .min_fds = EXTRA };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret = scan_processes(&opts, &items, &count);
+    bool all_match = true;
+    for (int i = 0; i < count; i++) {
+        all_match = all_match && items[i].fd_count >= EXTRA;
+        if (i > 0) {
+            all_match = all_match &&
+                        items[i - 1].fd_count >= items[i].fd_count;
+        }
+    }
+    ASSERT_TRUE(ret == 0 && opened == EXTRA && all_match &&
+                find_pid(items, count, getpid()) != NULL);
+    proc_summary_list_free(items);
+    for (int i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+}
+
+void test_scan_limit(void)
+{
+    TEST("scan_processes returns at most limit entries by RSS");
+    scan_options_t opts = { .sort = SCAN_SORT_RSS, .limit = 2,
+                            .min_rss_kb = 1 };
+    proc_summary_t *items = NULL;
+    int count = 0;
+    int ret = scan_processes(&opts, &items, &count);
+    ASSERT_TRUE(ret == 0 && count >= 1 && count <= 2 &&
+                items[0].info.vm_rss_kb > 0 &&
+                (count == 1 ||
+                 items[0].info.vm_rss_kb >= items[1].info.vm_rss_kb));
+    proc_summary_list_free(items);
+}
+
+void test_scan_invalid(void)
+{
+    TEST("scan_processes with NULL arguments");
+    scan_options_t opts = { .sort = SCAN_SORT_PID };
+    proc_summary_t *items = NULL;
+    int count = 5;
+    int ret1 = scan_processes(NULL, &items, &count);
+    int err1 = errno;
+    int ret2 = scan_processes(&opts, NULL, &count);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && items == NULL &&
+                count == 0 && ret2 == -1 && err2 == EINVAL);
+}
+
+/* Test scan_parse_sort */
+void test_parse_sort(void)
+{
+    TEST("scan_parse_sort with known and unknown keys");
+    scan_sort_t sort = SCAN_SORT_PID;
+    int ret1 = scan_parse_sort("threads", &sort);
+    scan_sort_t parsed = sort;
+    int ret2 = scan_parse_sort("cpu", &sort);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == 0 && parsed == SCAN_SORT_THREADS &&
+                ret2 == -1 && err2 == EINVAL && sort == SCAN_SORT_THREADS);
+}
+
+/* Test proc_summary_list_free */
+void test_summary_list_free_null(void)
+{
+    TEST("proc_summary_list_free with NULL");
+    proc_summary_list_free(NULL);
+    ASSERT_TRUE(1);
+}
+
+int main(void)
+{
+    printf("\n=== Running Process Scan Tests ===\n\n");
+
+    /* select_top_summaries tests */
+    test_select_top_rss();
+    test_select_full_sort();
+    test_select_unknown_fds_last();
+    test_select_empty();
+
+    /* scan_processes tests */
+    test_scan_finds_self();
+    test_scan_without_sockets();
+    test_scan_fields();
+    test_scan_uid_filter();
+    test_scan_min_fds();
+    test_scan_limit();
+    test_scan_invalid();
+
+    /* scan_parse_sort tests */
+    test_parse_sort();
+
+    /* proc_summary_list_free tests */
+    test_summary_list_free_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,390 @@
+/*
+ * test_shmring.c - Unit tests for the shared-memory sample ring
+ *
+ * Tests shmring_create(), shmring_publish(), shmring_open(),
+ * shmring_read() and shmring_seek() on rings named after this process,
+ * including readers racing the producer from other threads
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/shmring.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define RACE_RECORDS 200000
+#define RACE_READERS 3
+#define RACE_WORDS 13       /* An odd size, not a multiple of 8 bytes */
+
+static char ring_name[64];
+
+/* A record whose words all hold its index, so a torn copy is visible */
+typedef struct {
+    uint64_t words[RACE_WORDS];
+    uint32_t tail;
+} race_record_t;
+
+static void make_record(race_record_t *r, uint64_t index)
+{
+    for (int i = 0; i < RACE_WORDS; i++) {
+        r->words[i] = index;
+    }
+    r->tail = (uint32_t)index;
+}
+
+static bool record_intact(const race_record_t *r)
+{
+    for (int i = 1; i < RACE_WORDS; i++) {
+        if (r->words[i] != r->words[0]) {
+            return false;
+        }
+    }
+    return r->tail == (uint32_t)r->words[0];
+}
+
+/* Test shmring_create / shmring_open / shmring_read */
+void test_publish_and_read(void)
+{
+    TEST("records come back in order, then 0 once caught up");
+    shmring_t ring;
+    shmring_reader_t reader;
+    int created = shmring_create(&ring, ring_name, sizeof(shm_sample_t), 16,
+                                 0600);
+    int opened = shmring_open(&reader, ring_name, sizeof(shm_sample_t));
+    bool ok = created == 0 && opened == 0 && shmring_head(&reader) == 0 &&
+              shmring_producer(&reader) == getpid();
+
+    for (int i = 0; ok && i < 3; i++) {
+        shm_sample_t s;
+        memset(&s, 0, sizeof(s));
+        s.tick = 1;
+        s.pid = 100 + i;
+        s.fd_count = 10 * i;
+        snprintf(s.info.name, sizeof(s.info.name), "proc%d", i);
+        shmring_publish(&ring, &s);
+    }
+    for (int i = 0; ok && i < 3; i++) {
+        shm_sample_t s;
+        char name[PROC_NAME_MAX];
+        snprintf(name, sizeof(name), "proc%d", i);
+        ok = shmring_read(&reader, &s) == 1 && s.pid == 100 + i &&
+             s.fd_count == 10 * i && s.tick == 1 &&
+             strcmp(s.info.name, name) == 0;
+    }
+    shm_sample_t s;
+    ASSERT_TRUE(ok && shmring_read(&reader, &s) == 0 &&
+                shmring_head(&reader) == 3 && reader.dropped == 0);
+    if (opened == 0) {
+        shmring_close(&reader);
+    }
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+void test_capacity_rounded(void)
+{
+    TEST("capacity rounds up to a power of two");
+    shmring_t ring;
+    shmring_reader_t reader;
+    int created = shmring_create(&ring, ring_name, sizeof(uint64_t), 5, 0600);
+    int opened = shmring_open(&reader, ring_name, sizeof(uint64_t));
+    for (uint64_t i = 0; created == 0 && i < 8; i++) {
+        shmring_publish(&ring, &i);
+    }
+    /* All 8 survive in a ring of 8; a 5-slot ring would have lost 3 */
+    uint64_t v = 0;
+    int got = 0;
+    while (opened == 0 && shmring_read(&reader, &v) == 1) {
+        got++;
+    }
+    ASSERT_TRUE(created == 0 && opened == 0 && got == 8 && v == 7 &&
+                reader.dropped == 0);
+    if (opened == 0) {
+        shmring_close(&reader);
+    }
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+void test_lapped_reader(void)
+{
+    TEST("a lapped reader skips to the oldest record and counts drops");
+    shmring_t ring;
+    shmring_reader_t reader;
+    int created = shmring_create(&ring, ring_name, sizeof(uint64_t), 8, 0600);
+    int opened = shmring_open(&reader, ring_name, sizeof(uint64_t));
+    for (uint64_t i = 0; created == 0 && i < 20; i++) {
+        shmring_publish(&ring, &i);
+    }
+    uint64_t first = 0;
+    uint64_t v = 0;
+    int got = 0;
+    while (opened == 0 && shmring_read(&reader, &v) == 1) {
+        if (got++ == 0) {
+            first = v;
+        }
+    }
+    ASSERT_TRUE(created == 0 && opened == 0 && got == 8 && first == 12 &&
+                v == 19 && reader.dropped == 12);
+    if (opened == 0) {
+        shmring_close(&reader);
+    }
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+/* Test shmring_seek */
+void test_seek(void)
+{
+    TEST("open starts at the oldest record, seek clamps to the ring");
+    shmring_t ring;
+    shmring_reader_t reader;
+    int created = shmring_create(&ring, ring_name, sizeof(uint64_t), 8, 0600);
+    for (uint64_t i = 0; created == 0 && i < 10; i++) {
+        shmring_publish(&ring, &i);
+    }
+    int opened = shmring_open(&reader, ring_name, sizeof(uint64_t));
+    uint64_t v = 0;
+    bool ok = opened == 0 && reader.cursor == 2 &&
+              shmring_read(&reader, &v) == 1 && v == 2;
+    if (ok) {
+        shmring_seek(&reader, shmring_head(&reader) - 1);
+        ok = shmring_read(&reader, &v) == 1 && v == 9 &&
+             shmring_read(&reader, &v) == 0;
+    }
+    if (ok) {
+        shmring_seek(&reader, 0);
+        uint64_t low = reader.cursor;
+        shmring_seek(&reader, 1000);
+        ok = low == 2 && reader.cursor == 10;
+    }
+    ASSERT_TRUE(ok);
+    if (opened == 0) {
+        shmring_close(&reader);
+    }
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+/* Per-reader state for race_reader() */
+typedef struct {
+    const char *name;
+    uint64_t records;
+    uint64_t dropped;
+    bool intact;            /* Every record whole and in increasing order */
+    bool opened;
+} race_reader_t;
+
+static void *race_reader(void *arg)
+{
+    race_reader_t *r = arg;
+    shmring_reader_t reader;
+    r->opened = shmring_open(&reader, r->name, sizeof(race_record_t)) == 0;
+    r->intact = true;
+    if (!r->opened) {
+        return NULL;
+    }
+    bool have_last = false;
+    uint64_t last = 0;
+    while (r->records + reader.dropped < RACE_RECORDS) {
+        race_record_t rec;
+        if (shmring_read(&reader, &rec) == 0) {
+            if (shmring_head(&reader) >= RACE_RECORDS &&
+                reader.cursor >= RACE_RECORDS) {
+                break;
+            }
+            continue;
+        }
+        if (!record_intact(&rec) || (have_last && rec.words[0] <= last)) {
+            r->intact = false;
+        }
+        last = rec.words[0];
+        have_last = true;
+        r->records++;
+    }
+    r->dropped = reader.dropped;
+    shmring_close(&reader);
+    return NULL;
+}
+
+void test_concurrent_readers(void)
+{
+    TEST("concurrent readers never see a torn or reordered record");
+    shmring_t ring;
+    int created = shmring_create(&ring, ring_name, sizeof(race_record_t), 64,
+                                 0600);
+    race_reader_t readers[RACE_READERS];
+    pthread_t threads[RACE_READERS];
+    int started = 0;
+    for (int i = 0; created == 0 && i < RACE_READERS; i++) {
+        memset(&readers[i], 0, sizeof(readers[i]));
+        readers[i].name = ring_name;
+        if (pthread_create(&threads[i], NULL, race_reader,
+                           &readers[i]) == 0) {
+            started++;
+        }
+    }
+    for (uint64_t i = 0; created == 0 && i < RACE_RECORDS; i++) {
+        race_record_t rec;
+        make_record(&rec, i);
+        shmring_publish(&ring, &rec);
+    }
+
+    bool ok = created == 0 && started == RACE_READERS;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        /* A reader opened mid-stream starts at the oldest record then */
+        ok = ok && readers[i].opened && readers[i].intact &&
+             readers[i].records > 0 &&
+             readers[i].records + readers[i].dropped <= RACE_RECORDS;
+    }
+    ASSERT_TRUE(ok);
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+/* Test error handling */
+void test_bad_arguments(void)
+{
+    TEST("bad names, sizes and capacities fail with EINVAL");
+    shmring_t ring;
+    int a = shmring_create(&ring, "no-slash", 8, 8, 0600);
+    int ea = errno;
+    int b = shmring_create(&ring, "/a/b", 8, 8, 0600);
+    int eb = errno;
+    int c = shmring_create(&ring, ring_name, 0, 8, 0600);
+    int ec = errno;
+    int d = shmring_create(&ring, ring_name, 8, 0, 0600);
+    int ed = errno;
+    ASSERT_TRUE(a == -1 && ea == EINVAL && b == -1 && eb == EINVAL &&
+                c == -1 && ec == EINVAL && d == -1 && ed == EINVAL);
+}
+
+void test_open_errors(void)
+{
+    TEST("open fails on a missing ring, wrong size or foreign object");
+    shmring_reader_t reader;
+    shm_unlink(ring_name);
+    int missing = shmring_open(&reader, ring_name, 8);
+    int e_missing = errno;
+
+    shmring_t ring;
+    int created = shmring_create(&ring, ring_name, 16, 8, 0600);
+    int size = shmring_open(&reader, ring_name, 8);
+    int e_size = errno;
+    if (created == 0) {
+        shmring_destroy(&ring, true);
+    }
+
+    /* A shared-memory object that is not a ring */
+    int fd = shm_open(ring_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    int foreign = 0;
+    int e_foreign = 0;
+    if (fd >= 0) {
+        if (ftruncate(fd, 4096) == 0) {
+            foreign = shmring_open(&reader, ring_name, 8);
+            e_foreign = errno;
+        }
+        close(fd);
+        shm_unlink(ring_name);
+    }
+    ASSERT_TRUE(missing == -1 && e_missing == ENOENT && created == 0 &&
+                size == -1 && e_size == EINVAL && fd >= 0 &&
+                foreign == -1 && e_foreign == EPROTO);
+}
+
+void test_recreate_replaces(void)
+{
+    TEST("creating over a stale ring starts a fresh one");
+    shmring_t old_ring;
+    shmring_t ring;
+    shmring_reader_t reader;
+    int first = shmring_create(&old_ring, ring_name, 8, 8, 0600);
+    uint64_t v = 42;
+    if (first == 0) {
+        shmring_publish(&old_ring, &v);
+        shmring_destroy(&old_ring, false);
+    }
+    int second = shmring_create(&ring, ring_name, 8, 8, 0600);
+    int opened = shmring_open(&reader, ring_name, 8);
+    ASSERT_TRUE(first == 0 && second == 0 && opened == 0 &&
+                shmring_head(&reader) == 0 &&
+                shmring_read(&reader, &v) == 0);
+    if (opened == 0) {
+        shmring_close(&reader);
+    }
+    if (second == 0) {
+        shmring_destroy(&ring, true);
+    }
+}
+
+void test_null_safe(void)
+{
+    TEST("destroy and close are NULL-safe");
+    shmring_destroy(NULL, true);
+    shmring_close(NULL);
+    ASSERT_TRUE(true);
+}
+
+int main(void)
+{
+    printf("\n=== Running Shared-Memory Ring Tests ===\n\n");
+
+    snprintf(ring_name, sizeof(ring_name), "/pinspect-test-%d",
+             (int)getpid());
+
+    /* shmring_create / shmring_publish / shmring_read tests */
+    test_publish_and_read();
+    test_capacity_rounded();
+    test_lapped_reader();
+    test_seek();
+    test_concurrent_readers();
+
+    /* Error handling tests */
+    test_bad_arguments();
+    test_open_errors();
+    test_recreate_replaces();
+    test_null_safe();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/*
+ * test_stats.c - Unit tests for the --stats counters
+ *
+ * Tests stats_enable(), stats_snapshot(), stats_phase_name() and
+ * stats_print() against real collector calls on this process
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../include/stats.h"
+#include "../include/proc_status.h"
+#include "../include/proc_fd.h"
+#include "../include/net.h"
+#include "../include/workpool.h"
+#include "../include/uring.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define PARALLEL_READS 200
+#define URING_SOCKET_PAIRS 200
+
+/* Test stats_enable / stats_snapshot */
+void test_snapshot_starts_at_zero(void)
+{
+    TEST("stats_enable zeroes every counter");
+    proc_info_t info;
+    read_proc_status(getpid(), &info);
+    stats_enable();
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+    bool zero = true;
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        for (int c = 0; c < STATS_COUNTER_COUNT; c++) {
+            zero = zero && snap.values[p][c] == 0;
+        }
+    }
+    ASSERT_TRUE(zero);
+}
+
+void test_status_phase_counts(void)
+{
+    TEST("read_proc_status charges one open, read and entry to status");
+    stats_enable();
+    proc_info_t info;
+    int ret = read_proc_status(getpid(), &info);
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+    const uint64_t *status = snap.values[STATS_PHASE_STATUS];
+    const uint64_t *other = snap.values[STATS_PHASE_OTHER];
+    ASSERT_TRUE(ret == 0 && status[STATS_CALLS] == 1 &&
+                status[STATS_ENTRIES] == 1 && status[STATS_OPENS] == 1 &&
+                status[STATS_READS] >= 1 && status[STATS_BYTES_READ] > 100 &&
+                status[STATS_WALL_NS] > 0 && other[STATS_OPENS] == 1 &&
+                other[STATS_WALL_NS] == 0 && snap.elapsed_ns > 0);
+}
+
+void test_nested_phases_exclusive(void)
+{
+    TEST("find_process_sockets splits readlinks to fds, rows to net");
+    int pair[2];
+    int ret0 = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+    int fds = 0;
+    count_fds(getpid(), &fds);
+
+    stats_enable();
+    socket_info_t *sockets = NULL;
+    int count = 0;
+    int ret = find_process_sockets(getpid(), &sockets, &count);
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+    const uint64_t *fd = snap.values[STATS_PHASE_FDS];
+    const uint64_t *net = snap.values[STATS_PHASE_NET];
+    ASSERT_TRUE(ret0 == 0 && ret == 0 && count >= 2 &&
+                fd[STATS_CALLS] == 1 && fd[STATS_READLINKS] >= 5 &&
+                fd[STATS_READLINKS] == fd[STATS_ENTRIES] &&
+                net[STATS_CALLS] == 1 && net[STATS_READLINKS] == 0 &&
+                net[STATS_ENTRIES] >= 2 && net[STATS_READS] >= 1);
+    socket_list_free(sockets);
+    if (ret0 == 0) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+void test_uring_backend_counts(void)
+{
+    TEST("uring FD backend reads no links for sockets, enters per batch");
+    int pairs[URING_SOCKET_PAIRS][2];
+    int made = 0;
+    while (made < URING_SOCKET_PAIRS &&
+           socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[made]) == 0) {
+        made++;
+    }
+
+    fd_set_backend(FD_BACKEND_URING);
+    stats_enable();
+    fd_list_t list;
+    int ret = enumerate_fds(getpid(), &list);
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+    fd_set_backend(FD_BACKEND_READLINK);
+    const uint64_t *fd = snap.values[STATS_PHASE_FDS];
+
+    /* Without io_uring the walk falls back to one readlink per FD */
+    bool counts = uring_supported()
+                  ? fd[STATS_RING_ENTERS] >= 2 &&
+                    fd[STATS_READLINKS] + 2 * made <= fd[STATS_ENTRIES]
+                  : fd[STATS_READLINKS] == fd[STATS_ENTRIES];
+    ASSERT_TRUE(made == URING_SOCKET_PAIRS && ret == 0 && counts &&
+                list.count >= 2 * made);
+    if (ret == 0) {
+        fd_list_free(&list);
+    }
+    for (int i = 0; i < made; i++) {
+        close(pairs[i][0]);
+        close(pairs[i][1]);
+    }
+}
+
+/* workpool_run() task: one status read per index */
+static void read_status_task(void *ctx, size_t index)
+{
+    (void)ctx;
+    (void)index;
+    proc_info_t info;
+    read_proc_status(getpid(), &info);
+}
+
+void test_parallel_counts(void)
+{
+    TEST("counters add up across worker threads");
+    workpool_t pool;
+    int ret = workpool_init(&pool, 4);
+    stats_enable();
+    if (ret == 0) {
+        workpool_run(&pool, PARALLEL_READS, read_status_task, NULL);
+        workpool_destroy(&pool);
+    }
+    stats_snapshot_t snap;
+    stats_snapshot(&snap);
+    const uint64_t *status = snap.values[STATS_PHASE_STATUS];
+    ASSERT_TRUE(ret == 0 && status[STATS_CALLS] == PARALLEL_READS &&
+                status[STATS_OPENS] == PARALLEL_READS);
+}
+
+/* Test stats_phase_name */
+void test_phase_names(void)
+{
+    TEST("stats_phase_name for known and out-of-range phases");
+    ASSERT_TRUE(strcmp(stats_phase_name(STATS_PHASE_FDS), "fds") == 0 &&
+                strcmp(stats_phase_name(STATS_PHASE_NET), "net") == 0 &&
+                strcmp(stats_phase_name(STATS_PHASE_COUNT), "?") == 0);
+}
+
+/* Test stats_print */
+void test_print_rows(void)
+{
+    TEST("stats_print lists used phases and a total row");
+    stats_enable();
+    proc_info_t info;
+    read_proc_status(getpid(), &info);
+
+    char text[4096] = "";
+    FILE *fp = tmpfile();
+    if (fp != NULL) {
+        stats_print(fp);
+        rewind(fp);
+        size_t n = fread(text, 1, sizeof(text) - 1, fp);
+        text[n] = '\0';
+        fclose(fp);
+    }
+    ASSERT_TRUE(strstr(text, "  status ") != NULL &&
+                strstr(text, "  total ") != NULL &&
+                strstr(text, "  threads ") == NULL);
+}
+
+int main(void)
+{
+    printf("\n=== Running Stats Counter Tests ===\n\n");
+
+    if (!stats_supported()) {
+        printf("Built with STATS=0; nothing to test\n");
+        return 0;
+    }
+
+    /* stats_enable / stats_snapshot tests */
+    test_snapshot_starts_at_zero();
+    test_status_phase_counts();
+    test_nested_phases_exclusive();
+    test_uring_backend_counts();
+    test_parallel_counts();
+
+    /* stats_phase_name tests */
+    test_phase_names();
+
+    /* stats_print tests */
+    test_print_rows();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,365 @@
+/*
+ * test_top.c - Unit tests for per-thread CPU sampling
+ *
+ * Tests top_init(), top_sample(), top_run() and top_free() by sampling the
+ * test process itself while a helper thread spins or sleeps
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../include/top.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_EQ(actual, expected) \
+    do { \
+        if ((actual) == (expected)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (expected %d, got %d)\n", TEST_FAIL, \
+                   (int)(expected), (int)(actual)); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+static atomic_bool stop_spinning;
+
+/* Burn CPU until told to stop */
+static void *spin_thread(void *arg)
+{
+    (void)arg;
+    volatile unsigned long n = 0;
+    while (!atomic_load(&stop_spinning)) {
+        n++;
+    }
+    return NULL;
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec delay = { .tv_sec = ms / 1000,
+                              .tv_nsec = (ms % 1000) * 1000000L };
+    nanosleep(&delay, NULL);
+}
+
+/*
+ * Start a spinning thread. Returns 0 on success, -1 on error.
+ */
+static int start_spinner(pthread_t *thread)
+{
+    atomic_store(&stop_spinning, false);
+    return pthread_create(thread, NULL, spin_thread, NULL) == 0 ? 0 : -1;
+}
+
+static void stop_spinner(pthread_t thread)
+{
+    atomic_store(&stop_spinning, true);
+    pthread_join(thread, NULL);
+}
+
+/*
+ * Count non-overlapping occurrences of needle in haystack.
+ */
+static int count_substr(const char *haystack, const char *needle)
+{
+    int n = 0;
+    size_t len = strlen(needle);
+    for (const char *p = strstr(haystack, needle); p != NULL;
+         p = strstr(p + len, needle)) {
+        n++;
+    }
+    return n;
+}
+
+/* Test top_sample */
+void test_top_sample_baseline(void)
+{
+    TEST("top_sample first call only records a baseline");
+    top_state_t state;
+    const thread_rate_t *rates = NULL;
+    int count = -1;
+
+    int ret = top_init(&state, getpid());
+    if (ret == 0) {
+        ret = top_sample(&state, &rates, &count);
+    }
+    ASSERT_TRUE(ret == 0 && rates == NULL && count == 0 && state.primed &&
+                state.prev_count >= 1);
+
+    top_free(&state);
+}
+
+void test_top_sample_spinner_first(void)
+{
+    TEST("top_sample ranks a spinning thread first");
+    top_state_t state;
+    pthread_t spinner;
+    const thread_rate_t *rates = NULL;
+    int count = 0;
+    int ret = -1;
+
+    if (top_init(&state, getpid()) == 0 && start_spinner(&spinner) == 0) {
+        if (top_sample(&state, &rates, &count) == 0) {
+            sleep_ms(200);
+            ret = top_sample(&state, &rates, &count);
+        }
+        stop_spinner(spinner);
+    }
+
+    /* Main thread slept, so the other thread held the CPU */
+    ASSERT_TRUE(ret == 0 && count == 2 && rates[0].tid != getpid() &&
+                rates[0].cpu_percent > 30.0 &&
+                rates[0].cpu_percent > rates[1].cpu_percent);
+
+    top_free(&state);
+}
+
+void test_top_sample_sorted(void)
+{
+    TEST("top_sample sorts by descending CPU, ties by TID");
+    top_state_t state;
+    pthread_t spinner;
+    const thread_rate_t *rates = NULL;
+    int count = 0;
+    int ret = -1;
+
+    if (top_init(&state, getpid()) == 0 && start_spinner(&spinner) == 0) {
+        if (top_sample(&state, &rates, &count) == 0) {
+            sleep_ms(50);
+            ret = top_sample(&state, &rates, &count);
+        }
+        stop_spinner(spinner);
+    }
+
+    int sorted = (ret == 0);
+    for (int i = 1; sorted && i < count; i++) {
+        if (rates[i - 1].cpu_percent < rates[i].cpu_percent ||
+            (rates[i - 1].cpu_percent == rates[i].cpu_percent &&
+             rates[i - 1].tid >= rates[i].tid)) {
+            sorted = 0;
+        }
+    }
+    ASSERT_TRUE(sorted && count >= 2);
+
+    top_free(&state);
+}
+
+void test_top_sample_voluntary_switches(void)
+{
+    TEST("top_sample reports voluntary switches of a sleeping thread");
+    top_state_t state;
+    const thread_rate_t *rates = NULL;
+    int count = 0;
+    int ret = -1;
+
+    if (top_init(&state, getpid()) == 0 &&
+        top_sample(&state, &rates, &count) == 0) {
+        /* Each sleep blocks, which the kernel counts as a voluntary switch */
+        for (int i = 0; i < 10; i++) {
+            sleep_ms(5);
+        }
+        ret = top_sample(&state, &rates, &count);
+    }
+
+    double voluntary = 0;
+    for (int i = 0; ret == 0 && i < count; i++) {
+        if (rates[i].tid == getpid()) {
+            voluntary = rates[i].voluntary_per_sec;
+        }
+    }
+    ASSERT_TRUE(ret == 0 && voluntary > 0);
+
+    top_free(&state);
+}
+
+void test_top_sample_thread_exit(void)
+{
+    TEST("top_sample drops exited threads from the TID index");
+    top_state_t state;
+    pthread_t spinner;
+    const thread_rate_t *rates = NULL;
+    int count = 0;
+    int first = 0;
+    int ret = -1;
+
+    if (top_init(&state, getpid()) == 0 && start_spinner(&spinner) == 0) {
+        if (top_sample(&state, &rates, &count) == 0) {
+            first = state.prev_count;
+        }
+        stop_spinner(spinner);
+        ret = top_sample(&state, &rates, &count);
+    }
+
+    ASSERT_TRUE(ret == 0 && first == 2 && count == 1 &&
+                state.index.count == 1 &&
+                id_map_contains(&state.index, (unsigned long)getpid()));
+
+    top_free(&state);
+}
+
+void test_top_sample_bad_args(void)
+{
+    TEST("top_sample rejects NULL arguments (EINVAL)");
+    const thread_rate_t *rates;
+    int count;
+    int ret = top_sample(NULL, &rates, &count);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+/* Test top_init */
+void test_top_init_nonexistent(void)
+{
+    TEST("top_init with non-existent PID (ENOENT)");
+    top_state_t state;
+    int ret = top_init(&state, 999999);
+    int init_errno = errno;
+
+    const thread_rate_t *rates;
+    int count;
+    int sample_ret = top_sample(&state, &rates, &count);
+    ASSERT_TRUE(ret == -1 && init_errno == ENOENT && sample_ret == -1);
+
+    top_free(&state);
+}
+
+/* Test top_run */
+void test_top_run_max_samples(void)
+{
+    TEST("top_run prints max_samples refreshes");
+    top_options_t opts = { .interval_sec = 0.01, .limit = 0,
+                           .max_samples = 2 };
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+
+    int ret = (out != NULL) ? top_run(getpid(), &opts, out) : -1;
+    if (out != NULL) {
+        fclose(out);
+    }
+    ASSERT_TRUE(ret == 0 && text != NULL && count_substr(text, "CPU%") == 2);
+
+    free(text);
+}
+
+void test_top_run_limit(void)
+{
+    TEST("top_run limits rows per refresh");
+    top_options_t opts = { .interval_sec = 0.01, .limit = 1,
+                           .max_samples = 1 };
+    pthread_t spinner;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    int ret = -1;
+
+    if (out != NULL && start_spinner(&spinner) == 0) {
+        ret = top_run(getpid(), &opts, out);
+        stop_spinner(spinner);
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+
+    /* Summary line, header and exactly one row */
+    int lines = (text != NULL) ? count_substr(text, "\n") : 0;
+    ASSERT_TRUE(ret == 0 && text != NULL &&
+                strstr(text, "2 threads") != NULL && lines == 4);
+
+    free(text);
+}
+
+void test_top_run_bad_interval(void)
+{
+    TEST("top_run rejects non-positive interval (EINVAL)");
+    top_options_t opts = { .interval_sec = 0, .limit = 0, .max_samples = 1 };
+    int ret = top_run(getpid(), &opts, stdout);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+void test_top_run_nonexistent(void)
+{
+    TEST("top_run with non-existent PID (ENOENT)");
+    top_options_t opts = { .interval_sec = 0.01, .limit = 0,
+                           .max_samples = 1 };
+    int ret = top_run(999999, &opts, stdout);
+    ASSERT_TRUE(ret == -1 && errno == ENOENT);
+}
+
+/* Test top_free */
+void test_top_free_twice(void)
+{
+    TEST("top_free is safe to call twice and with NULL");
+    top_state_t state;
+    const thread_rate_t *rates;
+    int count;
+
+    top_init(&state, getpid());
+    top_sample(&state, &rates, &count);
+
+    top_free(&state);
+    top_free(&state);
+    top_free(NULL);
+    ASSERT_TRUE(state.prev == NULL && state.capacity == 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running Top Sampling Tests ===\n\n");
+
+    /* top_sample tests */
+    test_top_sample_baseline();
+    test_top_sample_spinner_first();
+    test_top_sample_sorted();
+    test_top_sample_voluntary_switches();
+    test_top_sample_thread_exit();
+    test_top_sample_bad_args();
+
+    /* top_init tests */
+    test_top_init_nonexistent();
+
+    /* top_run tests */
+    test_top_run_max_samples();
+    test_top_run_limit();
+    test_top_run_bad_interval();
+    test_top_run_nonexistent();
+
+    /* top_free tests */
+    test_top_free_twice();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
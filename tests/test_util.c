@@ -1,13 +1,22 @@
 /*
  * test_util.c - Unit tests for utility functions
  *
- * Tests parse_pid(), build_proc_path(), state conversions
+ * Tests parse_pid(), build_proc_path(), state conversions, PID lookup,
+ * file and number scanning helpers, timespec arithmetic and FNV-1a hashing
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
 #include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 #include "../include/util.h"
 #include "../include/pinspect.h"
 
@@ -137,6 +146,25 @@ void test_build_proc_path_small_buffer(void)
     ASSERT_EQ(build_proc_path(1234, "status", buf, sizeof(buf)), -1);
 }
 
+void test_proc_set_root(void)
+{
+    TEST("proc_set_root redirects paths and NULL restores /proc");
+    char proc_buf[256], task_buf[256], live_buf[256];
+    proc_set_root("/tmp/fixture");
+    int ret1 = build_proc_path(1234, "status", proc_buf, sizeof(proc_buf));
+    int ret2 = build_task_path(1234, 1235, "stat", task_buf,
+                               sizeof(task_buf));
+    bool custom = !proc_root_is_live();
+    proc_set_root(NULL);
+    int ret3 = build_proc_path(1234, NULL, live_buf, sizeof(live_buf));
+    ASSERT_TRUE(ret1 == 0 && ret2 == 0 && ret3 == 0 && custom &&
+                strcmp(proc_buf, "/tmp/fixture/1234/status") == 0 &&
+                strcmp(task_buf, "/tmp/fixture/1234/task/1235/stat") == 0 &&
+                strcmp(live_buf, "/proc/1234") == 0 &&
+                strcmp(proc_get_root(), PROC_ROOT) == 0 &&
+                proc_root_is_live());
+}
+
 /* Test build_task_path() */
 void test_build_task_path_with_file(void)
 {
@@ -238,6 +266,333 @@ void test_char_to_state_invalid(void)
     ASSERT_EQ(char_to_state('X'), PROC_STATE_UNKNOWN);
 }
 
+/* Test read_process_name() */
+void test_read_process_name_self(void)
+{
+    TEST("read_process_name for current process");
+    char name[PROC_NAME_MAX];
+    read_process_name(getpid(), name, sizeof(name));
+    ASSERT_STR_EQ(name, "test_util");
+}
+
+void test_read_process_name_nonexistent(void)
+{
+    TEST("read_process_name for non-existent PID");
+    char name[PROC_NAME_MAX];
+    read_process_name(999999, name, sizeof(name));
+    ASSERT_STR_EQ(name, "?");
+}
+
+/* Test sort_unique_pids() */
+void test_sort_unique_pids_duplicates(void)
+{
+    TEST("sort_unique_pids sorts and removes duplicates");
+    pid_t pids[] = { 42, 7, 42, 1, 7, 300 };
+    int n = sort_unique_pids(pids, 6);
+    ASSERT_TRUE(n == 4 && pids[0] == 1 && pids[1] == 7 &&
+                pids[2] == 42 && pids[3] == 300);
+}
+
+void test_sort_unique_pids_empty(void)
+{
+    TEST("sort_unique_pids with empty list");
+    ASSERT_EQ(sort_unique_pids(NULL, 0), 0);
+}
+
+/* Test find_pids_by_name() */
+void test_find_pids_by_name_child(void)
+{
+    TEST("find_pids_by_name finds forked child, not self");
+    pid_t child = fork();
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    pid_t *pids = NULL;
+    int count = 0;
+    int ret = find_pids_by_name("test_util", &pids, &count);
+
+    bool found_child = false, found_self = false;
+    for (int i = 0; i < count; i++) {
+        found_child |= (pids[i] == child);
+        found_self |= (pids[i] == getpid());
+    }
+    ASSERT_TRUE(child > 0 && ret == 0 && found_child && !found_self);
+
+    free(pids);
+    if (child > 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+}
+
+void test_find_pids_by_name_no_match(void)
+{
+    TEST("find_pids_by_name with no match");
+    pid_t *pids = NULL;
+    int count = -1;
+    int ret = find_pids_by_name("no-such-process-name", &pids, &count);
+    ASSERT_TRUE(ret == 0 && pids == NULL && count == 0);
+}
+
+void test_find_pids_by_name_null(void)
+{
+    TEST("find_pids_by_name with NULL pattern (EINVAL)");
+    pid_t *pids = NULL;
+    int count = 0;
+    int ret = find_pids_by_name(NULL, &pids, &count);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+/* scan_numeric_dir visitor summing IDs; stops after limit entries if set */
+typedef struct {
+    int visited;
+    long sum;
+    int limit;
+} scan_ctx_t;
+
+static int sum_entries(const char *name, long id, void *ctx)
+{
+    scan_ctx_t *c = ctx;
+    (void)name;
+    c->visited++;
+    c->sum += id;
+    return c->limit > 0 && c->visited >= c->limit;
+}
+
+/* Create a scratch directory with numeric and non-numeric entries */
+static bool make_scan_dir(char *dir)
+{
+    static const char *names[] = { "1", "22", "300", "abc", "12x", ".hidden" };
+    if (mkdtemp(dir) == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        int fd = open(path, O_CREAT | O_WRONLY, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        close(fd);
+    }
+    return true;
+}
+
+static void remove_scan_dir(const char *dir)
+{
+    static const char *names[] = { "1", "22", "300", "abc", "12x", ".hidden" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+/* Test scan_numeric_dir */
+void test_scan_numeric_dir_filters(void)
+{
+    TEST("scan_numeric_dir visits only all-digit names");
+    char dir[] = "/tmp/pinspect-scan-XXXXXX";
+    bool made = make_scan_dir(dir);
+    scan_ctx_t c = {0};
+    int ret = -1;
+    if (made) {
+        int fd = open(dir, O_RDONLY | O_DIRECTORY);
+        ret = scan_numeric_dir(fd, sum_entries, &c);
+        close(fd);
+    }
+    remove_scan_dir(dir);
+    ASSERT_TRUE(made && ret == 0 && c.visited == 3 && c.sum == 323);
+}
+
+void test_scan_numeric_dir_early_stop(void)
+{
+    TEST("scan_numeric_dir stops on non-zero visitor");
+    char dir[] = "/tmp/pinspect-scan-XXXXXX";
+    bool made = make_scan_dir(dir);
+    scan_ctx_t c = { .limit = 2 };
+    int ret = -1;
+    if (made) {
+        int fd = open(dir, O_RDONLY | O_DIRECTORY);
+        ret = scan_numeric_dir(fd, sum_entries, &c);
+        close(fd);
+    }
+    remove_scan_dir(dir);
+    ASSERT_TRUE(made && ret == 0 && c.visited == 2);
+}
+
+void test_scan_numeric_dir_errors(void)
+{
+    TEST("scan_numeric_dir with NULL visitor and bad fd");
+    scan_ctx_t c = {0};
+    int ret1 = scan_numeric_dir(0, NULL, NULL);
+    int err1 = errno;
+    int ret2 = scan_numeric_dir(-1, sum_entries, &c);
+    int err2 = errno;
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL &&
+                ret2 == -1 && err2 == EBADF && c.visited == 0);
+}
+
+/* Test read_dir_batch / visit_numeric_entries */
+void test_read_dir_batch(void)
+{
+    TEST("read_dir_batch then visit_numeric_entries, then end of dir");
+    char dir[] = "/tmp/pinspect-scan-XXXXXX";
+    bool made = make_scan_dir(dir);
+    scan_ctx_t c = {0};
+    long first = -1;
+    long second = -1;
+    if (made) {
+        char buf[4096];
+        int fd = open(dir, O_RDONLY | O_DIRECTORY);
+        first = read_dir_batch(fd, buf, sizeof(buf));
+        if (first > 0) {
+            visit_numeric_entries(buf, (size_t)first, sum_entries, &c);
+        }
+        second = read_dir_batch(fd, buf, sizeof(buf));
+        close(fd);
+    }
+    remove_scan_dir(dir);
+    ASSERT_TRUE(made && first > 0 && second == 0 &&
+                c.visited == 3 && c.sum == 323);
+}
+
+/* Test scan_decimal */
+void test_scan_decimal(void)
+{
+    TEST("scan_decimal skips blanks and stops at end or non-digit");
+    static const char text[] = " \t1234 kB";
+    unsigned long long v1 = 0, v2 = 0, v3 = 99;
+    const char *end = text + strlen(text);
+    const char *p1 = scan_decimal(text, end, &v1);
+    /* Bounded by end: only "12" of "1234" is in range */
+    const char *p2 = scan_decimal(text, text + 4, &v2);
+    const char *p3 = scan_decimal(p1, end, &v3);
+    ASSERT_TRUE(p1 == text + 6 && v1 == 1234 && p2 == text + 4 &&
+                v2 == 12 && p3 == NULL && v3 == 99);
+}
+
+/* Test read_file_at */
+void test_read_file_at(void)
+{
+    TEST("read_file_at reads a small file and NUL-terminates it");
+    char buf[64];
+    ssize_t len = read_file_at(AT_FDCWD, "/proc/self/comm", buf,
+                               sizeof(buf));
+    ssize_t short_len = read_file_at(AT_FDCWD, "/proc/self/comm", buf, 5);
+    char short_copy[8];
+    strcpy(short_copy, buf);
+    int ret = (int)read_file_at(AT_FDCWD, "/proc/999999/comm", buf,
+                                sizeof(buf));
+    int err = errno;
+    ASSERT_TRUE(len == 10 && short_len == 4 &&
+                strcmp(short_copy, "test") == 0 && ret == -1 &&
+                err == ENOENT && buf[0] == '\0');
+}
+
+/* read_lines_at() visitor counting newlines; stops after ctx[1] runs */
+static int count_lines(const char *text, size_t len, void *ctx)
+{
+    int *counts = ctx;
+    for (size_t i = 0; i < len; i++) {
+        counts[0] += (text[i] == '\n');
+    }
+    counts[2]++;
+    return counts[1] > 0 && counts[2] >= counts[1];
+}
+
+/* Test read_lines_at */
+void test_read_lines_at(void)
+{
+    TEST("read_lines_at carries partial lines and skips overlong ones");
+    char path[] = "/tmp/pinspect-lines-XXXXXX";
+    int fd = mkstemp(path);
+    bool written = false;
+    if (fd >= 0) {
+        /* 100 short lines, one 300-byte line, then a final unterminated one */
+        char text[2048];
+        size_t len = 0;
+        for (int i = 0; i < 100; i++) {
+            len += (size_t)snprintf(text + len, sizeof(text) - len,
+                                    "%d\n", i);
+        }
+        memset(text + len, 'x', 300);
+        len += 300;
+        text[len++] = '\n';
+        memcpy(text + len, "end", 3);
+        len += 3;
+        written = write(fd, text, len) == (ssize_t)len;
+        close(fd);
+    }
+
+    char buf[64];
+    int all[3] = { 0, 0, 0 };
+    int ret1 = read_lines_at(AT_FDCWD, path, buf, sizeof(buf), count_lines,
+                             all);
+    int stopped[3] = { 0, 1, 0 };
+    int ret2 = read_lines_at(AT_FDCWD, path, buf, sizeof(buf), count_lines,
+                             stopped);
+    int ret3 = read_lines_at(AT_FDCWD, path, buf, 0, count_lines, all);
+    unlink(path);
+
+    /* The long line's newline is dropped with it */
+    ASSERT_TRUE(written && ret1 == 0 && all[0] == 100 && ret2 == 0 &&
+                stopped[2] == 1 && stopped[0] < 100 && ret3 == -1 &&
+                errno == EINVAL);
+}
+
+/* Test timespec_add_sec / timespec_diff_sec */
+void test_timespec_helpers(void)
+{
+    TEST("timespec_add_sec carries nanoseconds and diff inverts it");
+    struct timespec start = { .tv_sec = 10, .tv_nsec = 900000000L };
+    struct timespec end = start;
+    timespec_add_sec(&end, 1.25);
+    double diff = timespec_diff_sec(&start, &end);
+    ASSERT_TRUE(end.tv_sec == 12 && end.tv_nsec == 150000000L &&
+                diff > 1.2499 && diff < 1.2501 &&
+                timespec_diff_sec(&end, &start) < 0);
+}
+
+/* Test parse_field_list */
+void test_parse_field_list(void)
+{
+    TEST("parse_field_list with names and all");
+    unsigned fields = 0;
+    int ret1 = parse_field_list("rss,fds,name,rss", &fields);
+    unsigned list = fields;
+    int ret2 = parse_field_list("all", &fields);
+    ASSERT_TRUE(ret1 == 0 && list == (FIELD_VM_RSS | FIELD_FDS | FIELD_NAME) &&
+                ret2 == 0 && fields == FIELDS_ALL);
+}
+
+void test_parse_field_list_invalid(void)
+{
+    TEST("parse_field_list with unknown and empty names");
+    unsigned fields = FIELD_NAME;
+    int ret1 = parse_field_list("rss,cpu", &fields);
+    int err1 = errno;
+    int ret2 = parse_field_list("rss,,fds", &fields);
+    int err2 = errno;
+    int ret3 = parse_field_list("", &fields);
+    int ret4 = parse_field_list(NULL, &fields);
+    ASSERT_TRUE(ret1 == -1 && err1 == EINVAL && ret2 == -1 && err2 == EINVAL &&
+                ret3 == -1 && ret4 == -1 && errno == EINVAL &&
+                fields == FIELD_NAME);
+}
+
+/* Test fnv1a64 against the published FNV-1a 64-bit vectors */
+void test_fnv1a64(void)
+{
+    TEST("fnv1a64 matches the reference vectors");
+    ASSERT_TRUE(fnv1a64("", 0) == 0xcbf29ce484222325ULL &&
+                fnv1a64("a", 1) == 0xaf63dc4c8601ec8cULL &&
+                fnv1a64("foobar", 6) == 0x85944171f73967e8ULL);
+}
+
 int main(void)
 {
     printf("\n=== Running Utility Function Tests ===\n\n");
@@ -256,6 +611,8 @@ int main(void)
     test_build_proc_path_without_file();
     test_build_proc_path_small_buffer();
 
+    test_proc_set_root();
+
     /* build_task_path tests */
     test_build_task_path_with_file();
     test_build_task_path_status();
@@ -277,6 +634,38 @@ int main(void)
     test_char_to_state_Z();
     test_char_to_state_invalid();
 
+    /* process name and PID list tests */
+    test_read_process_name_self();
+    test_read_process_name_nonexistent();
+    test_sort_unique_pids_duplicates();
+    test_sort_unique_pids_empty();
+    test_find_pids_by_name_child();
+    test_find_pids_by_name_no_match();
+    test_find_pids_by_name_null();
+
+    /* scan_numeric_dir tests */
+    test_scan_numeric_dir_filters();
+    test_scan_numeric_dir_early_stop();
+    test_scan_numeric_dir_errors();
+    test_read_dir_batch();
+
+    /* scan_decimal / read_file_at tests */
+    test_scan_decimal();
+    test_read_file_at();
+
+    /* read_lines_at tests */
+    test_read_lines_at();
+
+    /* timespec helper tests */
+    test_timespec_helpers();
+
+    /* parse_field_list tests */
+    test_parse_field_list();
+    test_parse_field_list_invalid();
+
+    /* fnv1a64 tests */
+    test_fnv1a64();
+
     printf("\n=== Test Results ===\n");
     printf("Passed: %d\n", tests_passed);
     printf("Failed: %d\n", tests_failed);
@@ -0,0 +1,334 @@
+/*
+ * test_watch.c - Unit tests for watch mode delta sampling
+ *
+ * Tests watch_sample(), watch_run() and watch_free() by sampling the test
+ * process itself while opening and closing descriptors between samples
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "../include/watch.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_EQ(actual, expected) \
+    do { \
+        if ((actual) == (expected)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (expected %d, got %d)\n", TEST_FAIL, \
+                   (int)(expected), (int)(actual)); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+/*
+ * High descriptor number so the sampler's own /proc/self/fd handle, which
+ * takes the lowest free slot, never lands on the descriptor under test.
+ */
+#define TEST_FD 100
+
+/*
+ * Open path at TEST_FD. Returns TEST_FD on success, -1 on error.
+ */
+static int open_test_fd(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int high = dup2(fd, TEST_FD);
+    close(fd);
+    return high;
+}
+
+/*
+ * Run one watch_sample() into a memory stream.
+ * Returns the sample result; *text receives the output (caller frees).
+ */
+static int sample_to_string(watch_state_t *state, char **text)
+{
+    size_t len = 0;
+    FILE *out = open_memstream(text, &len);
+    if (out == NULL) {
+        *text = NULL;
+        return -1;
+    }
+    int ret = watch_sample(state, out);
+    fclose(out);
+    return ret;
+}
+
+/* Test watch_sample */
+void test_watch_sample_baseline(void)
+{
+    TEST("watch_sample prints baseline on first sample");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    char *text = NULL;
+    int ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(ret == 0 && state.primed && state.fds.count >= 3 &&
+                text != NULL && strstr(text, "baseline:") != NULL);
+
+    free(text);
+    watch_free(&state);
+}
+
+void test_watch_sample_no_change(void)
+{
+    TEST("watch_sample reports nothing when nothing changed");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    char *text = NULL;
+    sample_to_string(&state, &text);
+    free(text);
+
+    int ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(ret == 0 && text != NULL && text[0] == '\0');
+
+    free(text);
+    watch_free(&state);
+}
+
+void test_watch_sample_fd_opened(void)
+{
+    TEST("watch_sample reports opened FD");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    char *text = NULL;
+    sample_to_string(&state, &text);
+    free(text);
+
+    int fd = open_test_fd("/dev/null");
+    int ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(fd >= 0 && ret == 1 && text != NULL &&
+                strstr(text, "+fd") != NULL &&
+                strstr(text, "/dev/null") != NULL);
+
+    free(text);
+    if (fd >= 0) {
+        close(fd);
+    }
+    watch_free(&state);
+}
+
+void test_watch_sample_fd_closed(void)
+{
+    TEST("watch_sample reports closed FD");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    int fd = open_test_fd("/dev/null");
+    char *text = NULL;
+    sample_to_string(&state, &text);
+    free(text);
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    int ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(fd >= 0 && ret == 1 && text != NULL &&
+                strstr(text, "-fd") != NULL);
+
+    free(text);
+    watch_free(&state);
+}
+
+void test_watch_sample_fd_retargeted(void)
+{
+    TEST("watch_sample reports FD number reused for another file");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    int fd = open_test_fd("/dev/null");
+    char *text = NULL;
+    sample_to_string(&state, &text);
+    free(text);
+
+    /* Same descriptor number, different target */
+    if (fd >= 0) {
+        fd = open_test_fd("/dev/zero");
+    }
+    int ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(fd >= 0 && ret == 1 && text != NULL &&
+                strstr(text, "~fd") != NULL &&
+                strstr(text, "/dev/zero") != NULL);
+
+    free(text);
+    if (fd >= 0) {
+        close(fd);
+    }
+    watch_free(&state);
+}
+
+void test_watch_sample_nonexistent(void)
+{
+    TEST("watch_init with non-existent PID (ENOENT)");
+    watch_state_t state;
+    int ret = watch_init(&state, 999999, false);
+    int init_errno = errno;
+
+    /* Sampling a state whose handle failed to open must fail cleanly */
+    char *text = NULL;
+    int sample_ret = sample_to_string(&state, &text);
+    ASSERT_TRUE(ret == -1 && init_errno == ENOENT && sample_ret == -1 &&
+                !state.primed);
+
+    free(text);
+    watch_free(&state);
+}
+
+/* Test watch_run */
+void test_watch_run_max_samples(void)
+{
+    TEST("watch_run stops after max_samples");
+    watch_options_t opts = { .interval_sec = 0.01, .network_only = true,
+                             .max_samples = 3 };
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+
+    int ret = (out != NULL) ? watch_run(getpid(), &opts, out) : -1;
+    if (out != NULL) {
+        fclose(out);
+    }
+    ASSERT_TRUE(ret == 0 && text != NULL &&
+                strstr(text, "baseline:") != NULL);
+
+    free(text);
+}
+
+void test_watch_run_bad_interval(void)
+{
+    TEST("watch_run rejects non-positive interval (EINVAL)");
+    watch_options_t opts = { .interval_sec = 0, .network_only = false,
+                             .max_samples = 1 };
+    int ret = watch_run(getpid(), &opts, stdout);
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+void test_watch_run_process_exit(void)
+{
+    TEST("watch_run returns 0 when process is gone");
+    watch_options_t opts = { .interval_sec = 0.01, .network_only = false,
+                             .max_samples = 0 };
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+
+    int ret = (out != NULL) ? watch_run(999999, &opts, out) : -1;
+    if (out != NULL) {
+        fclose(out);
+    }
+    ASSERT_TRUE(ret == 0 && text != NULL && strstr(text, "exited") != NULL);
+
+    free(text);
+}
+
+void test_watch_run_child_exit(void)
+{
+    TEST("watch_run stops when child exits, before it is reaped");
+    pid_t child = fork();
+    if (child == 0) {
+        struct timespec delay = { .tv_sec = 0, .tv_nsec = 50000000 };
+        nanosleep(&delay, NULL);
+        _exit(0);
+    }
+
+    watch_options_t opts = { .interval_sec = 0.01, .network_only = true,
+                             .max_samples = 0 };
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+
+    /* The child stays a zombie until waitpid(), so /proc/<pid> remains */
+    int ret = (child > 0 && out != NULL) ? watch_run(child, &opts, out) : -1;
+    if (out != NULL) {
+        fclose(out);
+    }
+    if (child > 0) {
+        waitpid(child, NULL, 0);
+    }
+    ASSERT_TRUE(ret == 0 && text != NULL && strstr(text, "exited") != NULL);
+
+    free(text);
+}
+
+/* Test watch_free */
+void test_watch_free_twice(void)
+{
+    TEST("watch_free is safe to call twice and with NULL");
+    watch_state_t state;
+    watch_init(&state, getpid(), false);
+
+    char *text = NULL;
+    sample_to_string(&state, &text);
+    free(text);
+
+    watch_free(&state);
+    watch_free(&state);
+    watch_free(NULL);
+    ASSERT_EQ(state.fds.count, 0);
+}
+
+int main(void)
+{
+    printf("\n=== Running Watch Mode Tests ===\n\n");
+
+    /* watch_sample tests */
+    test_watch_sample_baseline();
+    test_watch_sample_no_change();
+    test_watch_sample_fd_opened();
+    test_watch_sample_fd_closed();
+    test_watch_sample_fd_retargeted();
+    test_watch_sample_nonexistent();
+
+    /* watch_run tests */
+    test_watch_run_max_samples();
+    test_watch_run_bad_interval();
+    test_watch_run_process_exit();
+    test_watch_run_child_exit();
+
+    /* watch_free tests */
+    test_watch_free_twice();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}
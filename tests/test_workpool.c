@@ -0,0 +1,180 @@
+/*
+ * test_workpool.c - Unit tests for the pthread worker pool
+ *
+ * Tests workpool_init(), workpool_run() and workpool_destroy()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../include/workpool.h"
+
+#define TEST_PASS "\033[32m[PASS]\033[0m"
+#define TEST_FAIL "\033[31m[FAIL]\033[0m"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Testing %s... ", name); \
+        fflush(stdout); \
+    } while(0)
+
+#define ASSERT_EQ(actual, expected) \
+    do { \
+        if ((actual) == (expected)) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (expected %d, got %d)\n", TEST_FAIL, \
+                   (int)(expected), (int)(actual)); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(condition) \
+    do { \
+        if (condition) { \
+            printf("%s\n", TEST_PASS); \
+            tests_passed++; \
+        } else { \
+            printf("%s (condition was false)\n", TEST_FAIL); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define ITEMS 10000
+
+/* Each index bumps its own slot; any slot != 1 means lost or repeated work */
+static void mark_index(void *ctx, size_t index)
+{
+    int *hits = ctx;
+    hits[index]++;
+}
+
+static bool all_hit_once(const int *hits, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (hits[i] != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Test workpool_run */
+void test_workpool_inline(void)
+{
+    TEST("workpool_run with size 1 (inline)");
+    static int hits[ITEMS];
+    memset(hits, 0, sizeof(hits));
+
+    workpool_t pool;
+    int ret = workpool_init(&pool, 1);
+    if (ret == 0) {
+        ret = workpool_run(&pool, ITEMS, mark_index, hits);
+        workpool_destroy(&pool);
+    }
+    ASSERT_TRUE(ret == 0 && all_hit_once(hits, ITEMS));
+}
+
+void test_workpool_threads(void)
+{
+    TEST("workpool_run with 4 threads runs every index once");
+    static int hits[ITEMS];
+    memset(hits, 0, sizeof(hits));
+
+    workpool_t pool;
+    int ret = workpool_init(&pool, 4);
+    if (ret == 0) {
+        ret = workpool_run(&pool, ITEMS, mark_index, hits);
+        workpool_destroy(&pool);
+    }
+    ASSERT_TRUE(ret == 0 && all_hit_once(hits, ITEMS));
+}
+
+void test_workpool_reuse(void)
+{
+    TEST("workpool_run reused across many batches");
+    static int hits[64];
+    workpool_t pool;
+    bool ok = workpool_init(&pool, 3) == 0;
+
+    for (int round = 0; ok && round < 200; round++) {
+        memset(hits, 0, sizeof(hits));
+        size_t count = (size_t)(round % 64) + 1;
+        ok = workpool_run(&pool, count, mark_index, hits) == 0 &&
+             all_hit_once(hits, count) && (count == 64 || hits[count] == 0);
+    }
+    workpool_destroy(&pool);
+    ASSERT_TRUE(ok);
+}
+
+void test_workpool_empty(void)
+{
+    TEST("workpool_run with zero items");
+    workpool_t pool;
+    int ret = workpool_init(&pool, 2);
+    if (ret == 0) {
+        ret = workpool_run(&pool, 0, mark_index, NULL);
+        workpool_destroy(&pool);
+    }
+    ASSERT_EQ(ret, 0);
+}
+
+void test_workpool_null_fn(void)
+{
+    TEST("workpool_run with NULL function (EINVAL)");
+    workpool_t pool;
+    int ret = -1;
+    if (workpool_init(&pool, 2) == 0) {
+        ret = workpool_run(&pool, 10, NULL, NULL);
+        workpool_destroy(&pool);
+    }
+    ASSERT_TRUE(ret == -1 && errno == EINVAL);
+}
+
+/* Test workpool_init / workpool_destroy */
+void test_workpool_default_size(void)
+{
+    TEST("workpool_init with size 0 uses CPU count");
+    workpool_t pool;
+    int ret = workpool_init(&pool, 0);
+    int size = pool.size;
+    if (ret == 0) {
+        workpool_destroy(&pool);
+    }
+    ASSERT_TRUE(ret == 0 && size == workpool_default_size() && size >= 1);
+}
+
+void test_workpool_destroy_null(void)
+{
+    TEST("workpool_destroy with NULL");
+    workpool_destroy(NULL);
+    ASSERT_TRUE(1);
+}
+
+int main(void)
+{
+    printf("\n=== Running Worker Pool Tests ===\n\n");
+
+    /* workpool_run tests */
+    test_workpool_inline();
+    test_workpool_threads();
+    test_workpool_reuse();
+    test_workpool_empty();
+    test_workpool_null_fn();
+
+    /* workpool_init / workpool_destroy tests */
+    test_workpool_default_size();
+    test_workpool_destroy_null();
+
+    printf("\n=== Test Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed == 0 ? 0 : 1;
+}